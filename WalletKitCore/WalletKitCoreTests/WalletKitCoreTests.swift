@@ -169,6 +169,10 @@ final class WalletKitCoreTests: XCTestCase {
         runEventTests ()
     }
 
+    func XtestEventQueuePerformanceETH () {
+        runEventQueuePerfTests (16, 100_000)
+    }
+
     func testBaseETH () {
         runBaseTests()
     }
@@ -235,6 +239,22 @@ final class WalletKitCoreTests: XCTestCase {
         XCTAssert(1 == BRRunTestsBWM (paperKey, storagePath, bitcoinChain, (isMainnet ? 1 : 0)));
     }
 
+    func XtestBitcoinWalletPerformance () {
+        BRRunPerfTestsWallet (50_000)
+    }
+
+    func XtestBitcoinWalletRestorePerformance () {
+        BRRunPerfTestsWalletRestore (10_000)
+    }
+
+    func XtestBitcoinTransactionSignPerformance () {
+        BRRunPerfTestsTransactionSign (4_096, 8)
+    }
+
+    func XtestBitcoinHeadersPerformance () {
+        BRRunPerfTestsHeaders (200_000)
+    }
+
     func testBitcoinSyncOne() {
         BRRunTestsSync (paperKey, bitcoinChain, (isMainnet ? 1 : 0));
     }
@@ -41,6 +41,8 @@
 
 #include "bitcoin/BRBloomFilter.h"
 #include "bitcoin/BRMerkleBlock.h"
+#include "bitcoin/BRHeaderStore.h"
+#include "bitcoin/BRCompactFilter.h"
 #include "bitcoin/BRWallet.h"
 #include "bitcoin/BRBIP38Key.h"
 #include "bitcoin/BRPeer.h"
@@ -58,8 +60,12 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <time.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
 #include <pthread.h>
 
 #define SKIP_BIP38 1
@@ -358,6 +364,42 @@ int BRBase58Tests()
     if (l5 != 21 || memcmp(s, b5, l5) != 0)
         r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58CheckDecode() test 5\n", __func__);
 
+    // round trip lengths that leave partial limbs, with and without leading zeroes
+    
+    uint8_t data[300], b6[300];
+    char s6[420];
+    
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i*37 + 11);
+    
+    for (size_t len = 0; len <= sizeof(data); len += 23) {
+        data[0] = data[1] = (len % 2) ? 0 : 0x80;
+        size_t l6 = BRBase58Encode(s6, sizeof(s6), data, len);
+        
+        if (l6 != BRBase58Encode(NULL, 0, data, len) || BRBase58Encode(s6, l6 - 1, data, len) != 0 ||
+            BRBase58Decode(b6, sizeof(b6), s6) != len || memcmp(data, b6, len) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58Decode() test 7, %zu\n", __func__, len);
+    }
+    
+    if (BRBase58CheckEncodePublic(s6, sizeof(s6), (uint8_t *)s, 21) != strlen(s5) + 1 || strcmp(s6, s5) != 0 ||
+        BRBase58CheckDecodePublic(b6, sizeof(b6), s6) != 21 || memcmp(s, b6, 21) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58CheckEncodePublic() test\n", __func__);
+
+    // batches match single encodings
+    
+    char strs[9*40], s7[40];
+    
+    if (BRBase58CheckEncodeBatch(strs, 40, data, 21, 30, 9) != 9)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58CheckEncodeBatch() test 1\n", __func__);
+    
+    for (size_t i = 0; i < 9; i++) {
+        BRBase58CheckEncode(s7, sizeof(s7), &data[i*30], 21);
+        if (strcmp(s7, &strs[i*40]) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58CheckEncodeBatch() test 2, %zu\n", __func__, i);
+    }
+    
+    if (BRBase58CheckEncodeBatch(strs, 20, data, 21, 30, 9) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRBase58CheckEncodeBatch() test 3\n", __func__);
+
     return r;
 }
 
@@ -557,6 +599,25 @@ int BRHashTests()
                     "\x14\x7c\x4e\x72\xb9\x80\x77\x85\xaf\xee\x48\xbb", *(UInt256 *)md))
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256() test 6", __func__);
 
+    // test double-sha256 batches against single messages, covering full multi-buffer groups, remainders, and
+    // messages that pad into one or two blocks
+    
+    uint8_t batchData[19*130], batchMd[19*32];
+    
+    for (size_t i = 0; i < sizeof(batchData); i++) batchData[i] = (uint8_t)(i*131 + 7);
+    
+    for (size_t len = 0; len <= 130; len += 5) {
+        for (size_t count = 0; count <= 19; count += 3) {
+            BRSHA256_2Batch(batchMd, batchData, len, 130, count);
+            
+            for (size_t i = 0; i < count; i++) {
+                BRSHA256_2(md, &batchData[i*130], len);
+                if (! UInt256Eq(*(UInt256 *)md, *(UInt256 *)&batchMd[i*32]))
+                    r = 0, fprintf(stderr, "\n***FAILED*** %s: BRSHA256_2Batch() test %zu, %zu", __func__, len, count);
+            }
+        }
+    }
+
     // test sha512
     
     s = "Free online SHA512 Calculator, type text here...";
@@ -702,6 +763,32 @@ int BRHashTests()
                     "\x82\x27\x3b\x7b\xfa\xd8\x04\x5d\x85\xa4\x70", *(UInt256 *)md))
         r = 0, fprintf(stderr, "***FAILED*** %s: Keccak-256() test 1\n", __func__);
 
+    // test keccak-256 batches against single messages, with lanes of differing block counts sharing a group
+    
+    const void *keccakDatas[11];
+    size_t keccakLens[11];
+    
+    for (size_t i = 0; i < 11; i++) keccakDatas[i] = &batchData[i*97], keccakLens[i] = (i*i*37) % 420;
+    
+    for (size_t count = 0; count <= 11; count++) {
+        BRKeccak256Batch(batchMd, keccakDatas, keccakLens, count);
+        
+        for (size_t i = 0; i < count; i++) {
+            BRKeccak256(md, keccakDatas[i], keccakLens[i]);
+            if (! UInt256Eq(*(UInt256 *)md, *(UInt256 *)&batchMd[i*32]))
+                r = 0, fprintf(stderr, "***FAILED*** %s: BRKeccak256Batch() test %zu, %zu\n", __func__, i, count);
+        }
+    }
+
+    // test keccak-512
+
+    s = "";
+    BRKeccak512(md, s, strlen(s));
+    if (memcmp("\x0e\xab\x42\xde\x4c\x3c\xeb\x92\x35\xfc\x91\xac\xff\xe7\x46\xb2\x9c\x29\xa8\xc3\x66\xb7\xc6\x0e\x4e\x67"
+               "\xc4\x66\xf3\x6a\x43\x04\xc0\x0f\xa9\xca\xf9\xd8\x79\x76\xba\x46\x9b\xcb\xe0\x67\x13\xb4\x35\xf0\x91\xef"
+               "\x27\x69\xfb\x16\x0c\xda\xb3\x3d\x36\x70\x68\x0e", md, 64) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: Keccak-512() test 1\n", __func__);
+
     // test murmurHash3-x86_32
     
     if (BRMurmur3_32("", 0, 0) != 0)
@@ -1239,6 +1326,40 @@ int BRAesTests()
     BRAESCTR(buf, &key3, 32, iv, in3, 64);
     if (memcmp(buf, plain, 64) != 0) r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESCTR() test 3", __func__);
     
+    BRAESKey aesKey;
+    uint8_t ctr[16], long1[300], long2[300], long3[300];
+    
+    BRAESKeyInit(&aesKey, &key3, 32);
+    memcpy(buf, plain, 16);
+    BRAESKeyECBEncrypt(&aesKey, buf);
+    if (memcmp(buf, cipher3, 16) != 0) r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESKeyECBEncrypt() test", __func__);
+
+    BRAESKeyECBDecrypt(&aesKey, buf);
+    if (memcmp(buf, plain, 16) != 0) r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESKeyECBDecrypt() test", __func__);
+
+    memcpy(ctr, iv, 16);
+    BRAESKeyCTR(&aesKey, buf, ctr, in3, 16); // key stream continues across calls
+    BRAESKeyCTR(&aesKey, &buf[16], ctr, &in3[16], 48);
+    if (memcmp(buf, plain, 64) != 0) r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESKeyCTR() test 1", __func__);
+    
+    for (size_t i = 0; i < sizeof(long1); i++) long1[i] = (uint8_t)(i*7);
+    memset(ctr, 0xff, 16); // counter overflow
+    BRAESKeyCTR(&aesKey, long2, ctr, long1, sizeof(long1));
+    memset(ctr, 0xff, 16);
+    
+    for (size_t i = 0; i < sizeof(long1); i += 16) {
+        BRAESKeyCTR(&aesKey, &long3[i], ctr, &long1[i], (i + 16 < sizeof(long1)) ? 16 : sizeof(long1) - i);
+    }
+    
+    if (memcmp(long2, long3, sizeof(long2)) != 0)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESKeyCTR() test 2", __func__);
+    
+    memset(ctr, 0xff, 16);
+    BRAESKeyCTR(&aesKey, long3, ctr, long2, sizeof(long2));
+    if (memcmp(long1, long3, sizeof(long1)) != 0)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAESKeyCTR() test 3", __func__);
+    BRAESKeyClean(&aesKey);
+    
     if (! r) fprintf(stderr, "\n                                    ");
     return r;
 }
@@ -1889,6 +2010,30 @@ int BRAddressTests()
     if (! BRAddressEq(&addr7, &addr8))
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAddressFromWitness() test 2", __func__);
 
+    UInt160 hashes[7];
+    BRAddress addrs[7], addr9;
+    BRAddressParams legacyParams = BRMainNetParams->addrParams;
+    
+    legacyParams.bech32Prefix = NULL;
+    for (size_t i = 0; i < 7; i++) hashes[i] = BRKeyHash160(&k), hashes[i].u8[i] ^= 0x5a;
+    
+    if (BRAddressesFromHash160s(addrs, legacyParams, hashes, 7) != 7 ||
+        BRAddressesFromHash160s(addrs, BRMainNetParams->addrParams, hashes, 7) != 7)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAddressesFromHash160s() test 1", __func__);
+    
+    for (size_t i = 0; i < 7; i++) {
+        BRAddressFromHash160(addr9.s, sizeof(addr9), BRMainNetParams->addrParams, &hashes[i]);
+        if (! BRAddressEq(&addrs[i], &addr9))
+            r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAddressesFromHash160s() test 2", __func__);
+    }
+    
+    BRAddressesFromHash160s(addrs, legacyParams, hashes, 7);
+    for (size_t i = 0; i < 7; i++) {
+        BRAddressFromHash160(addr9.s, sizeof(addr9), legacyParams, &hashes[i]);
+        if (! BRAddressEq(&addrs[i], &addr9))
+            r = 0, fprintf(stderr, "\n***FAILED*** %s: BRAddressesFromHash160s() test 3", __func__);
+    }
+
     if (! r) fprintf(stderr, "\n                                    ");
     return r;
 }
@@ -2079,6 +2224,17 @@ int BRBIP32SequenceTests()
                     uint256("7b6a7dd645507d775215a9035be06700e1ed8c541da9351b4bd14bd50ab61428")))
         r = 0, fprintf(stderr, "***FAILED*** %s: BRBIP32PubKey() test\n", __func__);
 
+    BRChainPubKey cpk = BRBIP32ChainPubKey(mpk, SEQUENCE_INTERNAL_CHAIN);
+    BRECPoint pubKeys[20];
+
+    BRBIP32ChainPubKeyList(pubKeys, 20, cpk, 0);
+
+    for (uint32_t i = 0; i < 20; i++) {
+        BRBIP32PubKey(pubKey, sizeof(pubKey), mpk, SEQUENCE_INTERNAL_CHAIN, i);
+        if (memcmp(pubKey, pubKeys[i].p, sizeof(pubKey)) != 0)
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRBIP32ChainPubKeyList() test %"PRIu32"\n", __func__, i);
+    }
+
     UInt512 dk;
     BRAddress addr;
 
@@ -2299,6 +2455,27 @@ int BRTransactionTests()
     if (len6 != len7 || memcmp(buf6, buf7, len6) != 0)
         r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSerialize() test 3", __func__);
     BRTransactionFree(tx);
+
+    // threaded signing, with enough inputs to use several threads, is identical to serial signing
+    BRTransaction *stx = BRTransactionNew(), *ttx;
+
+    for (size_t i = 0; i < 48; i++) {
+        if (i % 2) BRTransactionAddInput(stx, inHash, (uint32_t)i, 1, wscript, wscriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+        else BRTransactionAddInput(stx, inHash, (uint32_t)i, 1, script, scriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+    }
+
+    BRTransactionAddOutput(stx, 1000000, script, scriptLen);
+    ttx = BRTransactionCopy(stx);
+    BRTransactionSign(stx, 0, k, 2);
+    BRTransactionSignWithThreads(ttx, 0, k, 2, 4);
+
+    uint8_t sbuf[BRTransactionSerialize(stx, NULL, 0)], tbuf[BRTransactionSerialize(ttx, NULL, 0)];
+    size_t slen = BRTransactionSerialize(stx, sbuf, sizeof(sbuf)), tlen = BRTransactionSerialize(ttx, tbuf, sizeof(tbuf));
+
+    if (! BRTransactionIsSigned(ttx) || slen != tlen || memcmp(sbuf, tbuf, slen) != 0)
+        r = 0, fprintf(stderr, "\n***FAILED*** %s: BRTransactionSignWithThreads() test", __func__);
+    BRTransactionFree(ttx);
+    BRTransactionFree(stx);
     
     tx = BRTransactionNew();
     BRTransactionAddInput(tx, uint256("fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f"), 0, 625000000,
@@ -2495,6 +2672,10 @@ int BRWalletTests()
     if (BRWalletBalance(w) != SATOSHIS*2)
         r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletUpdateTransactions() test\n", __func__);
 
+    BRWalletRebuildBalance(w); // tx is now confirmed, so it sorts ahead of the unconfirmed first tx
+    if (BRWalletBalance(w) != SATOSHIS*2 || BRWalletBalanceAfterTx(w, tx) != SATOSHIS || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletRebuildBalance() test\n", __func__);
+
     BRWalletFree(w);
     tx = BRTransactionNew();
     BRTransactionAddInput(tx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
@@ -2507,7 +2688,57 @@ int BRWalletTests()
 
     if (BRWalletAllAddrs(w, NULL, 0) != SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED + SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED + 1)
         r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletAllAddrs() test\n", __func__);
-    
+
+    BRWallet *w1 = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk),
+             *w2 = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+    size_t addrsCount = 500 + SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED;
+    BRAddress *addrs1 = calloc(addrsCount, sizeof(*addrs1)), *addrs2 = calloc(addrsCount, sizeof(*addrs2));
+
+    BRWalletUnusedAddrs(w1, NULL, 500, SEQUENCE_EXTERNAL_CHAIN);
+    if (BRWalletGenerateAddrs(w2, 500, SEQUENCE_EXTERNAL_CHAIN, 4) != 500 - SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletGenerateAddrs() test 1\n", __func__);
+
+    if (BRWalletAllAddrs(w1, addrs1, addrsCount) != addrsCount ||
+        BRWalletAllAddrs(w2, addrs2, addrsCount) != addrsCount ||
+        memcmp(addrs1, addrs2, addrsCount*sizeof(*addrs1)) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletGenerateAddrs() test 2\n", __func__);
+
+    BRWalletFree(w1);
+    BRWalletFree(w2);
+
+    // restore a wallet whose used external addresses run deeper than the initial gap, serially and with threads
+    BRTransaction *rtx = BRTransactionNew();
+
+    BRTransactionAddInput(rtx, inHash, 0, 1, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+
+    for (uint32_t i = 90; i <= 360; i += 90) {
+        uint8_t pubKey[33], script[25];
+        BRKey rk;
+        BRAddress raddr;
+
+        BRBIP32PubKey(pubKey, sizeof(pubKey), mpk, SEQUENCE_EXTERNAL_CHAIN, i);
+        BRKeySetPubKey(&rk, pubKey, sizeof(pubKey));
+        BRKeyLegacyAddr(&rk, raddr.s, sizeof(raddr), BRMainNetParams->addrParams);
+        BRTransactionAddOutput(rtx, SATOSHIS, script,
+                               BRAddressScriptPubKey(script, sizeof(script), BRMainNetParams->addrParams, raddr.s));
+    }
+
+    BRTransactionSign(rtx, 0, &k, 1);
+    w1 = BRWalletNew(BRMainNetParams->addrParams, &rtx, 1, mpk);
+    rtx = BRTransactionCopy(rtx);
+    w2 = BRWalletNewWithThreads(BRMainNetParams->addrParams, &rtx, 1, mpk, 4);
+    addrsCount = 361 + SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED + SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED;
+
+    if (! w1 || ! w2 || BRWalletAllAddrs(w1, addrs1, addrsCount) != addrsCount ||
+        BRWalletAllAddrs(w2, addrs2, addrsCount) != addrsCount ||
+        memcmp(addrs1, addrs2, addrsCount*sizeof(*addrs1)) != 0 || BRWalletBalance(w2) != SATOSHIS*4)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletNewWithThreads() test\n", __func__);
+
+    free(addrs1);
+    free(addrs2);
+    if (w1) BRWalletFree(w1);
+    if (w2) BRWalletFree(w2);
+
     UInt256 hash = tx->txHash;
 
     tx = BRWalletCreateTransaction(w, SATOSHIS*2, addr.s);
@@ -2600,6 +2831,324 @@ int BRWalletTests()
     return r;
 }
 
+static void walletBalanceTestChanged(void *info, uint64_t balance)
+{
+    (*(size_t *)info)++;
+}
+
+// signed tx spending inHash:n with the given outputs, confirmed at blockHeight (TX_UNCONFIRMED if not confirmed)
+// the inputs are signed with k regardless of the output they spend, which is all the wallet needs to register them
+static BRTransaction *walletBalanceTestTx(BRKey *k, const uint8_t *inScript, size_t inScriptLen, UInt256 inHash,
+                                          uint32_t n, const BRTxOutput outputs[], size_t outCount, uint32_t blockHeight)
+{
+    BRTransaction *tx = BRTransactionNew();
+
+    BRTransactionAddInput(tx, inHash, n, SATOSHIS, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+
+    for (size_t i = 0; i < outCount; i++) {
+        BRTransactionAddOutput(tx, outputs[i].amount, outputs[i].script, outputs[i].scriptLen);
+    }
+
+    tx->blockHeight = blockHeight;
+    tx->timestamp = (blockHeight == TX_UNCONFIRMED) ? 0 : blockHeight;
+    BRTransactionSign(tx, 0, k, 1);
+    return tx;
+}
+
+// compares the incrementally maintained balance, balance history, UTXO set, and invalid and pending transactions
+// against a full recompute after every kind of change to the wallet's transactions
+int BRWalletBalanceTests()
+{
+    int r = 1;
+    const char *phrase = "a random seed";
+    UInt512 seed;
+    UInt256 secret = uint256("0000000000000000000000000000000000000000000000000000000000000001"),
+            inHash = uint256("0000000000000000000000000000000000000000000000000000000000000001");
+    BRKey k;
+    BRAddress addr, recvAddr, changeAddr, deepAddr;
+    BRTransaction *a, *b, *c, *d, *e;
+    uint8_t pubKey[33];
+    size_t changes = 0;
+
+    BRBIP39DeriveKey(&seed, phrase, NULL);
+    BRMasterPubKey mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+    BRWallet *w = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+
+    BRWalletSetCallbacks(w, &changes, walletBalanceTestChanged, NULL, NULL, NULL);
+    BRKeySetSecret(&k, &secret, 1);
+    BRKeyAddress(&k, addr.s, sizeof(addr), BRMainNetParams->addrParams);
+    recvAddr = BRWalletReceiveAddress(w);
+    BRWalletUnusedAddrs(w, &changeAddr, 1, SEQUENCE_INTERNAL_CHAIN);
+    BRBIP32PubKey(pubKey, sizeof(pubKey), mpk, SEQUENCE_EXTERNAL_CHAIN, 200); // past the generated addresses
+    BRKeySetPubKey(&k, pubKey, sizeof(pubKey));
+    BRKeyLegacyAddr(&k, deepAddr.s, sizeof(deepAddr), BRMainNetParams->addrParams);
+    BRKeySetSecret(&k, &secret, 1);
+
+    uint8_t inScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, addr.s)];
+    size_t inScriptLen = BRAddressScriptPubKey(inScript, sizeof(inScript), BRMainNetParams->addrParams, addr.s);
+    uint8_t outScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, recvAddr.s)];
+    size_t outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), BRMainNetParams->addrParams, recvAddr.s);
+    uint8_t changeScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, changeAddr.s)];
+    size_t changeScriptLen = BRAddressScriptPubKey(changeScript, sizeof(changeScript), BRMainNetParams->addrParams,
+                                                   changeAddr.s);
+    uint8_t deepScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, deepAddr.s)];
+    size_t deepScriptLen = BRAddressScriptPubKey(deepScript, sizeof(deepScript), BRMainNetParams->addrParams,
+                                                 deepAddr.s);
+    BRTxOutput receive[] = { { SATOSHIS, outScript, outScriptLen } },
+               spend[] = { { SATOSHIS/2, inScript, inScriptLen }, { SATOSHIS/4, changeScript, changeScriptLen } },
+               deep[] = { { SATOSHIS, outScript, outScriptLen }, { SATOSHIS, deepScript, deepScriptLen } };
+
+    // a spends an outside input, b spends a, and c double spends a
+    a = walletBalanceTestTx(&k, inScript, inScriptLen, inHash, 0, receive, 1, TX_UNCONFIRMED);
+    b = walletBalanceTestTx(&k, inScript, inScriptLen, a->txHash, 0, spend, 2, TX_UNCONFIRMED);
+    c = walletBalanceTestTx(&k, inScript, inScriptLen, a->txHash, 0, spend, 1, TX_UNCONFIRMED);
+
+    BRWalletRegisterTransaction(w, b); // the spend arrives before its input
+    if (BRWalletBalance(w) != SATOSHIS/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: spend before input test 1\n", __func__);
+
+    BRWalletRegisterTransaction(w, a);
+    if (BRWalletBalance(w) != SATOSHIS/4 || BRWalletBalanceAfterTx(w, a) != SATOSHIS || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: spend before input test 2\n", __func__);
+
+    BRWalletRegisterTransaction(w, c);
+    if (BRWalletBalance(w) != SATOSHIS/4 || BRWalletTransactionIsValid(w, c) || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: double spend test\n", __func__);
+
+    BRWalletUpdateTransactions(w, &a->txHash, 1, 100, 100);
+    BRWalletUpdateTransactions(w, &b->txHash, 1, 101, 101);
+    if (BRWalletBalance(w) != SATOSHIS/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletUpdateTransactions() test 1\n", __func__);
+
+    BRWalletUpdateTransactions(w, &b->txHash, 1, 50, 50); // reorder the spend ahead of its input
+    if (BRWalletBalance(w) != SATOSHIS/4 || BRWalletBalanceAfterTx(w, b) != SATOSHIS/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletUpdateTransactions() test 2\n", __func__);
+
+    BRWalletSetTxUnconfirmedAfter(w, 60); // a becomes unconfirmed, b stays confirmed
+    if (BRWalletBalance(w) != SATOSHIS/4 || a->blockHeight != TX_UNCONFIRMED || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletSetTxUnconfirmedAfter() test 1\n", __func__);
+
+    BRWalletSetTxUnconfirmedAfter(w, 0);
+    if (BRWalletBalance(w) != SATOSHIS/4 || b->blockHeight != TX_UNCONFIRMED || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletSetTxUnconfirmedAfter() test 2\n", __func__);
+
+    // d has a future lockTime, so it and e, which spends it, are pending
+    d = BRTransactionNew();
+    BRTransactionAddInput(d, inHash, 1, SATOSHIS, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE - 1);
+    BRTransactionAddOutput(d, SATOSHIS, outScript, outScriptLen);
+    d->lockTime = 1000;
+    BRTransactionSign(d, 0, &k, 1);
+    e = walletBalanceTestTx(&k, inScript, inScriptLen, d->txHash, 0, spend, 2, TX_UNCONFIRMED);
+    BRWalletRegisterTransaction(w, d);
+    BRWalletRegisterTransaction(w, e);
+    if (BRWalletBalance(w) != SATOSHIS/4 || ! BRWalletTransactionIsPending(w, e) || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: pending tx test 1\n", __func__);
+
+    BRWalletUpdateTransactions(w, &d->txHash, 1, 1000, 1000);
+    if (BRWalletBalance(w) != SATOSHIS/2 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: pending tx test 2\n", __func__);
+
+    BRWalletRemoveTransaction(w, a->txHash); // removes a along with b and c, which depend on it
+    if (BRWalletTransactions(w, NULL, 0) != 2 || BRWalletBalance(w) != SATOSHIS/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletRemoveTransaction() test\n", __func__);
+
+    // a tx paying to an address that hasn't been generated yet only counts once the address is generated
+    a = walletBalanceTestTx(&k, inScript, inScriptLen, inHash, 2, deep, 2, 2000);
+    BRWalletRegisterTransaction(w, a);
+    if (BRWalletBalance(w) != SATOSHIS*5/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletUnusedAddrs() test 1\n", __func__);
+
+    changes = 0;
+    BRWalletUnusedAddrs(w, NULL, 250, SEQUENCE_EXTERNAL_CHAIN);
+    if (BRWalletBalance(w) != SATOSHIS*9/4 || changes != 1 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletUnusedAddrs() test 2\n", __func__);
+
+    BRWalletRebuildBalance(w);
+    if (BRWalletBalance(w) != SATOSHIS*9/4 || ! BRWalletVerifyBalance(w))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRWalletRebuildBalance() test\n", __func__);
+
+    BRWalletFree(w);
+    return r;
+}
+
+// registers txCount transactions, alternately receiving to and spending from the wallet, and at each doubling of the
+// history compares the time to apply one more transaction against the time to replay the entire history
+extern void BRRunPerfTestsWallet (size_t txCount)
+{
+    const char *phrase = "a random seed";
+    UInt512 seed;
+    UInt256 secret = uint256("0000000000000000000000000000000000000000000000000000000000000001");
+    BRKey k;
+    BRAddress addr, recvAddr;
+    BRTransaction *tx, *prev = NULL;
+    clock_t start;
+    double applyTime = 0.0;
+    size_t applyCount = 0, next = 64;
+
+    BRBIP39DeriveKey(&seed, phrase, NULL);
+    BRWallet *w = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, BRBIP32MasterPubKey(&seed, sizeof(seed)));
+    BRKeySetSecret(&k, &secret, 1);
+    BRKeyAddress(&k, addr.s, sizeof(addr), BRMainNetParams->addrParams);
+    recvAddr = BRWalletReceiveAddress(w);
+
+    uint8_t inScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, addr.s)];
+    size_t inScriptLen = BRAddressScriptPubKey(inScript, sizeof(inScript), BRMainNetParams->addrParams, addr.s);
+    uint8_t outScript[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, recvAddr.s)];
+    size_t outScriptLen = BRAddressScriptPubKey(outScript, sizeof(outScript), BRMainNetParams->addrParams, recvAddr.s);
+
+    printf("%10s %16s %16s\n", "txCount", "apply (ms/tx)", "replay (ms)");
+
+    for (size_t i = 1; i <= txCount; i++) {
+        tx = BRTransactionNew();
+
+        if (prev && i % 2 == 0) { // spend the previous receive, with change back to the wallet
+            BRTransactionAddInput(tx, prev->txHash, 0, SATOSHIS, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+            BRTransactionAddOutput(tx, SATOSHIS/2, inScript, inScriptLen);
+            BRTransactionAddOutput(tx, SATOSHIS/4, outScript, outScriptLen);
+        }
+        else {
+            UInt256 inHash = UINT256_ZERO;
+
+            UInt32SetLE(inHash.u8, (uint32_t)i);
+            BRTransactionAddInput(tx, inHash, 0, SATOSHIS, inScript, inScriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+            BRTransactionAddOutput(tx, SATOSHIS, outScript, outScriptLen);
+        }
+
+        tx->blockHeight = (uint32_t)i;
+        tx->timestamp = (uint32_t)i;
+        BRTransactionSign(tx, 0, &k, 1);
+        prev = tx;
+
+        start = clock();
+        BRWalletRegisterTransaction(w, tx);
+        applyTime += (double)(clock() - start)*1000.0/CLOCKS_PER_SEC;
+        applyCount++;
+
+        if (i == next || i == txCount) {
+            start = clock();
+            BRWalletRebuildBalance(w);
+            printf("%10zu %16.4f %16.4f\n", i, applyTime/applyCount,
+                   (double)(clock() - start)*1000.0/CLOCKS_PER_SEC);
+            applyTime = 0.0, applyCount = 0, next *= 2;
+        }
+    }
+
+    BRWalletFree(w);
+}
+
+extern void BRRunPerfTestsTransactionSign (size_t maxInputs, size_t threadCount)
+{
+    UInt256 secret = uint256("0000000000000000000000000000000000000000000000000000000000000001");
+    BRKey k[2];
+    BRAddress addr;
+    struct timeval start, end;
+    double serialTime, threadedTime;
+
+    BRKeySetSecret(&k[0], &secret, 1);
+    secret.u8[31] = 2;
+    BRKeySetSecret(&k[1], &secret, 1);
+    BRKeyAddress(&k[1], addr.s, sizeof(addr), BRMainNetParams->addrParams); // pay-to-witness-pubkey-hash
+
+    uint8_t script[BRAddressScriptPubKey(NULL, 0, BRMainNetParams->addrParams, addr.s)];
+    size_t scriptLen = BRAddressScriptPubKey(script, sizeof(script), BRMainNetParams->addrParams, addr.s);
+
+    printf("%10s %16s %16s\n", "inputs", "sign (ms/input)", "threaded (ms/in)");
+
+    for (size_t inCount = 16; inCount <= maxInputs; inCount *= 2) {
+        BRTransaction *tx = BRTransactionNew(), *tx2;
+        UInt256 txHash = UINT256_ZERO;
+
+        for (size_t i = 0; i < inCount; i++) {
+            UInt32SetLE(txHash.u8, (uint32_t)i);
+            BRTransactionAddInput(tx, txHash, 0, SATOSHIS, script, scriptLen, NULL, 0, NULL, 0, TXIN_SEQUENCE);
+        }
+
+        BRTransactionAddOutput(tx, SATOSHIS*inCount/2, script, scriptLen);
+        tx2 = BRTransactionCopy(tx);
+
+        gettimeofday(&start, NULL);
+        BRTransactionSign(tx, 0, k, 2);
+        gettimeofday(&end, NULL);
+        serialTime = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+
+        gettimeofday(&start, NULL);
+        BRTransactionSignWithThreads(tx2, 0, k, 2, threadCount);
+        gettimeofday(&end, NULL);
+        threadedTime = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+
+        printf("%10zu %16.4f %16.4f\n", inCount, serialTime/inCount, threadedTime/inCount);
+        if (! UInt256Eq(tx->wtxHash, tx2->wtxHash))
+            fprintf(stderr, "***FAILED*** %s: BRTransactionSignWithThreads() %zu inputs\n", __func__, inCount);
+        BRTransactionFree(tx);
+        BRTransactionFree(tx2);
+    }
+}
+
+extern void BRRunPerfTestsWalletRestore (size_t addrsCount)
+{
+    const char *phrase = "a random seed";
+    UInt512 seed;
+    struct timeval start, end;
+
+    BRBIP39DeriveKey(&seed, phrase, NULL);
+    BRMasterPubKey mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+
+    printf("%10s %16s\n", "threads", "restore (ms)");
+
+    for (size_t threadCount = 1; threadCount <= 16; threadCount *= 2) {
+        BRWallet *w = BRWalletNew(BRMainNetParams->addrParams, NULL, 0, mpk);
+
+        gettimeofday(&start, NULL);
+        BRWalletGenerateAddrs(w, (uint32_t)addrsCount, SEQUENCE_EXTERNAL_CHAIN, threadCount);
+        BRWalletGenerateAddrs(w, (uint32_t)addrsCount, SEQUENCE_INTERNAL_CHAIN, threadCount);
+        gettimeofday(&end, NULL);
+        printf("%10zu %16.1f\n", threadCount,
+               (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0);
+        BRWalletFree(w);
+    }
+}
+
+// times validating headersCount headers of a "headers" message, parsed and then checked one at a time as the peer used
+// to do, against BRMerkleBlockParseValidHeaders(), and prints headers per second
+extern void BRRunPerfTestsHeaders (size_t headersCount)
+{
+    // block 10001 header, repeated so that every header in the message is valid
+    const char header[] =
+    "\x01\x00\x00\x00\x06\xe5\x33\xfd\x1a\xda\x86\x39\x1f\x3f\x6c\x34\x32\x04\xb0\xd2\x78\xd4\xaa\xec\x1c"
+    "\x0b\x20\xaa\x27\xba\x03\x00\x00\x00\x00\x00\x6a\xbb\xb3\xeb\x3d\x73\x3a\x9f\xe1\x89\x67\xfd\x7d\x4c"
+    "\x11\x7e\x4c\xcb\xba\xc5\xbe\xc4\xd9\x10\xd9\x00\xb3\xae\x07\x93\xe7\x7f\x54\x24\x1b\x4d\x4c\x86\x04"
+    "\x1b\x40\x89\xcc\x9b\x00"; // followed by a zero tx count
+    uint8_t *msg = malloc(headersCount*81);
+    BRMerkleBlock **blocks = calloc(headersCount, sizeof(*blocks));
+    uint32_t now = (uint32_t)time(NULL);
+    struct timeval start, end;
+    double ms;
+    size_t i, n;
+
+    for (i = 0; i < headersCount; i++) memcpy(&msg[i*81], header, 81);
+    printf("%10s %16s\n", "", "headers/s");
+
+    gettimeofday(&start, NULL);
+    n = BRMerkleBlockParseHeaders(blocks, msg, 81, headersCount);
+    for (i = 0; i < n && blocks[i] && BRMerkleBlockIsValid(blocks[i], now); i++);
+    gettimeofday(&end, NULL);
+    ms = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+    printf("%10s %16.0f\n", "serial", headersCount*1000.0/ms);
+    if (i != headersCount) fprintf(stderr, "***FAILED*** %s: BRMerkleBlockIsValid()\n", __func__);
+    for (i = 0; i < n; i++) if (blocks[i]) BRMerkleBlockFree(blocks[i]);
+
+    gettimeofday(&start, NULL);
+    n = BRMerkleBlockParseValidHeaders(blocks, msg, 81, headersCount, now);
+    gettimeofday(&end, NULL);
+    ms = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+    printf("%10s %16.0f\n", "batch", headersCount*1000.0/ms);
+    if (n != headersCount) fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseValidHeaders()\n", __func__);
+    for (i = 0; i < headersCount; i++) if (blocks[i]) BRMerkleBlockFree(blocks[i]);
+
+    free(blocks);
+    free(msg);
+}
+
 int BRBloomFilterTests()
 {
     int r = 1;
@@ -2747,6 +3296,55 @@ int BRMerkleBlockTests()
     if (! UInt256Eq(txHashes[3], uint256("c9ab658448c10b6921b7a4ce3021eb22ed6bb6a7fde1e5bcc4b1db6615c6abc5")))
         r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockTxHashes() test 4\n", __func__);
     
+    BRMerkleBlock *headers[3];
+    uint8_t headersMsg[3*81];
+    
+    for (size_t i = 0; i < 3; i++) memcpy(&headersMsg[i*81], block, 80), headersMsg[i*81 + 80] = 0;
+    headersMsg[81 + 76]++; // change the nonce of the second header
+    
+    if (BRMerkleBlockParseHeaders(headers, headersMsg, 81, 3) != 3 || ! headers[0] || ! headers[1] || ! headers[2])
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseHeaders() test 0\n", __func__);
+    
+    if (headers[0] && ! UInt256Eq(headers[0]->blockHash, b->blockHash))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseHeaders() test 1\n", __func__);
+    
+    for (size_t i = 0; i < 3; i++) {
+        BRMerkleBlock *header = BRMerkleBlockParse(&headersMsg[i*81], 81);
+        
+        if (headers[i] && (! UInt256Eq(headers[i]->blockHash, header->blockHash) || headers[i]->nonce != header->nonce))
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseHeaders() test %zu\n", __func__, i + 2);
+        
+        if (headers[i]) BRMerkleBlockFree(headers[i]);
+        BRMerkleBlockFree(header);
+    }
+    
+    // the second header's changed nonce fails proof-of-work
+    if (BRMerkleBlockParseValidHeaders(headers, headersMsg, 81, 3, (uint32_t)time(NULL)) != 1 || ! headers[0] ||
+        headers[1] || ! headers[2])
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseValidHeaders() test 0\n", __func__);
+    
+    for (size_t i = 0; i < 3; i++) if (headers[i]) BRMerkleBlockFree(headers[i]);
+    
+    uint8_t *manyMsg = malloc(1000*81);
+    BRMerkleBlock **many = calloc(1000, sizeof(*many));
+    size_t validCount;
+    
+    for (size_t i = 0; i < 1000; i++) memcpy(&manyMsg[i*81], headersMsg, 81);
+    manyMsg[999*81 + 76]++; // change the nonce of the last header
+    validCount = BRMerkleBlockParseValidHeaders(many, manyMsg, 81, 1000, (uint32_t)time(NULL));
+    
+    if (validCount != 999 || many[999])
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseValidHeaders() test 1\n", __func__);
+    
+    for (size_t i = 0; i < validCount; i++) {
+        if (! many[i] || ! UInt256Eq(many[i]->blockHash, b->blockHash))
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRMerkleBlockParseValidHeaders() test %zu\n", __func__, i + 2);
+    }
+    
+    for (size_t i = 0; i < 1000; i++) if (many[i]) BRMerkleBlockFree(many[i]);
+    free(many);
+    free(manyMsg);
+    
     // TODO: test a block with an odd number of tree rows both at the tx level and merkle node level
 
     // TODO: XXX test BRMerkleBlockVerifyDifficulty()
@@ -2769,6 +3367,172 @@ int BRMerkleBlockTests()
     return r;
 }
 
+static BRMerkleBlock *_headerStoreTestBlock(uint32_t height, UInt256 prevBlock, uint32_t nonce)
+{
+    BRMerkleBlock *b = BRMerkleBlockNew();
+
+    b->height = height;
+    b->prevBlock = prevBlock;
+    b->timestamp = 1231006505 + height*600;
+    b->target = 0x1d00ffff;
+    b->nonce = nonce;
+    b->blockHash.u32[0] = height, b->blockHash.u32[1] = nonce, b->blockHash.u32[7] = 0x5eed; // distinct, not a real hash
+    return b;
+}
+
+int BRHeaderStoreTests()
+{
+    int r = 1, fd;
+    char path[] = "/tmp/BRHeaderStoreTestsXXXXXX";
+    BRHeaderStore *store;
+    BRMerkleBlock *b, *c;
+    UInt256 prevBlock = UINT256_ZERO, work;
+    size_t count;
+
+    fd = mkstemp(path);
+    if (fd < 0) return fprintf(stderr, "***FAILED*** %s: mkstemp() test\n", __func__), 0;
+    close(fd);
+    store = BRHeaderStoreOpen(path);
+
+    if (! store) return fprintf(stderr, "***FAILED*** %s: BRHeaderStoreOpen() test 0\n", __func__), 0;
+
+    b = _headerStoreTestBlock(BLOCK_DIFFICULTY_INTERVAL - 1, prevBlock, 0);
+    if (BRHeaderStoreAdd(store, b) || BRHeaderStoreCount(store) != 0) // must start at a difficulty transition
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test 0\n", __func__);
+    BRMerkleBlockFree(b);
+
+    for (uint32_t h = BLOCK_DIFFICULTY_INTERVAL; h < 4*BLOCK_DIFFICULTY_INTERVAL + 1000; h++) { // grows the file
+        b = _headerStoreTestBlock(h, prevBlock, 0);
+        if (! BRHeaderStoreAdd(store, b)) r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test 1\n", __func__);
+        prevBlock = b->blockHash;
+        BRMerkleBlockFree(b);
+    }
+
+    if (BRHeaderStoreBaseHeight(store) != BLOCK_DIFFICULTY_INTERVAL ||
+        BRHeaderStoreTipHeight(store) != 4*BLOCK_DIFFICULTY_INTERVAL + 999)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreTipHeight() test\n", __func__);
+
+    b = _headerStoreTestBlock(3*BLOCK_DIFFICULTY_INTERVAL + 5, UINT256_ZERO, 0);
+    if (BRHeaderStoreHeightForHash(store, b->blockHash) != 3*BLOCK_DIFFICULTY_INTERVAL + 5)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreHeightForHash() test 0\n", __func__);
+    b->blockHash.u32[1] = 1;
+    if (BRHeaderStoreHeightForHash(store, b->blockHash) != BLOCK_UNKNOWN_HEIGHT)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreHeightForHash() test 1\n", __func__);
+    BRMerkleBlockFree(b);
+
+    b = BRHeaderStoreBlockAtHeight(store, 2*BLOCK_DIFFICULTY_INTERVAL + 7);
+    if (! b || b->height != 2*BLOCK_DIFFICULTY_INTERVAL + 7 || b->target != 0x1d00ffff ||
+        b->timestamp != 1231006505 + b->height*600 || b->blockHash.u32[0] != b->height)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreBlockAtHeight() test\n", __func__);
+    if (b) BRMerkleBlockFree(b);
+
+    b = BRHeaderStoreRetargetBlock(store, 3*BLOCK_DIFFICULTY_INTERVAL - 1);
+    if (! b || b->height != 2*BLOCK_DIFFICULTY_INTERVAL)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreRetargetBlock() test\n", __func__);
+    if (b) BRMerkleBlockFree(b);
+
+    // the work for a 0x1d00ffff target is 0x100010001
+    work = BRHeaderStoreChainWork(store, BLOCK_DIFFICULTY_INTERVAL + 1);
+    if (work.u64[0] != 2*0x100010001ULL || work.u64[1] != 0 || work.u64[2] != 0 || work.u64[3] != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreChainWork() test\n", __func__);
+
+    // reorganize from a block below the tip
+    c = BRHeaderStoreBlockAtHeight(store, 4*BLOCK_DIFFICULTY_INTERVAL + 499);
+    b = _headerStoreTestBlock(4*BLOCK_DIFFICULTY_INTERVAL + 500, c->blockHash, 1);
+    if (! BRHeaderStoreAdd(store, b) || BRHeaderStoreTipHeight(store) != 4*BLOCK_DIFFICULTY_INTERVAL + 500)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreAdd() test 2\n", __func__);
+    BRMerkleBlockFree(b);
+    BRMerkleBlockFree(c);
+
+    BRHeaderStoreRewind(store, 4*BLOCK_DIFFICULTY_INTERVAL + 400);
+    BRHeaderStoreClose(store);
+    store = BRHeaderStoreOpen(path);
+
+    if (! store || BRHeaderStoreTipHeight(store) != 4*BLOCK_DIFFICULTY_INTERVAL + 400)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreOpen() test 1\n", __func__);
+
+    count = (store) ? BRHeaderStoreRecentBlocks(store, NULL, 0) : 0;
+    BRMerkleBlock *blocks[(count > 0) ? count : 1];
+
+    if (count != 401 || BRHeaderStoreRecentBlocks(store, blocks, count) != count ||
+        blocks[0]->height != 4*BLOCK_DIFFICULTY_INTERVAL || blocks[400]->height != 4*BLOCK_DIFFICULTY_INTERVAL + 400)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreRecentBlocks() test\n", __func__);
+    else for (size_t i = 0; i < count; i++) BRMerkleBlockFree(blocks[i]);
+
+    if (store) BRHeaderStoreClear(store);
+
+    if (store && (BRHeaderStoreCount(store) != 0 || BRHeaderStoreTipHeight(store) != BLOCK_UNKNOWN_HEIGHT ||
+                  BRHeaderStoreRecentBlocks(store, NULL, 0) != 0))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRHeaderStoreClear() test\n", __func__);
+
+    if (store) BRHeaderStoreClose(store);
+    unlink(path);
+    return r;
+}
+
+int BRCompactFilterTests()
+{
+    int r = 1;
+    uint8_t filter[16], data[400][sizeof(UInt256)], matches[4];
+    const uint8_t *items[400], *filters[4];
+    size_t i, len, lens[400], filterLens[4];
+    UInt256 blockHashes[4];
+    uint32_t n;
+
+    // BIP158 test vector, testnet genesis block
+    UInt256 blockHash = UInt256Reverse(uint256("000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943"));
+    const uint8_t script[] = "\x41\x04\x67\x8a\xfd\xb0\xfe\x55\x48\x27\x19\x67\xf1\xa6\x71\x30\xb7\x10\x5c\xd6\xa8\x28"
+    "\xe0\x39\x09\xa6\x79\x62\xe0\xea\x1f\x61\xde\xb6\x49\xf6\xbc\x3f\x4c\xef\x38\xc4\xf3\x55\x04\xe5\x1e\xc1\x12"
+    "\xde\x5c\x38\x4d\xf7\xba\x0b\x8d\x57\x8a\x4c\x70\x2b\x6b\xf1\x1d\x5f\xac";
+
+    items[0] = script;
+    lens[0] = sizeof(script) - 1;
+    len = BRCompactFilterBuild(filter, sizeof(filter), blockHash, items, lens, 1);
+    
+    if (len != 4 || memcmp(filter, "\x01\x9d\xfc\xa8", 4) != 0)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterBuild() test 0\n", __func__);
+
+    if (! UInt256Eq(BRCompactFilterHeader(BRCompactFilterHash(filter, len), UINT256_ZERO),
+                    UInt256Reverse(uint256("21584579b7eb08997773e5aeff3a7f932700042d0ed2a6129012b7d7ae81b750"))))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterHeader() test\n", __func__);
+
+    if (! BRCompactFilterMatchAny(filter, len, blockHash, items, lens, 1))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterMatchAny() test 0\n", __func__);
+
+    for (i = 0; i < 400; i++) {
+        n = (uint32_t)i;
+        BRSHA256(data[i], &n, sizeof(n));
+        items[i] = data[i];
+        lens[i] = 25;
+    }
+
+    // four filters of 50 items each, built from items 0-199
+    for (i = 0; i < 4; i++) {
+        blockHashes[i] = UInt256Get(data[399 - i]);
+        filterLens[i] = BRCompactFilterBuild(NULL, 0, blockHashes[i], &items[i*50], lens, 50);
+        filters[i] = malloc(filterLens[i]);
+        BRCompactFilterBuild((uint8_t *)filters[i], filterLens[i], blockHashes[i], &items[i*50], lens, 50);
+    }
+    
+    if (BRCompactFilterMatchAny(filters[1], filterLens[1], blockHashes[1], &items[200], lens, 150))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterMatchAny() test 1\n", __func__);
+
+    // items 200-349 aren't in any filter, item 120 is only in filters[2]
+    items[300] = data[120];
+
+    if (BRCompactFilterMatchAnyBatch(filters, filterLens, blockHashes, 4, &items[200], lens, 150, matches) != 1 ||
+        matches[0] || matches[1] || ! matches[2] || matches[3])
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterMatchAnyBatch() test\n", __func__);
+
+    for (i = 0; i < 4; i++) {
+        if (matches[i] != BRCompactFilterMatchAny(filters[i], filterLens[i], blockHashes[i], &items[200], lens, 150))
+            r = 0, fprintf(stderr, "***FAILED*** %s: BRCompactFilterMatchAny() test 2\n", __func__);
+        free((uint8_t *)filters[i]);
+    }
+
+    return r;
+}
+
 int BRPaymentProtocolTests()
 {
     int r = 1;
@@ -3205,15 +3969,424 @@ int BRPaymentProtocolEncryptionTests()
     return r;
 }
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// listens on an ephemeral loopback port, standing in for a bitcoin node, returns the listening socket or -1 on failure
+static int _peerTestListen(uint16_t *port)
+{
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (fd >= 0 && (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0 ||
+                    getsockname(fd, (struct sockaddr *)&addr, &addrLen) < 0)) {
+        close(fd);
+        fd = -1;
+    }
+
+    if (fd >= 0) *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+// accepts a peer's connection within 5 seconds, returns the connected socket or -1
+static int _peerTestAccept(int listenFd)
+{
+    struct pollfd pfd = { listenFd, POLLIN, 0 };
+    struct timeval tv = { 5, 0 };
+    int fd = (poll(&pfd, 1, 5000) == 1) ? accept(listenFd, NULL, NULL) : -1;
+
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// writes a message header and payload to buf, which must hold 24 + msgLen bytes, returns the number of bytes written
+static size_t _peerTestMessage(uint8_t *buf, uint32_t magicNumber, const char *type, const uint8_t *msg, size_t msgLen)
+{
+    UInt256 hash;
+
+    BRSHA256_2(&hash, msg, msgLen);
+    UInt32SetLE(&buf[0], magicNumber);
+    memset(&buf[4], 0, 12);
+    strncpy((char *)&buf[4], type, 12);
+    UInt32SetLE(&buf[16], (uint32_t)msgLen);
+    memcpy(&buf[20], &hash, sizeof(uint32_t));
+    if (msgLen > 0) memcpy(&buf[24], msg, msgLen);
+    return 24 + msgLen;
+}
+
+static int _peerTestSend(int fd, const uint8_t *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len > 0 && (n = send(fd, buf, len, MSG_NOSIGNAL)) > 0) buf += n, len -= n;
+    return (len == 0);
+}
+
+// sends a version message from a node with the given services and best block, followed by verack
+static int _peerTestSendVersion(int fd, uint32_t magicNumber, uint64_t services, uint32_t lastBlock)
+{
+    uint8_t msg[86], buf[24 + sizeof(msg)];
+    size_t len;
+
+    memset(msg, 0, sizeof(msg)); // the addresses, ports, nonce and user agent are left empty
+    UInt32SetLE(&msg[0], 70013);
+    UInt64SetLE(&msg[4], services);
+    UInt64SetLE(&msg[12], (uint64_t)time(NULL));
+    UInt32SetLE(&msg[81], lastBlock);
+    len = _peerTestMessage(buf, magicNumber, "version", msg, sizeof(msg));
+    if (! _peerTestSend(fd, buf, len)) return 0;
+    len = _peerTestMessage(buf, magicNumber, "verack", NULL, 0);
+    return _peerTestSend(fd, buf, len);
+}
+
+// reads the next message the peer sends within timeout seconds and copies its type, returns the payload length, with
+// the payload itself discarded, -1 if the connection closed, or -2 if nothing arrived in time
+static ssize_t _peerTestRecv(int fd, char type[13], int timeout)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    uint8_t header[24], discard[0x1000];
+    size_t len, off = 0;
+    ssize_t n = 1;
+    int count = poll(&pfd, 1, timeout*1000);
+
+    if (count == 0) return -2;
+    if (count < 0) return -1;
+    while (off < sizeof(header) && (n = recv(fd, &header[off], sizeof(header) - off, 0)) > 0) off += n;
+    if (off < sizeof(header)) return -1;
+    memcpy(type, &header[4], 12);
+    type[12] = '\0';
+    len = UInt32GetLE(&header[16]);
+
+    for (off = 0; off < len && n > 0; off += n) {
+        n = recv(fd, discard, (len - off < sizeof(discard)) ? len - off : sizeof(discard), 0);
+        if (n <= 0) return -1;
+    }
+
+    return (ssize_t)len;
+}
+
 void BRPeerAcceptMessageTest(BRPeer *peer, const uint8_t *msg, size_t len, const char *type);
 
+typedef struct {
+    pthread_mutex_t lock;
+    int connected, disconnected, error, cleanup;
+} BRPeerTestInfo;
+
+static void _peerTestConnected(void *info)
+{
+    BRPeerTestInfo *test = info;
+
+    pthread_mutex_lock(&test->lock);
+    test->connected++;
+    pthread_mutex_unlock(&test->lock);
+}
+
+static void _peerTestDisconnected(void *info, int error)
+{
+    BRPeerTestInfo *test = info;
+
+    pthread_mutex_lock(&test->lock);
+    test->disconnected++;
+    test->error = error;
+    pthread_mutex_unlock(&test->lock);
+}
+
+static void _peerTestThreadCleanup(void *info)
+{
+    BRPeerTestInfo *test = info;
+
+    pthread_mutex_lock(&test->lock);
+    test->cleanup++;
+    pthread_mutex_unlock(&test->lock);
+}
+
+// waits up to timeout seconds for the I/O thread servicing the peer to finish with it, and a little longer to catch any
+// duplicate callbacks, then returns a copy of info's counters and resets them
+static BRPeerTestInfo _peerTestWait(BRPeerTestInfo *info, int timeout)
+{
+    BRPeerTestInfo counts;
+    int done = 0;
+
+    for (int i = 0; i < timeout*100 && ! done; i++) {
+        pthread_mutex_lock(&info->lock);
+        done = info->cleanup;
+        pthread_mutex_unlock(&info->lock);
+        if (! done) usleep(10000);
+    }
+
+    usleep(100000);
+    pthread_mutex_lock(&info->lock);
+    counts = *info;
+    info->connected = info->disconnected = info->error = info->cleanup = 0;
+    pthread_mutex_unlock(&info->lock);
+    return counts;
+}
+
+// connects p to an address that can't be reached, returns true if the failure was reported exactly once, by
+// disconnected() and threadCleanup() when BRPeerConnect() started connecting, or by BRPeerConnect() alone otherwise
+static int _peerTestConnectFailure(BRPeer *p, BRPeerTestInfo *info)
+{
+    int started = BRPeerConnect(p);
+
+    BRPeerTestInfo counts = _peerTestWait(info, (started) ? 5 : 0);
+
+    if (BRPeerConnectStatus(p) != BRPeerStatusDisconnected) return 0;
+    if (started) return (counts.disconnected == 1 && counts.error != 0 && counts.cleanup == 1);
+    return (counts.disconnected == 0 && counts.cleanup == 0);
+}
+
 int BRPeerTests()
 {
     int r = 1;
-    BRPeer *p = BRPeerNew(BRMainNetParams->magicNumber);
+    const BRChainParams *params = BRMainNetParams;
+    UInt128 loopback = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 } },
+            broadcast = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 255, 255, 255, 255 } };
+    BRPeer *p = BRPeerNew(params->magicNumber);
     const char msg[] = "my message";
+    const uint8_t garbage[] = { 0xf9, 0xbe, 0x00, 0x01, 0x02 }, nonce[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t buf[2*(24 + sizeof(nonce))], *big;
+    BRPeerTestInfo info, counts;
+    char type[13];
+    ssize_t len;
+    size_t i, pongs = 0;
+    uint16_t port = 0;
+    int listenFd, fd = -1;
     
     BRPeerAcceptMessageTest(p, (const uint8_t *)msg, sizeof(msg) - 1, "inv");
+    BRPeerFree(p);
+
+    memset(&info, 0, sizeof(info));
+    pthread_mutex_init(&info.lock, NULL);
+    listenFd = _peerTestListen(&port);
+    if (listenFd < 0) r = 0, fprintf(stderr, "***FAILED*** %s: listen failed\n", __func__);
+    p = BRPeerNew(params->magicNumber);
+    p->address = loopback;
+    p->port = port;
+    BRPeerSetCallbacks(p, &info, _peerTestConnected, _peerTestDisconnected, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                       NULL, NULL, _peerTestThreadCleanup);
+
+    // the handshake follows bytes that aren't a message header, which have to be skipped to find the magic number
+    if (listenFd >= 0 && ! BRPeerConnect(p))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 1\n", __func__);
+    
+    fd = (listenFd >= 0) ? _peerTestAccept(listenFd) : -1;
+    len = (fd >= 0) ? _peerTestRecv(fd, type, 5) : -1;
+    
+    if (len < 0 || strcmp(type, "version") != 0 || ! _peerTestSend(fd, garbage, sizeof(garbage)) ||
+        ! _peerTestSendVersion(fd, params->magicNumber, params->services, 0))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 2\n", __func__);
+    
+    // a message delivered a byte at a time, then two messages in a single write, are each answered
+    len = _peerTestMessage(buf, params->magicNumber, "ping", nonce, sizeof(nonce));
+    
+    for (i = 0; fd >= 0 && i < (size_t)len; i++) {
+        _peerTestSend(fd, &buf[i], 1);
+        usleep(1000);
+    }
+
+    _peerTestMessage(&buf[len], params->magicNumber, "ping", nonce, sizeof(nonce));
+    if (fd >= 0) _peerTestSend(fd, buf, 2*len);
+    
+    while (fd >= 0 && pongs < 3 && (len = _peerTestRecv(fd, type, 5)) >= 0) {
+        if (strcmp(type, "pong") == 0 && len == sizeof(nonce)) pongs++;
+    }
+    
+    if (pongs != 3) r = 0, fprintf(stderr, "***FAILED*** %s: _BRPeerReadMessages() test 1\n", __func__);
+    
+    pthread_mutex_lock(&info.lock);
+    if (BRPeerConnectStatus(p) != BRPeerStatusConnected || info.connected != 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 3\n", __func__);
+    pthread_mutex_unlock(&info.lock);
+    
+    // sends to a node that isn't reading are queued rather than blocking, and arrive intact once it reads them
+    big = calloc(1, 0x100000);
+    for (i = 0; fd >= 0 && i < 16; i++) BRPeerSendMessage(p, big, 0x100000, "test");
+    free(big);
+    
+    for (i = 0; fd >= 0 && i < 16 && _peerTestRecv(fd, type, 5) == 0x100000 && strcmp(type, "test") == 0; i++);
+    if (i != 16) r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerSendMessage() test\n", __func__);
+    
+    // an invalid checksum is a protocol error, and the peer is disconnected exactly once
+    len = _peerTestMessage(buf, params->magicNumber, "ping", nonce, sizeof(nonce));
+    buf[20] ^= 0xff;
+    if (fd >= 0) _peerTestSend(fd, buf, len);
+    if (fd >= 0 && _peerTestRecv(fd, type, 5) != -1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: _BRPeerReadMessages() test 2\n", __func__);
+    
+    counts = _peerTestWait(&info, 5);
+    if (counts.disconnected != 1 || counts.error != EPROTO || counts.cleanup != 1)
+        r = 0, fprintf(stderr, "***FAILED*** %s: _BRPeerReadMessages() test 3\n", __func__);
+    
+    if (fd >= 0) close(fd);
+    
+    // a node closing the connection is noticed by the reactor, and also reported exactly once
+    if (listenFd >= 0 && ! BRPeerConnect(p))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 4\n", __func__);
+    
+    fd = (listenFd >= 0) ? _peerTestAccept(listenFd) : -1;
+    if (fd >= 0) close(fd);
+    counts = _peerTestWait(&info, 5);
+    
+    if (counts.disconnected != 1 || counts.error == 0 || counts.cleanup != 1 ||
+        BRPeerConnectStatus(p) != BRPeerStatusDisconnected)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerDisconnect() test\n", __func__);
+    
+    // a refused connection, and one that fails before it starts, are each reported once, either asynchronously by the
+    // callbacks, or synchronously by BRPeerConnect()
+    if (listenFd >= 0) close(listenFd);
+    if (! _peerTestConnectFailure(p, &info))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 5\n", __func__);
+    
+    p->address = broadcast;
+    if (! _peerTestConnectFailure(p, &info))
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerConnect() test 6\n", __func__);
+    
+    BRPeerFree(p);
+    pthread_mutex_destroy(&info.lock);
+    return r;
+}
+
+static int _peerManagerTestNetworkIsReachable(void *info)
+{
+    return 0;
+}
+
+// connects manager to a fixed peer while the network is unreachable, which starts a sync, and so a header catch up,
+// without any DNS lookups or sockets
+static void _peerManagerTestConnect(BRPeerManager *manager)
+{
+    UInt128 loopback = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 } };
+
+    BRPeerManagerSetCallbacks(manager, NULL, NULL, NULL, NULL, NULL, NULL, _peerManagerTestNetworkIsReachable, NULL);
+    BRPeerManagerSetFixedPeer(manager, loopback, BRMainNetParams->standardPort);
+    BRPeerManagerConnect(manager);
+    BRPeerManagerDisconnect(manager);
+}
+
+// stands in for a node with the given services for manager to connect to, and reads what manager sends after the
+// handshake until it goes quiet, returns the node's socket, or -1 if manager closed the connection, and sets
+// *filterload if manager loaded a bloom filter
+static int _peerManagerTestNode(BRPeerManager *manager, int listenFd, uint64_t services, int *filterload)
+{
+    const BRChainParams *params = BRPeerManagerChainParams(manager);
+    int fd = _peerTestAccept(listenFd);
+    char type[13];
+    ssize_t len = (fd >= 0) ? _peerTestRecv(fd, type, 5) : -1;
+
+    *filterload = 0;
+
+    if (len >= 0 && strcmp(type, "version") == 0 &&
+        _peerTestSendVersion(fd, params->magicNumber, services, BRPeerManagerLastBlockHeight(manager))) {
+        while ((len = _peerTestRecv(fd, type, 1)) >= 0) if (strcmp(type, "filterload") == 0) *filterload = 1;
+    }
+
+    if (fd >= 0 && len != -2) close(fd), fd = -1;
+    return fd;
+}
+
+int BRPeerManagerTests()
+{
+    int r = 1;
+    const BRChainParams *params = BRMainNetParams;
+    const BRCheckPoint *checkpoint = &params->checkpoints[params->checkpointsCount - 1];
+    uint32_t height = (checkpoint->height/BLOCK_DIFFICULTY_INTERVAL + 1)*BLOCK_DIFFICULTY_INTERVAL, earliestKeyTime;
+    const char *phrase = "a random seed";
+    UInt128 loopback = { .u8 = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 127, 0, 0, 1 } };
+    UInt256 prevBlock = UINT256_ZERO;
+    BRMerkleBlock *blocks[100];
+    BRPeerManager *m1, *m2, *m3;
+    UInt512 seed;
+    uint64_t services = params->services | SERVICES_NODE_NETWORK;
+    uint16_t port = 0;
+    int listenFd, fd, filterload;
+
+    BRBIP39DeriveKey(&seed, phrase, NULL);
+
+    BRMasterPubKey mpk = BRBIP32MasterPubKey(&seed, sizeof(seed));
+    BRWallet *w1 = BRWalletNew(params->addrParams, NULL, 0, mpk), *w2 = BRWalletNew(params->addrParams, NULL, 0, mpk),
+             *w3 = BRWalletNew(params->addrParams, NULL, 0, mpk);
+
+    // headers from the difficulty transition after the last checkpoint, all older than the wallets
+    for (size_t i = 0; i < 100; i++) {
+        blocks[i] = _headerStoreTestBlock(height + (uint32_t)i, prevBlock, 0);
+        prevBlock = blocks[i]->blockHash;
+    }
+
+    earliestKeyTime = blocks[99]->timestamp + 30*24*60*60;
+    m1 = BRPeerManagerNew(params, w1, earliestKeyTime, blocks, 100, NULL, 0);
+    m2 = BRPeerManagerNew(params, w2, earliestKeyTime, NULL, 0, NULL, 0);
+
+    if (BRPeerManagerLastBlockHeight(m1) != height + 99 || BRPeerManagerLastBlockHeight(m2) != checkpoint->height)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerManagerNew() test\n", __func__);
+
+    _peerManagerTestConnect(m2); // catches up from m1, on the same network
+
+    if (BRPeerManagerLastBlockHeight(m2) != height + 99)
+        r = 0, fprintf(stderr, "***FAILED*** %s: header catch up test 0\n", __func__);
+
+    BRPeerManagerFree(m1);
+    m3 = BRPeerManagerNew(params, w3, earliestKeyTime, NULL, 0, NULL, 0);
+    _peerManagerTestConnect(m3); // catches up from m2, m1 is gone
+
+    if (BRPeerManagerLastBlockHeight(m3) != height + 99)
+        r = 0, fprintf(stderr, "***FAILED*** %s: header catch up test 1\n", __func__);
+
+    BRPeerManagerFree(m2);
+    BRPeerManagerFree(m3);
+    m1 = BRPeerManagerNew(params, w1, earliestKeyTime, NULL, 0, NULL, 0);
+    _peerManagerTestConnect(m1); // the group went with its last manager, there's nothing to catch up from
+
+    if (BRPeerManagerLastBlockHeight(m1) != checkpoint->height)
+        r = 0, fprintf(stderr, "***FAILED*** %s: header catch up test 2\n", __func__);
+
+    BRPeerManagerFree(m1);
+
+    // in compact filter mode only nodes that serve compact filters are kept, and no bloom filter is loaded into them
+    listenFd = _peerTestListen(&port);
+    if (listenFd < 0) r = 0, fprintf(stderr, "***FAILED*** %s: _peerTestListen() test\n", __func__);
+    m1 = BRPeerManagerNew(params, w1, earliestKeyTime, NULL, 0, NULL, 0);
+    BRPeerManagerSetCallbacks(m1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    BRPeerManagerSetFixedPeer(m1, loopback, port);
+    BRPeerManagerSetCompactFilterSync(m1, 1);
+    BRPeerManagerConnect(m1);
+    fd = _peerManagerTestNode(m1, listenFd, services | SERVICES_NODE_BLOOM, &filterload);
+
+    if (fd >= 0 || filterload)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerManagerSetCompactFilterSync() test 0\n", __func__);
+
+    if (fd >= 0) close(fd);
+    fd = _peerManagerTestNode(m1, listenFd, services | SERVICES_NODE_COMPACT_FILTERS, &filterload);
+
+    if (fd < 0 || filterload || BRPeerManagerConnectStatus(m1) != BRPeerStatusConnected)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerManagerSetCompactFilterSync() test 1\n", __func__);
+
+    BRPeerManagerDisconnect(m1);
+    BRPeerManagerFree(m1);
+    if (fd >= 0) close(fd);
+
+    // the same node gets a bloom filter otherwise
+    m1 = BRPeerManagerNew(params, w1, earliestKeyTime, NULL, 0, NULL, 0);
+    BRPeerManagerSetCallbacks(m1, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    BRPeerManagerSetFixedPeer(m1, loopback, port);
+    BRPeerManagerConnect(m1);
+    fd = _peerManagerTestNode(m1, listenFd, services | SERVICES_NODE_BLOOM, &filterload);
+
+    if (fd < 0 || ! filterload)
+        r = 0, fprintf(stderr, "***FAILED*** %s: BRPeerManagerSetCompactFilterSync() test 2\n", __func__);
+
+    BRPeerManagerDisconnect(m1);
+    BRPeerManagerFree(m1);
+    if (fd >= 0) close(fd);
+    if (listenFd >= 0) close(listenFd);
+    BRWalletFree(w1);
+    BRWalletFree(w2);
+    BRWalletFree(w3);
     return r;
 }
 
@@ -3265,14 +4438,22 @@ int BRRunTests()
     printf("%s\n", (BRTransactionTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRWalletTests...                    ");
     printf("%s\n", (BRWalletTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRWalletBalanceTests...             ");
+    printf("%s\n", (BRWalletBalanceTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRBloomFilterTests...               ");
     printf("%s\n", (BRBloomFilterTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRMerkleBlockTests...               ");
     printf("%s\n", (BRMerkleBlockTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRHeaderStoreTests...               ");
+    printf("%s\n", (BRHeaderStoreTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRCompactFilterTests...             ");
+    printf("%s\n", (BRCompactFilterTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRPaymentProtocolTests...           ");
     printf("%s\n", (BRPaymentProtocolTests()) ? "success" : (fail++, "***FAIL***"));
     printf("BRPaymentProtocolEncryptionTests... ");
     printf("%s\n", (BRPaymentProtocolEncryptionTests()) ? "success" : (fail++, "***FAIL***"));
+    printf("BRPeerManagerTests...               ");
+    printf("%s\n", (BRPeerManagerTests()) ? "success" : (fail++, "***FAIL***"));
     printf("\n");
     
     if (fail > 0) printf("%d TEST FUNCTION(S) ***FAILED***\n", fail);
@@ -27,6 +27,8 @@
 #include "bitcoin/BRWallet.h"
 #include "bitcoin/BRWalletManager.h"
 
+#include "sqlite3/sqlite3.h"
+
 #ifdef __ANDROID__
 #include <android/log.h>
 #define fprintf(...) __android_log_print(ANDROID_LOG_ERROR, "testBwm", _va_rest(__VA_ARGS__, NULL))
@@ -1306,6 +1308,52 @@ BRTransactionEqual (BRTransaction *tx1, BRTransaction *tx2);
 static int
 BRPeerEqual (const BRPeer *p1, const BRPeer *p2);
 
+// block 10001 filtered to include only transactions 0, 1, 2, and 6
+static const char fileServiceTestBlock[] =
+    "\x01\x00\x00\x00\x06\xe5\x33\xfd\x1a\xda\x86\x39\x1f\x3f\x6c\x34\x32\x04\xb0\xd2\x78\xd4\xaa\xec\x1c"
+    "\x0b\x20\xaa\x27\xba\x03\x00\x00\x00\x00\x00\x6a\xbb\xb3\xeb\x3d\x73\x3a\x9f\xe1\x89\x67\xfd\x7d\x4c\x11\x7e\x4c"
+    "\xcb\xba\xc5\xbe\xc4\xd9\x10\xd9\x00\xb3\xae\x07\x93\xe7\x7f\x54\x24\x1b\x4d\x4c\x86\x04\x1b\x40\x89\xcc\x9b\x0c"
+    "\x00\x00\x00\x08\x4c\x30\xb6\x3c\xfc\xdc\x2d\x35\xe3\x32\x94\x21\xb9\x80\x5e\xf0\xc6\x56\x5d\x35\x38\x1c\xa8\x57"
+    "\x76\x2e\xa0\xb3\xa5\xa1\x28\xbb\xca\x50\x65\xff\x96\x17\xcb\xcb\xa4\x5e\xb2\x37\x26\xdf\x64\x98\xa9\xb9\xca\xfe"
+    "\xd4\xf5\x4c\xba\xb9\xd2\x27\xb0\x03\x5d\xde\xfb\xbb\x15\xac\x1d\x57\xd0\x18\x2a\xae\xe6\x1c\x74\x74\x3a\x9c\x4f"
+    "\x78\x58\x95\xe5\x63\x90\x9b\xaf\xec\x45\xc9\xa2\xb0\xff\x31\x81\xd7\x77\x06\xbe\x8b\x1d\xcc\x91\x11\x2e\xad\xa8"
+    "\x6d\x42\x4e\x2d\x0a\x89\x07\xc3\x48\x8b\x6e\x44\xfd\xa5\xa7\x4a\x25\xcb\xc7\xd6\xbb\x4f\xa0\x42\x45\xf4\xac\x8a"
+    "\x1a\x57\x1d\x55\x37\xea\xc2\x4a\xdc\xa1\x45\x4d\x65\xed\xa4\x46\x05\x54\x79\xaf\x6c\x6d\x4d\xd3\xc9\xab\x65\x84"
+    "\x48\xc1\x0b\x69\x21\xb7\xa4\xce\x30\x21\xeb\x22\xed\x6b\xb6\xa7\xfd\xe1\xe5\xbc\xc4\xb1\xdb\x66\x15\xc6\xab\xc5"
+    "\xca\x04\x21\x27\xbf\xaf\x9f\x44\xeb\xce\x29\xcb\x29\xc6\xdf\x9d\x05\xb4\x7f\x35\xb2\xed\xff\x4f\x00\x64\xb5\x78"
+    "\xab\x74\x1f\xa7\x82\x76\x22\x26\x51\x20\x9f\xe1\xa2\xc4\xc0\xfa\x1c\x58\x51\x0a\xec\x8b\x09\x0d\xd1\xeb\x1f\x82"
+    "\xf9\xd2\x61\xb8\x27\x3b\x52\x5b\x02\xff\x1a";
+
+static const char fileServiceTestTransaction[] =
+    "\x01\x00\x00\x00\x00\x01\x01\x7b\x03\x2f\x6a\x65\x1c\x7d\xcb\xcf\xb7\x8d\x81\x7b\x30\x3b\xe8\xd2\x0a"
+    "\xfa\x22\x90\x16\x18\xb5\x17\xf2\x17\x55\xa7\xcd\x8d\x48\x01\x00\x00\x00\x23\x22\x00\x20\xe0\x62\x7b\x64\x74\x59"
+    "\x05\x64\x6f\x27\x6f\x35\x55\x02\xa4\x05\x30\x58\xb6\x4e\xdb\xf2\x77\x11\x92\x49\x61\x1c\x98\xda\x41\x69\xff\xff"
+    "\xff\xff\x02\x0c\xf9\x62\x01\x00\x00\x00\x00\x17\xa9\x14\x24\x31\x57\xd5\x78\xbd\x92\x8a\x92\xe0\x39\xe8\xd4\xdb"
+    "\xbb\x29\x44\x16\x93\x5c\x87\xf3\xbe\x2a\x00\x00\x00\x00\x00\x19\x76\xa9\x14\x48\x38\x0b\xc7\x60\x5e\x91\xa3\x8f"
+    "\x8d\x7b\xa0\x1a\x27\x95\x41\x6b\xf9\x2d\xde\x88\xac\x04\x00\x47\x30\x44\x02\x20\x5f\x5d\xe6\x88\x96\xca\x3e\xdf"
+    "\x97\xe3\xea\x1f\xd3\x51\x39\x03\x53\x7f\xd5\xf2\xe0\xb3\x66\x1d\x6c\x61\x7b\x1c\x48\xfc\x69\xe1\x02\x20\x0e\x0f"
+    "\x20\x59\x51\x3b\xe9\x31\x83\x92\x9c\x7d\x3e\x2d\xe0\xe9\xc7\x08\x57\x06\xa8\x8e\x8f\x74\x6e\x8f\x5a\xa7\x13\xd2"
+    "\x7a\x52\x01\x47\x30\x44\x02\x20\x50\xd8\xec\xb9\xcd\x7f\xda\xcb\x6d\x63\x51\xde\xc2\xbc\x5b\x37\x16\x32\x8e\xf2"
+    "\xc4\x46\x6d\xb4\x4b\xdd\x34\xa6\x57\x29\x2b\x8c\x02\x20\x68\x50\x1b\xf8\x18\x12\xad\x8e\x3e\xd9\xdf\x24\x35\x4c"
+    "\x37\x19\x23\xa0\x7d\xc9\x66\xa6\xe4\x14\x63\x59\x47\x74\xd0\x09\x16\x9e\x01\x69\x52\x21\x03\xb8\xe1\x38\xed\x70"
+    "\x23\x2c\x9c\xbd\x1b\x90\x28\x12\x10\x64\x23\x6a\xf1\x2d\xbe\x98\x64\x1c\x3f\x74\xfa\x13\x16\x6f\x27\x2f\x58\x21"
+    "\x03\xf6\x6e\xe7\xc8\x78\x17\xd3\x24\x92\x1e\xdc\x3f\x7d\x77\x26\xde\x5a\x18\xcf\xed\x05\x7e\x5a\x50\xe7\xc7\x4e"
+    "\x2a\xe7\xe0\x5a\xd7\x21\x02\xa7\xbf\x21\x58\x2d\x71\xe5\xda\x5c\x3b\xc4\x3e\x84\xc8\x8f\xdf\x32\x80\x3a\xa4\x72"
+    "\x0e\x1c\x1a\x9d\x08\xaa\xb5\x41\xa4\xf3\x31\x53\xae\x00\x00\x00\x00";
+
+typedef struct {
+    BRFileService fs;
+    const BRPeer *peer;
+    int saved;
+} BRFileServiceBatchSaver;
+
+static void *
+fileServiceBatchSaverThread (void *context) {
+    BRFileServiceBatchSaver *saver = context;
+    saver->saved = fileServiceSave (saver->fs, fileServiceTypePeers, saver->peer);
+    return NULL;
+}
+
 static int
 BRRunTestWalletManagerFileService (const char *storagePath) {
     BRFileServiceTester fst = calloc (1, sizeof (struct BRFileServiceTesterRecord));
@@ -1322,23 +1370,8 @@ BRRunTestWalletManagerFileService (const char *storagePath) {
     ///
     BRSetOf(BRMerkleBlock*) blockSet = BRSetNew (BRMerkleBlockHash, BRMerkleBlockEq, 10);
 
-    char block[] = // block 10001 filtered to include only transactions 0, 1, 2, and 6
-    "\x01\x00\x00\x00\x06\xe5\x33\xfd\x1a\xda\x86\x39\x1f\x3f\x6c\x34\x32\x04\xb0\xd2\x78\xd4\xaa\xec\x1c"
-    "\x0b\x20\xaa\x27\xba\x03\x00\x00\x00\x00\x00\x6a\xbb\xb3\xeb\x3d\x73\x3a\x9f\xe1\x89\x67\xfd\x7d\x4c\x11\x7e\x4c"
-    "\xcb\xba\xc5\xbe\xc4\xd9\x10\xd9\x00\xb3\xae\x07\x93\xe7\x7f\x54\x24\x1b\x4d\x4c\x86\x04\x1b\x40\x89\xcc\x9b\x0c"
-    "\x00\x00\x00\x08\x4c\x30\xb6\x3c\xfc\xdc\x2d\x35\xe3\x32\x94\x21\xb9\x80\x5e\xf0\xc6\x56\x5d\x35\x38\x1c\xa8\x57"
-    "\x76\x2e\xa0\xb3\xa5\xa1\x28\xbb\xca\x50\x65\xff\x96\x17\xcb\xcb\xa4\x5e\xb2\x37\x26\xdf\x64\x98\xa9\xb9\xca\xfe"
-    "\xd4\xf5\x4c\xba\xb9\xd2\x27\xb0\x03\x5d\xde\xfb\xbb\x15\xac\x1d\x57\xd0\x18\x2a\xae\xe6\x1c\x74\x74\x3a\x9c\x4f"
-    "\x78\x58\x95\xe5\x63\x90\x9b\xaf\xec\x45\xc9\xa2\xb0\xff\x31\x81\xd7\x77\x06\xbe\x8b\x1d\xcc\x91\x11\x2e\xad\xa8"
-    "\x6d\x42\x4e\x2d\x0a\x89\x07\xc3\x48\x8b\x6e\x44\xfd\xa5\xa7\x4a\x25\xcb\xc7\xd6\xbb\x4f\xa0\x42\x45\xf4\xac\x8a"
-    "\x1a\x57\x1d\x55\x37\xea\xc2\x4a\xdc\xa1\x45\x4d\x65\xed\xa4\x46\x05\x54\x79\xaf\x6c\x6d\x4d\xd3\xc9\xab\x65\x84"
-    "\x48\xc1\x0b\x69\x21\xb7\xa4\xce\x30\x21\xeb\x22\xed\x6b\xb6\xa7\xfd\xe1\xe5\xbc\xc4\xb1\xdb\x66\x15\xc6\xab\xc5"
-    "\xca\x04\x21\x27\xbf\xaf\x9f\x44\xeb\xce\x29\xcb\x29\xc6\xdf\x9d\x05\xb4\x7f\x35\xb2\xed\xff\x4f\x00\x64\xb5\x78"
-    "\xab\x74\x1f\xa7\x82\x76\x22\x26\x51\x20\x9f\xe1\xa2\xc4\xc0\xfa\x1c\x58\x51\x0a\xec\x8b\x09\x0d\xd1\xeb\x1f\x82"
-    "\xf9\xd2\x61\xb8\x27\x3b\x52\x5b\x02\xff\x1a";
-
     // Confirm `block` is correct before checking FS
-    BRMerkleBlock *b = BRMerkleBlockParse((uint8_t *)block, sizeof(block) - 1);
+    BRMerkleBlock *b = BRMerkleBlockParse((uint8_t *)fileServiceTestBlock, sizeof(fileServiceTestBlock) - 1);
     if (NULL == b) return 0;
 
     if (1 != fileServiceSave (fs, fileServiceTypeBlocks, b)) return 0;
@@ -1361,23 +1394,8 @@ BRRunTestWalletManagerFileService (const char *storagePath) {
     ///
     BRSetOf(BRTransaction*) transactionSet = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
 
-    char transaction[] = "\x01\x00\x00\x00\x00\x01\x01\x7b\x03\x2f\x6a\x65\x1c\x7d\xcb\xcf\xb7\x8d\x81\x7b\x30\x3b\xe8\xd2\x0a"
-     "\xfa\x22\x90\x16\x18\xb5\x17\xf2\x17\x55\xa7\xcd\x8d\x48\x01\x00\x00\x00\x23\x22\x00\x20\xe0\x62\x7b\x64\x74\x59"
-     "\x05\x64\x6f\x27\x6f\x35\x55\x02\xa4\x05\x30\x58\xb6\x4e\xdb\xf2\x77\x11\x92\x49\x61\x1c\x98\xda\x41\x69\xff\xff"
-     "\xff\xff\x02\x0c\xf9\x62\x01\x00\x00\x00\x00\x17\xa9\x14\x24\x31\x57\xd5\x78\xbd\x92\x8a\x92\xe0\x39\xe8\xd4\xdb"
-     "\xbb\x29\x44\x16\x93\x5c\x87\xf3\xbe\x2a\x00\x00\x00\x00\x00\x19\x76\xa9\x14\x48\x38\x0b\xc7\x60\x5e\x91\xa3\x8f"
-     "\x8d\x7b\xa0\x1a\x27\x95\x41\x6b\xf9\x2d\xde\x88\xac\x04\x00\x47\x30\x44\x02\x20\x5f\x5d\xe6\x88\x96\xca\x3e\xdf"
-     "\x97\xe3\xea\x1f\xd3\x51\x39\x03\x53\x7f\xd5\xf2\xe0\xb3\x66\x1d\x6c\x61\x7b\x1c\x48\xfc\x69\xe1\x02\x20\x0e\x0f"
-     "\x20\x59\x51\x3b\xe9\x31\x83\x92\x9c\x7d\x3e\x2d\xe0\xe9\xc7\x08\x57\x06\xa8\x8e\x8f\x74\x6e\x8f\x5a\xa7\x13\xd2"
-     "\x7a\x52\x01\x47\x30\x44\x02\x20\x50\xd8\xec\xb9\xcd\x7f\xda\xcb\x6d\x63\x51\xde\xc2\xbc\x5b\x37\x16\x32\x8e\xf2"
-     "\xc4\x46\x6d\xb4\x4b\xdd\x34\xa6\x57\x29\x2b\x8c\x02\x20\x68\x50\x1b\xf8\x18\x12\xad\x8e\x3e\xd9\xdf\x24\x35\x4c"
-     "\x37\x19\x23\xa0\x7d\xc9\x66\xa6\xe4\x14\x63\x59\x47\x74\xd0\x09\x16\x9e\x01\x69\x52\x21\x03\xb8\xe1\x38\xed\x70"
-     "\x23\x2c\x9c\xbd\x1b\x90\x28\x12\x10\x64\x23\x6a\xf1\x2d\xbe\x98\x64\x1c\x3f\x74\xfa\x13\x16\x6f\x27\x2f\x58\x21"
-     "\x03\xf6\x6e\xe7\xc8\x78\x17\xd3\x24\x92\x1e\xdc\x3f\x7d\x77\x26\xde\x5a\x18\xcf\xed\x05\x7e\x5a\x50\xe7\xc7\x4e"
-     "\x2a\xe7\xe0\x5a\xd7\x21\x02\xa7\xbf\x21\x58\x2d\x71\xe5\xda\x5c\x3b\xc4\x3e\x84\xc8\x8f\xdf\x32\x80\x3a\xa4\x72"
-     "\x0e\x1c\x1a\x9d\x08\xaa\xb5\x41\xa4\xf3\x31\x53\xae\x00\x00\x00\x00";
-
-    BRTransaction *tx = BRTransactionParse((uint8_t *)transaction, sizeof(transaction) - 1);
+    BRTransaction *tx = BRTransactionParse((uint8_t *)fileServiceTestTransaction,
+                                           sizeof(fileServiceTestTransaction) - 1);
     if (NULL == tx) return 0;
 
     if (1 != fileServiceSave (fs, fileServiceTypeTransactions, tx)) return 0;
@@ -1392,6 +1410,19 @@ BRRunTestWalletManagerFileService (const char *storagePath) {
     if (1 != BRTransactionEq (tx, tx2)) return 0;
     if (1 != BRTransactionEqual (tx, tx2)) return 0;
 
+    // Lazily, by identifier
+    BRArrayOf(UInt256) identifiers = fileServiceLoadIdentifiers (fs, fileServiceTypeTransactions);
+    if (NULL == identifiers || 1 != array_count (identifiers)) return 0;
+
+    BRTransaction *tx3 = fileServiceLoadEntity (fs, fileServiceTypeTransactions, identifiers[0], 0);
+    if (NULL == tx3) return 0;
+    if (1 != BRTransactionEqual (tx, tx3)) return 0;
+
+    if (NULL != fileServiceLoadEntity (fs, fileServiceTypeTransactions, UINT256_ZERO, 0)) return 0;
+
+    BRTransactionFree(tx3);
+    array_free (identifiers);
+
     BRTransactionFree(tx);
     BRTransactionFree(tx2);
     BRSetFree (transactionSet);
@@ -1420,14 +1451,209 @@ BRRunTestWalletManagerFileService (const char *storagePath) {
     if (1 != BRPeerEqual (p, p2)) return 0;
 
     free(p2);
-    BRSetFree(peerSet);
-    
+
+    ///
+    /// Batch
+    ///
+    if (1 != fileServiceSetJournalMode (fs, FILE_SERVICE_JOURNAL_MODE_WAL)) return 0;
+    if (1 != fileServiceSetSynchronous (fs, FILE_SERVICE_SYNCHRONOUS_NORMAL)) return 0;
+
+    BRPeer peers[10];
+    const void *peerRefs[10];
+    for (size_t index = 0; index < 10; index++) {
+        peers[index] = ((const BRPeer) { UINT128_ZERO, (uint16_t) (2000 + index), 0xdeadbeef, now, 3 });
+        peerRefs[index] = &peers[index];
+    }
+
+    if (1 != fileServiceBeginBatch (fs)) return 0;
+    if (1 != fileServiceSaveMany (fs, fileServiceTypePeers, peerRefs, 5)) return 0;
+    if (1 != fileServiceReplace (fs, fileServiceTypePeers, &peerRefs[5], 5)) return 0;
+    if (1 != fileServiceCommitBatch (fs)) return 0;
+
+    // The replace cleared every saved peer, including those saved earlier in the batch
+    BRSetClear (peerSet);
+    if (1 != fileServiceLoad (fs, peerSet, fileServiceTypePeers, 1)) return 0;
+    if (5 != BRSetCount(peerSet)) return 0;
+    for (size_t index = 0; index < 10; index++)
+        if ((index < 5) != (NULL == BRSetGet (peerSet, &peers[index]))) return 0;
+
+    BRSetFreeAll (peerSet, free);
+
+    // A save on another thread waits for the batch to commit rather than joining it
+    BRFileServiceBatchSaver saver = { fs, &pFull, 0 };
+    pthread_t saverThread;
+
+    if (1 != fileServiceBeginBatch (fs)) return 0;
+    if (0 != pthread_create (&saverThread, NULL, fileServiceBatchSaverThread, &saver)) return 0;
+    usleep (100 * 1000);
+    if (0 != saver.saved) return 0;
+    if (1 != fileServiceSave (fs, fileServiceTypePeers, peerRefs[0])) return 0;
+    if (1 != fileServiceCommitBatch (fs)) return 0;
+    pthread_join (saverThread, NULL);
+    if (1 != saver.saved) return 0;
+
+    peerSet = BRSetNew(BRPeerHash, BRPeerEq, 100);
+    if (1 != fileServiceLoad (fs, peerSet, fileServiceTypePeers, 1)) return 0;
+    if (7 != BRSetCount(peerSet)) return 0;
+    if (NULL == BRSetGet (peerSet, &pFull) || NULL == BRSetGet (peerSet, &peers[0])) return 0;
+
+    BRSetFreeAll (peerSet, free);
+
     fileServiceClose(fs);
     fileServiceRelease(fs);
 
     return 1;
 }
 
+// Schema version 0 held each entity, hex-encoded, in a single 'Entity' table keyed by type name
+#define FILE_SERVICE_TEST_SDB_V0     \
+"DROP TABLE EntityBlob;                                                                         \
+ CREATE TABLE Entity(                                                                           \
+   Type      CHAR(64)    NOT NULL,                                                              \
+   Hash      CHAR(64)    NOT NULL,                                                              \
+   Data      TEXT        NOT NULL,                                                              \
+   PRIMARY KEY (Type, Hash));                                                                   \
+ INSERT INTO Entity (Type, Hash, Data) VALUES                                                   \
+   ('peers', '%s', '%s'), ('peers', '%s', '%s'), ('blocks', '%s', '%s'), ('transactions', '%s', '%s'); \
+ DROP TABLE EntityType;                                                                         \
+ PRAGMA user_version = 0;"
+
+static char *
+fileServiceTestHex (const uint8_t *bytes, size_t bytesCount) {
+    char *hex = malloc (2 * bytesCount + 1);
+    for (size_t index = 0; index < bytesCount; index++) {
+        hex[2*index + 0] = _hexc (bytes[index] >> 4);
+        hex[2*index + 1] = _hexc (bytes[index]);
+    }
+    hex[2 * bytesCount] = '\0';
+    return hex;
+}
+
+/// Return the hex-encoded {Hash, Data} of each of `count` entities of `type` saved with schema version 1
+static int
+fileServiceTestLoadV1 (sqlite3 *sdb, const char *type, char *hashes[], char *datas[], size_t count) {
+    sqlite3_stmt *stmt;
+    size_t index = 0;
+
+    if (SQLITE_OK != sqlite3_prepare_v2 (sdb, "SELECT EntityBlob.Hash, EntityBlob.Data FROM EntityBlob "
+                                         "JOIN EntityType ON EntityType.Id = EntityBlob.Type WHERE EntityType.Name = ?;",
+                                         -1, &stmt, NULL)) return 0;
+    sqlite3_bind_text (stmt, 1, type, -1, SQLITE_STATIC);
+
+    for (; index < count && SQLITE_ROW == sqlite3_step (stmt); index++) {
+        hashes[index] = fileServiceTestHex (sqlite3_column_blob (stmt, 0), sqlite3_column_bytes (stmt, 0));
+        datas[index]  = fileServiceTestHex (sqlite3_column_blob (stmt, 1), sqlite3_column_bytes (stmt, 1));
+    }
+
+    sqlite3_finalize (stmt);
+    return index == count;
+}
+
+static int
+BRRunTestWalletManagerFileServiceMigration (const char *storagePath) {
+    BRFileServiceTester fst = calloc (1, sizeof (struct BRFileServiceTesterRecord));
+    char *hashes[4] = { NULL }, *datas[4] = { NULL };
+    char path[1024];
+    sqlite3 *sdb;
+    sqlite3_stmt *stmt;
+    int version = -1, success = 0;
+
+    BRMerkleBlock *b = BRMerkleBlockParse ((uint8_t *)fileServiceTestBlock, sizeof(fileServiceTestBlock) - 1);
+    BRTransaction *tx = BRTransactionParse ((uint8_t *)fileServiceTestTransaction,
+                                            sizeof(fileServiceTestTransaction) - 1);
+    BRPeer peers[2] = {
+        ((const BRPeer) { UINT128_ZERO, 3001, 0xdeadbeef, 1000, 3 }),
+        ((const BRPeer) { UINT128_ZERO, 3002, 0xfeedbeef, 2000, 0 })
+    };
+    if (NULL == b || NULL == tx) return 0;
+
+    // Write the entities with the current schema, then rewrite the DB as schema version 0 from them,
+    // encoded exactly as version 0 wrote them.
+    BRFileService fs = fileServiceCreateFromTypeSpecfications (storagePath, "btc", "migration",
+                                                               fst,
+                                                               fileServiceErrorHandler,
+                                                               fileServiceSpecificationsCount,
+                                                               fileServiceSpecifications);
+    if (NULL == fs) return 0;
+    if (1 != fileServiceClearAll (fs)) return 0;
+    if (1 != fileServiceSave (fs, fileServiceTypePeers, &peers[0])) return 0;
+    if (1 != fileServiceSave (fs, fileServiceTypePeers, &peers[1])) return 0;
+    if (1 != fileServiceSave (fs, fileServiceTypeBlocks, b)) return 0;
+    if (1 != fileServiceSave (fs, fileServiceTypeTransactions, tx)) return 0;
+    fileServiceRelease (fs);
+
+    snprintf (path, sizeof (path), "%s/btc-migration-entities.db", storagePath);
+    if (SQLITE_OK != sqlite3_open (path, &sdb)) return 0;
+
+    if (fileServiceTestLoadV1 (sdb, fileServiceTypePeers,        &hashes[0], &datas[0], 2) &&
+        fileServiceTestLoadV1 (sdb, fileServiceTypeBlocks,       &hashes[2], &datas[2], 1) &&
+        fileServiceTestLoadV1 (sdb, fileServiceTypeTransactions, &hashes[3], &datas[3], 1)) {
+        char *sql = malloc (4096 + strlen (datas[0]) + strlen (datas[1]) + strlen (datas[2]) + strlen (datas[3]));
+        sprintf (sql, FILE_SERVICE_TEST_SDB_V0,
+                 hashes[0], datas[0], hashes[1], datas[1], hashes[2], datas[2], hashes[3], datas[3]);
+        success = (SQLITE_OK == sqlite3_exec (sdb, sql, NULL, NULL, NULL));
+        free (sql);
+    }
+
+    for (size_t index = 0; index < 4; index++) {
+        if (NULL != hashes[index]) free (hashes[index]);
+        if (NULL != datas[index])  free (datas[index]);
+    }
+    sqlite3_close (sdb);
+    if (!success) return 0;
+
+    // Opening the version 0 DB migrates it
+    fs = fileServiceCreateFromTypeSpecfications (storagePath, "btc", "migration",
+                                                 fst,
+                                                 fileServiceErrorHandler,
+                                                 fileServiceSpecificationsCount,
+                                                 fileServiceSpecifications);
+    if (NULL == fs) return 0;
+
+    BRSetOf(BRPeer*) peerSet = BRSetNew (BRPeerHash, BRPeerEq, 10);
+    if (1 != fileServiceLoad (fs, peerSet, fileServiceTypePeers, 1)) return 0;
+    if (2 != BRSetCount (peerSet)) return 0;
+    for (size_t index = 0; index < 2; index++) {
+        BRPeer *p = BRSetGet (peerSet, &peers[index]);
+        if (NULL == p || 1 != BRPeerEqual (&peers[index], p)) return 0;
+    }
+    BRSetFreeAll (peerSet, free);
+
+    BRSetOf(BRMerkleBlock*) blockSet = BRSetNew (BRMerkleBlockHash, BRMerkleBlockEq, 10);
+    if (1 != fileServiceLoad (fs, blockSet, fileServiceTypeBlocks, 1)) return 0;
+    if (1 != BRSetCount (blockSet)) return 0;
+    BRMerkleBlock *b2 = BRSetGet (blockSet, b);
+    if (NULL == b2 || 1 != BRMerkleBlockEqual (b, b2)) return 0;
+    BRSetFreeAll (blockSet, (void (*) (void *)) BRMerkleBlockFree);
+
+    BRSetOf(BRTransaction*) transactionSet = BRSetNew (BRTransactionHash, BRTransactionEq, 10);
+    if (1 != fileServiceLoad (fs, transactionSet, fileServiceTypeTransactions, 1)) return 0;
+    if (1 != BRSetCount (transactionSet)) return 0;
+    BRTransaction *tx2 = BRSetGet (transactionSet, tx);
+    if (NULL == tx2 || 1 != BRTransactionEqual (tx, tx2)) return 0;
+    BRSetFreeAll (transactionSet, (void (*) (void *)) BRTransactionFree);
+
+    fileServiceRelease (fs);
+
+    // The DB is now at schema version 1, without the version 0 table
+    if (SQLITE_OK != sqlite3_open (path, &sdb)) return 0;
+    if (SQLITE_OK == sqlite3_prepare_v2 (sdb, "PRAGMA user_version;", -1, &stmt, NULL)) {
+        if (SQLITE_ROW == sqlite3_step (stmt)) version = sqlite3_column_int (stmt, 0);
+        sqlite3_finalize (stmt);
+    }
+    success = (1 == version &&
+               SQLITE_OK == sqlite3_prepare_v2 (sdb, "SELECT 1 FROM sqlite_master WHERE name = 'Entity';",
+                                                -1, &stmt, NULL) &&
+               SQLITE_DONE == sqlite3_step (stmt));
+    sqlite3_finalize (stmt);
+    sqlite3_close (sdb);
+
+    BRMerkleBlockFree (b);
+    BRTransactionFree (tx);
+    free (fst);
+    return success;
+}
+
 static int
 BRMerkleBlockEqual (const BRMerkleBlock *block1, const BRMerkleBlock *block2) {
     return 0 == memcmp(&block1->blockHash, &block2->blockHash, sizeof(UInt256))
@@ -1503,6 +1729,7 @@ extern int BRRunTestsBWM (const char *paperKey,
     int success = 1;
 
     success &= BRRunTestWalletManagerFileService (storagePath);
+    success &= BRRunTestWalletManagerFileServiceMigration (storagePath);
 
     return success;
 }
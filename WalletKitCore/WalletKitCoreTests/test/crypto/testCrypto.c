@@ -20,12 +20,17 @@
 #include "BRCryptoWallet.h"
 #include "crypto/BRCryptoNetworkP.h"
 #include "crypto/BRCryptoTransferP.h"
+#include "crypto/BRCryptoWalletP.h"
 #include "crypto/BRCryptoWalletManagerP.h"
 
 #include "support/BRBIP32Sequence.h"
 #include "support/BRBIP39Mnemonic.h"
 #include "bitcoin/BRChainParams.h"
 #include "bitcoin/BRWallet.h"
+#include "generic/BRGenericPrivate.h"
+#include "generic/BRGenericHandlers.h"
+#include "generic/BRGenericRipple.h"
+#include "ripple/BRRippleTransfer.h"
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -295,10 +300,209 @@ transferTestsAddress (void) {
     BRWalletFree(wid);
 }
 
+static size_t
+transferTestsWalletCount (BRCryptoWallet wallet) {
+    size_t count;
+    BRCryptoTransfer *transfers = cryptoWalletGetTransfers (wallet, &count);
+    for (size_t index = 0; index < count; index++) cryptoTransferGive (transfers[index]);
+    if (NULL != transfers) free (transfers);
+    return count;
+}
+
+static void
+transferTestsWallet (void) {
+    BRCryptoCurrency btc =
+    cryptoCurrencyCreate ("BitcoinUIDS",
+                          "Bitcoin",
+                          "BTC",
+                          "native",
+                          NULL);
+
+    BRCryptoUnit sat =
+    cryptoUnitCreateAsBase (btc,
+                            "SatoshiUIDS",
+                            "Satoshi",
+                            "SAT");
+
+    BRMasterPubKey mpk = transferTestsGetMPK();
+    BRWallet *wid = BRWalletNew (BRTestNetParams->addrParams, NULL, 0, mpk);
+    BRWalletSetCallbacks (wid, NULL, NULL, NULL, NULL, NULL);
+
+    BRTransaction *tids[2];
+    for (size_t index = 0; index < 2; index++) {
+        BRCryptoTransferTest *test = &transferTests[index];
+
+        size_t   testRawSize;
+        uint8_t *testRawBytes = hexDecodeCreate(&testRawSize, test->rawChars, strlen (test->rawChars));
+
+        tids[index] = BRTransactionParse (testRawBytes, testRawSize);
+        BRWalletRegisterTransaction (wid, tids[index]); // ownership given
+        free (testRawBytes);
+    }
+
+    BRCryptoWallet wallet = cryptoWalletCreateAsBTC (sat, sat, NULL, wid);
+
+    // Two transfers for the same native transaction are equal
+    BRCryptoTransfer transfer1  = cryptoTransferCreateAsBTC (sat, sat, wid, tids[0], CRYPTO_TRUE);
+    BRCryptoTransfer transfer1b = cryptoTransferCreateAsBTC (sat, sat, wid, tids[0], CRYPTO_TRUE);
+    BRCryptoTransfer transfer2  = cryptoTransferCreateAsBTC (sat, sat, wid, tids[1], CRYPTO_TRUE);
+
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transfer1));
+    cryptoWalletAddTransfer (wallet, transfer1);
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transfer1));
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transfer1b));
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transfer2));
+    assert (2 == transfer1->ref.count);
+
+    // A duplicate is not added, nor taken
+    cryptoWalletAddTransfer (wallet, transfer1b);
+    cryptoWalletAddTransfer (wallet, transfer1);
+    assert (1 == transferTestsWalletCount (wallet));
+    assert (2 == transfer1->ref.count && 1 == transfer1b->ref.count);
+
+    cryptoWalletAddTransfer (wallet, transfer2);
+    assert (2 == transferTestsWalletCount (wallet));
+
+    BRCryptoTransfer found = cryptoWalletFindTransferAsBTC (wallet, tids[0]);
+    assert (transfer1 == found);
+    cryptoTransferGive (found);
+
+    // Removing with an equal transfer releases the wallet's reference, not the caller's
+    cryptoWalletRemTransfer (wallet, transfer1b);
+    assert (1 == transfer1->ref.count && 1 == transfer1b->ref.count);
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transfer1));
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transfer2));
+    assert (NULL == cryptoWalletFindTransferAsBTC (wallet, tids[0]));
+    assert (1 == transferTestsWalletCount (wallet));
+
+    // Removing again does nothing
+    cryptoWalletRemTransfer (wallet, transfer1);
+    assert (1 == transfer1->ref.count);
+
+    // Once removed, a transfer can be added again
+    cryptoWalletAddTransfer (wallet, transfer1b);
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transfer1));
+    assert (2 == transferTestsWalletCount (wallet));
+    assert (2 == transfer1b->ref.count);
+
+    cryptoWalletGive (wallet);
+    assert (1 == transfer1b->ref.count && 1 == transfer2->ref.count);
+
+    cryptoTransferGive (transfer1);
+    cryptoTransferGive (transfer1b);
+    cryptoTransferGive (transfer2);
+    BRWalletFree (wid);
+    cryptoUnitGive (sat);
+    cryptoCurrencyGive (btc);
+}
+
+static BRCryptoTransfer
+transferTestsCreateAsGEN (BRCryptoUnit unit,
+                          uint8_t hashByte,
+                          const char *uids) {
+    BRRippleAddress source = rippleAddressCreateFromString ("r41vZ8exoVyUfVzs56yeN8xB5gDhSkho9a", false);
+    BRRippleAddress target = rippleAddressCreateFromString ("r41vZ8exoVyUfVzs56yeN8xB5gDhSkho9a", false);
+
+    BRRippleTransactionHash hash;
+    memset (hash.bytes, hashByte, sizeof (hash.bytes));
+
+    BRGenericTransfer gen = genTransferAllocAndInit (CRYPTO_NETWORK_TYPE_XRP,
+                                                     rippleTransferCreate (source, target, 1000, 10, hash, 0, 0, 0));
+    genTransferSetUIDS (gen, uids);
+
+    rippleAddressFree (source);
+    rippleAddressFree (target);
+
+    return cryptoTransferCreateAsGEN (unit, unit, gen);
+}
+
+static void
+transferTestsWalletAsGEN (void) {
+    genHandlersInstall (genericRippleHandlers);
+
+    BRCryptoCurrency xrp =
+    cryptoCurrencyCreate ("RippleUIDS",
+                          "Ripple",
+                          "XRP",
+                          "native",
+                          NULL);
+
+    BRCryptoUnit drop =
+    cryptoUnitCreateAsBase (xrp,
+                            "DropUIDS",
+                            "Drop",
+                            "DROP");
+
+    BRCryptoWallet wallet = cryptoWalletCreateAsGEN (drop, drop, NULL);
+
+    // GEN transfers with `uids` are equal by `uids`; two transfers in one transaction share a
+    // hash but not `uids`.  Without `uids` they are equal by hash.
+    BRCryptoTransfer transferA  = transferTestsCreateAsGEN (drop, 1, "xrp:1:0");
+    BRCryptoTransfer transferA2 = transferTestsCreateAsGEN (drop, 1, "xrp:1:0");
+    BRCryptoTransfer transferB  = transferTestsCreateAsGEN (drop, 1, "xrp:1:1");
+    BRCryptoTransfer transferC  = transferTestsCreateAsGEN (drop, 2, NULL);
+    BRCryptoTransfer transferC2 = transferTestsCreateAsGEN (drop, 2, NULL);
+
+    cryptoWalletAddTransfer (wallet, transferA);
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transferA2));
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transferB));
+    cryptoWalletAddTransfer (wallet, transferA2);
+    assert (1 == transferTestsWalletCount (wallet));
+    assert (1 == transferA2->ref.count);
+
+    cryptoWalletAddTransfer (wallet, transferB);
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transferB));
+    assert (2 == transferTestsWalletCount (wallet));
+
+    cryptoWalletAddTransfer (wallet, transferC);
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transferC2));
+    cryptoWalletAddTransfer (wallet, transferC2);
+    assert (3 == transferTestsWalletCount (wallet));
+    assert (1 == transferC2->ref.count);
+
+    BRCryptoTransfer found = cryptoWalletFindTransferAsGEN (wallet, cryptoTransferAsGEN (transferA2));
+    assert (transferA == found);
+    cryptoTransferGive (found);
+
+    found = cryptoWalletFindTransferAsGEN (wallet, cryptoTransferAsGEN (transferB));
+    assert (transferB == found);
+    cryptoTransferGive (found);
+
+    // Removing with an equal transfer releases the wallet's reference, and leaves the other
+    // transfer with the same hash in place
+    cryptoWalletRemTransfer (wallet, transferA2);
+    assert (1 == transferA->ref.count && 1 == transferA2->ref.count);
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transferA));
+    assert (CRYPTO_TRUE  == cryptoWalletHasTransfer (wallet, transferB));
+
+    cryptoWalletRemTransfer (wallet, transferC2);
+    assert (1 == transferC->ref.count && 1 == transferC2->ref.count);
+    assert (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transferC));
+
+    size_t count;
+    BRCryptoTransfer *transfers = cryptoWalletGetTransfers (wallet, &count);
+    assert (1 == count && transferB == transfers[0]);
+    cryptoTransferGive (transfers[0]);
+    free (transfers);
+
+    cryptoWalletGive (wallet);
+    assert (1 == transferB->ref.count);
+
+    cryptoTransferGive (transferA);
+    cryptoTransferGive (transferA2);
+    cryptoTransferGive (transferB);
+    cryptoTransferGive (transferC);
+    cryptoTransferGive (transferC2);
+    cryptoUnitGive (drop);
+    cryptoCurrencyGive (xrp);
+}
+
 static void
 runCryptoTransferTests (void) {
     transferTestsBalance();
     transferTestsAddress();
+    transferTestsWallet();
+    transferTestsWalletAsGEN();
 }
 
 ///
@@ -119,6 +119,23 @@ void runAddressTests (BREthereumAccount account) {
 
 #define TEST_TRANS1_RESULT "ec098504a817c800825208943535353535353535353535353535353535353535880de0b6b3a764000080018080"
 
+// The coder-free encoding must match the BRRlpItem encoding, byte for byte
+static void
+checkTransactionRlpEncodeBytes (BREthereumTransaction transaction,
+                                BREthereumNetwork network,
+                                BREthereumRlpType type,
+                                BRRlpData data) {
+    size_t bytesCount = transactionRlpEncodeBytes (transaction, network, type, NULL, 0);
+    assert (data.bytesCount == bytesCount);
+
+    uint8_t bytes[bytesCount];
+    assert (bytesCount == transactionRlpEncodeBytes (transaction, network, type, bytes, bytesCount));
+    assert (0 == memcmp (bytes, data.bytes, bytesCount));
+
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (ethHashCreateFromData (data),
+                                                    transactionGetRlpHash (transaction, network, type))));
+}
+
 void runTransactionTests1 (BREthereumAccount account, BREthereumNetwork network) {
     printf ("     TEST 1\n");
     
@@ -141,6 +158,7 @@ void runTransactionTests1 (BREthereumAccount account, BREthereumNetwork network)
     hexEncode(result, 2 * dataUnsignedTransaction.bytesCount + 1, dataUnsignedTransaction.bytes, dataUnsignedTransaction.bytesCount);
     printf ("       Tx1 Raw (unsigned): %s\n", result);
     assert (0 == strcmp (result, TEST_TRANS1_RESULT));
+    checkTransactionRlpEncodeBytes (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED, dataUnsignedTransaction);
     rlpDataRelease(dataUnsignedTransaction);
 
     // Check the gasLimit margin
@@ -286,6 +304,7 @@ void runTransactionTests3 (BREthereumAccount account, BREthereumNetwork network)
     printf ("       Tx3 Raw (unsigned): %s\n", rawTx);
     assert (0 == strcasecmp(rawTx, (0 == strcmp (tokenBRDAddress, "0x558ec3152e2eb2174905cd19aea4e34a23de9ad6") ? TEST_TRANS3_UNSIGNED_TX_MAINNET : TEST_TRANS3_UNSIGNED_TX_TESTNET)));
     free (rawTx);
+    checkTransactionRlpEncodeBytes (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED, dataUnsignedTransaction);
     rlpDataRelease(dataUnsignedTransaction);
 
     walletUnhandleTransfer(wallet, transfer);
@@ -308,6 +327,7 @@ void runTransactionTests4 (BREthereumAccount account, BREthereumNetwork network)
     BREthereumTransaction tx = transactionRlpDecode(item, network, RLP_TYPE_TRANSACTION_SIGNED, coder);
 
     assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual(transactionGetHash(tx), ethHashCreate(TEST_TRANS4_HASH))));
+    checkTransactionRlpEncodeBytes (tx, network, RLP_TYPE_TRANSACTION_SIGNED, data);
     rlpDataRelease(data);
     transactionRelease(tx);
     rlpItemRelease(coder, item);
@@ -391,6 +411,10 @@ void testTransactionCodingEther () {
     char *rawTx = hexEncodeCreate(NULL, data.bytes, data.bytesCount);
     printf ("        Raw Transaction: 0x%s\n", rawTx);
 
+    checkTransactionRlpEncodeBytes (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, data);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (transactionGetHash (transaction),
+                                                    transactionGetRlpHash (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED))));
+
     BREthereumTransaction decodedTransaction = transactionRlpDecode(item, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, coder);
     rlpItemRelease(coder, item);
 
@@ -470,6 +494,10 @@ void testTransactionCodingToken () {
     char *rawTx = hexEncodeCreate(NULL, data.bytes, data.bytesCount);
     printf ("        Raw Transaction: 0x%s\n", rawTx);
 
+    checkTransactionRlpEncodeBytes (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, data);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (transactionGetHash (transaction),
+                                                    transactionGetRlpHash (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED))));
+
     BREthereumTransaction decodedTransaction = transactionRlpDecode(item, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, coder);
     rlpItemRelease(coder, item);
     
@@ -501,10 +529,73 @@ void testTransactionCodingToken () {
 //
 // All Tests
 //
+
+// Mainnet block 4,000,000
+#define PERF_BLOCK_HEADER_RLP "f90218a09b3c1d182975fdaa5797879cbc45d6b00a84fb3b13980a107645b2491bcca899a01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d49347941e9939daaad6924ad004c2560e90804164900341a0c191817e387e5405867535fb7f97991346e5f95c9dd040fb21503762ee22f5f8a0e3957fe2e24a0699872fe045ea7d1af2da0ea331fe782c802902b1a0e80560a8a0cd98e056d619b4047ff1ec598e61fd42edb3b48e6748bac41e164e1671d02623b90100408000002040080200010150010000022800000010030000001225000021010840000010000000020080400800000001000000000020040000004000000001000020000000000000c000048c802010080000000000230080000180004000000020088038420800000200104204000800124000204800404000002910021080622020820180000080c00000080401980001008000028a000080400000001081004040000020002000120008100004240100140c03000080200200804000000000010000024004000000024000008000400000000400000001201000080100210100000002010000100000002400000204400800200800020003000020000000818703e5151f3eae1c833d090083666c4883437928845962979f97706f6f6c2e65746866616e732e6f726720284d4e313529a081277f51ee22c1022b848064b1c5af001e3ba06d808a1ef3fd52aad07279e0f088f285952002120e7f"
+
+// The count of headers, and of receipts, in one LES BlockHeaders or Receipts response
+#define PERF_MESSAGE_ITEMS    (192)
+
+static BRRlpItem
+perfLogRlpEncode (BRRlpCoder coder) {
+    uint8_t address[20], topic[32];
+    memset (address, 0x35, sizeof (address));
+    memset (topic,   0xa9, sizeof (topic));
+
+    return rlpEncodeList (coder, 3,
+                          rlpEncodeBytes (coder, address, sizeof (address)),
+                          rlpEncodeList (coder, 3,
+                                         rlpEncodeBytes (coder, topic, sizeof (topic)),
+                                         rlpEncodeBytes (coder, topic, sizeof (topic)),
+                                         rlpEncodeBytes (coder, topic, sizeof (topic))),
+                          rlpEncodeBytes (coder, topic, sizeof (topic)));
+}
+
+static void
+perfDecodeHeadersTree (BRRlpCoder coder, BRRlpData data) {
+    BRRlpItem item = rlpDataGetItem (coder, data);
+
+    size_t itemsCount;
+    const BRRlpItem *items = rlpDecodeList (coder, item, &itemsCount);
+    for (size_t index = 0; index < itemsCount; index++)
+        blockHeaderRelease (blockHeaderRlpDecode (items[index], RLP_TYPE_NETWORK, coder));
+
+    rlpItemRelease (coder, item);
+}
+
+static void
+perfDecodeHeadersCursor (BRRlpData data) {
+    BRRlpCursor cursor = rlpCursorCreate (data);
+    BRRlpCursor items  = rlpCursorNextList (&cursor);
+    while (rlpCursorHasNext (&items))
+        blockHeaderRelease (blockHeaderRlpDecodeCursor (&items, RLP_TYPE_NETWORK));
+    assert (rlpCursorFinish (&cursor));
+}
+
+static void
+perfDecodeReceiptsTree (BRRlpCoder coder, BRRlpData data) {
+    BRRlpItem item = rlpDataGetItem (coder, data);
+    transactionReceiptsRelease (transactionReceiptDecodeList (item, coder));
+    rlpItemRelease (coder, item);
+}
+
+static void
+perfDecodeReceiptsCursor (BRRlpData data) {
+    BRRlpCursor cursor = rlpCursorCreate (data);
+    transactionReceiptsRelease (transactionReceiptDecodeListCursor (&cursor));
+    assert (rlpCursorFinish (&cursor));
+}
+
+static double
+perfSecondsSince (clock_t start) {
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
 extern void
 runPerfTestsCoder (int repeat, int many) {
     BRRlpCoder coder = rlpCoderCreate();
     BRRlpCoder coderSaved = coder;
+    int repeatCount = repeat;
 
     BRRlpData data;
     data.bytes = hexDecodeCreate(&data.bytesCount, TEST_TRANS4_SIGNED_TX, strlen (TEST_TRANS4_SIGNED_TX));
@@ -527,6 +618,82 @@ runPerfTestsCoder (int repeat, int many) {
         if (many) rlpCoderRelease(coder);
     }
 
+    // Block headers and receipts - the bulk of LES responses - decoded via a BRRlpItem tree and
+    // decoded in place with a BRRlpCursor.
+    BRRlpData headerData;
+    headerData.bytes = hexDecodeCreate(&headerData.bytesCount, PERF_BLOCK_HEADER_RLP, strlen (PERF_BLOCK_HEADER_RLP));
+
+    uint8_t bloom[256];
+    memset (bloom, 0, sizeof (bloom));
+
+    BRRlpItem headerItems  [PERF_MESSAGE_ITEMS];
+    BRRlpItem receiptItems [PERF_MESSAGE_ITEMS];
+    for (int i = 0; i < PERF_MESSAGE_ITEMS; i++) {
+        headerItems[i]  = rlpDataGetItem (coderSaved, headerData);
+        receiptItems[i] = rlpEncodeList (coderSaved, 4,
+                                         rlpEncodeUInt64 (coderSaved, 1, 0),
+                                         rlpEncodeUInt64 (coderSaved, 21000 * (i + 1), 0),
+                                         rlpEncodeBytes  (coderSaved, bloom, sizeof (bloom)),
+                                         rlpEncodeList2  (coderSaved,
+                                                          perfLogRlpEncode (coderSaved),
+                                                          perfLogRlpEncode (coderSaved)));
+    }
+
+    BRRlpItem listItem = rlpEncodeListItems (coderSaved, headerItems, PERF_MESSAGE_ITEMS);
+    BRRlpData headersData = rlpItemGetData (coderSaved, listItem);
+    rlpItemRelease (coderSaved, listItem);
+
+    listItem = rlpEncodeListItems (coderSaved, receiptItems, PERF_MESSAGE_ITEMS);
+    BRRlpData receiptsData = rlpItemGetData (coderSaved, listItem);
+    rlpItemRelease (coderSaved, listItem);
+
+    clock_t start;
+    double headersTree, headersCursor, receiptsTree, receiptsCursor, encodeTree, encodeBytes;
+
+    // Transaction encoding - through a BRRlpItem tree and directly into a buffer.
+    start = clock();
+    for (int r = 0; r < repeatCount; r++)
+        for (int i = 0; i < 100; i++) {
+            BRRlpItem txItem = transactionRlpEncode (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, coderSaved);
+            rlpDataRelease (rlpItemGetData (coderSaved, txItem));
+            rlpItemRelease (coderSaved, txItem);
+        }
+    encodeTree = perfSecondsSince (start);
+
+    start = clock();
+    for (int r = 0; r < repeatCount; r++)
+        for (int i = 0; i < 100; i++) {
+            uint8_t txBytes[1024];
+            transactionRlpEncodeBytes (transaction, ethNetworkMainnet, RLP_TYPE_TRANSACTION_SIGNED, txBytes, sizeof (txBytes));
+        }
+    encodeBytes = perfSecondsSince (start);
+
+    start = clock();
+    for (int r = 0; r < repeatCount; r++) perfDecodeHeadersTree (coderSaved, headersData);
+    headersTree = perfSecondsSince (start);
+
+    start = clock();
+    for (int r = 0; r < repeatCount; r++) perfDecodeHeadersCursor (headersData);
+    headersCursor = perfSecondsSince (start);
+
+    start = clock();
+    for (int r = 0; r < repeatCount; r++) perfDecodeReceiptsTree (coderSaved, receiptsData);
+    receiptsTree = perfSecondsSince (start);
+
+    start = clock();
+    for (int r = 0; r < repeatCount; r++) perfDecodeReceiptsCursor (receiptsData);
+    receiptsCursor = perfSecondsSince (start);
+
+    printf ("%10s %12s %12s\n", "decode", "tree (s)", "cursor (s)");
+    printf ("%10s %12.4f %12.4f\n", "headers",  headersTree,  headersCursor);
+    printf ("%10s %12.4f %12.4f\n", "receipts", receiptsTree, receiptsCursor);
+    printf ("%10s %12s %12s\n", "encode", "tree (s)", "bytes (s)");
+    printf ("%10s %12.4f %12.4f\n", "tx",       encodeTree,   encodeBytes);
+
+    rlpDataRelease (receiptsData);
+    rlpDataRelease (headersData);
+    rlpDataRelease (headerData);
+
     rlpItemRelease(coderSaved, item);
     rlpCoderRelease(coderSaved);
 }
@@ -228,8 +228,28 @@ void runSignatureTests (void) {
     runSignatureTests2();
 }
 
+static void
+runAddressTests (void) {
+    printf ("\n== Address\n");
+    BRKey keys[9];
+    BREthereumAddress addresses[9];
+
+    // Batched addresses match those created one at a time
+    for (size_t index = 0; index < 9; index++) {
+        BRKeyClean (&keys[index]);
+        keys[index].pubKey[0] = 0x04;
+        for (size_t byte = 1; byte < sizeof (keys[index].pubKey); byte++)
+            keys[index].pubKey[byte] = (uint8_t) (index * 31 + byte * 7);
+    }
+
+    ethAddressCreateKeys (addresses, keys, 9);
+    for (size_t index = 0; index < 9; index++)
+        assert (ETHEREUM_BOOLEAN_IS_TRUE (ethAddressEqual (addresses[index], ethAddressCreateKey (&keys[index]))));
+}
+
 extern void
 runBaseTests () {
     runEtherParseTests();
     runSignatureTests();
+    runAddressTests();
 }
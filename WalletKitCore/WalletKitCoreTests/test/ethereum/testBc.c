@@ -9,8 +9,13 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "support/BRCrypto.h"
+#include "ethereum/mpt/BREthereumMPT.h"
 #include "ethereum/blockchain/BREthereumBlockChain.h"
 
 //
@@ -37,6 +42,18 @@ runBloomTests (void) {
     assert (ETHEREUM_BOOLEAN_IS_TRUE(bloomFilterMatch(filter, filter2)));
     assert (ETHEREUM_BOOLEAN_IS_FALSE(bloomFilterMatch(filter, bloomFilterCreateAddress(ethAddressCreate("195e7baea6a6c7c4c2dfeb977efac326af552d87")))));
 
+    // Batched filters match those created one at a time
+    BREthereumAddress addresses[6];
+    BRRlpData datas[6];
+    BREthereumBloomFilter filters[6];
+    for (size_t index = 0; index < 6; index++) {
+        addresses[index] = ethAddressCreate(BLOOM_ADDR_1);
+        addresses[index].bytes[index] ^= 0x5a;
+        datas[index] = (BRRlpData) { sizeof (addresses[index].bytes), addresses[index].bytes };
+    }
+    bloomFilterCreateDatas (filters, datas, 6);
+    for (size_t index = 0; index < 6; index++)
+        assert (ETHEREUM_BOOLEAN_IS_TRUE(bloomFilterEqual(filters[index], bloomFilterCreateAddress(addresses[index]))));
 }
 
 #define BLOCK_HEADER_0_RLP "f9020ca00000000000000000000000000000000000000000000000000000000000000000a01dcc4de8dec75d7aab85b567b6ccd41ad312451b948a7413f0a142fd40d49347940000000000000000000000000000000000000000a0d7f8974fb5ac78d9ac099b9ad5018bedc2ce0a72dad1827a1709da30580f0544a056e81f171bcc55a6ff8345e692c0f86e5b48e01b996cadc001622fb5e363b421a056e81f171bcc55a6ff8345e692c0f86e5b48e01b996cadc001622fb5e363b421b9010000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000850400000000008213880000a011bbe8db4e347b4e8c937c1c8370e4b5ed33adb3db69cbdb7a38e1e50b1b82faa0000000000000000000000000000000000000000000000000000000000000000042"
@@ -63,6 +80,24 @@ testGetBlockHeader (const char *rlp) {
 
     BREthereumBlockHeader header = blockHeaderRlpDecode(blockItem, RLP_TYPE_NETWORK, coder);
 
+    // Decoding in place must produce the identical header, hash included.
+    BRRlpCursor cursor = rlpCursorCreate (data);
+    BREthereumBlockHeader headerInPlace = blockHeaderRlpDecodeCursor (&cursor, RLP_TYPE_NETWORK);
+    assert (NULL != headerInPlace && rlpCursorFinish (&cursor));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (blockHeaderGetHash (header), blockHeaderGetHash (headerInPlace))));
+
+    BRRlpItem headerItem = blockHeaderRlpEncode (headerInPlace, ETHEREUM_BOOLEAN_TRUE, RLP_TYPE_NETWORK, coder);
+    BRRlpData headerData = rlpItemGetData (coder, headerItem);
+    assert (data.bytesCount == headerData.bytesCount
+            && 0 == memcmp (data.bytes, headerData.bytes, headerData.bytesCount));
+    rlpDataRelease (headerData);
+    rlpItemRelease (coder, headerItem);
+    blockHeaderRelease (headerInPlace);
+
+    // ... and a truncated header must fail, not overrun.
+    cursor = rlpCursorCreate ((BRRlpData) { data.bytesCount - 1, data.bytes });
+    assert (NULL == blockHeaderRlpDecodeCursor (&cursor, RLP_TYPE_NETWORK) && rlpCursorHasFailed (&cursor));
+
     rlpDataRelease(data);
     rlpItemRelease (coder, blockItem);
     rlpCoderRelease(coder);
@@ -133,6 +168,76 @@ runBlockHeaderTests (void) {
 
 }
 
+//
+// Proof of Work Test
+//
+extern void
+runProofOfWorkTests (void) {
+    // Mainnet blocks 1 and 2 are in epoch 0; block 4000001 is in epoch 133.
+    BREthereumBlockHeader header_1 = testGetBlockHeader(BLOCK_HEADER_1_RLP);
+    BREthereumBlockHeader header_2 = testGetBlockHeader(BLOCK_HEADER_2_RLP);
+    BREthereumBlockHeader header_4000000 = testGetBlockHeader(BLOCK_HEADER_4000000_RLP);
+    BREthereumBlockHeader header_4000001 = testGetBlockHeader(BLOCK_HEADER_4000001_RLP);
+
+    // Block 2 with its nonce's last hex digit changed
+    char rlpBadNonce[] = BLOCK_HEADER_2_RLP;
+    size_t rlpBadNonceLast = strlen (rlpBadNonce) - 1;
+    rlpBadNonce[rlpBadNonceLast] = ('0' == rlpBadNonce[rlpBadNonceLast] ? '1' : '0');
+    BREthereumBlockHeader header_2_bad = testGetBlockHeader(rlpBadNonce);
+
+    UInt256 n;
+    BREthereumHash m;
+
+    BREthereumProofOfWork pow = proofOfWorkCreate (NULL);
+
+    // Without the epoch's cache a header is not valid; generation starts in the background.
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (header_4000001, header_4000000, 0, NULL, pow)));
+
+    // Nothing is computed either (epoch 0 waits for epoch 133's generation to finish).
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkIsReady (pow, header_2)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkCompute (pow, header_2, &n, &m)));
+
+    proofOfWorkGenerate (pow, header_2);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkIsReady (pow, header_2)));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkCompute (pow, header_2, &n, &m)));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (m, blockHeaderGetMixHash (header_2))));
+
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockHeaderIsValid (header_2,     header_1, 0, NULL, pow)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (header_2_bad, header_1, 0, NULL, pow)));
+
+    proofOfWorkGenerate (pow, header_4000001);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockHeaderIsValid (header_4000001, header_4000000, 0, NULL, pow)));
+    proofOfWorkRelease (pow);
+
+    // Releasing stops a background generation
+    pow = proofOfWorkCreate (NULL);
+    proofOfWorkPrepare (pow, blockHeaderGetNumber (header_4000001));
+    proofOfWorkRelease (pow);
+
+    // Saved caches are memory-mapped by a later ProofOfWork
+    char path[] = "/tmp/BREthereumProofOfWorkTestsXXXXXX";
+    assert (NULL != mkdtemp (path));
+
+    pow = proofOfWorkCreate (path);
+    proofOfWorkGenerate (pow, header_2);
+    proofOfWorkRelease (pow);
+
+    pow = proofOfWorkCreate (path);
+    proofOfWorkGenerate (pow, header_2);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE  (blockHeaderIsValid (header_2,     header_1, 0, NULL, pow)));
+    assert (ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (header_2_bad, header_1, 0, NULL, pow)));
+    proofOfWorkRelease (pow);
+
+    proofOfWorkWipe (path);
+    assert (0 != access (path, F_OK));
+
+    blockHeaderRelease (header_1);
+    blockHeaderRelease (header_2);
+    blockHeaderRelease (header_2_bad);
+    blockHeaderRelease (header_4000000);
+    blockHeaderRelease (header_4000001);
+}
+
 //
 // block Test
 //
@@ -270,6 +375,103 @@ runBlockTest1 () {
     }
 }
 
+static void
+runBloomMatchBatchTest (void) {
+    // Both blocks' logsBlooms against the interests of both blocks' transactions, in one batch.
+    BREthereumBloomFilter blooms[2] = {
+        bloomFilterCreateString(BLOCK_1_BLOOM),
+        bloomFilterCreateString(BLOCK_2_BLOOM)
+    };
+    const BREthereumBloomFilter *filters[2] = { &blooms[0], &blooms[1] };
+
+    BREthereumBloomFilter others[6] = {
+        bloomFilterCreateAddress(ethAddressCreate(BLOCK_1_TX_132_TOKENC)),
+        logTopicGetBloomFilterAddress(ethAddressCreate(BLOCK_1_TX_132_SOURCE)),
+        bloomFilterCreateAddress(ethAddressCreate(BLOCK_1_TX_132_SOURCE)),
+        bloomFilterCreateAddress(ethAddressCreate(BLOCK_2_TX_53_TOKENC)),
+        logTopicGetBloomFilterAddress(ethAddressCreate(BLOCK_2_TX_53_TARGET)),
+        bloomFilterCreateAddress(ethAddressCreate(BLOCK_2_TX_53_TARGET))
+    };
+
+    uint64_t matches[2];
+    assert (2 == bloomFilterMatchBatch (filters, 2, others, 6, matches));
+    assert (0x03 == (matches[0] & 0x07));
+    assert (0x18 == (matches[1] & 0x38));
+    for (size_t f = 0; f < 2; f++)
+        for (size_t o = 0; o < 6; o++)
+            assert ((0 != (matches[f] & (UINT64_C(1) << o))) ==
+                    ETHEREUM_BOOLEAN_IS_TRUE (bloomFilterMatch (blooms[f], others[o])));
+
+    // Dense filters against the most others, each checked against the by-value 'or then equal'
+    srand (24);
+    BREthereumBloomFilter dense[16], denseOthers[BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT];
+    const BREthereumBloomFilter *denseFilters[16];
+    uint64_t denseMatches[16];
+
+    for (size_t f = 0; f < 16; f++) {
+        for (size_t index = 0; index < ETHEREUM_BLOOM_FILTER_BYTES; index++)
+            dense[f].bytes[index] = (uint8_t) rand();
+        denseFilters[f] = &dense[f];
+    }
+    for (size_t o = 0; o < BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT; o++) {
+        // A subset of some dense filter, with one stray bit in half of them
+        denseOthers[o] = bloomFilterCreateEmpty();
+        for (size_t index = 0; index < ETHEREUM_BLOOM_FILTER_BYTES; index++)
+            denseOthers[o].bytes[index] = dense[o % 16].bytes[index] & (uint8_t) rand() & (uint8_t) rand();
+        if (o & 1) denseOthers[o].bytes[rand() % ETHEREUM_BLOOM_FILTER_BYTES] |= (uint8_t) (1 << (rand() % 8));
+    }
+    bloomFilterMatchBatch (denseFilters, 16, denseOthers, BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT, denseMatches);
+    for (size_t f = 0; f < 16; f++)
+        for (size_t o = 0; o < BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT; o++)
+            assert ((0 != (denseMatches[f] & (UINT64_C(1) << o))) ==
+                    ETHEREUM_BOOLEAN_IS_TRUE (bloomFilterEqual (dense[f], bloomFilterOr (dense[f], denseOthers[o]))));
+
+    // An empty filter matches everything
+    BREthereumBloomFilter empty = bloomFilterCreateEmpty();
+    assert (16 == bloomFilterMatchBatch (denseFilters, 16, &empty, 1, denseMatches));
+
+    // Headers: a batch of headers matches as each header does, one at a time.
+    BREthereumBlockHeader headers[3] = {
+        testGetBlockHeader(BLOCK_HEADER_4000000_RLP),
+        testGetBlockHeader(BLOCK_HEADER_6000000_RLP),
+        testGetBlockHeader(BLOCK_HEADER_1_RLP)
+    };
+    BREthereumAddress address = ethAddressCreate(BLOCK_2_TX_53_TOKENC);
+    BREthereumBloomFilter interests[3] = {
+        bloomFilterCreateAddress (address),
+        logTopicGetBloomFilterAddress (address),
+        bloomFilterCreateEmpty()
+    };
+    interests[2].bytes[0] = 0x40;       // The first logsBloom bit of block 4000000, not 6000000
+
+    uint64_t headerMatches[3];
+    BREthereumBoolean addressMatches[3];
+    size_t matched = blockHeadersMatch (headers, 3, interests, 3, headerMatches);
+    blockHeadersMatchAddress (headers, 3, address, addressMatches);
+
+    // More headers than one chunk; each matches as it did alone.
+    BREthereumBlockHeader manyHeaders[601];
+    BREthereumBoolean manyMatches[601];
+    for (size_t h = 0; h < 601; h++) manyHeaders[h] = headers[h % 3];
+    blockHeadersMatchAddress (manyHeaders, 601, address, manyMatches);
+    for (size_t h = 0; h < 601; h++)
+        assert (manyMatches[h] == addressMatches[h % 3]);
+
+    size_t expected = 0;
+    for (size_t h = 0; h < 3; h++) {
+        for (size_t i = 0; i < 3; i++)
+            assert ((0 != (headerMatches[h] & (UINT64_C(1) << i))) ==
+                    ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderMatch (headers[h], interests[i])));
+        assert ((0 != (headerMatches[h] & 0x03)) == ETHEREUM_BOOLEAN_IS_TRUE (addressMatches[h]));
+        if (0 != headerMatches[h]) expected++;
+        blockHeaderRelease (headers[h]);
+    }
+    assert (expected == matched);
+    assert (0x04 == (headerMatches[0] & 0x04));
+    assert (0x00 == (headerMatches[1] & 0x04));
+    assert (0 == headerMatches[2]);     // Block 1 has no logs
+}
+
 static void
 runBlockCheckpointTest (void) {
     const BREthereumBlockCheckpoint *cp1;
@@ -347,6 +549,21 @@ runLogTests (void) {
 
     rlpDataShow(data, "LogTest");
 
+    // In place
+    BRRlpCursor cursor = rlpCursorCreate (data);
+    BREthereumLog logInPlace = logRlpDecodeCursor (&cursor);
+    assert (NULL != logInPlace && rlpCursorFinish (&cursor));
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethAddressEqual (address, logGetAddress (logInPlace))));
+    assert (logGetTopicsCount (log) == logGetTopicsCount (logInPlace));
+
+    logItem = logRlpEncode(logInPlace, RLP_TYPE_NETWORK, coder);
+    BRRlpData encodeDataInPlace = rlpItemGetData(coder, logItem);
+    rlpItemRelease(coder, logItem);
+    assert (data.bytesCount == encodeDataInPlace.bytesCount
+            && 0 == memcmp (data.bytes, encodeDataInPlace.bytes, encodeDataInPlace.bytesCount));
+    rlpDataRelease(encodeDataInPlace);
+    logRelease (logInPlace);
+
     // Archive
     BREthereumHash someBlockHash = HASH_INIT("fc45a8c5ebb5f920931e3d5f48992f3a89b544b4e21dc2c11c5bf8165a7245d6");
     uint64_t someBlockNumber = 11592;
@@ -469,10 +686,229 @@ runTransactionReceiptTests (void) {
 }
 
 
+//
+// MPT Proofs
+//
+// Proofs are built by hand: a root branch, a second branch and a leaf.  Proofs of different keys
+// share the root and second branch, as proofs from one trie do, and thus share cached nodes.
+
+static BRRlpItem
+mptTestLeaf (BRRlpCoder coder, const uint8_t *nibbles, size_t nibblesCount, const char *value) {
+    uint8_t path[40];
+    size_t count = 0;
+
+    // An odd count of nibbles takes the first into the 0x3 prefix; even gets a 0x20 prefix
+    if (nibblesCount & 1) { path[count++] = 0x30 | nibbles[0]; nibbles++; nibblesCount--; }
+    else path[count++] = 0x20;
+
+    for (size_t index = 0; index < nibblesCount; index += 2)
+        path[count++] = (uint8_t) ((nibbles[index] << 4) | nibbles[index + 1]);
+
+    return rlpEncodeList2 (coder,
+                           rlpEncodeBytes (coder, path, count),
+                           rlpEncodeBytes (coder, (uint8_t *) value, strlen (value)));
+}
+
+static BREthereumHash
+mptTestHash (BRRlpCoder coder, BRRlpItem item) {
+    BRRlpData data = rlpItemGetDataSharedDontRelease (coder, item);
+    BREthereumHash hash;
+    BRKeccak256 (hash.bytes, data.bytes, data.bytesCount);
+    return hash;
+}
+
+// A branch referencing `child` at `nibble`, by hash or, if `embed`, embedded; the other fifteen
+// references are arbitrary hashes, derived from `fill`.
+static BRRlpItem
+mptTestBranch (BRRlpCoder coder, uint8_t nibble, BRRlpItem child, int embed, uint8_t fill) {
+    BRRlpItem items[17];
+    for (uint8_t index = 0; index < 16; index++) {
+        BREthereumHash hash;
+        memset (hash.bytes, fill + index, ETHEREUM_HASH_BYTES);
+
+        if (index == nibble && embed)
+            items[index] = rlpDataGetItem (coder, rlpItemGetDataSharedDontRelease (coder, child));
+        else {
+            if (index == nibble) hash = mptTestHash (coder, child);
+            items[index] = rlpEncodeBytes (coder, hash.bytes, ETHEREUM_HASH_BYTES);
+        }
+    }
+    items[16] = rlpEncodeBytes (coder, NULL, 0);
+    return rlpEncodeListItems (coder, items, 17);
+}
+
+static BREthereumMPTNodePath
+mptTestPath (BRRlpCoder coder, BRRlpItem *nodes, size_t count) {
+    BRRlpItem copies[count];
+    for (size_t index = 0; index < count; index++)
+        copies[index] = rlpDataGetItem (coder, rlpItemGetDataSharedDontRelease (coder, nodes[index]));
+
+    BRRlpItem item = rlpEncodeListItems (coder, copies, count);
+    BREthereumMPTNodePath path = mptNodePathDecode (item, coder);
+    rlpItemRelease (coder, item);
+    return path;
+}
+
+// Check that `path` proves `key` holds a value ending in `value`
+static int
+mptTestPathProves (BREthereumMPTNodePath path, BREthereumData key, const char *value) {
+    BREthereumBoolean found = ETHEREUM_BOOLEAN_FALSE;
+    BRRlpData data = mptNodePathGetValue (path, key, &found);
+
+    size_t valueCount = strlen (value);
+    int proves = (ETHEREUM_BOOLEAN_IS_TRUE (found) &&
+                  data.bytesCount >= valueCount &&
+                  0 == memcmp (&data.bytes[data.bytesCount - valueCount], value, valueCount));
+
+    rlpDataRelease (data);
+    mptNodePathRelease (path);
+    return proves;
+}
+
+static void
+mptTestNibbles (BREthereumData key, uint8_t *nibbles) {
+    for (size_t index = 0; index < key.count; index++) {
+        nibbles[2 * index + 0] = key.bytes[index] >> 4;
+        nibbles[2 * index + 1] = key.bytes[index] & 0x0f;
+    }
+}
+
+static void *
+runMPTProofTest (void *ignore) {
+    BRRlpCoder coder = rlpCoderCreate();
+
+    // Two keys sharing their first nibble
+    BREthereumHash hash1, hash2;
+    for (size_t index = 0; index < ETHEREUM_HASH_BYTES; index++) {
+        hash1.bytes[index] = (uint8_t) (7 * index + 1);
+        hash2.bytes[index] = (uint8_t) (11 * index + 3);
+    }
+    hash2.bytes[0] = (hash1.bytes[0] & 0xf0) | ((hash1.bytes[0] + 1) & 0x0f);
+
+    BREthereumData key1 = mptKeyGetFromHash (hash1);
+    BREthereumData key2 = mptKeyGetFromHash (hash2);
+
+    uint8_t nibbles1[64], nibbles2[64];
+    mptTestNibbles (key1, nibbles1);
+    mptTestNibbles (key2, nibbles2);
+
+    BRRlpItem leaf1 = mptTestLeaf (coder, &nibbles1[2], 62, "value-one");
+    BRRlpItem leaf2 = mptTestLeaf (coder, &nibbles2[2], 62, "value-two");
+
+    // The second branch references both leaves
+    BRRlpItem branchItems[17];
+    for (uint8_t index = 0; index < 16; index++)
+        branchItems[index] = (index == nibbles1[1]
+                              ? ethHashRlpEncode (mptTestHash (coder, leaf1), coder)
+                              : (index == nibbles2[1]
+                                 ? ethHashRlpEncode (mptTestHash (coder, leaf2), coder)
+                                 : rlpEncodeBytes (coder, NULL, 0)));
+    branchItems[16] = rlpEncodeBytes (coder, NULL, 0);
+    BRRlpItem branch = rlpEncodeListItems (coder, branchItems, 17);
+
+    BRRlpItem root = mptTestBranch (coder, nibbles1[0], branch, 0, 0x80);
+    BREthereumHash rootHash = mptTestHash (coder, root);
+
+    // Repeat; after the first round the root and branch are found in the cache
+    for (size_t round = 0; round < 3; round++) {
+        BRRlpItem nodes1[3] = { root, branch, leaf1 };
+        BRRlpItem nodes2[3] = { root, branch, leaf2 };
+
+        BREthereumMPTNodePath path = mptTestPath (coder, nodes1, 3);
+        assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (rootHash, mptNodePathGetRootHash (path))));
+        assert ( mptTestPathProves (path, key1, "value-one"));
+        assert ( mptTestPathProves (mptTestPath (coder, nodes2, 3), key2, "value-two"));
+        assert (!mptTestPathProves (mptTestPath (coder, nodes1, 3), key2, "value-two"));
+
+        // A forged leaf, under the cached root and branch
+        BRRlpItem leafForged = mptTestLeaf (coder, &nibbles1[2], 62, "value-bad");
+        BRRlpItem nodesForgedLeaf[3] = { root, branch, leafForged };
+        assert (!mptTestPathProves (mptTestPath (coder, nodesForgedLeaf, 3), key1, "value-bad"));
+        assert (!mptTestPathProves (mptTestPath (coder, nodesForgedLeaf, 3), key1, "value-one"));
+
+        // A forged branch, referencing the forged leaf, under the cached root
+        BRRlpItem branchForged = mptTestBranch (coder, nibbles1[1], leafForged, 0, 0x41);
+        BRRlpItem nodesForgedBranch[3] = { root, branchForged, leafForged };
+        assert (!mptTestPathProves (mptTestPath (coder, nodesForgedBranch, 3), key1, "value-bad"));
+
+        rlpItemRelease (coder, branchForged);
+        rlpItemRelease (coder, leafForged);
+    }
+
+    // Eviction: many more roots than the cache holds; each proof still proves
+    for (size_t index = 0; index < 2000; index++) {
+        BRRlpItem rootOther = mptTestBranch (coder, nibbles1[0], branch, 0, (uint8_t) index);
+        BRRlpItem nodes[3] = { rootOther, branch, leaf1 };
+        assert (mptTestPathProves (mptTestPath (coder, nodes, 3), key1, "value-one"));
+        rlpItemRelease (coder, rootOther);
+    }
+
+    rlpItemRelease (coder, root);
+    rlpItemRelease (coder, branch);
+    rlpItemRelease (coder, leaf2);
+    rlpItemRelease (coder, leaf1);
+    ethDataRelease (key2);
+    ethDataRelease (key1);
+    rlpCoderRelease (coder);
+    return NULL;
+}
+
+static void
+runMPTEmbeddedProofTest (void) {
+    BRRlpCoder coder = rlpCoderCreate();
+
+    // An eight byte key; the leaf, with a short path and value, is embedded in its parent.
+    BREthereumData key = mptKeyGetFromUInt64 (0x1234567890abcdefULL);
+    uint8_t nibbles[16];
+    mptTestNibbles (key, nibbles);
+
+    BRRlpItem leaf       = mptTestLeaf (coder, &nibbles[2], 14, "v");
+    BRRlpItem leafForged = mptTestLeaf (coder, &nibbles[2], 14, "w");
+    assert (rlpItemGetDataSharedDontRelease (coder, leaf).bytesCount < ETHEREUM_HASH_BYTES);
+
+    BRRlpItem branch = mptTestBranch (coder, nibbles[1], leaf,   1, 0x40);
+    BRRlpItem root   = mptTestBranch (coder, nibbles[0], branch, 0, 0x80);
+
+    BRRlpItem nodes[3] = { root, branch, leaf };
+    assert (mptTestPathProves (mptTestPath (coder, nodes, 3), key, "v"));
+
+    // A short node must be the node embedded in its parent
+    BRRlpItem nodesForged[3] = { root, branch, leafForged };
+    assert (!mptTestPathProves (mptTestPath (coder, nodesForged, 3), key, "w"));
+
+    // A short root is hashed
+    BREthereumMPTNodePath path = mptTestPath (coder, &leaf, 1);
+    assert (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (mptTestHash (coder, leaf), mptNodePathGetRootHash (path))));
+    mptNodePathRelease (path);
+
+    rlpItemRelease (coder, root);
+    rlpItemRelease (coder, branch);
+    rlpItemRelease (coder, leafForged);
+    rlpItemRelease (coder, leaf);
+    ethDataRelease (key);
+    rlpCoderRelease (coder);
+}
+
+#define MPT_TEST_THREADS        (4)
+
+extern void
+runMPTTests (void) {
+    runMPTProofTest (NULL);
+    runMPTEmbeddedProofTest ();
+
+    // The node cache is shared by all threads
+    pthread_t threads[MPT_TEST_THREADS];
+    for (size_t index = 0; index < MPT_TEST_THREADS; index++)
+        pthread_create (&threads[index], NULL, runMPTProofTest, NULL);
+    for (size_t index = 0; index < MPT_TEST_THREADS; index++)
+        pthread_join (threads[index], NULL);
+}
+
 static void
 runBlockTests (void) {
     runBlockTest0();
     runBlockTest1();
+    runBloomMatchBatchTest ();
     runBlockCheckpointTest ();
     runBlockTransactionTest ();
 }
@@ -481,10 +917,12 @@ extern void
 runBcTests (void) {
 //    runBloomTests();
     runBlockHeaderTests ();
+    runProofOfWorkTests ();
     runBlockTests();
     runLogTests();
     runAccountStateTests();
     runTransactionStatusTests();
     runTransactionReceiptTests();
+    runMPTTests();
 }
 
@@ -9,10 +9,13 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "ethereum/event/BREvent.h"
 #include "ethereum/event/BREventAlarm.h"
+#include "ethereum/event/BREventQueue.h"
 
 static pthread_cond_t testEventAlarmConditional = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t testEventAlarmMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -49,7 +52,140 @@ runEventTest (void) {
     alarmClockDestroy(alarmClock);
 }
 
+/// MARK: - Event Queue
+
+typedef struct {
+    BREvent base;
+    size_t producer;
+    size_t sequence;
+} BRTestQueueEvent;
+
+static BREventType testQueueEventType = {
+    "Test Queue Event",
+    sizeof (BRTestQueueEvent),
+    NULL,
+    NULL
+};
+
+typedef struct {
+    BREventQueue queue;
+    size_t producer;
+    size_t count;
+} BRTestQueueProducer;
+
+static void *
+testQueueProducerThread (BRTestQueueProducer *producer) {
+    for (size_t sequence = 0; sequence < producer->count; sequence++) {
+        BRTestQueueEvent event = { { NULL, &testQueueEventType }, producer->producer, sequence };
+        eventQueueEnqueueTailSignal (producer->queue, (BREvent *) &event);
+    }
+    return NULL;
+}
+
+static double
+testQueueTime (void) {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (double) tv.tv_sec + (double) tv.tv_usec / 1e6;
+}
+
+/// Enqueue `count` events from each of `producersCount` threads while dequeuing them all, in
+/// the calling thread; confirm each producer's events arrive in order.  Return the elapsed time.
+static double
+runEventQueueProducers (size_t producersCount, size_t count) {
+    BREventQueue queue = eventQueueCreate (sizeof (BRTestQueueEvent));
+    BRTestQueueProducer *producers = calloc (producersCount, sizeof (BRTestQueueProducer));
+    pthread_t *threads = calloc (producersCount, sizeof (pthread_t));
+    size_t *sequences  = calloc (producersCount, sizeof (size_t));
+
+    double start = testQueueTime ();
+
+    for (size_t index = 0; index < producersCount; index++) {
+        producers[index] = (BRTestQueueProducer) { queue, index, count };
+        pthread_create (&threads[index], NULL, (void* (*) (void*)) testQueueProducerThread, &producers[index]);
+    }
+
+    BRTestQueueEvent event;
+    for (size_t received = 0; received < producersCount * count; received++) {
+        BREventStatus status = eventQueueDequeueWait (queue, (BREvent *) &event);
+        assert (EVENT_STATUS_SUCCESS == status);
+        assert (event.producer < producersCount);
+        assert (event.sequence == sequences[event.producer]);
+        sequences[event.producer] += 1;
+    }
+
+    double elapsed = testQueueTime () - start;
+
+    for (size_t index = 0; index < producersCount; index++)
+        pthread_join (threads[index], NULL);
+
+    assert (!eventQueueHasPending (queue));
+    assert (EVENT_STATUS_NONE_PENDING == eventQueueDequeue (queue, (BREvent *) &event));
+
+    free (sequences);
+    free (threads);
+    free (producers);
+    eventQueueDestroy (queue);
+
+    return elapsed;
+}
+
+static void
+runEventQueueTest (void) {
+    BREventQueue queue = eventQueueCreate (sizeof (BRTestQueueEvent));
+    BRTestQueueEvent event;
+
+    assert (!eventQueueHasPending (queue));
+    assert (EVENT_STATUS_NONE_PENDING == eventQueueDequeue (queue, (BREvent *) &event));
+
+    // Tail events in order; head events before them all, most recent first.
+    for (size_t sequence = 0; sequence < 3; sequence++) {
+        event = (BRTestQueueEvent) { { NULL, &testQueueEventType }, 0, sequence };
+        eventQueueEnqueueTail (queue, (BREvent *) &event);
+    }
+    event = (BRTestQueueEvent) { { NULL, &testQueueEventType }, 1, 0 };
+    eventQueueEnqueueHead (queue, (BREvent *) &event);
+    event = (BRTestQueueEvent) { { NULL, &testQueueEventType }, 1, 1 };
+    eventQueueEnqueueHead (queue, (BREvent *) &event);
+
+    assert (eventQueueHasPending (queue));
+
+    size_t expected[5][2] = { {1, 1}, {1, 0}, {0, 0}, {0, 1}, {0, 2} };
+    for (size_t index = 0; index < 5; index++) {
+        // A head event enqueued mid-way is next.
+        if (3 == index) {
+            event = (BRTestQueueEvent) { { NULL, &testQueueEventType }, 1, 2 };
+            eventQueueEnqueueHead (queue, (BREvent *) &event);
+            assert (EVENT_STATUS_SUCCESS == eventQueueDequeue (queue, (BREvent *) &event));
+            assert (1 == event.producer && 2 == event.sequence);
+        }
+        assert (EVENT_STATUS_SUCCESS == eventQueueDequeue (queue, (BREvent *) &event));
+        assert (expected[index][0] == event.producer && expected[index][1] == event.sequence);
+    }
+    assert (!eventQueueHasPending (queue));
+
+    // Clear pending
+    eventQueueEnqueueTail (queue, (BREvent *) &event);
+    eventQueueEnqueueHead (queue, (BREvent *) &event);
+    eventQueueClear (queue);
+    assert (!eventQueueHasPending (queue));
+
+    eventQueueDestroy (queue);
+
+    // Many producers, in order per producer
+    runEventQueueProducers (8, 10000);
+}
+
+extern void
+runEventQueuePerfTests (size_t producersCount, size_t count) {
+    double elapsed = runEventQueueProducers (producersCount, count);
+    printf ("==== Event Queue: %zu producers x %zu events: %.3f s (%.0f events/s)\n",
+            producersCount, count, elapsed,
+            (double) (producersCount * count) / elapsed);
+}
+
 extern void
 runEventTests (void) {
     runEventTest();
+    runEventQueueTest();
 }
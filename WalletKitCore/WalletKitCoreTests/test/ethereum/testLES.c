@@ -430,7 +430,9 @@ run_GetBlookProofs_Tests (BREthereumLES les) {
     lesProvideBlockProofsOne (les, NODE_REFERENCE_ANY,
                               (void*)&_GetBlockProofs_Context1,
                               _GetBlockProofs_Calllback_Test1,
-                              6000000);
+                              6000000,
+                              ethNetworkGetTrustedCHTRoot (ethNetworkMainnet,
+                                                           messageLESGetChtNumber (6000000)));
     _waitForTests();
 
     eth_log(TST_LOG_TOPIC, "GetBlockProofs: %s", "Tests Successful");
@@ -913,29 +915,38 @@ static void run_GetAccountState_Tests (BREthereumLES les){
 
     BREthereumAddress address = addressCreate("0x52bc44d5378309ee2abf1539bf71de1b7d7be3b5");
 
+    // TODO: Fill in each block's stateRoot; the account state proofs are checked against them.
     BREthereumHash block_350000 = hashCreate("0x8cd1f73a98ab1cdd65f829530a46559d3ea345f330bc04924f30fe00bcbad6f1");
+    BREthereumHash root_350000  = EMPTY_HASH_INIT;
     lesProvideAccountStatesOne (les, NODE_REFERENCE_ANY,
                                 (void*) &_GetAccount_Context1,
                                 _GetAccountState_Callback_Test1,
                                 address,
-                                block_350000);
+                                block_350000,
+                                root_350000);
 
     BREthereumHash block_349999 = hashCreate("0xb86a49b1589b3f8474171d35c796e27f5c20ba1db16a2d93cf67d7358122b361");
+    BREthereumHash root_349999  = EMPTY_HASH_INIT;
     lesProvideAccountStatesOne (les, NODE_REFERENCE_ANY,
                                 (void*) &_GetAccount_Context1,
                                 _GetAccountState_Callback_Test1,
                                 address,
-                                block_349999);
+                                block_349999,
+                                root_349999);
 
     BRArrayOf(BREthereumHash) hashes;
+    BRArrayOf(BREthereumHash) roots;
     array_new (hashes, 2);
+    array_new (roots,  2);
 
     array_add (hashes, block_350000); array_add (hashes, block_349999);
+    array_add (roots,  root_350000);  array_add (roots,  root_349999);
     lesProvideAccountStates (les, NODE_REFERENCE_ANY,
                              (void*) &_GetAccount_Context1,
                              _GetAccountState_Callback_Test2,
                              address,
-                             hashes);
+                             hashes,
+                             roots);
 
     _waitForTests();
     eth_log(TST_LOG_TOPIC, "GetAccopuntState: %s", "Tests Successful");
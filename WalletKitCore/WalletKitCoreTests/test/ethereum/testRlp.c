@@ -175,8 +175,170 @@ void runRlpDecodeTest () {
     rlpCoderRelease(coder);
 }
 
+void runRlpCursorTest () {
+    printf ("         Cursor\n");
+
+    // cat & dog
+    uint8_t l1b[] = RLP_L1_RES;
+    BRRlpCursor l1c = rlpCursorCreate ((BRRlpData) { 9, l1b });
+    BRRlpCursor l1is = rlpCursorNextList (&l1c);
+    assert (2 == rlpCursorCount (&l1is));
+
+    BRRlpData liCat = rlpCursorNextBytesSharedDontRelease (&l1is);
+    BRRlpData liDog = rlpCursorNextBytesSharedDontRelease (&l1is);
+    assert (equalBytes (liCat.bytes, liCat.bytesCount, (uint8_t *) "cat", 3));
+    assert (equalBytes (liDog.bytes, liDog.bytesCount, (uint8_t *) "dog", 3));
+    assert (rlpCursorFinish (&l1is));
+    assert (rlpCursorFinish (&l1c));
+
+    // Lorem ipsum, w/ a long length
+    uint8_t s3b[] = RLP_S3_RES;
+    BRRlpCursor s3c = rlpCursorCreate ((BRRlpData) { 58, s3b });
+    BRRlpView s3v = rlpCursorNext (&s3c);
+    assert (!s3v.isList && 58 == s3v.encoding.bytesCount);
+    assert (equalBytes (s3v.payload.bytes, s3v.payload.bytesCount, (uint8_t *) RLP_S3, strlen (RLP_S3)));
+    assert (rlpCursorFinish (&s3c));
+
+    // 1024, and 1024 is not a byte
+    uint8_t v3b[] = RLP_V3_RES;
+    BRRlpCursor v3c = rlpCursorCreate ((BRRlpData) { 3, v3b });
+    assert (1024 == rlpCursorNextUInt64 (&v3c));
+    assert (rlpCursorFinish (&v3c));
+
+    v3c = rlpCursorCreate ((BRRlpData) { 3, v3b });
+    uint8_t v3byte;
+    rlpCursorNextBytesFixed (&v3c, &v3byte, 1, 0);
+    assert (rlpCursorHasFailed (&v3c));
+
+    // 5968770000000000000000, as encoded above
+    uint8_t u256b[] = { 0x8a, 0x01, 0x43, 0x91, 0x52, 0xd3, 0x19, 0xe8, 0x4d, 0x00, 0x00 };
+    BRRlpCursor u256c = rlpCursorCreate ((BRRlpData) { sizeof (u256b), u256b });
+    BRCoreParseStatus status = CORE_PARSE_OK;
+    UInt256 u256 = rlpCursorNextUInt256 (&u256c);
+    assert (uint256EQL (u256, uint256CreateParse("5968770000000000000000", 10, &status)));
+
+    // ... but too big for a uint64_t
+    u256c = rlpCursorCreate ((BRRlpData) { sizeof (u256b), u256b });
+    assert (0 == rlpCursorNextUInt64 (&u256c) && rlpCursorHasFailed (&u256c));
+
+    // Truncated: the list claims 8 bytes; only 7 follow.  Failure reaches the enclosing cursor.
+    BRRlpCursor t1c = rlpCursorCreate ((BRRlpData) { 8, l1b });
+    assert (0 == rlpCursorCount (&t1c) && rlpCursorHasFailed (&t1c));
+
+    uint8_t t2b[] = { 0xc8, 0x83, 'c', 'a', 't', 0x84, 'd', 'o', 'g' };
+    BRRlpCursor t2c  = rlpCursorCreate ((BRRlpData) { 9, t2b });
+    BRRlpCursor t2is = rlpCursorNextList (&t2c);
+    rlpCursorNextBytesSharedDontRelease (&t2is);
+    assert (!rlpCursorHasFailed (&t2c));
+    BRRlpData t2dog = rlpCursorNextBytesSharedDontRelease (&t2is);
+    assert (NULL == t2dog.bytes && rlpCursorHasFailed (&t2is) && rlpCursorHasFailed (&t2c));
+
+    // Long length whose length bytes are themselves truncated
+    uint8_t t3b[] = { 0xb9, 0x01 };
+    BRRlpCursor t3c = rlpCursorCreate ((BRRlpData) { 2, t3b });
+    rlpCursorNext (&t3c);
+    assert (rlpCursorHasFailed (&t3c));
+
+    // A string where a list is expected
+    BRRlpCursor t4c = rlpCursorCreate ((BRRlpData) { 58, s3b });
+    BRRlpCursor t4is = rlpCursorNextList (&t4c);
+    assert (!rlpCursorHasNext (&t4is) && rlpCursorHasFailed (&t4c));
+}
+
+// Write `item`, sized as `size`, and check it against `result`
+#define RLP_WRITE_CHECK(size, write, result)   do {               \
+    uint8_t expected[] = result;                                   \
+    uint8_t bytes[sizeof (expected)];                              \
+    assert (sizeof (expected) == (size));                          \
+    BRRlpWriter writer = rlpWriterCreate (bytes, sizeof (bytes));  \
+    write;                                                         \
+    assert (!rlpWriterHasFailed (&writer));                        \
+    assert (equalBytes (bytes, writer.bytesIndex, expected, sizeof (expected))); \
+} while (0)
+
+void runRlpWriterTest () {
+    printf ("         Writer\n");
+
+    RLP_WRITE_CHECK (rlpSizeBytes ((uint8_t *) RLP_S1, 3),
+                     rlpWriteBytes (&writer, (uint8_t *) RLP_S1, 3),
+                     RLP_S1_RES);
+    RLP_WRITE_CHECK (rlpSizeBytes (NULL, 0),
+                     rlpWriteBytes (&writer, NULL, 0),
+                     RLP_S2_RES);
+    RLP_WRITE_CHECK (rlpSizeBytes ((uint8_t *) RLP_S3, strlen (RLP_S3)),
+                     rlpWriteBytes (&writer, (uint8_t *) RLP_S3, strlen (RLP_S3)),
+                     RLP_S3_RES);
+    RLP_WRITE_CHECK (rlpSizeUInt64 (RLP_V1, 0),
+                     rlpWriteUInt64 (&writer, RLP_V1, 0),
+                     RLP_V1_RES);
+    RLP_WRITE_CHECK (rlpSizeUInt64 (RLP_V2, 0),
+                     rlpWriteUInt64 (&writer, RLP_V2, 0),
+                     RLP_V2_RES);
+    RLP_WRITE_CHECK (rlpSizeUInt64 (RLP_V3, 0),
+                     rlpWriteUInt64 (&writer, RLP_V3, 0),
+                     RLP_V3_RES);
+    RLP_WRITE_CHECK (rlpSizeUInt64 (0, 1),
+                     rlpWriteUInt64 (&writer, 0, 1),
+                     RLP_S2_RES);
+    RLP_WRITE_CHECK (rlpSizeHexString ("0x0f"),
+                     rlpWriteHexString (&writer, "0x0f"),
+                     RLP_V2_RES);
+    RLP_WRITE_CHECK (rlpSizeHexString ("0400"),
+                     rlpWriteHexString (&writer, "0400"),
+                     RLP_V3_RES);
+    RLP_WRITE_CHECK (rlpSizeBytesPurgeLeadingZeros ((uint8_t[]) { 0, 0, 0x04, 0x00 }, 4),
+                     rlpWriteBytesPurgeLeadingZeros (&writer, (uint8_t[]) { 0, 0, 0x04, 0x00 }, 4),
+                     RLP_V3_RES);
+
+    // 'cat', 'dog'
+    size_t catDogItemsSize = 2 * rlpSizeBytes ((uint8_t *) "cat", 3);
+    RLP_WRITE_CHECK (rlpSizeList (catDogItemsSize),
+                     (rlpWriteList  (&writer, catDogItemsSize),
+                      rlpWriteBytes (&writer, (uint8_t *) "cat", 3),
+                      rlpWriteBytes (&writer, (uint8_t *) "dog", 3)),
+                     RLP_L1_RES);
+
+    // 5968770000000000000000, matching rlpEncodeUInt256()
+    BRCoreParseStatus status = CORE_PARSE_OK;
+    UInt256 value = uint256CreateParse("5968770000000000000000", 10, &status);
+#define RLP_U256_RES { 0x8a, 0x01, 0x43, 0x91, 0x52, 0xd3, 0x19, 0xe8, 0x4d, 0x00, 0x00 }
+    RLP_WRITE_CHECK (rlpSizeUInt256 (value, 0),
+                     rlpWriteUInt256 (&writer, value, 0),
+                     RLP_U256_RES);
+
+    // A long list, w/ a multi-byte length, matching rlpEncodeListItems()
+    BRRlpCoder coder = rlpCoderCreate();
+    BRRlpItem items[2] = {
+        rlpEncodeBytes (coder, (uint8_t *) RLP_S3, strlen (RLP_S3)),
+        rlpEncodeBytes (coder, (uint8_t *) RLP_S3, strlen (RLP_S3))
+    };
+    BRRlpItem listItem = rlpEncodeListItems (coder, items, 2);
+    BRRlpData listData = rlpItemGetData (coder, listItem);
+
+    size_t itemsSize = 2 * rlpSizeBytes ((uint8_t *) RLP_S3, strlen (RLP_S3));
+    assert (listData.bytesCount == rlpSizeList (itemsSize));
+
+    uint8_t listBytes[listData.bytesCount];
+    BRRlpWriter writer = rlpWriterCreate (listBytes, sizeof (listBytes));
+    rlpWriteList  (&writer, itemsSize);
+    rlpWriteBytes (&writer, (uint8_t *) RLP_S3, strlen (RLP_S3));
+    rlpWriteBytes (&writer, (uint8_t *) RLP_S3, strlen (RLP_S3));
+    assert (!rlpWriterHasFailed (&writer));
+    assert (equalBytes (listBytes, writer.bytesIndex, listData.bytes, listData.bytesCount));
+
+    // One more byte doesn't fit
+    rlpWriteBytes (&writer, (uint8_t *) "c", 1);
+    assert (rlpWriterHasFailed (&writer) && listData.bytesCount == writer.bytesIndex);
+
+    rlpDataRelease (listData);
+    rlpItemRelease (coder, listItem);
+    rlpCoderRelease (coder);
+}
+
 void runRlpTests (void) {
     printf ("==== RLP\n");
     runRlpEncodeTest ();
     runRlpDecodeTest ();
+    runRlpCursorTest ();
+    runRlpWriterTest ();
 }
@@ -30,6 +30,7 @@ extern void runRlpTests (void);
 
 // Event
 extern void runEventTests (void);
+extern void runEventQueuePerfTests (size_t producersCount, size_t count);
 
 // Base
 extern void runBaseTests (void);
@@ -86,6 +87,11 @@ extern int BRRunSupTests (void);
 
 extern int BRRunTests();
 
+extern void BRRunPerfTestsWallet (size_t txCount);
+extern void BRRunPerfTestsWalletRestore (size_t addrsCount);
+extern void BRRunPerfTestsTransactionSign (size_t maxInputs, size_t threadCount);
+extern void BRRunPerfTestsHeaders (size_t headersCount);
+
 extern int BRRunTestsSync (const char *paperKey,
                            BRBitcoinChain bitcoinChain,
                            int isMainnet);
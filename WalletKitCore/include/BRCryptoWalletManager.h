@@ -203,6 +203,14 @@ extern "C" {
     cryptoWalletManagerSetNetworkReachable (BRCryptoWalletManager cwm,
                                             BRCryptoBoolean isNetworkReachable);
 
+    /**
+     * Have a P2P sync use BIP157 compact block filters, from peers that serve them, rather than
+     * BIP37 bloom filters.  Only Bitcoin-type wallet managers support it; call before connecting.
+     */
+    extern void
+    cryptoWalletManagerSetCompactFilterSync (BRCryptoWalletManager cwm,
+                                             BRCryptoBoolean useCompactFilters);
+
     extern BRCryptoBoolean
     cryptoWalletManagerHasWallet (BRCryptoWalletManager cwm,
                                   BRCryptoWallet wallet);
@@ -282,6 +290,16 @@ extern "C" {
                              BRCryptoTransfer transfer,
                              const char *paperKey);
 
+    /**
+     * Set the number of threads `cryptoWalletManagerSign()` uses to sign a transfer's inputs; the
+     * default of 1 signs on the caller's thread.  Only BTC-like transfers, which have one
+     * signature per input, are signed in parallel.  Signatures are deterministic, so the signed
+     * transfer is the same for any thread count.
+     */
+    extern void
+    cryptoWalletManagerSetSignThreadCount (BRCryptoWalletManager cwm,
+                                           size_t threadCount);
+
     extern void
     cryptoWalletManagerSubmit (BRCryptoWalletManager cwm,
                                BRCryptoWallet wid,
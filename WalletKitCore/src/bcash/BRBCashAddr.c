@@ -151,7 +151,7 @@ size_t BRBCashAddrDecode(char *bitcoinAddr36, const char *bCashAddr)
             if (data[0] == 0x08) ver = BITCOIN_SCRIPT_PREFIX_TEST;
         }
     }
-    else if (BRBase58CheckDecode(data, sizeof(data), bCashAddr) == 21) {
+    else if (BRBase58CheckDecodePublic(data, sizeof(data), bCashAddr) == 21) {
         if (data[0] == BITCOIN_PUBKEY_PREFIX) ver = BITCOIN_PUBKEY_PREFIX;
         if (data[0] == BITCOIN_SCRIPT_PREFIX) ver = BITCOIN_SCRIPT_PREFIX;
     }
@@ -175,7 +175,7 @@ size_t BRBCashAddrDecode(char *bitcoinAddr36, const char *bCashAddr)
     }
 
     data[0] = ver;
-    return (ver != UINT8_MAX) ? BRBase58CheckEncode(bitcoinAddr36, 36, data, 21) : 0;
+    return (ver != UINT8_MAX) ? BRBase58CheckEncodePublic(bitcoinAddr36, 36, data, 21) : 0;
 }
 
 // returns the number of bytes written to bCashAddr55 (maximum of 55)
@@ -186,7 +186,7 @@ size_t BRBCashAddrEncode(char *bCashAddr55, const char *bitcoinAddr)
     
     assert(bCashAddr55 != NULL);
     assert(bitcoinAddr != NULL);
-    if (BRBase58CheckDecode(data, sizeof(data), bitcoinAddr) != 21) return 0;
+    if (BRBase58CheckDecodePublic(data, sizeof(data), bitcoinAddr) != 21) return 0;
     if (data[0] == BITCOIN_PUBKEY_PREFIX) ver = 0x00, hrp = "bitcoincash";
     if (data[0] == BITCOIN_SCRIPT_PREFIX) ver = 0x08, hrp = "bitcoincash";
     if (data[0] == BITCOIN_PUBKEY_PREFIX_TEST) ver = 0x00, hrp = "bchtest";
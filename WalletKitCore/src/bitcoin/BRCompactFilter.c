@@ -0,0 +1,288 @@
+//
+//  BRCompactFilter.c
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#include "BRCompactFilter.h"
+#include "support/BRCrypto.h"
+#include "support/BRAddress.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define SIP_LANES 4
+
+#define _rol64(a, b) (((a) << (b)) | ((a) >> (64 - (b))))
+
+// one sipround on each of SIP_LANES independent states, written lane-wise so the compiler can vectorize it
+#define _sipround4(a, b, c, d) do {\
+    for (int _l = 0; _l < SIP_LANES; _l++) {\
+        a[_l] += b[_l], b[_l] = _rol64(b[_l], 13) ^ a[_l], a[_l] = _rol64(a[_l], 32);\
+        c[_l] += d[_l], d[_l] = _rol64(d[_l], 16) ^ c[_l];\
+        a[_l] += d[_l], d[_l] = _rol64(d[_l], 21) ^ a[_l];\
+        c[_l] += b[_l], b[_l] = _rol64(b[_l], 17) ^ c[_l], c[_l] = _rol64(c[_l], 32);\
+    }\
+} while (0)
+
+// sipHash-2-4 of the same data under SIP_LANES keys, matching BRSip64() for each key
+static void _BRSip64x4(uint64_t md[SIP_LANES], const uint64_t k0[SIP_LANES], const uint64_t k1[SIP_LANES],
+                       const uint8_t *data, size_t dataLen)
+{
+    uint64_t a[SIP_LANES], b[SIP_LANES], c[SIP_LANES], d[SIP_LANES], x;
+    size_t i, j;
+    int l;
+
+    for (l = 0; l < SIP_LANES; l++) {
+        a[l] = 0x736f6d6570736575 ^ k0[l], b[l] = 0x646f72616e646f6d ^ k1[l];
+        c[l] = 0x6c7967656e657261 ^ k0[l], d[l] = 0x7465646279746573 ^ k1[l];
+    }
+
+    for (i = 0; i + 7 < dataLen; i += sizeof(x)) {
+        x = UInt64GetLE(&data[i]);
+        for (l = 0; l < SIP_LANES; l++) d[l] ^= x;
+        _sipround4(a, b, c, d);
+        _sipround4(a, b, c, d);
+        for (l = 0; l < SIP_LANES; l++) a[l] ^= x;
+    }
+
+    x = (uint64_t)dataLen << 56;
+    for (j = 0; i + j < dataLen; j++) x |= (uint64_t)data[i + j] << j*8;
+    for (l = 0; l < SIP_LANES; l++) d[l] ^= x;
+    _sipround4(a, b, c, d);
+    _sipround4(a, b, c, d);
+    for (l = 0; l < SIP_LANES; l++) a[l] ^= x, c[l] ^= 0xff;
+    for (j = 0; j < 4; j++) _sipround4(a, b, c, d);
+    for (l = 0; l < SIP_LANES; l++) md[l] = a[l] ^ b[l] ^ c[l] ^ d[l];
+}
+
+// high 64 bits of the 128 bit product a*b, which maps a uniform 64 bit hash to a uniform value in the range [0, b)
+// (done in 32 bit halves, since 128 bit integers aren't available on every target)
+static uint64_t _BRMulHi64(uint64_t a, uint64_t b)
+{
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t lo = aLo*bLo, m1 = aHi*bLo, m2 = aLo*bHi, mid = (lo >> 32) + (uint32_t)m1 + (uint32_t)m2;
+
+    return aHi*bHi + (m1 >> 32) + (m2 >> 32) + (mid >> 32);
+}
+
+static int _uint64Compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+// reads the golomb-rice coded set most significant bit first, through a 64 bit window
+typedef struct {
+    const uint8_t *buf;
+    size_t len, off;
+    uint64_t window;
+    int bits;
+} _BRGolombReader;
+
+static void _BRGolombRefill(_BRGolombReader *r)
+{
+    while (r->bits <= 56 && r->off < r->len) {
+        r->window |= (uint64_t)r->buf[r->off++] << (56 - r->bits);
+        r->bits += 8;
+    }
+}
+
+// returns false if the set ends before a complete value
+static int _BRGolombRead(_BRGolombReader *r, uint64_t *value)
+{
+    uint64_t q = 0;
+
+    for (;;) { // quotient in unary, terminated by a 0 bit
+        if (r->bits == 0) _BRGolombRefill(r);
+        if (r->bits == 0) return 0;
+        if ((r->window >> 63) == 0) break;
+        r->window <<= 1, r->bits--, q++;
+    }
+
+    r->window <<= 1, r->bits--;
+    _BRGolombRefill(r);
+    if (r->bits < COMPACT_FILTER_BASIC_P) return 0;
+    *value = (q << COMPACT_FILTER_BASIC_P) | (r->window >> (64 - COMPACT_FILTER_BASIC_P));
+    r->window <<= COMPACT_FILTER_BASIC_P, r->bits -= COMPACT_FILTER_BASIC_P;
+    return 1;
+}
+
+// writes value to buf at bitIdx, or just counts the bits if buf is NULL, returns the new bitIdx
+static size_t _BRGolombWrite(uint8_t *buf, size_t bitIdx, uint64_t value)
+{
+    uint64_t q = value >> COMPACT_FILTER_BASIC_P;
+
+    if (buf) {
+        for (; q > 0; q--, bitIdx++) buf[bitIdx/8] |= 0x80 >> (bitIdx % 8);
+        bitIdx++; // terminating 0 bit
+
+        for (int i = COMPACT_FILTER_BASIC_P - 1; i >= 0; i--, bitIdx++) {
+            if ((value >> i) & 1) buf[bitIdx/8] |= 0x80 >> (bitIdx % 8);
+        }
+    }
+    else bitIdx += q + 1 + COMPACT_FILTER_BASIC_P;
+
+    return bitIdx;
+}
+
+// parses the item count at the start of filter, returns false if it's malformed
+static int _BRCompactFilterCount(const uint8_t *filter, size_t filterLen, uint64_t *count, size_t *off)
+{
+    *off = 0;
+    *count = (filter) ? BRVarInt(filter, filterLen, off) : 0;
+
+    // every item takes at least P + 1 bits
+    return (*off > 0 && *count <= (uint64_t)(filterLen - *off)*8/(COMPACT_FILTER_BASIC_P + 1));
+}
+
+// true if any of the sorted hashes are in the set that starts at filter[off]
+static int _BRCompactFilterMatchSorted(const uint8_t *filter, size_t filterLen, size_t off, uint64_t count,
+                                       const uint64_t hashes[], size_t hashesCount)
+{
+    _BRGolombReader r = { filter, filterLen, off, 0, 0 };
+    uint64_t value = 0, delta;
+    size_t i = 0;
+
+    for (uint64_t n = 0; n < count && i < hashesCount; n++) {
+        if (! _BRGolombRead(&r, &delta)) return 0;
+        value += delta;
+        while (i < hashesCount && hashes[i] < value) i++;
+        if (i < hashesCount && hashes[i] == value) return 1;
+    }
+
+    return 0;
+}
+
+// writes a basic filter for the given items to filter, returns number of bytes written, or total filterLen needed if
+// filter is NULL - items must not contain duplicates
+size_t BRCompactFilterBuild(uint8_t *filter, size_t filterLen, UInt256 blockHash, const uint8_t *items[],
+                            const size_t itemLens[], size_t itemsCount)
+{
+    uint64_t f = (uint64_t)itemsCount*COMPACT_FILTER_BASIC_M, *hashes = malloc((itemsCount + 1)*sizeof(*hashes));
+    size_t i, bitsCount = 0, off, len;
+
+    assert(hashes != NULL);
+    assert(items != NULL || itemsCount == 0);
+    assert(itemLens != NULL || itemsCount == 0);
+
+    for (i = 0; i < itemsCount; i++) hashes[i] = _BRMulHi64(BRSip64(blockHash.u8, items[i], itemLens[i]), f);
+    qsort(hashes, itemsCount, sizeof(*hashes), _uint64Compare);
+    for (i = 0; i < itemsCount; i++) bitsCount = _BRGolombWrite(NULL, bitsCount, hashes[i] - (i > 0 ? hashes[i - 1] : 0));
+    len = BRVarIntSize(itemsCount) + (bitsCount + 7)/8;
+
+    if (filter && len <= filterLen) {
+        memset(filter, 0, len);
+        off = BRVarIntSet(filter, filterLen, itemsCount);
+        bitsCount = 0;
+
+        for (i = 0; i < itemsCount; i++) {
+            bitsCount = _BRGolombWrite(&filter[off], bitsCount, hashes[i] - (i > 0 ? hashes[i - 1] : 0));
+        }
+    }
+
+    free(hashes);
+    return (! filter || len <= filterLen) ? len : 0;
+}
+
+// true if any of the items may be in the basic filter for blockHash, false if the filter is malformed
+int BRCompactFilterMatchAny(const uint8_t *filter, size_t filterLen, UInt256 blockHash, const uint8_t *items[],
+                            const size_t itemLens[], size_t itemsCount)
+{
+    uint64_t count, *hashes;
+    size_t off;
+    int r = 0;
+
+    assert(items != NULL || itemsCount == 0);
+    assert(itemLens != NULL || itemsCount == 0);
+
+    if (itemsCount > 0 && _BRCompactFilterCount(filter, filterLen, &count, &off) && count > 0) {
+        hashes = malloc(itemsCount*sizeof(*hashes));
+        assert(hashes != NULL);
+
+        for (size_t i = 0; i < itemsCount; i++) {
+            hashes[i] = _BRMulHi64(BRSip64(blockHash.u8, items[i], itemLens[i]), count*COMPACT_FILTER_BASIC_M);
+        }
+
+        qsort(hashes, itemsCount, sizeof(*hashes), _uint64Compare);
+        r = _BRCompactFilterMatchSorted(filter, filterLen, off, count, hashes, itemsCount);
+        free(hashes);
+    }
+
+    return r;
+}
+
+// matches the same items against each of filtersCount basic filters, setting matches[i] to true if any item may be in
+// filters[i], returns the number of filters matched
+size_t BRCompactFilterMatchAnyBatch(const uint8_t *filters[], const size_t filterLens[], const UInt256 blockHashes[],
+                                    size_t filtersCount, const uint8_t *items[], const size_t itemLens[],
+                                    size_t itemsCount, uint8_t matches[])
+{
+    uint64_t *hashes = malloc((SIP_LANES*itemsCount + 1)*sizeof(*hashes)), k0[SIP_LANES], k1[SIP_LANES],
+             f[SIP_LANES], counts[SIP_LANES], md[SIP_LANES];
+    size_t i, j, offs[SIP_LANES], matchCount = 0;
+    int l, lanes, valid[SIP_LANES];
+
+    assert(hashes != NULL);
+    assert(filters != NULL || filtersCount == 0);
+    assert(filterLens != NULL || filtersCount == 0);
+    assert(blockHashes != NULL || filtersCount == 0);
+    assert(matches != NULL || filtersCount == 0);
+    assert(items != NULL || itemsCount == 0);
+    assert(itemLens != NULL || itemsCount == 0);
+
+    for (i = 0; i < filtersCount; i += SIP_LANES) {
+        lanes = (filtersCount - i < SIP_LANES) ? (int)(filtersCount - i) : SIP_LANES;
+
+        for (l = 0; l < SIP_LANES; l++) { // a short final batch repeats its first filter in the unused lanes
+            j = i + ((l < lanes) ? l : 0);
+            valid[l] = _BRCompactFilterCount(filters[j], filterLens[j], &counts[l], &offs[l]) && counts[l] > 0;
+            f[l] = (valid[l]) ? counts[l]*COMPACT_FILTER_BASIC_M : 0;
+            k0[l] = UInt64GetLE(&blockHashes[j].u8[0]);
+            k1[l] = UInt64GetLE(&blockHashes[j].u8[sizeof(uint64_t)]);
+        }
+
+        for (j = 0; j < itemsCount; j++) {
+            _BRSip64x4(md, k0, k1, items[j], itemLens[j]);
+            for (l = 0; l < lanes; l++) hashes[l*itemsCount + j] = _BRMulHi64(md[l], f[l]);
+        }
+
+        for (l = 0; l < lanes; l++) {
+            matches[i + l] = 0;
+            if (! valid[l] || itemsCount == 0) continue;
+            qsort(&hashes[l*itemsCount], itemsCount, sizeof(*hashes), _uint64Compare);
+            matches[i + l] = _BRCompactFilterMatchSorted(filters[i + l], filterLens[i + l], offs[l], counts[l],
+                                                         &hashes[l*itemsCount], itemsCount);
+            if (matches[i + l]) matchCount++;
+        }
+    }
+
+    free(hashes);
+    return matchCount;
+}
+
+// the BIP157 filter hash, sha256d of the serialized filter
+UInt256 BRCompactFilterHash(const uint8_t *filter, size_t filterLen)
+{
+    UInt256 md;
+
+    assert(filter != NULL || filterLen == 0);
+    BRSHA256_2(&md, filter, filterLen);
+    return md;
+}
+
+// the BIP157 filter header, sha256d of filterHash followed by the previous block's filter header
+UInt256 BRCompactFilterHeader(UInt256 filterHash, UInt256 prevHeader)
+{
+    uint8_t buf[sizeof(UInt256)*2];
+    UInt256 md;
+
+    UInt256Set(buf, filterHash);
+    UInt256Set(&buf[sizeof(UInt256)], prevHeader);
+    BRSHA256_2(&md, buf, sizeof(buf));
+    return md;
+}
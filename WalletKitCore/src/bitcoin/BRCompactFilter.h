@@ -0,0 +1,60 @@
+//
+//  BRCompactFilter.h
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#ifndef BRCompactFilter_h
+#define BRCompactFilter_h
+
+#include "support/BRInt.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// compact block filters are explained in BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+// and BIP158: https://github.com/bitcoin/bips/blob/master/bip-0158.mediawiki
+
+#define COMPACT_FILTER_TYPE_BASIC 0x00
+#define COMPACT_FILTER_BASIC_P    19     // golomb-rice coding parameter
+#define COMPACT_FILTER_BASIC_M    784931 // inverse false positive rate
+#define COMPACT_FILTER_MAX_COUNT  1000   // most filters a peer will return for one getcfilters request
+
+// A basic filter is the number of items N as a varint, followed by the golomb-rice coded, sorted differences of each
+// item's siphash, keyed by the first 16 bytes of the block hash, mapped into the range [0, N*M). The items are the
+// output scripts of every transaction in the block, and the output scripts spent by every non-coinbase input, so a
+// wallet's own scriptPubKeys are all that's needed to find both the transactions it received and those it sent.
+
+// writes a basic filter for the given items to filter, returns number of bytes written, or total filterLen needed if
+// filter is NULL - items must not contain duplicates
+size_t BRCompactFilterBuild(uint8_t *filter, size_t filterLen, UInt256 blockHash, const uint8_t *items[],
+                            const size_t itemLens[], size_t itemsCount);
+
+// true if any of the items may be in the basic filter for blockHash, false if the filter is malformed
+int BRCompactFilterMatchAny(const uint8_t *filter, size_t filterLen, UInt256 blockHash, const uint8_t *items[],
+                            const size_t itemLens[], size_t itemsCount);
+
+// matches the same items against each of filtersCount basic filters, setting matches[i] to true if any item may be in
+// filters[i], returns the number of filters matched
+// - items are hashed under four block keys at a time, so a batch costs about a quarter of the hashing of single matches
+size_t BRCompactFilterMatchAnyBatch(const uint8_t *filters[], const size_t filterLens[], const UInt256 blockHashes[],
+                                    size_t filtersCount, const uint8_t *items[], const size_t itemLens[],
+                                    size_t itemsCount, uint8_t matches[]);
+
+// the BIP157 filter hash, sha256d of the serialized filter
+UInt256 BRCompactFilterHash(const uint8_t *filter, size_t filterLen);
+
+// the BIP157 filter header, sha256d of filterHash followed by the previous block's filter header
+UInt256 BRCompactFilterHeader(UInt256 filterHash, UInt256 prevHeader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRCompactFilter_h
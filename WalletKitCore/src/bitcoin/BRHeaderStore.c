@@ -0,0 +1,456 @@
+//
+//  BRHeaderStore.c
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#include "BRHeaderStore.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HEADER_STORE_MAGIC   0x53484252 // "BRHS"
+#define HEADER_STORE_VERSION 1
+#define HEADER_STORE_PREFIX  64   // magic, version, record length, header count, base height, zero padding
+#define HEADER_RECORD_LENGTH 148  // 80 byte header, 4 byte height, 32 byte block hash, 32 byte chain work
+#define HEADER_HEIGHT_OFF    80
+#define HEADER_HASH_OFF      84
+#define HEADER_WORK_OFF      116
+#define HEADER_STORE_GROWTH  4096 // records the file is extended by when it's full
+
+struct BRHeaderStoreStruct {
+    int fd;
+    uint8_t *map;
+    size_t mapLen, capacity, count;
+    uint32_t baseHeight;
+    uint32_t *index; // open addressed hash index of record number + 1, 0 for an empty slot
+    size_t indexLen; // power of two
+    pthread_mutex_t lock;
+};
+
+inline static uint8_t *_BRHeaderStoreRecord(BRHeaderStore *store, size_t i)
+{
+    return &store->map[HEADER_STORE_PREFIX + i*HEADER_RECORD_LENGTH];
+}
+
+inline static UInt256 _BRHeaderStoreHash(BRHeaderStore *store, size_t i)
+{
+    return UInt256Get(&_BRHeaderStoreRecord(store, i)[HEADER_HASH_OFF]);
+}
+
+static void _BRHeaderStoreSetCount(BRHeaderStore *store, size_t count)
+{
+    store->count = count;
+    UInt32SetLE(&store->map[12], (uint32_t)count);
+    UInt32SetLE(&store->map[16], store->baseHeight);
+}
+
+static int _BRHeaderStoreMap(BRHeaderStore *store, size_t mapLen)
+{
+    uint8_t *map;
+
+    // the new mapping is made before the old one is released, so a failure leaves the store as it was
+    if (ftruncate(store->fd, (off_t)mapLen) < 0) return 0;
+    map = mmap(NULL, mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (map == MAP_FAILED) return 0;
+    if (store->map) munmap(store->map, store->mapLen);
+    store->map = map;
+    store->mapLen = mapLen;
+    store->capacity = (mapLen - HEADER_STORE_PREFIX)/HEADER_RECORD_LENGTH;
+    return 1;
+}
+
+static void _BRHeaderStoreIndexAdd(BRHeaderStore *store, size_t i)
+{
+    size_t slot = (size_t)_BRHeaderStoreHash(store, i).u64[0] & (store->indexLen - 1);
+
+    while (store->index[slot] != 0) slot = (slot + 1) & (store->indexLen - 1);
+    store->index[slot] = (uint32_t)(i + 1);
+}
+
+// rebuilds the hash index for the current count, sized for at least the current capacity
+static void _BRHeaderStoreIndexBuild(BRHeaderStore *store)
+{
+    size_t indexLen = 1024;
+
+    while (indexLen < 2*store->capacity) indexLen *= 2;
+    if (indexLen != store->indexLen) store->index = realloc(store->index, indexLen*sizeof(*store->index));
+    assert(store->index != NULL);
+    store->indexLen = indexLen;
+    memset(store->index, 0, indexLen*sizeof(*store->index));
+    for (size_t i = 0; i < store->count; i++) _BRHeaderStoreIndexAdd(store, i);
+}
+
+// returns the record number for blockHash, or SIZE_MAX if it's not in the store
+static size_t _BRHeaderStoreFind(BRHeaderStore *store, UInt256 blockHash)
+{
+    size_t slot = (size_t)blockHash.u64[0] & (store->indexLen - 1);
+
+    while (store->index[slot] != 0) {
+        if (UInt256Eq(_BRHeaderStoreHash(store, store->index[slot] - 1), blockHash)) return store->index[slot] - 1;
+        slot = (slot + 1) & (store->indexLen - 1);
+    }
+
+    return SIZE_MAX;
+}
+
+// u64[0] is the least significant limb
+static UInt256 _BRUInt256Add(UInt256 a, UInt256 b)
+{
+    uint64_t carry = 0;
+
+    for (int i = 0; i < 4; i++) {
+        uint64_t s = a.u64[i] + carry;
+
+        carry = (s < carry);
+        a.u64[i] = s + b.u64[i];
+        carry += (a.u64[i] < s);
+    }
+
+    return a;
+}
+
+// returns the expected number of hashes needed to find a block with the given compact target, 2^256/(target + 1),
+// computed as ~target/(target + 1) + 1 so it fits in 256 bits
+static UInt256 _BRTargetWork(uint32_t target)
+{
+    uint32_t size = target >> 24, word = target & 0x007fffff;
+    UInt256 t = UINT256_ZERO, n, q = UINT256_ZERO, r = UINT256_ZERO;
+    int i;
+
+    if (size > 32) return UINT256_ZERO;
+
+    if (size <= 3) t.u64[0] = word >> 8*(3 - size);
+    else for (i = 0; i < 3 && size - 3 + i < 32; i++) t.u8[size - 3 + i] = (uint8_t)(word >> 8*i); // little endian
+    if (UInt256IsZero(t)) return UINT256_ZERO;
+
+    for (i = 0; i < 4; i++) n.u64[i] = ~t.u64[i];
+    t = _BRUInt256Add(t, ((UInt256) { .u64 = { 1, 0, 0, 0 } }));
+
+    for (i = 255; i >= 0; i--) { // long division, one bit at a time
+        int top = (r.u64[3] >> 63) != 0, ge = top;
+
+        for (int j = 3; j > 0; j--) r.u64[j] = (r.u64[j] << 1) | (r.u64[j - 1] >> 63);
+        r.u64[0] = (r.u64[0] << 1) | ((n.u64[i/64] >> (i % 64)) & 1);
+
+        for (int j = 3; ! ge && j >= 0; j--) {
+            if (r.u64[j] != t.u64[j]) {
+                ge = (r.u64[j] > t.u64[j]);
+                break;
+            }
+
+            if (j == 0) ge = 1;
+        }
+
+        if (ge) {
+            uint64_t borrow = 0;
+
+            for (int j = 0; j < 4; j++) {
+                uint64_t d = r.u64[j] - t.u64[j] - borrow;
+
+                borrow = (r.u64[j] < t.u64[j]) || (r.u64[j] - t.u64[j] < borrow);
+                r.u64[j] = d;
+            }
+
+            q.u64[i/64] |= 1ULL << (i % 64);
+        }
+    }
+
+    return _BRUInt256Add(q, ((UInt256) { .u64 = { 1, 0, 0, 0 } }));
+}
+
+static UInt256 _BRHeaderStoreWork(BRHeaderStore *store, size_t i)
+{
+    const uint8_t *work = &_BRHeaderStoreRecord(store, i)[HEADER_WORK_OFF];
+    UInt256 u;
+
+    for (int j = 0; j < 4; j++) u.u64[j] = UInt64GetLE(&work[j*sizeof(uint64_t)]);
+    return u;
+}
+
+static BRMerkleBlock *_BRHeaderStoreBlock(BRHeaderStore *store, size_t i)
+{
+    const uint8_t *record = _BRHeaderStoreRecord(store, i);
+    BRMerkleBlock *block = BRMerkleBlockNew();
+
+    block->version = UInt32GetLE(&record[0]);
+    block->prevBlock = UInt256Get(&record[4]);
+    block->merkleRoot = UInt256Get(&record[36]);
+    block->timestamp = UInt32GetLE(&record[68]);
+    block->target = UInt32GetLE(&record[72]);
+    block->nonce = UInt32GetLE(&record[76]);
+    block->height = UInt32GetLE(&record[HEADER_HEIGHT_OFF]);
+    block->blockHash = UInt256Get(&record[HEADER_HASH_OFF]);
+    return block; // totalTx is left 0, marking it as a header
+}
+
+static int _BRHeaderStoreAppend(BRHeaderStore *store, const BRMerkleBlock *block)
+{
+    BRMerkleBlock header = *block;
+    uint8_t *record;
+    UInt256 work = _BRTargetWork(block->target);
+
+    if (store->count == store->capacity) {
+        if (! _BRHeaderStoreMap(store, store->mapLen + HEADER_STORE_GROWTH*HEADER_RECORD_LENGTH)) return 0;
+        _BRHeaderStoreIndexBuild(store);
+    }
+
+    if (store->count == 0) store->baseHeight = block->height;
+    else work = _BRUInt256Add(work, _BRHeaderStoreWork(store, store->count - 1));
+    record = _BRHeaderStoreRecord(store, store->count);
+    header.totalTx = 0; // serialize just the 80 byte header
+    BRMerkleBlockSerialize(&header, record, 80);
+    UInt32SetLE(&record[HEADER_HEIGHT_OFF], block->height);
+    UInt256Set(&record[HEADER_HASH_OFF], block->blockHash);
+    for (int j = 0; j < 4; j++) UInt64SetLE(&record[HEADER_WORK_OFF + j*sizeof(uint64_t)], work.u64[j]);
+    _BRHeaderStoreIndexAdd(store, store->count);
+    _BRHeaderStoreSetCount(store, store->count + 1); // the count is written last, after the record is complete
+    return 1;
+}
+
+static void _BRHeaderStoreTruncate(BRHeaderStore *store, size_t count)
+{
+    if (count < store->count) {
+        _BRHeaderStoreSetCount(store, count);
+        _BRHeaderStoreIndexBuild(store);
+    }
+}
+
+// opens the header store at path, creating it if needed, returns NULL on failure
+// - a store that fails validation is truncated to its last valid header
+BRHeaderStore *BRHeaderStoreOpen(const char *path)
+{
+    BRHeaderStore *store = calloc(1, sizeof(*store));
+    struct stat st;
+    size_t count = 0, i;
+
+    assert(store != NULL);
+    assert(path != NULL);
+    store->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if (store->fd < 0 || fstat(store->fd, &st) < 0 ||
+        ! _BRHeaderStoreMap(store, ((size_t)st.st_size >= HEADER_STORE_PREFIX + HEADER_RECORD_LENGTH) ?
+                            (size_t)st.st_size : HEADER_STORE_PREFIX + HEADER_STORE_GROWTH*HEADER_RECORD_LENGTH)) {
+        if (store->fd >= 0) close(store->fd);
+        free(store);
+        return NULL;
+    }
+
+    if (UInt32GetLE(&store->map[0]) == HEADER_STORE_MAGIC && UInt32GetLE(&store->map[4]) == HEADER_STORE_VERSION &&
+        UInt32GetLE(&store->map[8]) == HEADER_RECORD_LENGTH) {
+        count = UInt32GetLE(&store->map[12]);
+        store->baseHeight = UInt32GetLE(&store->map[16]);
+        if (count > store->capacity) count = store->capacity;
+    }
+
+    // the first header must be a difficulty transition, and each one after must follow the one before it
+    for (i = 0; i < count; i++) {
+        const uint8_t *record = _BRHeaderStoreRecord(store, i);
+
+        if (UInt32GetLE(&record[HEADER_HEIGHT_OFF]) != store->baseHeight + i) break;
+        if (i == 0 && (store->baseHeight % BLOCK_DIFFICULTY_INTERVAL) != 0) break;
+        if (i > 0 && ! UInt256Eq(UInt256Get(&record[4]), _BRHeaderStoreHash(store, i - 1))) break;
+    }
+
+    memset(store->map, 0, HEADER_STORE_PREFIX);
+    UInt32SetLE(&store->map[0], HEADER_STORE_MAGIC);
+    UInt32SetLE(&store->map[4], HEADER_STORE_VERSION);
+    UInt32SetLE(&store->map[8], HEADER_RECORD_LENGTH);
+    _BRHeaderStoreSetCount(store, i);
+    _BRHeaderStoreIndexBuild(store);
+    pthread_mutex_init(&store->lock, NULL);
+    return store;
+}
+
+// number of headers in the store
+size_t BRHeaderStoreCount(BRHeaderStore *store)
+{
+    size_t count;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    count = store->count;
+    pthread_mutex_unlock(&store->lock);
+    return count;
+}
+
+// height of the first header in the store, or BLOCK_UNKNOWN_HEIGHT if it's empty
+uint32_t BRHeaderStoreBaseHeight(BRHeaderStore *store)
+{
+    uint32_t height;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    height = (store->count > 0) ? store->baseHeight : BLOCK_UNKNOWN_HEIGHT;
+    pthread_mutex_unlock(&store->lock);
+    return height;
+}
+
+// height of the last header in the store, or BLOCK_UNKNOWN_HEIGHT if it's empty
+uint32_t BRHeaderStoreTipHeight(BRHeaderStore *store)
+{
+    uint32_t height;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    height = (store->count > 0) ? store->baseHeight + (uint32_t)store->count - 1 : BLOCK_UNKNOWN_HEIGHT;
+    pthread_mutex_unlock(&store->lock);
+    return height;
+}
+
+// adds the header of block, which must have a known height, returns true if it's stored
+// - a block that extends the tip is appended
+// - a block that connects below the tip replaces the headers from its height on (chain reorganization)
+// - a difficulty transition block that doesn't connect restarts the store from that block
+// - an empty store can only be started from a difficulty transition block
+int BRHeaderStoreAdd(BRHeaderStore *store, const BRMerkleBlock *block)
+{
+    size_t i;
+    int r = 0;
+
+    assert(store != NULL);
+    assert(block != NULL);
+    if (block->height == BLOCK_UNKNOWN_HEIGHT) return 0;
+    pthread_mutex_lock(&store->lock);
+    i = (store->count > 0 && block->height >= store->baseHeight) ? block->height - store->baseHeight : SIZE_MAX;
+
+    if (i < store->count && UInt256Eq(_BRHeaderStoreHash(store, i), block->blockHash)) {
+        r = 1; // already stored
+    }
+    else if (i != SIZE_MAX && i > 0 && i <= store->count &&
+             UInt256Eq(_BRHeaderStoreHash(store, i - 1), block->prevBlock)) {
+        _BRHeaderStoreTruncate(store, i);
+        r = _BRHeaderStoreAppend(store, block);
+    }
+    else if ((block->height % BLOCK_DIFFICULTY_INTERVAL) == 0) {
+        _BRHeaderStoreTruncate(store, 0);
+        r = _BRHeaderStoreAppend(store, block);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return r;
+}
+
+// removes all headers above height
+void BRHeaderStoreRewind(BRHeaderStore *store, uint32_t height)
+{
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+
+    if (store->count > 0 && height != BLOCK_UNKNOWN_HEIGHT) {
+        _BRHeaderStoreTruncate(store, (height >= store->baseHeight) ? height - store->baseHeight + 1 : 0);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+}
+
+// removes all headers
+void BRHeaderStoreClear(BRHeaderStore *store)
+{
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    _BRHeaderStoreTruncate(store, 0);
+    pthread_mutex_unlock(&store->lock);
+}
+
+// returns a header-only block for the given height, or NULL if it's not in the store
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockAtHeight(BRHeaderStore *store, uint32_t height)
+{
+    BRMerkleBlock *block = NULL;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+
+    if (store->count > 0 && height >= store->baseHeight && height - store->baseHeight < store->count) {
+        block = _BRHeaderStoreBlock(store, height - store->baseHeight);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return block;
+}
+
+// returns the height of the header with the given block hash, or BLOCK_UNKNOWN_HEIGHT if it's not in the store
+uint32_t BRHeaderStoreHeightForHash(BRHeaderStore *store, UInt256 blockHash)
+{
+    uint32_t height = BLOCK_UNKNOWN_HEIGHT;
+    size_t i;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    i = _BRHeaderStoreFind(store, blockHash);
+    if (i != SIZE_MAX) height = store->baseHeight + (uint32_t)i;
+    pthread_mutex_unlock(&store->lock);
+    return height;
+}
+
+// returns the last difficulty transition block at or before height, whose target applies to the block at height, or
+// NULL if it's not in the store - result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreRetargetBlock(BRHeaderStore *store, uint32_t height)
+{
+    return (height == BLOCK_UNKNOWN_HEIGHT) ? NULL :
+           BRHeaderStoreBlockAtHeight(store, height - (height % BLOCK_DIFFICULTY_INTERVAL));
+}
+
+// chain work accumulated from the store's first header through the header at height, or UINT256_ZERO if it's not in
+// the store
+UInt256 BRHeaderStoreChainWork(BRHeaderStore *store, uint32_t height)
+{
+    UInt256 work = UINT256_ZERO;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+
+    if (store->count > 0 && height >= store->baseHeight && height - store->baseHeight < store->count) {
+        work = _BRHeaderStoreWork(store, height - store->baseHeight);
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return work;
+}
+
+// writes header-only blocks from the last difficulty transition at or before the tip, through the tip, to blocks, in
+// ascending height order - returns the number of blocks written, or the total needed if blocks is NULL
+// each block must be freed by calling BRMerkleBlockFree()
+size_t BRHeaderStoreRecentBlocks(BRHeaderStore *store, BRMerkleBlock *blocks[], size_t blocksCount)
+{
+    size_t first, count = 0;
+
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+
+    if (store->count > 0) {
+        first = (store->baseHeight + store->count - 1) % BLOCK_DIFFICULTY_INTERVAL; // records after the transition
+        first = store->count - 1 - ((first < store->count) ? first : store->count - 1);
+        count = store->count - first;
+
+        if (blocks) {
+            if (count > blocksCount) count = blocksCount;
+            for (size_t i = 0; i < count; i++) blocks[i] = _BRHeaderStoreBlock(store, first + i);
+        }
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return count;
+}
+
+// closes the store, unmapping its file
+void BRHeaderStoreClose(BRHeaderStore *store)
+{
+    assert(store != NULL);
+    pthread_mutex_lock(&store->lock);
+    if (store->map) munmap(store->map, store->mapLen);
+    close(store->fd);
+    if (store->index) free(store->index);
+    pthread_mutex_unlock(&store->lock);
+    pthread_mutex_destroy(&store->lock);
+    free(store);
+}
@@ -0,0 +1,82 @@
+//
+//  BRHeaderStore.h
+//
+//  Copyright © 2026 Breadwallet AG. All rights reserved.
+//
+//  See the LICENSE file at the project root for license information.
+//  See the CONTRIBUTORS file at the project root for a list of contributors.
+//
+
+#ifndef BRHeaderStore_h
+#define BRHeaderStore_h
+
+#include "BRMerkleBlock.h"
+#include "support/BRInt.h"
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An append-only, memory-mapped store of consecutive block headers, starting at a difficulty transition. Each record is
+// the 80 byte header followed by its height, block hash and the chain work accumulated since the store's first block,
+// so lookup by height and the retarget ancestor of any height are O(1), and lookup by hash goes through an in-memory
+// index that's rebuilt from the stored hashes when the store is opened, without re-parsing or re-hashing any headers.
+
+typedef struct BRHeaderStoreStruct BRHeaderStore;
+
+// opens the header store at path, creating it if needed, returns NULL on failure
+// - a store that fails validation is truncated to its last valid header
+BRHeaderStore *BRHeaderStoreOpen(const char *path);
+
+// number of headers in the store
+size_t BRHeaderStoreCount(BRHeaderStore *store);
+
+// height of the first header in the store, or BLOCK_UNKNOWN_HEIGHT if it's empty
+uint32_t BRHeaderStoreBaseHeight(BRHeaderStore *store);
+
+// height of the last header in the store, or BLOCK_UNKNOWN_HEIGHT if it's empty
+uint32_t BRHeaderStoreTipHeight(BRHeaderStore *store);
+
+// adds the header of block, which must have a known height, returns true if it's stored
+// - a block that extends the tip is appended
+// - a block that connects below the tip replaces the headers from its height on (chain reorganization)
+// - a difficulty transition block that doesn't connect restarts the store from that block
+// - an empty store can only be started from a difficulty transition block
+int BRHeaderStoreAdd(BRHeaderStore *store, const BRMerkleBlock *block);
+
+// removes all headers above height
+void BRHeaderStoreRewind(BRHeaderStore *store, uint32_t height);
+
+// removes all headers
+void BRHeaderStoreClear(BRHeaderStore *store);
+
+// returns a header-only block for the given height, or NULL if it's not in the store
+// result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreBlockAtHeight(BRHeaderStore *store, uint32_t height);
+
+// returns the height of the header with the given block hash, or BLOCK_UNKNOWN_HEIGHT if it's not in the store
+uint32_t BRHeaderStoreHeightForHash(BRHeaderStore *store, UInt256 blockHash);
+
+// returns the last difficulty transition block at or before height, whose target applies to the block at height, or
+// NULL if it's not in the store - result must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRHeaderStoreRetargetBlock(BRHeaderStore *store, uint32_t height);
+
+// chain work accumulated from the store's first header through the header at height, or UINT256_ZERO if it's not in
+// the store
+UInt256 BRHeaderStoreChainWork(BRHeaderStore *store, uint32_t height);
+
+// writes header-only blocks from the last difficulty transition at or before the tip, through the tip, to blocks, in
+// ascending height order - returns the number of blocks written, or the total needed if blocks is NULL
+// each block must be freed by calling BRMerkleBlockFree()
+size_t BRHeaderStoreRecentBlocks(BRHeaderStore *store, BRMerkleBlock *blocks[], size_t blocksCount);
+
+// closes the store, unmapping its file
+void BRHeaderStoreClose(BRHeaderStore *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BRHeaderStore_h
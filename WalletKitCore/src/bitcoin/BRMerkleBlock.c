@@ -97,9 +97,8 @@ BRMerkleBlock *BRMerkleBlockCopy(const BRMerkleBlock *block)
     return cpy;
 }
 
-// buf must contain either a serialized merkleblock or header
-// returns a merkle block struct that must be freed by calling BRMerkleBlockFree()
-BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen)
+// blockHash may be NULL, in which case it's computed from the first 80 bytes of buf
+static BRMerkleBlock *_BRMerkleBlockParse(const uint8_t *buf, size_t bufLen, const UInt256 *blockHash)
 {
     BRMerkleBlock *block = (buf && 80 <= bufLen) ? BRMerkleBlockNew() : NULL;
     size_t off = 0, len = 0;
@@ -137,7 +136,8 @@ BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen)
             off += len;
         }
         
-        BRSHA256_2(&block->blockHash, buf, 80);
+        if (blockHash) block->blockHash = *blockHash;
+        else BRSHA256_2(&block->blockHash, buf, 80);
 
         if (off > bufLen) {
             BRMerkleBlockFree(block);
@@ -148,6 +148,53 @@ BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen)
     return block;
 }
 
+// buf must contain either a serialized merkleblock or header
+// returns a merkle block struct that must be freed by calling BRMerkleBlockFree()
+BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen)
+{
+    return _BRMerkleBlockParse(buf, bufLen, NULL);
+}
+
+// buf must contain count serialized headers spaced stride bytes apart (81 bytes in a headers message)
+// the block hashes are computed as a batch, and each parsed header is written to blocks, to be freed by calling
+// BRMerkleBlockFree() - returns the number of headers parsed
+size_t BRMerkleBlockParseHeaders(BRMerkleBlock *blocks[], const uint8_t *buf, size_t stride, size_t count)
+{
+    UInt256 _hashes[0x100], *hashes = (count <= 0x100) ? _hashes : malloc(count*sizeof(*hashes));
+    size_t i;
+    
+    assert(blocks != NULL || count == 0);
+    assert(buf != NULL || count == 0);
+    assert(stride >= 80);
+    assert(hashes != NULL);
+    
+    BRSHA256_2Batch(hashes, buf, 80, stride, count);
+    for (i = 0; i < count; i++) blocks[i] = _BRMerkleBlockParse(&buf[i*stride], 80, &hashes[i]);
+    if (hashes != _hashes) free(hashes);
+    return count;
+}
+
+// same as BRMerkleBlockParseHeaders(), but also checks each header with BRMerkleBlockIsValid() - malformed or invalid
+// headers are freed and their blocks entries set to NULL
+// returns the number of leading headers that parsed and are valid, which is count if all of them are
+size_t BRMerkleBlockParseValidHeaders(BRMerkleBlock *blocks[], const uint8_t *buf, size_t stride, size_t count,
+                                      uint32_t currentTime)
+{
+    size_t i;
+    
+    BRMerkleBlockParseHeaders(blocks, buf, stride, count);
+    
+    for (i = 0; i < count; i++) {
+        if (blocks[i] && ! BRMerkleBlockIsValid(blocks[i], currentTime)) {
+            BRMerkleBlockFree(blocks[i]);
+            blocks[i] = NULL;
+        }
+    }
+    
+    for (i = 0; i < count && blocks[i]; i++);
+    return i;
+}
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
 size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen)
 {
@@ -242,31 +289,73 @@ void BRMerkleBlockSetTxHashes(BRMerkleBlock *block, const UInt256 hashes[], size
     if (block->flags) memcpy(block->flags, flags, flagsLen);
 }
 
-// recursively walks the merkle tree to calculate the merkle root
-// NOTE: this merkle tree design has a security vulnerability (CVE-2012-2459), which can be defended against by
-// considering the merkle root invalid if there are duplicate hashes in any rows with an even number of elements
-static UInt256 _BRMerkleBlockRootR(const BRMerkleBlock *block, size_t *hashIdx, size_t *flagIdx, int depth)
+typedef struct {
+    UInt256 md;
+    size_t right; // index of the right branch, or 0 for a leaf (the left branch always directly follows its parent)
+    int depth;
+} _BRMerkleNode;
+
+// recursively walks the merkle tree, appending each visited node to nodes in depth first order
+static size_t _BRMerkleBlockTreeR(const BRMerkleBlock *block, _BRMerkleNode *nodes, size_t *nodesCount,
+                                  size_t *hashIdx, size_t *flagIdx, int depth)
 {
+    size_t idx = (*nodesCount)++;
     uint8_t flag;
-    UInt256 hashes[2], md = UINT256_ZERO;
 
+    nodes[idx] = (_BRMerkleNode) { UINT256_ZERO, 0, depth };
+    
     if (*flagIdx/8 < block->flagsLen && *hashIdx < block->hashesCount) {
         flag = (block->flags[*flagIdx/8] & (1 << (*flagIdx % 8)));
         (*flagIdx)++;
 
         if (flag && depth != _ceil_log2(block->totalTx)) {
-            hashes[0] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // left branch
-            hashes[1] = _BRMerkleBlockRootR(block, hashIdx, flagIdx, depth + 1); // right branch
+            _BRMerkleBlockTreeR(block, nodes, nodesCount, hashIdx, flagIdx, depth + 1); // left branch
+            nodes[idx].right = _BRMerkleBlockTreeR(block, nodes, nodesCount, hashIdx, flagIdx, depth + 1); // right
+        }
+        else nodes[idx].md = block->hashes[(*hashIdx)++]; // leaf
+    }
+    
+    return idx;
+}
+
+// walks the merkle tree to calculate the merkle root, hashing the node pairs of each tree level as a batch
+// NOTE: this merkle tree design has a security vulnerability (CVE-2012-2459), which can be defended against by
+// considering the merkle root invalid if there are duplicate hashes in any rows with an even number of elements
+static UInt256 _BRMerkleBlockRoot(const BRMerkleBlock *block)
+{
+    // every branch node consumes a flag bit and has exactly two children
+    size_t maxCount = 2*block->flagsLen*8 + 1, nodesCount = 0, hashIdx = 0, flagIdx = 0, pairsCount, i;
+    size_t len = maxCount*(sizeof(_BRMerkleNode) + 3*sizeof(UInt256) + sizeof(size_t));
+    uint64_t _buf[0x400];
+    void *buf = (len <= sizeof(_buf)) ? _buf : malloc(len);
+    _BRMerkleNode *nodes = (_BRMerkleNode *)buf;
+    UInt256 (*pairs)[2] = (UInt256 (*)[2])&nodes[maxCount];
+    UInt256 *mds = (UInt256 *)&pairs[maxCount], md = UINT256_ZERO;
+    size_t *pairIdxs = (size_t *)&mds[maxCount];
+    int depth, r = 1;
 
-            if (! UInt256IsZero(hashes[0]) && ! UInt256Eq(hashes[0], hashes[1])) {
-                if (UInt256IsZero(hashes[1])) hashes[1] = hashes[0]; // if right branch is missing, dup left branch
-                BRSHA256_2(&md, hashes, sizeof(hashes));
+    assert(buf != NULL);
+    _BRMerkleBlockTreeR(block, nodes, &nodesCount, &hashIdx, &flagIdx, 0);
+    
+    for (depth = _ceil_log2(block->totalTx) - 1; r && depth >= 0; depth--) {
+        for (i = 0, pairsCount = 0; r && i < nodesCount; i++) {
+            if (nodes[i].depth != depth || nodes[i].right == 0) continue;
+            pairs[pairsCount][0] = nodes[i + 1].md, pairs[pairsCount][1] = nodes[nodes[i].right].md;
+            
+            if (! UInt256IsZero(pairs[pairsCount][0]) && ! UInt256Eq(pairs[pairsCount][0], pairs[pairsCount][1])) {
+                // if right branch is missing, dup left branch
+                if (UInt256IsZero(pairs[pairsCount][1])) pairs[pairsCount][1] = pairs[pairsCount][0];
+                pairIdxs[pairsCount++] = i;
             }
-            else *hashIdx = SIZE_MAX; // defend against (CVE-2012-2459)
+            else r = 0; // defend against (CVE-2012-2459)
         }
-        else md = block->hashes[(*hashIdx)++]; // leaf
+        
+        if (r) BRSHA256_2Batch(mds, pairs, sizeof(pairs[0]), sizeof(pairs[0]), pairsCount);
+        for (i = 0; r && i < pairsCount; i++) nodes[pairIdxs[i]].md = mds[i];
     }
     
+    if (r && nodesCount > 0) md = nodes[0].md;
+    if (buf != (void *)_buf) free(buf);
     return md;
 }
 
@@ -280,8 +369,7 @@ int BRMerkleBlockIsValid(const BRMerkleBlock *block, uint32_t currentTime)
     // target is in "compact" format, where the most significant byte is the size of the value in bytes, next
     // bit is the sign, and the last 23 bits is the value after having been right shifted by (size - 3)*8 bits
     const uint32_t size = block->target >> 24, target = block->target & 0x007fffff;
-    size_t hashIdx = 0, flagIdx = 0;
-    UInt256 merkleRoot = _BRMerkleBlockRootR(block, &hashIdx, &flagIdx, 0), t = UINT256_ZERO;
+    UInt256 merkleRoot = _BRMerkleBlockRoot(block), t = UINT256_ZERO;
     int r = 1;
     
     // check if merkle root is correct
@@ -66,6 +66,17 @@ BRMerkleBlock *BRMerkleBlockCopy(const BRMerkleBlock *block);
 // returns a merkle block struct that must be freed by calling BRMerkleBlockFree()
 BRMerkleBlock *BRMerkleBlockParse(const uint8_t *buf, size_t bufLen);
 
+// buf must contain count serialized headers spaced stride bytes apart (81 bytes in a headers message)
+// the block hashes are computed as a batch, and each parsed header is written to blocks, to be freed by calling
+// BRMerkleBlockFree() - returns the number of headers parsed
+size_t BRMerkleBlockParseHeaders(BRMerkleBlock *blocks[], const uint8_t *buf, size_t stride, size_t count);
+
+// same as BRMerkleBlockParseHeaders(), but also checks each header with BRMerkleBlockIsValid() - malformed or invalid
+// headers are freed and their blocks entries set to NULL
+// returns the number of leading headers that parsed and are valid, which is count if all of them are
+size_t BRMerkleBlockParseValidHeaders(BRMerkleBlock *blocks[], const uint8_t *buf, size_t stride, size_t count,
+                                      uint32_t currentTime);
+
 // returns number of bytes written to buf, or total bufLen needed if buf is NULL (block->height is not serialized)
 size_t BRMerkleBlockSerialize(const BRMerkleBlock *block, uint8_t *buf, size_t bufLen);
 
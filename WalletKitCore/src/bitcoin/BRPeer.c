@@ -24,6 +24,7 @@
 
 #include "BRPeer.h"
 #include "BRMerkleBlock.h"
+#include "BRCompactFilter.h"
 #include "support/BRBase.h"
 #include "support/BRAddress.h"
 #include "support/BRSet.h"
@@ -38,6 +39,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -53,10 +55,31 @@
 #define LOCAL_HOST         ((UInt128) { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 0x7f, 0x00, 0x00, 0x01 })
 #define CONNECT_TIMEOUT    3.0
 #define MESSAGE_TIMEOUT    10.0
+#define SEND_TIMEOUT       10.0 // seconds queued bytes may go unsent before the peer is dropped as too slow
+#define MAX_SEND_QUEUE     (HEADER_LENGTH + MAX_MSG_LENGTH) // unsent bytes allowed before the peer is dropped
 #define WITNESS_FLAG       0x40000000
 
 #define PTHREAD_STACK_SIZE  (512 * 1024)
 
+#if defined(__linux__) && ! defined(BR_PEER_REACTOR)
+#define BR_PEER_REACTOR 1 // multiplex all peer sockets over a shared epoll reactor instead of using a thread per peer
+#endif
+
+#if BR_PEER_REACTOR
+#include <sys/epoll.h>
+#endif
+
+#ifndef BR_PEER_REACTOR_THREADS
+#define BR_PEER_REACTOR_THREADS 4
+#endif
+
+#define REACTOR_MAX_EVENTS 64
+#define READ_LIMIT         (256 * 1024) // bytes read from one peer before servicing others or checking timeouts
+
+#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
+#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
+#endif
+
 // the standard blockchain download protocol works as follows (for SPV mode):
 // - local peer sends getblocks
 // - remote peer reponds with inv containing up to 500 block hashes
@@ -84,6 +107,11 @@
 // - if at any point tx messages consume enough wallet addresses to drop below the bip32 chain gap limit, more addresses
 //   are generated and local peer sends filterload with an updated bloom filter
 // - after filterload is sent, getdata is sent to re-request recent blocks that may contain new tx matching the filter
+//
+// in compact block filter mode (BIP157) the same getheaders sequence continues past earliestKeyTime to the chain tip,
+// with no filterload, getblocks or merkleblock messages - the peer's owner requests the filters for each range of
+// headers with getcfheaders and getcfilters, matches them against the wallet locally, and requests just the matching
+// blocks with getdata
 
 typedef enum {
     inv_undefined = 0,
@@ -127,12 +155,25 @@ typedef struct {
     BRTransaction *(*requestedTx)(void *info, UInt256 txHash);
     int (*networkIsReachable)(void *info);
     void (*threadCleanup)(void *info);
+    void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevHeader, const UInt256 filterHashes[],
+                                 size_t count);
+    void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter, size_t filterLen);
+    void (*relayedFullBlock)(void *info, BRMerkleBlock *block, BRTransaction *txs[], size_t txCount);
+    void (*relayedHeaders)(void *info, BRMerkleBlock *blocks[], size_t count);
     void **volatile pongInfo;
     void (**volatile pongCallback)(void *info, int success);
     void *volatile mempoolInfo;
     void (*volatile mempoolCallback)(void *info, int success);
     pthread_t thread;
     pthread_mutex_t lock;
+    uint8_t header[HEADER_LENGTH], *payload; // partially read message
+    size_t headerLen, payloadLen, readLen;
+    uint8_t *sendQueue; // framed messages not yet accepted by the socket, starting at sendOff
+    size_t sendOff;
+    double sendTime; // when the send queue last made progress
+    double msgTimeout;
+    int connectPending, reactorBusy, reactorPending;
+    uint32_t reactorSlot, reactorGeneration;
 } BRPeerContext;
 
 void BRPeerSendVersionMessage(BRPeer *peer);
@@ -259,6 +300,7 @@ static int _BRPeerAcceptVerackMessage(BRPeer *peer, const uint8_t *msg, size_t m
         ctx->startTime = 0;
         peer_log(peer, "got verack in %fs", ctx->pingTime);
         ctx->gotVerack = 1;
+        if (ctx->relayedFilter) BRPeerSendMessage(peer, NULL, 0, MSG_SENDHEADERS); // have new blocks sent as headers
         _BRPeerDidConnect(peer);
     }
     
@@ -482,7 +524,11 @@ static int _BRPeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t
             BRSHA256_2(&locators[0], &msg[off + 81*(count - 1)], 80);
             BRSHA256_2(&locators[1], &msg[off], 80);
 
-            if (timestamp > 0 && timestamp + 7*24*60*60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime) {
+            if (ctx->relayedFilter) {
+                // in compact filter mode, keep requesting headers to the chain tip, the caller requests filters for them
+                if (count >= 2000) BRPeerSendGetheaders(peer, locators, 2, UINT256_ZERO);
+            }
+            else if (timestamp > 0 && timestamp + 7*24*60*60 + BLOCK_MAX_TIME_DRIFT >= ctx->earliestKeyTime) {
                 // request blocks for the remainder of the chain
                 timestamp = (++last < count) ? UInt32GetLE(&msg[off + 81*last + 68]) : 0;
 
@@ -495,23 +541,34 @@ static int _BRPeerAcceptHeadersMessage(BRPeer *peer, const uint8_t *msg, size_t
             }
             else BRPeerSendGetheaders(peer, locators, 2, UINT256_ZERO);
 
-            for (size_t i = 0; r && i < count; i++) {
-                BRMerkleBlock *block = BRMerkleBlockParse(&msg[off + 81*i], 81);
+            BRMerkleBlock **blocks = calloc(count, sizeof(*blocks));
+            size_t i, validCount;
+
+            assert(blocks != NULL || count == 0);
+            // parse and proof-of-work check the whole message up front, so that linking the headers into the chain
+            // is all that's left for the caller to do while holding its lock
+            validCount = BRMerkleBlockParseValidHeaders(blocks, &msg[off], 81, count, (uint32_t)now);
+
+            if (validCount < count) {
+                UInt256 blockHash;
                 
-                if (! block) {
-                    peer_log(peer, "malformed headers message with length: %zu", msgLen);
-                    r = 0;
-                }
-                else if (! BRMerkleBlockIsValid(block, (uint32_t)now)) {
-                    peer_log(peer, "invalid block header: %s", u256hex(block->blockHash));
-                    BRMerkleBlockFree(block);
-                    r = 0;
-                }
-                else if (ctx->relayedBlock) {
-                    ctx->relayedBlock(ctx->info, block);
+                BRSHA256_2(&blockHash, &msg[off + 81*validCount], 80);
+                peer_log(peer, "invalid block header: %s", u256hex(blockHash));
+                r = 0;
+            }
+
+            if (validCount > 0 && ctx->relayedHeaders) {
+                ctx->relayedHeaders(ctx->info, blocks, validCount);
+            }
+            else {
+                for (i = 0; i < validCount; i++) {
+                    if (ctx->relayedBlock) ctx->relayedBlock(ctx->info, blocks[i]);
+                    else BRMerkleBlockFree(blocks[i]);
                 }
-                else BRMerkleBlockFree(block);
             }
+
+            for (i = validCount; i < count; i++) if (blocks[i]) BRMerkleBlockFree(blocks[i]);
+            if (blocks) free(blocks);
         }
         else {
             peer_log(peer, "non-standard headers message, %zu is fewer header(s) than expected", count);
@@ -834,6 +891,181 @@ static int _BRPeerAcceptFeeFilterMessage(BRPeer *peer, const uint8_t *msg, size_
     return r;
 }
 
+// described in BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+static int _BRPeerAcceptCfheadersMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    size_t off = 1 + 2*sizeof(UInt256), len = 0, count = 0;
+    int r = 1;
+
+    if (off < msgLen) count = (size_t)BRVarInt(&msg[off], msgLen - off, &len);
+
+    if (len == 0 || count > (msgLen - off - len)/sizeof(UInt256) || msg[0] != COMPACT_FILTER_TYPE_BASIC) {
+        peer_log(peer, "malformed cfheaders message with length: %zu", msgLen);
+        r = 0;
+    }
+    else if (! ctx->relayedFilterHeaders) {
+        peer_log(peer, "dropping cfheaders, not in compact filter mode");
+    }
+    else {
+        UInt256 *filterHashes = malloc((count + 1)*sizeof(*filterHashes));
+
+        assert(filterHashes != NULL);
+        peer_log(peer, "got cfheaders with %zu filter hash(es)", count);
+        for (size_t i = 0; i < count; i++) filterHashes[i] = UInt256Get(&msg[off + len + i*sizeof(UInt256)]);
+        ctx->relayedFilterHeaders(ctx->info, UInt256Get(&msg[1]), UInt256Get(&msg[1 + sizeof(UInt256)]), filterHashes,
+                                  count);
+        free(filterHashes);
+    }
+
+    return r;
+}
+
+// described in BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+static int _BRPeerAcceptCfilterMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    size_t off = 1 + sizeof(UInt256), len = 0, filterLen = 0;
+    int r = 1;
+
+    if (off < msgLen) filterLen = (size_t)BRVarInt(&msg[off], msgLen - off, &len);
+
+    if (len == 0 || filterLen > msgLen - off - len || msg[0] != COMPACT_FILTER_TYPE_BASIC) {
+        peer_log(peer, "malformed cfilter message with length: %zu", msgLen);
+        r = 0;
+    }
+    else if (! ctx->relayedFilter) {
+        peer_log(peer, "dropping cfilter, not in compact filter mode");
+    }
+    else ctx->relayedFilter(ctx->info, UInt256Get(&msg[1]), &msg[off + len], filterLen);
+
+    return r;
+}
+
+// returns the varint at buf[*off] and advances *off past it, or sets *off past bufLen if buf ends first
+static size_t _BRPeerReadVarInt(const uint8_t *buf, size_t bufLen, size_t *off)
+{
+    size_t len = 0, n = (*off < bufLen) ? (size_t)BRVarInt(&buf[*off], bufLen - *off, &len) : 0;
+
+    *off = (len > 0) ? *off + len : bufLen + 1;
+    return n;
+}
+
+// advances *off past the varint length prefixed script or witness item at buf[*off], or past bufLen if buf ends first
+static void _BRPeerSkipVarBytes(const uint8_t *buf, size_t bufLen, size_t *off)
+{
+    size_t n = _BRPeerReadVarInt(buf, bufLen, off);
+
+    *off = (*off <= bufLen && n <= bufLen - *off) ? *off + n : bufLen + 1;
+}
+
+// returns the length of the serialized tx at the start of buf, including any witness data, or 0 if it's malformed
+static size_t _BRPeerTxLength(const uint8_t *buf, size_t bufLen)
+{
+    size_t off = sizeof(uint32_t), inCount, outCount, count, i, j;
+    int witnessFlag = 0;
+
+    inCount = _BRPeerReadVarInt(buf, bufLen, &off);
+
+    if (inCount == 0 && off < bufLen && buf[off] == 1) { // segwit marker and flag
+        witnessFlag = 1, off++;
+        inCount = _BRPeerReadVarInt(buf, bufLen, &off);
+    }
+
+    for (i = 0; off <= bufLen && i < inCount; i++) {
+        off += sizeof(UInt256) + sizeof(uint32_t);
+        _BRPeerSkipVarBytes(buf, bufLen, &off);
+        off += sizeof(uint32_t);
+    }
+
+    outCount = _BRPeerReadVarInt(buf, bufLen, &off);
+
+    for (i = 0; off <= bufLen && i < outCount; i++) {
+        off += sizeof(uint64_t);
+        _BRPeerSkipVarBytes(buf, bufLen, &off);
+    }
+
+    for (i = 0; off <= bufLen && witnessFlag && i < inCount; i++) {
+        count = _BRPeerReadVarInt(buf, bufLen, &off);
+        for (j = 0; off <= bufLen && j < count; j++) _BRPeerSkipVarBytes(buf, bufLen, &off);
+    }
+
+    off += sizeof(uint32_t); // lockTime
+    return (off <= bufLen) ? off : 0;
+}
+
+// a full block, requested in compact filter mode, is relayed as a merkle block that includes every tx in the block,
+// along with the block's transactions
+static int _BRPeerAcceptBlockMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    BRMerkleBlock *block = (msgLen >= 80) ? BRMerkleBlockParse(msg, 80) : NULL;
+    size_t off = 80, len = 0, txLen, count = 0, i;
+    int r = 1;
+
+    if (block) count = (size_t)BRVarInt(&msg[off], msgLen - off, &len);
+    off += len;
+
+    if (! block || len == 0 || count == 0 || count > (msgLen - off)/60) { // a tx is at least 60 bytes
+        peer_log(peer, "malformed block message with length: %zu", msgLen);
+        if (block) BRMerkleBlockFree(block);
+        r = 0;
+    }
+    else if (! ctx->relayedFullBlock) {
+        peer_log(peer, "dropping block, not in compact filter mode");
+        BRMerkleBlockFree(block);
+    }
+    else {
+        BRTransaction **txs = calloc(count, sizeof(*txs));
+        UInt256 *txHashes = malloc(count*sizeof(*txHashes));
+        size_t flagsLen = (2*count + 32)/8;
+        uint8_t *flags = malloc(flagsLen);
+
+        assert(txs != NULL);
+        assert(txHashes != NULL);
+        assert(flags != NULL);
+
+        for (i = 0; r && i < count; i++) {
+            txLen = _BRPeerTxLength(&msg[off], msgLen - off);
+            txs[i] = (txLen > 0) ? BRTransactionParse(&msg[off], txLen) : NULL;
+
+            if (! txs[i]) {
+                peer_log(peer, "malformed tx %zu in block message with length: %zu", i, msgLen);
+                r = 0;
+            }
+            else txHashes[i] = txs[i]->txHash;
+
+            off += txLen;
+        }
+
+        if (r) { // every tx is a matched leaf, so every node of the merkle tree is flagged
+            memset(flags, 0xff, flagsLen);
+            block->totalTx = (uint32_t)count;
+            BRMerkleBlockSetTxHashes(block, txHashes, count, flags, flagsLen);
+        }
+
+        if (r && ! BRMerkleBlockIsValid(block, (uint32_t)time(NULL))) {
+            peer_log(peer, "invalid block: %s", u256hex(block->blockHash));
+            r = 0;
+        }
+
+        if (r) {
+            peer_log(peer, "got block %s with %zu tx", u256hex(block->blockHash), count);
+            ctx->relayedFullBlock(ctx->info, block, txs, count);
+        }
+        else {
+            for (i = 0; i < count; i++) if (txs[i]) BRTransactionFree(txs[i]);
+            BRMerkleBlockFree(block);
+        }
+
+        free(flags);
+        free(txHashes);
+        free(txs);
+    }
+
+    return r;
+}
+
 static int _BRPeerAcceptMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -860,11 +1092,65 @@ static int _BRPeerAcceptMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen,
     else if (strncmp(MSG_MERKLEBLOCK, type, 12) == 0) r = _BRPeerAcceptMerkleblockMessage(peer, msg, msgLen);
     else if (strncmp(MSG_REJECT, type, 12) == 0) r = _BRPeerAcceptRejectMessage(peer, msg, msgLen);
     else if (strncmp(MSG_FEEFILTER, type, 12) == 0) r = _BRPeerAcceptFeeFilterMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_CFHEADERS, type, 12) == 0) r = _BRPeerAcceptCfheadersMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_CFILTER, type, 12) == 0) r = _BRPeerAcceptCfilterMessage(peer, msg, msgLen);
+    else if (strncmp(MSG_BLOCK, type, 12) == 0) r = _BRPeerAcceptBlockMessage(peer, msg, msgLen);
     else peer_log(peer, "dropping %s, length %zu, not implemented", type, msgLen);
 
     return r;
 }
 
+static int _peerCheckAndGetSocket (BRPeerContext *ctx, int *socket) {
+    int exists;
+
+    pthread_mutex_lock(&ctx->lock);
+    exists = ctx->socket >= 0;
+    if (NULL != socket) *socket = ctx->socket;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return exists;
+}
+
+static int _peerGetSocket (BRPeerContext *ctx) {
+    int socket;
+
+    pthread_mutex_lock(&ctx->lock);
+    socket = ctx->socket;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return socket;
+}
+
+static double _peerGetDisconnectTime (BRPeerContext *ctx) {
+    double value;
+
+    pthread_mutex_lock(&ctx->lock);
+    value = ctx->disconnectTime;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return value;
+}
+
+static double _peerGetMempoolTime (BRPeerContext *ctx) {
+    double value;
+
+    pthread_mutex_lock(&ctx->lock);
+    value = ctx->mempoolTime;
+    pthread_mutex_unlock(&ctx->lock);
+
+    return value;
+}
+
+
+static double _peerGetTime (void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + (double)tv.tv_usec/1000000;
+}
+
+// opens a non-blocking socket to peer and connects it, or when timeout is negative, just starts connecting so the caller
+// can wait for completion with _BRPeerFinishConnect()
 static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *error)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -884,16 +1170,12 @@ static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *erro
         r = 0;
     }
     else {
-        tv.tv_sec = 1; // one second timeout for send/receive, so thread doesn't block for too long
-        tv.tv_usec = 0;
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
         setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
 #ifdef SO_NOSIGPIPE // BSD based systems have a SO_NOSIGPIPE socket option to supress SIGPIPE signals
         setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
 #endif
         arg = fcntl(sock, F_GETFL, NULL);
-        if (arg < 0 || fcntl(sock, F_SETFL, arg | O_NONBLOCK) < 0) r = 0; // temporarily set socket non-blocking
+        if (arg < 0 || fcntl(sock, F_SETFL, arg | O_NONBLOCK) < 0) r = 0; // sends are queued, reads never block
         if (! r) err = errno;
     }
 
@@ -915,7 +1197,10 @@ static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *erro
         
         if (connect(sock, (struct sockaddr *)&addr, addrLen) < 0) err = errno;
         
-        if (err == EINPROGRESS) {
+        if (err == EINPROGRESS && timeout < 0) {
+            err = 0; // caller waits for the socket to become writable
+        }
+        else if (err == EINPROGRESS) {
             err = 0;
             optLen = sizeof(err);
             tv.tv_sec = timeout;
@@ -931,12 +1216,15 @@ static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *erro
             }
         }
         else if (err && domain == PF_INET6 && _BRPeerIsIPv4(peer)) {
+            pthread_mutex_lock(&ctx->lock);
+            ctx->socket = -1;
+            pthread_mutex_unlock(&ctx->lock);
+            close(sock);
             return _BRPeerOpenSocket(peer, PF_INET, timeout, error); // fallback to IPv4
         }
         else if (err) r = 0;
 
-        if (r) peer_log(peer, "socket connected");
-        fcntl(sock, F_SETFL, arg); // restore socket non-blocking status
+        if (r && timeout >= 0) peer_log(peer, "socket connected");
     }
 
     if (! r && err) peer_log(peer, "connect error: %s", strerror(err));
@@ -944,159 +1232,196 @@ static int _BRPeerOpenSocket(BRPeer *peer, int domain, double timeout, int *erro
     return r;
 }
 
-static int _peerCheckAndGetSocket (BRPeerContext *ctx, int *socket) {
-    int exists;
+// completes a connection started with a negative _BRPeerOpenSocket() timeout, once the socket is writable
+static int _BRPeerFinishConnect(BRPeer *peer, int *error)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    socklen_t optLen = sizeof(int);
+    int sock = _peerGetSocket(ctx), err = 0;
 
-    pthread_mutex_lock(&ctx->lock);
-    exists = ctx->socket >= 0;
-    if (NULL != socket) *socket = ctx->socket;
-    pthread_mutex_unlock(&ctx->lock);
+    if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &optLen) < 0) err = errno;
+    if (err) peer_log(peer, "connect error: %s", strerror(err));
+    else peer_log(peer, "socket connected");
+    if (error && err) *error = err;
+    return ! err;
+}
 
-    return exists;
+// reads up to limit bytes of whatever is available on socket, and accepts each complete message, returns an errno.h
+// code on error, otherwise 0 - partially read messages are kept in ctx so reading can resume on the next call
+static int _BRPeerReadMessages(BRPeer *peer, int socket, int flags, size_t limit)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    const char *type = (const char *)(&ctx->header[4]);
+    uint32_t msgLen = 0, checksum;
+    size_t total = 0;
+    ssize_t n = 0;
+    UInt256 hash;
+    int error = 0;
+
+    while (! error && total < limit) {
+        if (ctx->headerLen < HEADER_LENGTH) {
+            n = recv(socket, &ctx->header[ctx->headerLen], HEADER_LENGTH - ctx->headerLen, flags);
+        }
+        else {
+            msgLen = UInt32GetLE(&ctx->header[16]);
+            n = recv(socket, &ctx->payload[ctx->readLen], msgLen - ctx->readLen, flags);
+        }
+
+        if (n == 0) error = ECONNRESET;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EWOULDBLOCK && errno != EAGAIN) error = errno;
+        if (n <= 0) break;
+        total += n;
+
+        if (ctx->headerLen < HEADER_LENGTH) {
+            ctx->headerLen += n;
+
+            while (sizeof(uint32_t) <= ctx->headerLen && UInt32GetLE(ctx->header) != ctx->magicNumber) {
+                memmove(ctx->header, &ctx->header[1], --ctx->headerLen); // consume one byte at a time until we find the magic number
+            }
+
+            if (ctx->headerLen < HEADER_LENGTH) continue;
+            msgLen = UInt32GetLE(&ctx->header[16]);
+
+            if (ctx->header[15] != 0) { // verify header type field is NULL terminated
+                peer_log(peer, "malformed message header: type not NULL terminated");
+                error = EPROTO;
+            }
+            else if (msgLen > MAX_MSG_LENGTH) { // check message length
+                peer_log(peer, "error reading %s, message length %"PRIu32" is too long", type, msgLen);
+                error = EPROTO;
+            }
+            else {
+                if (! ctx->payload || msgLen > ctx->payloadLen) {
+                    ctx->payloadLen = (msgLen > 0x1000) ? msgLen : 0x1000;
+                    ctx->payload = realloc(ctx->payload, ctx->payloadLen);
+                }
+
+                assert(ctx->payload != NULL);
+                ctx->readLen = 0;
+            }
+        }
+        else ctx->readLen += n;
+
+        if (! error) ctx->msgTimeout = _peerGetTime() + MESSAGE_TIMEOUT;
+        if (error || ctx->readLen < msgLen) continue;
+        checksum = UInt32GetLE(&ctx->header[20]);
+        BRSHA256_2(&hash, ctx->payload, msgLen);
+        ctx->headerLen = ctx->readLen = 0;
+        ctx->msgTimeout = DBL_MAX;
+
+        if (UInt32GetLE(&hash) != checksum) { // verify checksum
+            peer_log(peer, "error reading %s, invalid checksum %x, expected %x, payload length:%"PRIu32
+                     ", SHA256_2:%s", type, UInt32GetLE(&hash), checksum, msgLen, u256hex(hash));
+            error = EPROTO;
+        }
+        else if (! _BRPeerAcceptMessage(peer, ctx->payload, msgLen, type)) error = EPROTO;
+    }
+
+    if (error) peer_log(peer, "%s", strerror(error));
+    return error;
 }
 
-static int _peerGetSocket (BRPeerContext *ctx) {
-    int socket;
+// sends as much of the send queue as the socket accepts without blocking, and sets *pending to true if any bytes are
+// left queued, returns an errno.h code on error, otherwise 0
+static int _BRPeerFlushSendQueue(BRPeerContext *ctx, int *pending)
+{
+    size_t count;
+    ssize_t n;
+    int error = 0;
 
     pthread_mutex_lock(&ctx->lock);
-    socket = ctx->socket;
-    pthread_mutex_unlock(&ctx->lock);
+    count = array_count(ctx->sendQueue);
+    if (ctx->socket < 0 && ctx->sendOff < count) error = ENOTCONN;
+
+    while (! error && ctx->sendOff < count) {
+        n = send(ctx->socket, &ctx->sendQueue[ctx->sendOff], count - ctx->sendOff, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EWOULDBLOCK && errno != EAGAIN) error = errno;
+        if (n <= 0) break;
+        ctx->sendOff += n;
+        ctx->sendTime = _peerGetTime();
+    }
 
-    return socket;
+    if (ctx->sendOff == count) {
+        array_clear(ctx->sendQueue);
+        ctx->sendOff = 0;
+    }
+
+    if (pending) *pending = (ctx->sendOff < array_count(ctx->sendQueue));
+    pthread_mutex_unlock(&ctx->lock);
+    return error;
 }
 
-static double _peerGetDisconnectTime (BRPeerContext *ctx) {
-    double value;
+// true if the send queue has bytes waiting for the socket to become writable
+static int _BRPeerSendPending(BRPeerContext *ctx)
+{
+    int pending;
 
     pthread_mutex_lock(&ctx->lock);
-    value = ctx->disconnectTime;
+    pending = (ctx->sendOff < array_count(ctx->sendQueue));
     pthread_mutex_unlock(&ctx->lock);
-
-    return value;
+    return pending;
 }
 
-static double _peerGetMempoolTime (BRPeerContext *ctx) {
-    double value;
+// true if queued bytes haven't been accepted by the socket for SEND_TIMEOUT seconds, meaning the remote peer has
+// stopped reading
+static int _BRPeerSendStalled(BRPeerContext *ctx, double time)
+{
+    int stalled;
 
     pthread_mutex_lock(&ctx->lock);
-    value = ctx->mempoolTime;
+    stalled = (ctx->sendOff < array_count(ctx->sendQueue) && time >= ctx->sendTime + SEND_TIMEOUT);
     pthread_mutex_unlock(&ctx->lock);
-
-    return value;
+    return stalled;
 }
 
-
-static void *_peerThreadRoutine(void *arg)
+// checks for a requested disconnect, the disconnect, message and send timeouts, and the mempool response timeout,
+// returns an errno.h code if the connection should be closed, otherwise 0
+static int _BRPeerCheckTimeouts(BRPeer *peer, double time)
 {
-    BRPeer *peer = arg;
-    BRPeerContext *ctx = arg;
-    int socket, error = 0;
-
-    pthread_cleanup_push(ctx->threadCleanup, ctx->info);
-    
-    if (_BRPeerOpenSocket(peer, PF_INET6, CONNECT_TIMEOUT, &error)) {
-        struct timeval tv;
-        double time = 0, msgTimeout;
-        uint8_t header[HEADER_LENGTH], *payload = malloc(0x1000);
-        size_t len = 0, payloadLen = 0x1000;
-        ssize_t n = 0;
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    int error = 0;
 
-        assert(payload != NULL);
-        gettimeofday(&tv, NULL);
-        ctx->startTime = tv.tv_sec + (double)tv.tv_usec/1000000;
-        BRPeerSendVersionMessage(peer);
+    if (BRPeerConnectStatus(peer) == BRPeerStatusDisconnected) error = ENOTCONN; // BRPeerDisconnect() was called
+    else if (time >= _peerGetDisconnectTime(ctx) || time >= ctx->msgTimeout) error = ETIMEDOUT;
+    else if (_BRPeerSendStalled(ctx, time)) {
+        peer_log(peer, "send queue stalled");
+        error = ETIMEDOUT;
+    }
+    else if (time >= _peerGetMempoolTime(ctx)) {
+        peer_log(peer, "done waiting for mempool response");
+        BRPeerSendPing(peer, ctx->mempoolInfo, ctx->mempoolCallback);
+        ctx->mempoolCallback = NULL;
 
-        while (_peerCheckAndGetSocket(ctx, &socket) && ! error) {
-            len = 0;
-
-            while (socket >= 0 && ! error && len < HEADER_LENGTH) {
-                n = read(socket, &header[len], sizeof(header) - len);
-                if (n > 0) len += n;
-                if (n == 0) error = ECONNRESET;
-                if (n < 0 && errno != EWOULDBLOCK) error = errno;
-                gettimeofday(&tv, NULL);
-                time = tv.tv_sec + (double)tv.tv_usec/1000000;
-                if (! error && time >= _peerGetDisconnectTime(ctx)) error = ETIMEDOUT;
-
-                if (! error && time >= _peerGetMempoolTime(ctx)) {
-                    peer_log(peer, "done waiting for mempool response");
-                    BRPeerSendPing(peer, ctx->mempoolInfo, ctx->mempoolCallback);
-                    ctx->mempoolCallback = NULL;
-
-                    pthread_mutex_lock(&ctx->lock);
-                    ctx->mempoolTime = DBL_MAX;
-                    pthread_mutex_unlock(&ctx->lock);
-                }
+        pthread_mutex_lock(&ctx->lock);
+        ctx->mempoolTime = DBL_MAX;
+        pthread_mutex_unlock(&ctx->lock);
+    }
 
-                while (sizeof(uint32_t) <= len && UInt32GetLE(header) != ctx->magicNumber) {
-                    memmove(header, &header[1], --len); // consume one byte at a time until we find the magic number
-                }
+    if (error == ETIMEDOUT) peer_log(peer, "%s", strerror(error));
+    return error;
+}
 
-                socket = _peerGetSocket(ctx);
-            }
-            
-            if (error) {
-                peer_log(peer, "%s", strerror(error));
-            }
-            else if (header[15] != 0) { // verify header type field is NULL terminated
-                peer_log(peer, "malformed message header: type not NULL terminated");
-                error = EPROTO;
-            }
-            else if (len == HEADER_LENGTH) {
-                const char *type = (const char *)(&header[4]);
-                uint32_t msgLen = UInt32GetLE(&header[16]);
-                uint32_t checksum = UInt32GetLE(&header[20]);
-                UInt256 hash;
-                
-                if (msgLen > MAX_MSG_LENGTH) { // check message length
-                    peer_log(peer, "error reading %s, message length %"PRIu32" is too long", type, msgLen);
-                    error = EPROTO;
-                }
-                else {
-                    if (msgLen > payloadLen) payload = realloc(payload, (payloadLen = msgLen));
-                    assert(payload != NULL);
-                    len = 0;
-                    socket = _peerGetSocket(ctx);
-                    msgTimeout = time + MESSAGE_TIMEOUT;
-                    
-                    while (socket >= 0 && ! error && len < msgLen) {
-                        n = read(socket, &payload[len], msgLen - len);
-                        if (n > 0) len += n;
-                        if (n == 0) error = ECONNRESET;
-                        if (n < 0 && errno != EWOULDBLOCK) error = errno;
-                        gettimeofday(&tv, NULL);
-                        time = tv.tv_sec + (double)tv.tv_usec/1000000;
-                        if (n > 0) msgTimeout = time + MESSAGE_TIMEOUT;
-                        if (! error && time >= msgTimeout) error = ETIMEDOUT;
-                        socket = _peerGetSocket(ctx);
-                    }
-                    
-                    if (error) {
-                        peer_log(peer, "%s", strerror(error));
-                    }
-                    else if (len == msgLen) {
-                        BRSHA256_2(&hash, payload, msgLen);
-                        
-                        if (UInt32GetLE(&hash) != checksum) { // verify checksum
-                            peer_log(peer, "error reading %s, invalid checksum %x, expected %x, payload length:%"PRIu32
-                                     ", SHA256_2:%s", type, UInt32GetLE(&hash), checksum, msgLen, u256hex(hash));
-                            error = EPROTO;
-                        }
-                        else if (! _BRPeerAcceptMessage(peer, payload, msgLen, type)) error = EPROTO;
-                    }
-                }
-            }
-        }
-        
-        free(payload);
-    }
+// closes the socket and notifies any pending pong and mempool callbacks, followed by the disconnected callback, which
+// may free peer
+static void _BRPeerDidDisconnect(BRPeer *peer, int error)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    int socket;
 
     pthread_mutex_lock(&ctx->lock);
     socket = ctx->socket;
+    ctx->socket = -1;
     ctx->status = BRPeerStatusDisconnected;
+    array_clear(ctx->sendQueue);
+    ctx->sendOff = 0;
     pthread_mutex_unlock(&ctx->lock);
 
     if (socket >= 0) close(socket);
+    if (ctx->payload) free(ctx->payload);
+    ctx->payload = NULL;
+    ctx->payloadLen = 0;
     peer_log(peer, "disconnected");
     
     while (array_count(ctx->pongCallback) > 0) {
@@ -1111,10 +1436,269 @@ static void *_peerThreadRoutine(void *arg)
     if (ctx->mempoolCallback) ctx->mempoolCallback(ctx->mempoolInfo, 0);
     ctx->mempoolCallback = NULL;
     if (ctx->disconnected) ctx->disconnected(ctx->info, error);
+}
+
+// fallback for when the shared reactor isn't available, each peer gets its own thread polling its socket
+static void *_peerThreadRoutine(void *arg)
+{
+    BRPeer *peer = arg;
+    BRPeerContext *ctx = arg;
+    struct pollfd fds;
+    int socket, error = 0;
+
+    pthread_cleanup_push(ctx->threadCleanup, ctx->info);
+    
+    if (_BRPeerOpenSocket(peer, PF_INET6, CONNECT_TIMEOUT, &error)) {
+        ctx->startTime = _peerGetTime();
+        BRPeerSendVersionMessage(peer);
+
+        while (! error && _peerCheckAndGetSocket(ctx, &socket)) {
+            fds.fd = socket;
+            fds.events = POLLIN | (_BRPeerSendPending(ctx) ? POLLOUT : 0);
+            fds.revents = 0;
+
+            // wait at most a second, so the timeouts get checked, and bytes queued by other threads get sent
+            if (poll(&fds, 1, 1000) < 0 && errno != EINTR) error = errno;
+            if (! error) error = _BRPeerFlushSendQueue(ctx, NULL);
+            if (! error && fds.revents) error = _BRPeerReadMessages(peer, socket, MSG_DONTWAIT, READ_LIMIT);
+            if (! error) error = _BRPeerCheckTimeouts(peer, _peerGetTime());
+        }
+    }
+
+    _BRPeerDidDisconnect(peer, error);
     pthread_cleanup_pop(1);
     return NULL; // detached threads don't need to return a value
 }
 
+#if BR_PEER_REACTOR
+// The reactor multiplexes the sockets of all connected peers, across every peer manager in the process, over a single
+// epoll instance serviced by a small fixed pool of I/O threads. Each peer is registered EPOLLONESHOT, and a peer that
+// is being serviced is marked busy, so at most one thread runs a given peer's callbacks at a time, in the same order
+// they would run on a dedicated peer thread. Once a second one of the I/O threads sweeps all idle peers to check their
+// timeouts. A peer is only ever unregistered by the thread servicing it, and epoll events carry a slot index and
+// generation rather than a pointer, so a stale event for a peer that has since been freed is simply dropped.
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;
+    int fd;
+    BRPeerContext **peers; // registered peers, indexed by reactorSlot, NULL for free slots
+    uint32_t generation;
+    double sweepTime;
+} _reactor = { PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, -1, NULL, 0, 0 };
+
+static uint64_t _BRPeerReactorToken(BRPeerContext *ctx)
+{
+    return ((uint64_t)ctx->reactorGeneration << 32) | ctx->reactorSlot;
+}
+
+// arms ctx's socket for a single readiness event, also waiting for it to become writable while the send queue isn't
+// empty, the reactor lock must be held
+static int _BRPeerReactorArm(BRPeerContext *ctx, int op)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = (ctx->connectPending ? EPOLLOUT : EPOLLIN | (_BRPeerSendPending(ctx) ? EPOLLOUT : 0)) | EPOLLONESHOT;
+    event.data.u64 = _BRPeerReactorToken(ctx);
+    return epoll_ctl(_reactor.fd, op, ctx->socket, &event);
+}
+
+// returns the peer registered under token and marks it busy, or NULL if it's gone or already busy, in which case a
+// readiness event is recorded so the busy thread services it
+static BRPeerContext *_BRPeerReactorClaim(uint64_t token)
+{
+    uint32_t slot = (uint32_t)token, generation = (uint32_t)(token >> 32);
+    BRPeerContext *ctx = NULL;
+
+    pthread_mutex_lock(&_reactor.lock);
+    if (slot < array_count(_reactor.peers)) ctx = _reactor.peers[slot];
+    if (ctx && ctx->reactorGeneration != generation) ctx = NULL;
+    
+    if (ctx && ctx->reactorBusy) {
+        ctx->reactorPending = 1;
+        ctx = NULL;
+    }
+    else if (ctx) ctx->reactorBusy = 1;
+
+    pthread_mutex_unlock(&_reactor.lock);
+    return ctx;
+}
+
+// re-arms an idle registered peer after a send left bytes queued, so the reactor flushes them once the socket is
+// writable - a busy peer is re-armed by the thread servicing it
+static void _BRPeerReactorWantWrite(BRPeerContext *ctx)
+{
+    if (_reactor.fd < 0) return;
+    pthread_mutex_lock(&_reactor.lock);
+
+    if (ctx->reactorSlot < array_count(_reactor.peers) && _reactor.peers[ctx->reactorSlot] == ctx &&
+        ! ctx->reactorBusy && ! ctx->connectPending) {
+        _BRPeerReactorArm(ctx, EPOLL_CTL_MOD);
+    }
+
+    pthread_mutex_unlock(&_reactor.lock);
+}
+
+static void _BRPeerReactorUnregister(BRPeerContext *ctx)
+{
+    epoll_ctl(_reactor.fd, EPOLL_CTL_DEL, ctx->socket, NULL);
+    _reactor.peers[ctx->reactorSlot] = NULL;
+    while (array_count(_reactor.peers) > 0 && ! _reactor.peers[array_count(_reactor.peers) - 1]) {
+        array_set_count(_reactor.peers, array_count(_reactor.peers) - 1);
+    }
+}
+
+// services a claimed peer until no more readiness events are recorded for it, ready is true when the peer's socket
+// signaled readiness, and false for a timeout sweep
+static void _BRPeerReactorRun(BRPeerContext *ctx, int ready)
+{
+    BRPeer *peer = &ctx->peer;
+    void (*threadCleanup)(void *info) = ctx->threadCleanup;
+    void *info = ctx->info;
+    int error, rearm = ready;
+
+    do {
+        error = _BRPeerCheckTimeouts(peer, _peerGetTime());
+
+        if (! error && ready && ctx->connectPending && _BRPeerFinishConnect(peer, &error)) {
+            ctx->connectPending = 0;
+            ctx->startTime = _peerGetTime();
+            BRPeerSendVersionMessage(peer);
+        }
+        else if (! error && ready && ! ctx->connectPending) {
+            error = _BRPeerFlushSendQueue(ctx, NULL);
+            if (! error) error = _BRPeerReadMessages(peer, _peerGetSocket(ctx), MSG_DONTWAIT, READ_LIMIT);
+        }
+
+        pthread_mutex_lock(&_reactor.lock);
+        ready = (! error && ctx->reactorPending);
+        ctx->reactorPending = 0;
+        if (ready) rearm = 1;
+        else if (error) _BRPeerReactorUnregister(ctx);
+        else if ((rearm || _BRPeerSendPending(ctx)) && _BRPeerReactorArm(ctx, EPOLL_CTL_MOD) < 0) {
+            error = errno;
+            _BRPeerReactorUnregister(ctx);
+        }
+        else ctx->reactorBusy = 0;
+
+        pthread_mutex_unlock(&_reactor.lock);
+    } while (ready);
+
+    if (error) {
+        _BRPeerDidDisconnect(peer, error);
+        threadCleanup(info);
+    }
+}
+
+static void *_BRPeerReactorRoutine(void *arg)
+{
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    BRPeerContext *ctx, **idle;
+    size_t count;
+    double time;
+    int n;
+
+    array_new(idle, 100);
+
+    for (;;) {
+        n = epoll_wait(_reactor.fd, events, REACTOR_MAX_EVENTS, 1000);
+
+        for (int i = 0; i < n; i++) {
+            ctx = _BRPeerReactorClaim(events[i].data.u64);
+            if (ctx) _BRPeerReactorRun(ctx, 1);
+        }
+
+        time = _peerGetTime();
+        array_clear(idle);
+        pthread_mutex_lock(&_reactor.lock);
+
+        if (time >= _reactor.sweepTime) { // claim all idle peers so their timeouts can be checked
+            _reactor.sweepTime = time + 1.0;
+
+            for (size_t i = 0; i < array_count(_reactor.peers); i++) {
+                ctx = _reactor.peers[i];
+                if (! ctx || ctx->reactorBusy) continue;
+                ctx->reactorBusy = 1;
+                array_add(idle, ctx);
+            }
+        }
+
+        pthread_mutex_unlock(&_reactor.lock);
+        count = array_count(idle);
+        for (size_t i = 0; i < count; i++) _BRPeerReactorRun(idle[i], 0);
+    }
+
+    return NULL;
+}
+
+static void _BRPeerReactorInit(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    int threadCount = 0;
+
+    _reactor.fd = epoll_create1(EPOLL_CLOEXEC);
+    if (_reactor.fd < 0) return;
+    array_new(_reactor.peers, 100);
+
+    for (int i = 0; i < BR_PEER_REACTOR_THREADS; i++) {
+        if (pthread_attr_init(&attr) != 0) continue;
+        if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) == 0 &&
+            pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) == 0 &&
+            pthread_create(&thread, &attr, _BRPeerReactorRoutine, NULL) == 0) threadCount++;
+        pthread_attr_destroy(&attr);
+    }
+
+    if (threadCount == 0) { // fall back to a thread per peer
+        close(_reactor.fd);
+        _reactor.fd = -1;
+    }
+}
+
+// starts connecting peer and registers its socket with the reactor, returns true if the reactor will service peer,
+// false if connecting failed before any I/O was scheduled, or -1 if the reactor isn't available
+static int _BRPeerReactorConnect(BRPeer *peer)
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    size_t slot;
+    int error = 0, r = 1;
+
+    pthread_once(&_reactor.once, _BRPeerReactorInit);
+    if (_reactor.fd < 0) return -1;
+    ctx->connectPending = 1;
+    ctx->reactorBusy = ctx->reactorPending = 0;
+
+    if (_BRPeerOpenSocket(peer, PF_INET6, -1, &error)) {
+        pthread_mutex_lock(&_reactor.lock);
+        for (slot = 0; slot < array_count(_reactor.peers) && _reactor.peers[slot]; slot++);
+        if (slot == array_count(_reactor.peers)) array_add(_reactor.peers, NULL);
+        ctx->reactorSlot = (uint32_t)slot;
+        ctx->reactorGeneration = ++_reactor.generation;
+        _reactor.peers[slot] = ctx;
+
+        if (_BRPeerReactorArm(ctx, EPOLL_CTL_ADD) < 0) {
+            peer_log(peer, "error registering socket: %s", strerror(errno));
+            _BRPeerReactorUnregister(ctx);
+            r = 0;
+        }
+
+        pthread_mutex_unlock(&_reactor.lock);
+    }
+    else r = 0;
+
+    if (! r) { // connect failed before any I/O was scheduled, report it the same way as failing to create a thread
+        pthread_mutex_lock(&ctx->lock);
+        if (ctx->socket >= 0) close(ctx->socket);
+        ctx->socket = -1;
+        ctx->status = BRPeerStatusDisconnected;
+        pthread_mutex_unlock(&ctx->lock);
+    }
+
+    return r;
+}
+#endif // BR_PEER_REACTOR
+
 static void _dummyThreadCleanup(void *info)
 {
 }
@@ -1133,9 +1717,11 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
     ctx->knownTxHashSet = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
     array_new(ctx->pongInfo, 10);
     array_new(ctx->pongCallback, 10);
+    array_new(ctx->sendQueue, 0x1000);
     ctx->pingTime = DBL_MAX;
     ctx->mempoolTime = DBL_MAX;
     ctx->disconnectTime = DBL_MAX;
+    ctx->msgTimeout = DBL_MAX;
     ctx->socket = -1;
     ctx->threadCleanup = _dummyThreadCleanup;
 
@@ -1161,7 +1747,8 @@ BRPeer *BRPeerNew(uint32_t magicNumber)
 // void notfound(void *, const UInt256[], size_t, const UInt256[], size_t) - called when "notfound" message is received
 // BRTransaction *requestedTx(void *, UInt256) - called when "getdata" message with a tx hash is received from peer
 // int networkIsReachable(void *) - must return true when networking is available, false otherwise
-// void threadCleanup(void *) - called before a thread terminates to faciliate any needed cleanup
+// void threadCleanup(void *) - called once the peer's I/O has finished, after disconnected(), from the I/O thread that
+//                              was servicing the peer, to faciliate any needed cleanup
 void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         void (*connected)(void *info),
                         void (*disconnected)(void *info, int error),
@@ -1194,6 +1781,29 @@ void BRPeerSetCallbacks(BRPeer *peer, void *info,
     ctx->threadCleanup = (threadCleanup) ? threadCleanup : _dummyThreadCleanup;
 }
 
+void BRPeerSetCompactFilterCallbacks(BRPeer *peer,
+                                     void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevHeader,
+                                                                  const UInt256 filterHashes[], size_t count),
+                                     void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter,
+                                                           size_t filterLen),
+                                     void (*relayedFullBlock)(void *info, BRMerkleBlock *block, BRTransaction *txs[],
+                                                              size_t txCount))
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    
+    ctx->relayedFilterHeaders = relayedFilterHeaders;
+    ctx->relayedFilter = relayedFilter;
+    ctx->relayedFullBlock = relayedFullBlock;
+}
+
+void BRPeerSetRelayedHeadersCallback(BRPeer *peer,
+                                     void (*relayedHeaders)(void *info, BRMerkleBlock *blocks[], size_t count))
+{
+    BRPeerContext *ctx = (BRPeerContext *)peer;
+    
+    ctx->relayedHeaders = relayedHeaders;
+}
+
 // set earliestKeyTime to wallet creation time in order to speed up initial sync
 void BRPeerSetEarliestKeyTime(BRPeer *peer, uint32_t earliestKeyTime)
 {
@@ -1219,12 +1829,13 @@ BRPeerStatus BRPeerConnectStatus(BRPeer *peer)
     return status;
 }
 
-// open connection to peer and perform handshake
-void BRPeerConnect(BRPeer *peer)
+// open connection to peer and perform handshake, returns false if the connection failed before any I/O was scheduled,
+// in which case the status is BRPeerStatusDisconnected and neither disconnected() nor threadCleanup() will be called
+int BRPeerConnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
-    struct timeval tv;
     pthread_attr_t attr;
+    int willConnect = 0, r = 1;
 
     pthread_mutex_lock(&ctx->lock);
     if (ctx->status == BRPeerStatusDisconnected || ctx->waitingForNetwork) {
@@ -1237,45 +1848,62 @@ void BRPeerConnect(BRPeer *peer)
         else {
             peer_log(peer, "connecting");
             ctx->waitingForNetwork = 0;
-            gettimeofday(&tv, NULL);
-
-            // No race - set before the thread starts.
-            ctx->disconnectTime = tv.tv_sec + (double)tv.tv_usec/1000000 + CONNECT_TIMEOUT;
 
-            if (pthread_attr_init(&attr) != 0) {
-                // error = ENOMEM;
-                peer_log(peer, "error creating thread");
-                ctx->status = BRPeerStatusDisconnected;
-                //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
-            }
-            else if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0 ||
-                     pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) != 0 ||
-                     pthread_create(&ctx->thread, &attr, _peerThreadRoutine, peer) != 0) {
-                // error = EAGAIN;
-                peer_log(peer, "error creating thread");
-                pthread_attr_destroy(&attr);
-                ctx->status = BRPeerStatusDisconnected;
-                //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
-            }
+            // No race - set before the connection starts.
+            ctx->disconnectTime = _peerGetTime() + CONNECT_TIMEOUT;
+            ctx->headerLen = ctx->readLen = 0;
+            ctx->msgTimeout = DBL_MAX;
+            willConnect = 1;
         }
     }
     pthread_mutex_unlock(&ctx->lock);
+
+#if BR_PEER_REACTOR
+    if (willConnect) r = _BRPeerReactorConnect(peer);
+    if (r >= 0) willConnect = 0;
+    else r = 1; // fall back to a thread per peer
+#endif
+
+    if (willConnect) {
+        if (pthread_attr_init(&attr) != 0) {
+            // error = ENOMEM;
+            peer_log(peer, "error creating thread");
+            willConnect = 0;
+            //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
+        }
+        else if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0 ||
+                 pthread_attr_setstacksize(&attr, PTHREAD_STACK_SIZE) != 0 ||
+                 pthread_create(&ctx->thread, &attr, _peerThreadRoutine, peer) != 0) {
+            // error = EAGAIN;
+            peer_log(peer, "error creating thread");
+            pthread_attr_destroy(&attr);
+            willConnect = 0;
+            //if (ctx->disconnected) ctx->disconnected(ctx->info, error);
+        }
+
+        if (! willConnect) {
+            pthread_mutex_lock(&ctx->lock);
+            ctx->status = BRPeerStatusDisconnected;
+            pthread_mutex_unlock(&ctx->lock);
+            r = 0;
+        }
+    }
+
+    return r;
 }
 
 // close connection to peer
 void BRPeerDisconnect(BRPeer *peer)
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
-    int socket = -1;
 
-    if (_peerCheckAndGetSocket(ctx, &socket)) {
-        pthread_mutex_lock(&ctx->lock);
+    // the socket is only shut down here, the I/O thread servicing peer closes it once it notices
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->socket >= 0) {
         ctx->status = BRPeerStatusDisconnected;
-        pthread_mutex_unlock(&ctx->lock);
-
-        if (shutdown(socket, SHUT_RDWR) < 0) peer_log(peer, "%s", strerror(errno));
-        close(socket);
+        if (shutdown(ctx->socket, SHUT_RDWR) < 0) peer_log(peer, "%s", strerror(errno));
     }
+    pthread_mutex_unlock(&ctx->lock);
 }
 
 // call this to (re)schedule a disconnect in the given number of seconds, or < 0 to cancel (useful for sync timeout)
@@ -1348,11 +1976,8 @@ uint64_t BRPeerFeePerKb(BRPeer *peer)
     return feePerKb;
 }
 
-#ifndef MSG_NOSIGNAL   // linux based systems have a MSG_NOSIGNAL send flag, useful for supressing SIGPIPE signals
-#define MSG_NOSIGNAL 0 // set to 0 if undefined (BSD has the SO_NOSIGPIPE sockopt, and windows has no signals at all)
-#endif
-
-// sends a bitcoin protocol message to peer
+// sends a bitcoin protocol message to peer, whatever the socket doesn't accept right away is queued and sent by the I/O
+// thread servicing peer once the socket is writable
 void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const char *type)
 {
     if (msgLen > MAX_MSG_LENGTH) {
@@ -1360,40 +1985,54 @@ void BRPeerSendMessage(BRPeer *peer, const uint8_t *msg, size_t msgLen, const ch
     }
     else {
         BRPeerContext *ctx = (BRPeerContext *)peer;
-        uint8_t buf[HEADER_LENGTH + msgLen], hash[32];
-        size_t off = 0;
-        ssize_t n = 0;
-        struct timeval tv;
-        int socket, error = 0;
-        
-        UInt32SetLE(&buf[off], ctx->magicNumber);
-        off += sizeof(uint32_t);
-        strncpy((char *)&buf[off], type, 12);
-        off += 12;
-        UInt32SetLE(&buf[off], (uint32_t)msgLen);
-        off += sizeof(uint32_t);
-        BRSHA256_2(hash, msg, msgLen);
-        memcpy(&buf[off], hash, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        memcpy(&buf[off], msg, msgLen);
-        peer_log(peer, "sending %s", type);
-        msgLen = 0;
-        socket = _peerGetSocket(ctx);
-        if (socket < 0) error = ENOTCONN;
-        
-        while (socket >= 0 && ! error && msgLen < sizeof(buf)) {
-            n = send(socket, &buf[msgLen], sizeof(buf) - msgLen, MSG_NOSIGNAL);
-            if (n >= 0) msgLen += n;
-            if (n < 0 && errno != EWOULDBLOCK) error = errno;
-            gettimeofday(&tv, NULL);
-            if (! error && tv.tv_sec + (double)tv.tv_usec/1000000 >= _peerGetDisconnectTime(ctx)) error = ETIMEDOUT;
-            socket = _peerGetSocket(ctx);
+        uint8_t *buf, hash[32];
+        size_t off = 0, count;
+        int error = 0, pending = 0;
+
+        pthread_mutex_lock(&ctx->lock);
+        count = array_count(ctx->sendQueue) - ctx->sendOff;
+
+        if (ctx->socket < 0) error = ENOTCONN;
+        else if (count + HEADER_LENGTH + msgLen > MAX_SEND_QUEUE) {
+            peer_log(peer, "failed to send %s, %zu bytes already queued", type, count);
+            error = ENOBUFS;
         }
-        
+        else {
+            if (ctx->sendOff > 0) { // drop the bytes already sent
+                memmove(ctx->sendQueue, &ctx->sendQueue[ctx->sendOff], count);
+                array_set_count(ctx->sendQueue, count);
+                ctx->sendOff = 0;
+            }
+
+            if (count == 0) ctx->sendTime = _peerGetTime();
+            array_set_count(ctx->sendQueue, count + HEADER_LENGTH + msgLen);
+            buf = &ctx->sendQueue[count];
+            UInt32SetLE(&buf[off], ctx->magicNumber);
+            off += sizeof(uint32_t);
+            strncpy((char *)&buf[off], type, 12);
+            off += 12;
+            UInt32SetLE(&buf[off], (uint32_t)msgLen);
+            off += sizeof(uint32_t);
+            BRSHA256_2(hash, msg, msgLen);
+            memcpy(&buf[off], hash, sizeof(uint32_t));
+            off += sizeof(uint32_t);
+            if (msgLen > 0) memcpy(&buf[off], msg, msgLen);
+        }
+
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (! error) {
+            peer_log(peer, "sending %s", type);
+            error = _BRPeerFlushSendQueue(ctx, &pending);
+        }
+
         if (error) {
             peer_log(peer, "%s", strerror(error));
             BRPeerDisconnect(peer);
         }
+#if BR_PEER_REACTOR
+        else if (pending) _BRPeerReactorWantWrite(ctx);
+#endif
     }
 }
 
@@ -1600,6 +2239,56 @@ void BRPeerSendGetaddr(BRPeer *peer)
     BRPeerSendMessage(peer, NULL, 0, MSG_GETADDR);
 }
 
+static void _BRPeerSendCompactFilterRequest(BRPeer *peer, uint32_t startHeight, UInt256 stopHash, const char *type)
+{
+    uint8_t msg[sizeof(uint8_t) + sizeof(uint32_t) + sizeof(UInt256)];
+    size_t off = 0;
+    
+    msg[off] = COMPACT_FILTER_TYPE_BASIC;
+    off += sizeof(uint8_t);
+    UInt32SetLE(&msg[off], startHeight);
+    off += sizeof(uint32_t);
+    UInt256Set(&msg[off], stopHash);
+    off += sizeof(UInt256);
+    peer_log(peer, "calling %s with startHeight: %"PRIu32", stopHash: %s", type, startHeight, u256hex(stopHash));
+    BRPeerSendMessage(peer, msg, off, type);
+}
+
+void BRPeerSendGetcfheaders(BRPeer *peer, uint32_t startHeight, UInt256 stopHash)
+{
+    _BRPeerSendCompactFilterRequest(peer, startHeight, stopHash, MSG_GETCFHEADERS);
+}
+
+void BRPeerSendGetcfilters(BRPeer *peer, uint32_t startHeight, UInt256 stopHash)
+{
+    _BRPeerSendCompactFilterRequest(peer, startHeight, stopHash, MSG_GETCFILTERS);
+}
+
+void BRPeerSendGetdataBlocks(BRPeer *peer, const UInt256 blockHashes[], size_t blockCount)
+{
+    size_t i, off = 0;
+    
+    if (blockCount > MAX_GETDATA_HASHES) {
+        peer_log(peer, "couldn't send getdata, %zu is too many items, max is %d", blockCount, MAX_GETDATA_HASHES);
+    }
+    else if (blockCount > 0) {
+        size_t msgLen = BRVarIntSize(blockCount) + (sizeof(uint32_t) + sizeof(UInt256))*blockCount;
+        uint8_t msg[msgLen];
+        
+        off += BRVarIntSet(&msg[off], (off <= msgLen ? msgLen - off : 0), blockCount);
+        
+        for (i = 0; i < blockCount; i++) {
+            UInt32SetLE(&msg[off], inv_witness_block);
+            off += sizeof(uint32_t);
+            UInt256Set(&msg[off], blockHashes[i]);
+            off += sizeof(UInt256);
+        }
+        
+        ((BRPeerContext *)peer)->sentGetdata = 1;
+        BRPeerSendMessage(peer, msg, off, MSG_GETDATA);
+    }
+}
+
 void BRPeerSendPing(BRPeer *peer, void *info, void (*pongCallback)(void *info, int success))
 {
     BRPeerContext *ctx = (BRPeerContext *)peer;
@@ -1640,6 +2329,8 @@ void BRPeerFree(BRPeer *peer)
     if (ctx->knownTxHashSet) BRSetFree(ctx->knownTxHashSet);
     if (ctx->pongCallback) array_free(ctx->pongCallback);
     if (ctx->pongInfo) array_free(ctx->pongInfo);
+    if (ctx->payload) free(ctx->payload);
+    if (ctx->sendQueue) array_free(ctx->sendQueue);
     
     pthread_mutex_destroy(&ctx->lock);
     free(ctx);
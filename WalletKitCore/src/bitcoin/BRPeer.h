@@ -56,6 +56,7 @@ extern "C" {
 #define SERVICES_NODE_BLOOM   0x04 // BIP111: https://github.com/bitcoin/bips/blob/master/bip-0111.mediawiki
 #define SERVICES_NODE_WITNESS 0x08 // BIP144: https://github.com/bitcoin/bips/blob/master/bip-0144.mediawiki
 #define SERVICES_NODE_BCASH   0x20 // https://github.com/Bitcoin-UAHF/spec/blob/master/uahf-technical-spec.md
+#define SERVICES_NODE_COMPACT_FILTERS 0x40 // BIP157: https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
     
 #define BR_VERSION "2.1"
 #define USER_AGENT "/bread:" BR_VERSION "/"
@@ -83,6 +84,11 @@ extern "C" {
 #define MSG_ALERT       "alert"
 #define MSG_REJECT      "reject"   // described in BIP61: https://github.com/bitcoin/bips/blob/master/bip-0061.mediawiki
 #define MSG_FEEFILTER   "feefilter"// described in BIP133 https://github.com/bitcoin/bips/blob/master/bip-0133.mediawiki
+#define MSG_SENDHEADERS "sendheaders" // described in BIP130 https://github.com/bitcoin/bips/blob/master/bip-0130.mediawiki
+#define MSG_GETCFILTERS  "getcfilters" // described in BIP157 https://github.com/bitcoin/bips/blob/master/bip-0157.mediawiki
+#define MSG_CFILTER      "cfilter"
+#define MSG_GETCFHEADERS "getcfheaders"
+#define MSG_CFHEADERS    "cfheaders"
 
 #define REJECT_INVALID     0x10 // transaction is invalid for some reason (invalid signature, output value > input, etc)
 #define REJECT_SPENT       0x12 // an input is already spent
@@ -119,10 +125,12 @@ BRPeer *BRPeerNew(uint32_t magicNumber);
 // void hasTx(void *, UInt256 txHash) - called when an "inv" message with an already-known tx hash is received from peer
 // void rejectedTx(void *, UInt256 txHash, uint8_t) - called when a "reject" message is received from peer
 // void relayedBlock(void *, BRMerkleBlock *) - called when a "merkleblock" or "headers" message is received from peer
+//                                              (unless a relayedHeaders callback is set for "headers" messages)
 // void notfound(void *, const UInt256[], size_t, const UInt256[], size_t) - called when "notfound" message is received
 // BRTransaction *requestedTx(void *, UInt256) - called when "getdata" message with a tx hash is received from peer
 // int networkIsReachable(void *) - must return true when networking is available, false otherwise
-// void threadCleanup(void *) - called before a thread terminates to faciliate any needed cleanup    
+// void threadCleanup(void *) - called once the peer's I/O has finished, after disconnected(), from the I/O thread that
+//                              was servicing the peer, to faciliate any needed cleanup
 void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         void (*connected)(void *info),
                         void (*disconnected)(void *info, int error),
@@ -138,6 +146,33 @@ void BRPeerSetCallbacks(BRPeer *peer, void *info,
                         int (*networkIsReachable)(void *info),
                         void (*threadCleanup)(void *info));
 
+// setting these callbacks puts the peer in compact block filter mode (BIP157), and must be done before connecting:
+// the peer asks to have new blocks announced with headers instead of inv, keeps requesting headers past
+// earliestKeyTime, and never requests merkleblocks, leaving filter and block requests to the caller
+// void relayedFilterHeaders(void *, UInt256, UInt256, const UInt256[], size_t) - called when a "cfheaders" message is
+//                                                                                   received, with stop hash,
+//                                                                                   previous filter header and the
+//                                                                                   filter hashes
+// void relayedFilter(void *, UInt256, const uint8_t *, size_t) - called when a "cfilter" message is received, with
+//                                                                  block hash and filter
+// void relayedFullBlock(void *, BRMerkleBlock *, BRTransaction *[], size_t) - called when a "block" message is
+//                                                                              received, the block and each tx are
+//                                                                              owned by the callee
+void BRPeerSetCompactFilterCallbacks(BRPeer *peer,
+                                     void (*relayedFilterHeaders)(void *info, UInt256 stopHash, UInt256 prevHeader,
+                                                                  const UInt256 filterHashes[], size_t count),
+                                     void (*relayedFilter)(void *info, UInt256 blockHash, const uint8_t *filter,
+                                                           size_t filterLen),
+                                     void (*relayedFullBlock)(void *info, BRMerkleBlock *block, BRTransaction *txs[],
+                                                              size_t txCount));
+
+// setting this callback has each "headers" message relayed as one batch instead of one header at a time, after the
+// headers are parsed and proof-of-work checked, and must be done before connecting
+// void relayedHeaders(void *, BRMerkleBlock *[], size_t) - called with the valid headers of a "headers" message, in
+//                                                           message order, each owned by the callee
+void BRPeerSetRelayedHeadersCallback(BRPeer *peer,
+                                     void (*relayedHeaders)(void *info, BRMerkleBlock *blocks[], size_t count));
+
 // set earliestKeyTime to wallet creation time in order to speed up initial sync
 void BRPeerSetEarliestKeyTime(BRPeer *peer, uint32_t earliestKeyTime);
 
@@ -147,8 +182,9 @@ void BRPeerSetCurrentBlockHeight(BRPeer *peer, uint32_t currentBlockHeight);
 // current connection status
 BRPeerStatus BRPeerConnectStatus(BRPeer *peer);
 
-// open connection to peer and perform handshake
-void BRPeerConnect(BRPeer *peer);
+// open connection to peer and perform handshake, returns false if the connection failed before any I/O was scheduled,
+// in which case the status is BRPeerStatusDisconnected and neither disconnected() nor threadCleanup() will be called
+int BRPeerConnect(BRPeer *peer);
 
 // close connection to peer
 void BRPeerDisconnect(BRPeer *peer);
@@ -189,6 +225,9 @@ void BRPeerSendGetdata(BRPeer *peer, const UInt256 txHashes[], size_t txCount, c
                        size_t blockCount);
 void BRPeerSendGetaddr(BRPeer *peer);
 void BRPeerSendPing(BRPeer *peer, void *info, void (*pongCallback)(void *info, int success));
+void BRPeerSendGetcfheaders(BRPeer *peer, uint32_t startHeight, UInt256 stopHash);
+void BRPeerSendGetcfilters(BRPeer *peer, uint32_t startHeight, UInt256 stopHash);
+void BRPeerSendGetdataBlocks(BRPeer *peer, const UInt256 blockHashes[], size_t blockCount); // full witness blocks
 
 // useful to get additional tx after a bloom filter update
 void BRPeerRerequestBlocks(BRPeer *peer, UInt256 fromBlock);
@@ -24,11 +24,13 @@
 
 #include "BRPeerManager.h"
 #include "BRBloomFilter.h"
+#include "BRCompactFilter.h"
 #include "support/BRSet.h"
 #include "support/BRArray.h"
 #include "support/BRInt.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <time.h>
@@ -43,6 +45,7 @@
 #define MAX_CONNECT_FAILURES  20 // notify user of network problems after this many connect failures in a row
 #define PEER_FLAG_SYNCED      0x01
 #define PEER_FLAG_NEEDSUPDATE 0x02
+#define MAX_SCRIPT_PUBKEY_LENGTH 64 // longer than any standard output script
 
 #define genesis_block_hash(params) UInt256Reverse((params)->checkpoints[0].hash)
 
@@ -166,6 +169,110 @@ inline static int _BRBlockHeightEq(const void *block, const void *otherBlock)
     return (((const BRMerkleBlock *)block)->height == ((const BRMerkleBlock *)otherBlock)->height);
 }
 
+// Peer managers on the same network are kept in a process-wide group per BRChainParams, which lives as long as any of
+// them. The group only holds the checkpoints, built once and shared read-only, and the list of its managers. Each
+// manager still has its own blocks, header store and peers. When one starts syncing behind another, it copies the
+// headers it would only have downloaded (those older than one week before earliestKeyTime) from that manager's blocks
+// instead of from its peers.
+typedef struct {
+    const BRChainParams *params;
+    BRSet *checkpoints; // checkpoints are indexed by height, never modified once built
+    BRPeerManager **managers; // managers on this network, whose verified blocks the others can catch up from
+    pthread_mutex_t lock;
+} BRPeerManagerGroup;
+
+static BRPeerManagerGroup **_peerManagerGroups = NULL; // one per network with a manager
+static pthread_mutex_t _peerManagerGroupsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// adds manager to the group for params, creating the group if needed
+static BRPeerManagerGroup *_BRPeerManagerGroupJoin(const BRChainParams *params, BRPeerManager *manager)
+{
+    BRPeerManagerGroup *group = NULL;
+    BRMerkleBlock *block;
+
+    pthread_mutex_lock(&_peerManagerGroupsLock);
+    if (! _peerManagerGroups) array_new(_peerManagerGroups, 10);
+
+    for (size_t i = 0; ! group && i < array_count(_peerManagerGroups); i++) {
+        if (_peerManagerGroups[i]->params == params) group = _peerManagerGroups[i];
+    }
+
+    if (! group) {
+        group = calloc(1, sizeof(*group));
+        assert(group != NULL);
+        group->params = params;
+        group->checkpoints = BRSetNew(_BRBlockHeightHash, _BRBlockHeightEq, params->checkpointsCount);
+        array_new(group->managers, 10);
+        pthread_mutex_init(&group->lock, NULL);
+
+        for (size_t i = 0; i < params->checkpointsCount; i++) {
+            block = BRMerkleBlockNew();
+            block->height = params->checkpoints[i].height;
+            block->blockHash = UInt256Reverse(params->checkpoints[i].hash);
+            block->timestamp = params->checkpoints[i].timestamp;
+            block->target = params->checkpoints[i].target;
+            BRSetAdd(group->checkpoints, block);
+        }
+
+        array_add(_peerManagerGroups, group);
+    }
+
+    pthread_mutex_lock(&group->lock);
+    array_add(group->managers, manager);
+    pthread_mutex_unlock(&group->lock);
+    pthread_mutex_unlock(&_peerManagerGroupsLock);
+    return group;
+}
+
+// removes manager from its group, freeing the group along with its last manager
+static void _BRPeerManagerGroupLeave(BRPeerManagerGroup *group, BRPeerManager *manager)
+{
+    size_t managersCount;
+
+    pthread_mutex_lock(&_peerManagerGroupsLock);
+    pthread_mutex_lock(&group->lock);
+
+    for (size_t i = array_count(group->managers); i > 0; i--) {
+        if (group->managers[i - 1] == manager) array_rm(group->managers, i - 1);
+    }
+
+    managersCount = array_count(group->managers);
+    pthread_mutex_unlock(&group->lock);
+
+    if (managersCount == 0) {
+        for (size_t i = array_count(_peerManagerGroups); i > 0; i--) {
+            if (_peerManagerGroups[i - 1] == group) array_rm(_peerManagerGroups, i - 1);
+        }
+
+        BRSetFreeAll(group->checkpoints, (void (*)(void *))BRMerkleBlockFree);
+        array_free(group->managers);
+        pthread_mutex_destroy(&group->lock);
+        free(group);
+    }
+
+    if (array_count(_peerManagerGroups) == 0) {
+        array_free(_peerManagerGroups);
+        _peerManagerGroups = NULL;
+    }
+
+    pthread_mutex_unlock(&_peerManagerGroupsLock);
+}
+
+static BRMerkleBlock *_BRMerkleBlockHeaderCopy(const BRMerkleBlock *block)
+{
+    BRMerkleBlock *header = BRMerkleBlockNew();
+
+    header->blockHash = block->blockHash;
+    header->version = block->version;
+    header->prevBlock = block->prevBlock;
+    header->merkleRoot = block->merkleRoot;
+    header->timestamp = block->timestamp;
+    header->target = block->target;
+    header->nonce = block->nonce;
+    header->height = block->height;
+    return header; // totalTx is left 0, marking it as a header
+}
+
 struct BRPeerManagerStruct {
     const BRChainParams *params;
     BRWallet *wallet;
@@ -177,6 +284,18 @@ struct BRPeerManagerStruct {
     double fpRate, averageTxPerBlock;
     BRSet *blocks, *orphans, *checkpoints;
     BRMerkleBlock *lastBlock, *lastOrphan;
+    BRPeerManagerGroup *group;
+    BRHeaderStore *headerStore; // optional, not owned
+    int compactFilters; // BIP157 compact block filter sync instead of BIP37 bloom filters
+    uint32_t filterHeight, filterBatchCount; // filterHeight is the last block matched against the wallet
+    size_t filterRecvCount, filterAddrsCount;
+    UInt256 filterHeader, filterBatchHeader, *filterBlockHashes, *filterHashes, *filterMatches;
+    BRPeer *filterCheckPeer; // another peer asked for the batch's cfheaders, cleared once it answers or disconnects
+    UInt256 filterCheckHeader; // the batch header from filterCheckPeer's cfheaders, or zero if it didn't answer
+    uint8_t **filters, *filterMatched;
+    size_t *filterLens;
+    BRMerkleBlock **saveQueue; // copies of blocks to pass to saveBlocks() once the lock is released
+    int saveReplace;
     BRTxPeerList *txRelays, *txRequests;
     BRPublishedTx *publishedTx;
     UInt256 *publishedTxHashes;
@@ -258,6 +377,64 @@ static size_t _BRPeerManagerBlockLocators(BRPeerManager *manager, UInt256 locato
     return ++i;
 }
 
+// copies headers from other's blocks into manager->blocks, up to the last one that's older than one week before
+// manager's earliestKeyTime, returns the number of headers added - both managers must be locked
+static size_t _BRPeerManagerCopyHeaders(BRPeerManager *manager, BRPeerManager *other)
+{
+    BRMerkleBlock *b, *last = NULL, **headers;
+    size_t count = 0;
+
+    // walk back from other's tip to the newest header manager would have taken from a peer
+    for (b = other->lastBlock; b && b->height > manager->lastBlock->height; b = BRSetGet(other->blocks, &b->prevBlock)){
+        if (b->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime) continue;
+        last = b;
+        break;
+    }
+
+    array_new(headers, 100);
+
+    // collect headers back to where they join manager's chain, or to a difficulty transition it can start from
+    for (b = last; b && ! BRSetContains(manager->blocks, b); b = BRSetGet(other->blocks, &b->prevBlock)) {
+        array_add(headers, b);
+        if ((b->height % BLOCK_DIFFICULTY_INTERVAL) == 0) break;
+    }
+
+    if (b && array_count(headers) > 0) {
+        for (size_t i = array_count(headers); i > 0; i--) {
+            BRSetAdd(manager->blocks, _BRMerkleBlockHeaderCopy(headers[i - 1]));
+        }
+
+        count = array_count(headers);
+        manager->lastBlock = BRSetGet(manager->blocks, last);
+    }
+
+    array_free(headers);
+    return count;
+}
+
+// copies headers into manager->blocks from the first manager in its group that's ahead of it, returns the number of
+// headers added - manager must be locked
+static size_t _BRPeerManagerCatchUpHeaders(BRPeerManager *manager)
+{
+    BRPeerManagerGroup *group = manager->group;
+    BRPeerManager *other;
+    size_t count = 0;
+
+    pthread_mutex_lock(&group->lock);
+
+    for (size_t i = 0; count == 0 && i < array_count(group->managers); i++) {
+        other = group->managers[i];
+
+        // don't wait on a busy manager, it may be catching up from this one
+        if (other == manager || pthread_mutex_trylock(&other->lock) != 0) continue;
+        if (other->lastBlock->height > manager->lastBlock->height) count = _BRPeerManagerCopyHeaders(manager, other);
+        pthread_mutex_unlock(&other->lock);
+    }
+
+    pthread_mutex_unlock(&group->lock);
+    return count;
+}
+
 static void _setApplyFreeBlock(void *info, void *block)
 {
     BRMerkleBlockFree(block);
@@ -610,6 +787,274 @@ static void _BRPeerManagerLoadMempools(BRPeerManager *manager)
     }
 }
 
+static void _BRPeerManagerClearFilterBatch(BRPeerManager *manager)
+{
+    for (size_t i = 0; manager->filters && i < manager->filterBatchCount; i++) {
+        if (manager->filters[i]) free(manager->filters[i]);
+    }
+
+    if (manager->filters) free(manager->filters);
+    if (manager->filterLens) free(manager->filterLens);
+    if (manager->filterMatched) free(manager->filterMatched);
+    manager->filters = NULL;
+    manager->filterLens = NULL;
+    manager->filterMatched = NULL;
+    manager->filterBatchCount = 0;
+    manager->filterCheckPeer = NULL;
+    manager->filterCheckHeader = UINT256_ZERO;
+    manager->filterRecvCount = 0;
+    array_clear(manager->filterHashes);
+    array_clear(manager->filterMatches);
+}
+
+// queues copies of blocks for the saveBlocks() callback, which _BRPeerManagerSaveQueuedBlocks() makes once the lock is
+// released, so that writing them to the persistent store doesn't hold up the chain - a replace drops what's queued
+static void _BRPeerManagerQueueSaveBlocks(BRPeerManager *manager, int replace, BRMerkleBlock *blocks[], size_t count)
+{
+    if (! manager->saveBlocks) return;
+    
+    if (replace) {
+        for (size_t i = array_count(manager->saveQueue); i > 0; i--) BRMerkleBlockFree(manager->saveQueue[i - 1]);
+        array_clear(manager->saveQueue);
+        manager->saveReplace = 1;
+    }
+    
+    for (size_t i = 0; i < count; i++) array_add(manager->saveQueue, BRMerkleBlockCopy(blocks[i]));
+}
+
+// must be called without the lock held
+static void _BRPeerManagerSaveQueuedBlocks(BRPeerManager *manager)
+{
+    BRMerkleBlock **blocks = NULL;
+    int replace = 0;
+    
+    pthread_mutex_lock(&manager->lock);
+    
+    if (array_count(manager->saveQueue) > 0) {
+        blocks = manager->saveQueue;
+        replace = manager->saveReplace;
+        array_new(manager->saveQueue, 10);
+        manager->saveReplace = 0;
+    }
+    
+    pthread_mutex_unlock(&manager->lock);
+    if (! blocks) return;
+    manager->saveBlocks(manager->info, replace, blocks, array_count(blocks));
+    for (size_t i = array_count(blocks); i > 0; i--) BRMerkleBlockFree(blocks[i - 1]);
+    array_free(blocks);
+}
+
+// abandons any compact filter batch in flight, and starts matching filters again after height, up to lastBlock
+static void _BRPeerManagerResetCompactFilters(BRPeerManager *manager, uint32_t height)
+{
+    BRMerkleBlock *b = manager->lastBlock;
+    uint32_t filterHeight = manager->filterHeight;
+    size_t i;
+
+    _BRPeerManagerClearFilterBatch(manager);
+    if (height > manager->lastBlock->height) height = manager->lastBlock->height;
+    array_set_count(manager->filterBlockHashes, manager->lastBlock->height - height);
+
+    for (i = array_count(manager->filterBlockHashes); b && i > 0; i--) {
+        manager->filterBlockHashes[i - 1] = b->blockHash;
+        b = BRSetGet(manager->blocks, &b->prevBlock);
+    }
+
+    if (i > 0) { // headers were freed, there's no way to match their filters short of a rescan
+        _peer_log("BPM: missing headers below block #%"PRIu32", skipping compact filters for %zu block(s)",
+                  manager->lastBlock->height, array_count(manager->filterBlockHashes));
+        height = manager->lastBlock->height;
+        array_clear(manager->filterBlockHashes);
+    }
+
+    // the filter header at filterHeight was checked along with its batch, so it still holds, otherwise the next batch
+    // is only connected to the rest of the filter header chain by cross-checking its cfheaders with another peer
+    if (height != filterHeight) manager->filterHeader = UINT256_ZERO;
+    manager->filterHeight = height;
+}
+
+// requests filters for the next batch of headers once enough are pending, or the chain tip is reached, returns true if
+// that completes the chain sync
+static int _BRPeerManagerRequestCompactFilters(BRPeerManager *manager)
+{
+    BRPeer *peer = manager->downloadPeer;
+    size_t i, j, count = array_count(manager->filterBlockHashes);
+    int r = 0;
+
+    if (! manager->compactFilters || ! peer || manager->filterBatchCount > 0) return 0; // batch still in flight
+
+    if (count >= COMPACT_FILTER_MAX_COUNT || (count > 0 && manager->lastBlock->height >= manager->estimatedHeight)) {
+        if (count > COMPACT_FILTER_MAX_COUNT) count = COMPACT_FILTER_MAX_COUNT;
+        manager->filterBatchCount = (uint32_t)count;
+        manager->filterAddrsCount = 0;
+        manager->filters = calloc(count, sizeof(*manager->filters));
+        manager->filterLens = calloc(count, sizeof(*manager->filterLens));
+        manager->filterMatched = calloc(count, sizeof(*manager->filterMatched));
+        assert(manager->filters != NULL);
+        assert(manager->filterLens != NULL);
+        assert(manager->filterMatched != NULL);
+        BRPeerSendGetcfheaders(peer, manager->filterHeight + 1, manager->filterBlockHashes[count - 1]);
+        BRPeerSendGetcfilters(peer, manager->filterHeight + 1, manager->filterBlockHashes[count - 1]);
+        BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+
+        // ask the fastest other peer that has the batch for its cfheaders too, so the download peer can't feed us a
+        // filter header chain of its own making
+        for (i = array_count(manager->connectedPeers); i > 0; i--) {
+            BRPeer *p = manager->connectedPeers[i - 1];
+
+            if (p == peer || BRPeerConnectStatus(p) != BRPeerStatusConnected ||
+                (p->services & SERVICES_NODE_COMPACT_FILTERS) != SERVICES_NODE_COMPACT_FILTERS ||
+                BRPeerLastBlock(p) < manager->filterHeight + count) continue;
+            if (! manager->filterCheckPeer ||
+                BRPeerPingTime(p) < BRPeerPingTime(manager->filterCheckPeer)) manager->filterCheckPeer = p;
+        }
+
+        if (manager->filterCheckPeer) {
+            BRPeerSendGetcfheaders(manager->filterCheckPeer, manager->filterHeight + 1,
+                                   manager->filterBlockHashes[count - 1]);
+        }
+        else peer_log(peer, "no other peer to cross-check cfheaders with through block #%"PRIu32", will download "
+                      "full blocks", manager->filterHeight + (uint32_t)count);
+    }
+    else if (count == 0 && manager->syncStartHeight > 0 && manager->lastBlock->height >= manager->estimatedHeight) {
+        BRMerkleBlock *b = manager->lastBlock;
+        size_t saveCount = (b->height % BLOCK_DIFFICULTY_INTERVAL) + BLOCK_DIFFICULTY_INTERVAL + 1;
+        BRMerkleBlock *saveBlocks[saveCount];
+
+        for (i = 0; b && i < saveCount; i++) {
+            saveBlocks[i] = b;
+            b = BRSetGet(manager->blocks, &b->prevBlock);
+        }
+
+        // make sure the set of blocks to be saved starts at a difficulty interval
+        j = (i > 0) ? saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL : 0;
+        if (j > 0) i -= (i > BLOCK_DIFFICULTY_INTERVAL - j) ? BLOCK_DIFFICULTY_INTERVAL - j : i;
+        if (i > 0) _BRPeerManagerQueueSaveBlocks(manager, (i > 1 ? 1 : 0), saveBlocks, i);
+
+        peer_log(peer, "sync succeeded");
+        manager->connectFailureCount = 0; // reset connect failure count
+        _BRPeerManagerSyncStopped(manager);
+        _BRPeerManagerRequestUnrelayedTx(manager, peer);
+        BRPeerSendGetaddr(peer); // request a list of other bitcoin peers
+        r = 1;
+    }
+
+    return r;
+}
+
+// matches the wallet's scripts against the batch of filters if there are addresses it hasn't been matched with yet,
+// and requests the matching blocks that haven't already been requested, returns the number of blocks requested - if
+// the peers disagree on the batch's cfheaders, or no other peer's cfheaders were there to check them against, there's
+// no telling which filters are genuine, so every block matches and the batch falls back to downloading full blocks
+static size_t _BRPeerManagerMatchCompactFilters(BRPeerManager *manager)
+{
+    size_t i, n, count = 0, addrsCount;
+    int unchecked = UInt256IsZero(manager->filterCheckHeader),
+        checkFailed = (! unchecked && ! UInt256Eq(manager->filterCheckHeader, manager->filterBatchHeader));
+
+    // every wallet transaction found uses up an address, so generate some spare addresses up front to avoid having to
+    // match the batch again for each one
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED, SEQUENCE_EXTERNAL_CHAIN);
+    BRWalletUnusedAddrs(manager->wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED, SEQUENCE_INTERNAL_CHAIN);
+    addrsCount = BRWalletAllAddrs(manager->wallet, NULL, 0);
+
+    if (addrsCount > manager->filterAddrsCount) {
+        BRAddress *addrs = malloc(addrsCount*sizeof(*addrs));
+        uint8_t *scripts = malloc(addrsCount*MAX_SCRIPT_PUBKEY_LENGTH), *matches = calloc(manager->filterBatchCount, 1);
+        const uint8_t **items = malloc(addrsCount*sizeof(*items));
+        size_t *itemLens = malloc(addrsCount*sizeof(*itemLens));
+
+        assert(addrs != NULL);
+        assert(scripts != NULL);
+        assert(matches != NULL);
+        assert(items != NULL);
+        assert(itemLens != NULL);
+        addrsCount = BRWalletAllAddrs(manager->wallet, addrs, addrsCount);
+
+        // filters hold the output scripts a block pays to or spends from, so the wallet's own scripts find both
+        for (i = 0, n = 0; i < addrsCount; i++) {
+            items[n] = &scripts[i*MAX_SCRIPT_PUBKEY_LENGTH];
+            itemLens[n] = BRAddressScriptPubKey(&scripts[i*MAX_SCRIPT_PUBKEY_LENGTH], MAX_SCRIPT_PUBKEY_LENGTH,
+                                                manager->params->addrParams, addrs[i].s);
+            if (itemLens[n] > 0) n++;
+        }
+
+        if (unchecked || checkFailed) memset(matches, 1, manager->filterBatchCount);
+        else BRCompactFilterMatchAnyBatch((const uint8_t **)manager->filters, manager->filterLens,
+                                          manager->filterBlockHashes, manager->filterBatchCount, items, itemLens, n,
+                                          matches);
+
+        for (i = 0; i < manager->filterBatchCount; i++) {
+            if (! matches[i] || manager->filterMatched[i]) continue;
+            manager->filterMatched[i] = 1;
+            array_add(manager->filterMatches, manager->filterBlockHashes[i]);
+            count++;
+        }
+
+        if (count > 0 && unchecked) {
+            peer_log(manager->downloadPeer, "no other peer's cfheaders to check against, requesting all %zu block(s)",
+                     count);
+        }
+        else if (count > 0 && checkFailed) {
+            peer_log(manager->downloadPeer, "cfheaders don't match another peer's, requesting all %zu block(s)", count);
+        }
+        else if (count > 0) {
+            peer_log(manager->downloadPeer, "%zu of %"PRIu32" compact filters matched the wallet's %zu addresses",
+                     count, manager->filterBatchCount, addrsCount);
+        }
+
+        if (count > 0) {
+            BRPeerSendGetdataBlocks(manager->downloadPeer, &manager->filterMatches[array_count(manager->filterMatches) -
+                                                                                   count], count);
+        }
+
+        manager->filterAddrsCount = addrsCount;
+        free(itemLens);
+        free(items);
+        free(matches);
+        free(scripts);
+        free(addrs);
+    }
+
+    return count;
+}
+
+// called when every filter in the batch has been matched and all the matching blocks have been received, returns true
+// if that completes the chain sync
+static int _BRPeerManagerCompactFilterBatchDone(BRPeerManager *manager)
+{
+    uint32_t i, height, count = manager->filterBatchCount;
+    BRMerkleBlock *b;
+
+    for (i = 0; i < count; i++) { // save transition blocks once the wallet has caught up to them
+        height = manager->filterHeight + 1 + i;
+        if ((height % BLOCK_DIFFICULTY_INTERVAL) != 0 || height + 100 >= manager->estimatedHeight) continue;
+        b = BRSetGet(manager->blocks, &manager->filterBlockHashes[i]);
+        if (b) _BRPeerManagerQueueSaveBlocks(manager, 0, &b, 1);
+    }
+
+    if (manager->downloadPeer) {
+        peer_log(manager->downloadPeer, "matched compact filters through block #%"PRIu32,
+                 manager->filterHeight + count);
+    }
+
+    manager->filterHeader = manager->filterBatchHeader;
+    manager->filterHeight += count;
+    array_rm_range(manager->filterBlockHashes, 0, count);
+    _BRPeerManagerClearFilterBatch(manager);
+    return _BRPeerManagerRequestCompactFilters(manager);
+}
+
+// called when a filter arrives, or the cross-check of the batch's cfheaders is answered or abandoned, matches the batch
+// once it's all in, returns true if that completes the chain sync
+static int _BRPeerManagerCompactFilterBatchReady(BRPeerManager *manager)
+{
+    if (manager->filterBatchCount == 0 || manager->filterRecvCount < manager->filterBatchCount ||
+        manager->filterCheckPeer) return 0;
+    if (_BRPeerManagerMatchCompactFilters(manager) > 0) return 0;
+    return _BRPeerManagerCompactFilterBatchDone(manager);
+}
+
 // returns a UINT128_ZERO terminated array of addresses for hostname that must be freed, or NULL if lookup failed
 static UInt128 *_addressLookup(const char *hostname)
 {
@@ -716,6 +1161,7 @@ static void _peerConnected(void *info)
     BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
     BRPeerCallbackInfo *peerInfo;
     time_t now = time(NULL);
+    int syncFinished = 0;
     
     pthread_mutex_lock(&manager->lock);
     if (peer->timestamp > now + 2*60*60 || peer->timestamp < now - 2*60*60) peer->timestamp = now; // sanity check
@@ -733,14 +1179,24 @@ static void _peerConnected(void *info)
         peer_log(peer, "node isn't synced");
         BRPeerDisconnect(peer);
     }
-    else if (BRPeerVersion(peer) >= 70011 && (peer->services & SERVICES_NODE_BLOOM) != SERVICES_NODE_BLOOM) {
+    else if (manager->compactFilters &&
+             (peer->services & SERVICES_NODE_COMPACT_FILTERS) != SERVICES_NODE_COMPACT_FILTERS) {
+        peer_log(peer, "node doesn't serve compact block filters");
+        BRPeerDisconnect(peer);
+    }
+    else if (! manager->compactFilters && BRPeerVersion(peer) >= 70011 &&
+             (peer->services & SERVICES_NODE_BLOOM) != SERVICES_NODE_BLOOM) {
         peer_log(peer, "node doesn't support SPV mode");
         BRPeerDisconnect(peer);
     }
     else if (manager->downloadPeer && // check if we should stick with the existing download peer
              (BRPeerLastBlock(manager->downloadPeer) >= BRPeerLastBlock(peer) ||
               manager->lastBlock->height >= BRPeerLastBlock(peer))) {
-        if (manager->lastBlock->height >= BRPeerLastBlock(peer)) { // only load bloom filter if we're done syncing
+        if (manager->lastBlock->height >= BRPeerLastBlock(peer) && manager->compactFilters) {
+            manager->connectFailureCount = 0; // there's no bloom filter or mempool to load in compact filter mode
+            _BRPeerManagerPublishPendingTx(manager, peer);
+        }
+        else if (manager->lastBlock->height >= BRPeerLastBlock(peer)) { // only load bloom filter if we're done syncing
             manager->connectFailureCount = 0; // also reset connect failure count if we're already synced
             _BRPeerManagerLoadBloomFilter(manager, peer);
             _BRPeerManagerPublishPendingTx(manager, peer);
@@ -770,7 +1226,8 @@ static void _peerConnected(void *info)
         manager->downloadPeer = peer;
         manager->isConnected = 1;
         manager->estimatedHeight = BRPeerLastBlock(peer);
-        _BRPeerManagerLoadBloomFilter(manager, peer);
+        if (manager->compactFilters) _BRPeerManagerResetCompactFilters(manager, manager->filterHeight);
+        else _BRPeerManagerLoadBloomFilter(manager, peer);
         BRPeerSetCurrentBlockHeight(peer, manager->lastBlock->height);
         _BRPeerManagerPublishPendingTx(manager, peer);
             
@@ -780,13 +1237,18 @@ static void _peerConnected(void *info)
             
             BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // schedule sync timeout
 
-            // request just block headers up to a week before earliestKeyTime, and then merkleblocks after that
-            // we do not reset connect failure count yet incase this request times out
-            if (manager->lastBlock->timestamp + 7*24*60*60 >= manager->earliestKeyTime) {
+            // request just block headers up to a week before earliestKeyTime, and then merkleblocks after that, or
+            // only headers in compact filter mode - we do not reset connect failure count yet incase this request
+            // times out
+            if (! manager->compactFilters && manager->lastBlock->timestamp + 7*24*60*60 >= manager->earliestKeyTime) {
                 BRPeerSendGetblocks(peer, locators, count, UINT256_ZERO);
             }
             else BRPeerSendGetheaders(peer, locators, count, UINT256_ZERO);
         }
+        else if (manager->compactFilters) { // we're synced, except maybe for some pending filters
+            manager->connectFailureCount = 0; // reset connect failure count
+            syncFinished = _BRPeerManagerRequestCompactFilters(manager);
+        }
         else { // we're already synced
             manager->connectFailureCount = 0; // reset connect failure count
             _BRPeerManagerLoadMempools(manager);
@@ -794,6 +1256,8 @@ static void _peerConnected(void *info)
     }
 
     pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
 }
 
 static void _peerDisconnected(void *info, int error)
@@ -801,7 +1265,7 @@ static void _peerDisconnected(void *info, int error)
     BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
     BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
     BRTxPeerList *peerList;
-    int willSave = 0, willReconnect = 0, txError = 0;
+    int willSave = 0, willReconnect = 0, txError = 0, syncFinished = 0;
     size_t txCount = 0;
     
     //free(info);
@@ -836,8 +1300,14 @@ static void _peerDisconnected(void *info, int error)
     if (peer == manager->downloadPeer) { // download peer disconnected
         manager->isConnected = 0;
         manager->downloadPeer = NULL;
+        if (manager->compactFilters) _BRPeerManagerResetCompactFilters(manager, manager->filterHeight);
         if (manager->connectFailureCount > MAX_CONNECT_FAILURES) manager->connectFailureCount = MAX_CONNECT_FAILURES;
     }
+    else if (peer == manager->filterCheckPeer) { // unchecked, the batch falls back to downloading full blocks
+        peer_log(peer, "disconnected before cross-checking cfheaders");
+        manager->filterCheckPeer = NULL;
+        syncFinished = _BRPeerManagerCompactFilterBatchReady(manager);
+    }
 
     if (! manager->isConnected && manager->connectFailureCount == MAX_CONNECT_FAILURES) {
         _BRPeerManagerSyncStopped(manager);
@@ -873,6 +1343,8 @@ static void _peerDisconnected(void *info, int error)
         pubTx[i].callback(pubTx[i].info, txError);
     }
     
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
     if (willSave && manager->savePeers) manager->savePeers(manager->info, 1, NULL, 0);
     if (willSave && manager->syncStopped) manager->syncStopped(manager->info, error);
     if (willReconnect) BRPeerManagerConnect(manager); // try connecting to another peer
@@ -1087,11 +1559,23 @@ static int _BRPeerManagerVerifyBlock(BRPeerManager *manager, BRMerkleBlock *bloc
 
     // check if we hit a difficulty transition, and find previous transition time
     if (r && (block->height % BLOCK_DIFFICULTY_INTERVAL) == 0) {
-        BRMerkleBlock *b = block;
+        BRMerkleBlock *b = NULL, *retarget = NULL;
         UInt256 prevBlock;
 
-        for (uint32_t i = 0; b && i < BLOCK_DIFFICULTY_INTERVAL; i++) {
-            b = BRSetGet(manager->blocks, &b->prevBlock);
+        // the header store has the previous transition at a fixed offset, use it if it's the one in our chain
+        if (manager->headerStore) retarget = BRHeaderStoreRetargetBlock(manager->headerStore, block->height - 1);
+
+        if (retarget) {
+            b = BRSetGet(manager->blocks, retarget);
+            BRMerkleBlockFree(retarget);
+        }
+
+        if (! b) {
+            b = block;
+
+            for (uint32_t i = 0; b && i < BLOCK_DIFFICULTY_INTERVAL; i++) {
+                b = BRSetGet(manager->blocks, &b->prevBlock);
+            }
         }
 
         if (! b) {
@@ -1141,39 +1625,23 @@ static void _peerRelayedBlockFailed (BRMerkleBlock *blockToFree, BRPeer *peer, c
     assert (0);
 }
 
-static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
+// links a relayed block into the chain, setting syncFinished if it completes a compact filter sync, txStatusUpdate
+// if transaction confirmations may have changed, and invalid if the block failed verification and the peer was
+// disconnected - must be called with the manager lock held
+// returns the next block if it was received earlier as an orphan, removed from the orphans, to be linked next
+static BRMerkleBlock *_BRPeerManagerAddBlock(BRPeerManager *manager, BRPeer *peer, BRMerkleBlock *block,
+                                             int *syncFinished, int *txStatusUpdate, int *invalid)
 {
-    if (NULL == info || NULL == block) {
-        _peerRelayedBlockFailed (block, NULL, "missed 'info' or 'block'");
-        return;
-    }
-
-    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
-    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
     size_t i, j, fpCount = 0, saveCount = 0;
     BRMerkleBlock orphan, *b, *b2, *prev, *next = NULL;
-    uint32_t txTime = 0;
-
-    if (NULL == peer || NULL == manager) {
-        _peerRelayedBlockFailed (block, peer, "missed 'peer' or 'manager'");
-        return;
-    }
-
-    // Check manager - ensure anything dereferenced subsequently is valid
-    if (NULL == manager->blocks ||
-        NULL == manager->wallet ||
-        NULL == manager->lastBlock ||
-        NULL == manager->downloadPeer) {
-        _peerRelayedBlockFailed (block, peer, "missed 'manager' fields");
-        return;
-    }
+    uint32_t txTime = 0, forkHeight;
 
     // Check block - ensure anything dereferenced subsequently is valid.  The only pointers in
     // block are: txHashes and flags, both of which can be NULL.
     if ((NULL == block->hashes && 0 != block->hashesCount) ||
         (NULL == block->flags  && 0 != block->flagsLen)) {
         _peerRelayedBlockFailed (block, peer, "missed 'block' fields");
-        return;
+        return NULL;
     }
 
     size_t txCount = BRMerkleBlockTxHashes(block, NULL, 0);
@@ -1181,7 +1649,6 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     assert(txHashes != NULL);
     txCount = BRMerkleBlockTxHashes(block, txHashes, txCount);
 
-    pthread_mutex_lock(&manager->lock);
     prev = BRSetGet(manager->blocks, &block->prevBlock);
 
     if (prev) {
@@ -1190,7 +1657,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     }
     
     // track the observed bloom filter false positive rate using a low pass filter to smooth out variance
-    if (peer == manager->downloadPeer && block->totalTx > 0) {
+    if (! manager->compactFilters && peer == manager->downloadPeer && block->totalTx > 0) {
         for (i = 0; i < txCount; i++) { // wallet tx are not false-positives
             if (! BRWalletTransactionForHash(manager->wallet, txHashes[i])) fpCount++;
         }
@@ -1215,12 +1682,15 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         }
     }
 
-    // ignore block headers that are newer than one week before earliestKeyTime (it's a header if it has 0 totalTx)
-    if (block->totalTx == 0 && block->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime) {
+    // ignore block headers that are newer than one week before earliestKeyTime (it's a header if it has 0 totalTx),
+    // unless they're for compact filter sync, which only ever gets headers
+    if (! manager->compactFilters && block->totalTx == 0 &&
+        block->timestamp + 7*24*60*60 - 2*60*60 > manager->earliestKeyTime) {
         BRMerkleBlockFree(block);
         block = NULL;
     }
-    else if (manager->bloomFilter == NULL) { // ingore potentially incomplete blocks when a filter update is pending
+    else if (! manager->compactFilters && manager->bloomFilter == NULL) {
+        // ingore potentially incomplete blocks when a filter update is pending
         BRMerkleBlockFree(block);
         block = NULL;
 
@@ -1246,8 +1716,14 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
                 size_t locatorsCount = _BRPeerManagerBlockLocators(manager, locators,
                                                                    sizeof(locators)/sizeof(*locators));
                 
-                peer_log(peer, "calling getblocks");
-                BRPeerSendGetblocks(peer, locators, locatorsCount, UINT256_ZERO);
+                if (manager->compactFilters) {
+                    peer_log(peer, "calling getheaders");
+                    BRPeerSendGetheaders(peer, locators, locatorsCount, UINT256_ZERO);
+                }
+                else {
+                    peer_log(peer, "calling getblocks");
+                    BRPeerSendGetblocks(peer, locators, locatorsCount, UINT256_ZERO);
+                }
             }
             
             BRSetAdd(manager->orphans, block); // BUG: limit total orphans to avoid memory exhaustion attack
@@ -1258,6 +1734,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         peer_log(peer, "relayed invalid block");
         BRMerkleBlockFree(block);
         block = NULL;
+        *invalid = 1;
         _BRPeerManagerPeerMisbehavin(manager, peer);
     }
     else if (UInt256Eq(block->prevBlock, manager->lastBlock->blockHash)) { // new block extends main chain
@@ -1269,17 +1746,28 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
         manager->lastBlock = block;
         if (txCount > 0) BRWalletUpdateTransactions(manager->wallet, txHashes, txCount, block->height, txTime);
         if (manager->downloadPeer) BRPeerSetCurrentBlockHeight(manager->downloadPeer, block->height);
+
+        if (manager->compactFilters && block->height == manager->filterHeight + 1 &&
+            block->timestamp + 7*24*60*60 - 2*60*60 <= manager->earliestKeyTime) {
+            manager->filterHeight = block->height; // no filter to match before the wallet existed
+        }
+        else if (manager->compactFilters) array_add(manager->filterBlockHashes, block->blockHash);
             
         if (block->height < manager->estimatedHeight && peer == manager->downloadPeer) {
             BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
             manager->connectFailureCount = 0; // reset failure count once we know our initial request didn't timeout
         }
         
-        if ((block->height % BLOCK_DIFFICULTY_INTERVAL) == 0 && block->height + 100 < manager->estimatedHeight) {
-            saveCount = 1; // save transition blocks immediately
+        // save transition blocks immediately, or in compact filter mode, once their filters are matched
+        if ((block->height % BLOCK_DIFFICULTY_INTERVAL) == 0 && block->height + 100 < manager->estimatedHeight &&
+            (! manager->compactFilters || block->height <= manager->filterHeight)) {
+            saveCount = 1;
         }
         
-        if (block->height == manager->estimatedHeight) { // chain download is complete
+        if (manager->compactFilters) {
+            *syncFinished |= _BRPeerManagerRequestCompactFilters(manager);
+        }
+        else if (block->height == manager->estimatedHeight) { // chain download is complete
             saveCount = (block->height % BLOCK_DIFFICULTY_INTERVAL) + BLOCK_DIFFICULTY_INTERVAL + 1;
             _BRPeerManagerLoadMempools(manager);
         }
@@ -1294,7 +1782,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
 
         if (NULL == b) {
             _peerRelayedBlockFailed (block, peer, "In 'already have a block' missed 'b'");
-            return;
+            return NULL;
         }
 
         if (BRMerkleBlockEq(b, block)) { // if it's not on a fork, set block heights for its transactions
@@ -1339,9 +1827,10 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
 
             if (NULL == b) {
                 _peerRelayedBlockFailed (NULL, peer, "In 'on a fork' missed 'b'");
-                return;
+                return NULL;
             }
             peer_log(peer, "reorganizing chain from height %"PRIu32", new height is %"PRIu32, b->height, block->height);
+            forkHeight = b->height;
         
             BRWalletSetTxUnconfirmedAfter(manager->wallet, b->height); // mark tx after the join point as unconfirmed
 
@@ -1356,7 +1845,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
                                malloc(count*sizeof(*txHashes));
                     if (NULL == txHashes) {
                         _peerRelayedBlockFailed (NULL, peer, "In 'on a fork' missed 'txHashes'");
-                        return;
+                        return NULL;
                     }
                     txCount = count;
                 }
@@ -1368,8 +1857,13 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
             }
         
             manager->lastBlock = block;
-            
-            if (block->height == manager->estimatedHeight) { // chain download is complete
+                
+            if (manager->compactFilters) { // match filters on the new main chain from where it joins the old one
+                _BRPeerManagerResetCompactFilters(manager, (forkHeight < manager->filterHeight) ? forkHeight :
+                                                  manager->filterHeight);
+                *syncFinished |= _BRPeerManagerRequestCompactFilters(manager);
+            }
+            else if (block->height == manager->estimatedHeight) { // chain download is complete
                 saveCount = (block->height % BLOCK_DIFFICULTY_INTERVAL) + BLOCK_DIFFICULTY_INTERVAL + 1;
                 _BRPeerManagerLoadMempools(manager);
             }
@@ -1391,7 +1885,7 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     for (i = 0, b = block; b && i < saveCount; i++) {
         if (b->height == BLOCK_UNKNOWN_HEIGHT) {
             _peerRelayedBlockFailed (NULL, peer, "In 'save' missed 'height'");
-            return;
+            return NULL;
         }
         saveBlocks[i] = b;
         b = BRSetGet(manager->blocks, &b->prevBlock);
@@ -1402,17 +1896,220 @@ static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
     if (j > 0) i -= (i > BLOCK_DIFFICULTY_INTERVAL - j) ? BLOCK_DIFFICULTY_INTERVAL - j : i;
     if (i != 0 && (saveBlocks[i - 1]->height % BLOCK_DIFFICULTY_INTERVAL) != 0) {
         _peerRelayedBlockFailed (NULL, peer, "In 'save' missed 'difficulty'");
-        return;
+        return NULL;
     }
-    if (i > 0 && manager->saveBlocks) manager->saveBlocks(manager->info, (i > 1 ? 1 : 0), saveBlocks, i);
-    pthread_mutex_unlock(&manager->lock);
+    if (i > 0) _BRPeerManagerQueueSaveBlocks(manager, (i > 1 ? 1 : 0), saveBlocks, i);
     
-    if (block && block->height != BLOCK_UNKNOWN_HEIGHT && block->height >= BRPeerLastBlock(peer) &&
-        manager->txStatusUpdate) {
-        manager->txStatusUpdate(manager->info); // notify that transaction confirmations may have changed
+    if (block && block->height != BLOCK_UNKNOWN_HEIGHT && block->height >= BRPeerLastBlock(peer)) {
+        *txStatusUpdate = 1; // transaction confirmations may have changed
     }
     
-    if (next) _peerRelayedBlock(info, next);
+    return next;
+}
+
+static void _peerRelayedBlock(void *info, BRMerkleBlock *block)
+{
+    if (NULL == info || NULL == block) {
+        _peerRelayedBlockFailed (block, NULL, "missed 'info' or 'block'");
+        return;
+    }
+
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    int syncFinished = 0, txStatusUpdate = 0, invalid = 0;
+
+    if (NULL == peer || NULL == manager) {
+        _peerRelayedBlockFailed (block, peer, "missed 'peer' or 'manager'");
+        return;
+    }
+
+    // Check manager - ensure anything dereferenced subsequently is valid
+    if (NULL == manager->blocks ||
+        NULL == manager->wallet ||
+        NULL == manager->lastBlock ||
+        NULL == manager->downloadPeer) {
+        _peerRelayedBlockFailed (block, peer, "missed 'manager' fields");
+        return;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+    while (block) block = _BRPeerManagerAddBlock(manager, peer, block, &syncFinished, &txStatusUpdate, &invalid);
+    pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+    if (txStatusUpdate && manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
+}
+
+// the headers have already been parsed and proof-of-work checked by the peer, outside of the manager lock, so a whole
+// "headers" message is linked into the chain under a single lock, with callbacks made once for the batch
+static void _peerRelayedHeaders(void *info, BRMerkleBlock *blocks[], size_t count)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    BRMerkleBlock *block;
+    size_t i;
+    int syncFinished = 0, txStatusUpdate = 0, invalid = 0;
+
+    // Check manager - ensure anything dereferenced subsequently is valid
+    if (NULL == manager->blocks ||
+        NULL == manager->wallet ||
+        NULL == manager->lastBlock ||
+        NULL == manager->downloadPeer) {
+        for (size_t i = 0; i < count; i++) BRMerkleBlockFree(blocks[i]);
+        _peerRelayedBlockFailed (NULL, peer, "missed 'manager' fields");
+        return;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+
+    for (i = 0; i < count && ! invalid; i++) {
+        block = blocks[i];
+        while (block) block = _BRPeerManagerAddBlock(manager, peer, block, &syncFinished, &txStatusUpdate, &invalid);
+    }
+
+    // the peer has been disconnected for relaying an invalid header, so the rest of the message builds on a chain we
+    // rejected - drop it rather than filling the orphans with it
+    if (i < count) peer_log(peer, "dropping %zu header(s) after invalid block", count - i);
+    for (; i < count; i++) BRMerkleBlockFree(blocks[i]);
+    pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+    if (txStatusUpdate && manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
+}
+
+
+static void _peerRelayedFilterHeaders(void *info, UInt256 stopHash, UInt256 prevHeader, const UInt256 filterHashes[],
+                                      size_t count)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    UInt256 header = prevHeader;
+    int syncFinished = 0;
+
+    pthread_mutex_lock(&manager->lock);
+
+    if (peer == manager->filterCheckPeer && peer != manager->downloadPeer && count == manager->filterBatchCount &&
+        UInt256Eq(stopHash, manager->filterBlockHashes[count - 1])) {
+        for (size_t i = 0; i < count; i++) header = BRCompactFilterHeader(filterHashes[i], header);
+        manager->filterCheckHeader = header; // the batch header commits to prevHeader as well, so that's all to compare
+        manager->filterCheckPeer = NULL;
+        syncFinished = _BRPeerManagerCompactFilterBatchReady(manager);
+    }
+    else if (peer != manager->downloadPeer || count == 0 || count != manager->filterBatchCount ||
+        array_count(manager->filterHashes) > 0 || ! UInt256Eq(stopHash, manager->filterBlockHashes[count - 1])) {
+        peer_log(peer, "ignoring unrequested cfheaders with stop block: %s", u256hex(stopHash));
+    }
+    else if (! UInt256IsZero(manager->filterHeader) && ! UInt256Eq(prevHeader, manager->filterHeader)) {
+        peer_log(peer, "cfheaders don't connect to filter header %s at block #%"PRIu32, u256hex(manager->filterHeader),
+                 manager->filterHeight);
+        _BRPeerManagerPeerMisbehavin(manager, peer);
+    }
+    else {
+        for (size_t i = 0; i < count; i++) header = BRCompactFilterHeader(filterHashes[i], header);
+        array_add_array(manager->filterHashes, filterHashes, count);
+        manager->filterBatchHeader = header;
+        BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+    if (syncFinished && manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
+}
+
+static void _peerRelayedFilter(void *info, UInt256 blockHash, const uint8_t *filter, size_t filterLen)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    int syncFinished = 0;
+    size_t i;
+
+    pthread_mutex_lock(&manager->lock);
+    i = manager->filterRecvCount; // filters arrive in height order, after the cfheaders for the batch
+
+    if (peer != manager->downloadPeer || i >= array_count(manager->filterHashes) ||
+        ! UInt256Eq(blockHash, manager->filterBlockHashes[i])) {
+        peer_log(peer, "ignoring unrequested cfilter for block: %s", u256hex(blockHash));
+    }
+    else if (! UInt256Eq(BRCompactFilterHash(filter, filterLen), manager->filterHashes[i])) {
+        peer_log(peer, "cfilter doesn't match its filter header, blockHash: %s", u256hex(blockHash));
+        _BRPeerManagerPeerMisbehavin(manager, peer);
+    }
+    else {
+        manager->filters[i] = malloc((filterLen > 0) ? filterLen : 1);
+        assert(manager->filters[i] != NULL);
+        memcpy(manager->filters[i], filter, filterLen);
+        manager->filterLens[i] = filterLen;
+        manager->filterRecvCount++;
+        BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+
+        // the whole batch is matched at once, so each wallet script is hashed under several block keys at a time
+        syncFinished = _BRPeerManagerCompactFilterBatchReady(manager);
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+    if (syncFinished && manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
+}
+
+static void _peerRelayedFullBlock(void *info, BRMerkleBlock *block, BRTransaction *txs[], size_t txCount)
+{
+    BRPeer *peer = ((BRPeerCallbackInfo *)info)->peer;
+    BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    size_t i, count = BRMerkleBlockTxHashes(block, NULL, 0);
+    UInt256 *txHashes = NULL;
+    uint32_t height;
+    int syncFinished = 0;
+
+    pthread_mutex_lock(&manager->lock);
+    for (i = array_count(manager->filterMatches); i > 0; i--) {
+        if (UInt256Eq(manager->filterMatches[i - 1], block->blockHash)) break;
+    }
+
+    if (peer != manager->downloadPeer || i == 0) {
+        pthread_mutex_unlock(&manager->lock);
+        peer_log(peer, "ignoring unrequested block: %s", u256hex(block->blockHash));
+        for (i = 0; i < txCount; i++) BRTransactionFree(txs[i]);
+        BRMerkleBlockFree(block);
+        return;
+    }
+
+    array_rm(manager->filterMatches, i - 1); // claim the block, so it's only registered once if it's relayed again
+    for (i = 0; i < manager->filterBatchCount; i++) {
+        if (UInt256Eq(manager->filterBlockHashes[i], block->blockHash)) break;
+    }
+
+    height = manager->filterHeight + 1 + (uint32_t)i;
+    pthread_mutex_unlock(&manager->lock);
+
+    // register the wallet's transactions in block order, so a spend of an earlier one in the same block is recognized
+    for (i = 0; i < txCount; i++) {
+        if (BRWalletContainsTransaction(manager->wallet, txs[i])) _peerRelayedTx(info, txs[i]);
+        else BRTransactionFree(txs[i]);
+    }
+
+    txHashes = malloc(count*sizeof(*txHashes));
+    assert(txHashes != NULL || count == 0);
+    count = BRMerkleBlockTxHashes(block, txHashes, count);
+    pthread_mutex_lock(&manager->lock);
+
+    // the batch is abandoned if the download peer disconnected meanwhile, and matched again from the start later
+    if (peer == manager->downloadPeer && manager->filterBatchCount > 0) {
+        peer_log(peer, "relayed matching block #%"PRIu32" with %zu tx", height, count);
+        BRWalletUpdateTransactions(manager->wallet, txHashes, count, height, block->timestamp);
+        BRPeerScheduleDisconnect(peer, PROTOCOL_TIMEOUT); // reschedule sync timeout
+
+        // once all the matching blocks are in, match the batch again with any addresses their transactions used up
+        if (array_count(manager->filterMatches) == 0) syncFinished = _BRPeerManagerCompactFilterBatchReady(manager);
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    _BRPeerManagerSaveQueuedBlocks(manager);
+    BRMerkleBlockFree(block);
+    if (txHashes) free(txHashes);
+    if (syncFinished && manager->syncStopped) manager->syncStopped(manager->info, 0);
+    if (manager->txStatusUpdate) manager->txStatusUpdate(manager->info);
 }
 
 static void _peerDataNotfound(void *info, const UInt256 txHashes[], size_t txCount,
@@ -1495,12 +2192,16 @@ static int _peerNetworkIsReachable(void *info)
 static void _peerThreadCleanup(void *info)
 {
     BRPeerManager *manager = ((BRPeerCallbackInfo *)info)->manager;
+    void (*threadCleanup)(void *info);
+    void *managerInfo;
 
     free(info);
     pthread_mutex_lock(&manager->lock);
-    manager->peerThreadCount--;
+    threadCleanup = manager->threadCleanup;
+    managerInfo = manager->info;
+    manager->peerThreadCount--; // manager may be freed as soon as this reaches zero
     pthread_mutex_unlock(&manager->lock);
-    if (manager->threadCleanup) manager->threadCleanup(manager->info);
+    if (threadCleanup) threadCleanup(managerInfo);
 }
 
 static void _dummyThreadCleanup(void *info)
@@ -1531,7 +2232,8 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
     array_new(manager->connectedPeers, PEER_MAX_CONNECTIONS);
     manager->blocks = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, blocksCount);
     manager->orphans = BRSetNew(_BRPrevBlockHash, _BRPrevBlockEq, blocksCount); // orphans are indexed by prevBlock
-    manager->checkpoints = BRSetNew(_BRBlockHeightHash, _BRBlockHeightEq, 100); // checkpoints are indexed by height
+    manager->group = _BRPeerManagerGroupJoin(params, manager);
+    manager->checkpoints = manager->group->checkpoints; // shared, checkpoints are indexed by height
 
     for (size_t i = 0; i < manager->params->checkpointsCount; i++) {
         block = BRMerkleBlockNew();
@@ -1539,7 +2241,6 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
         block->blockHash = UInt256Reverse(manager->params->checkpoints[i].hash);
         block->timestamp = manager->params->checkpoints[i].timestamp;
         block->target = manager->params->checkpoints[i].target;
-        BRSetAdd(manager->checkpoints, block);
         BRSetAdd(manager->blocks, block);
         if (i == 0 || block->timestamp + 7*24*60*60 < manager->earliestKeyTime) manager->lastBlock = block;
     }
@@ -1572,6 +2273,11 @@ BRPeerManager *BRPeerManagerNew(const BRChainParams *params, BRWallet *wallet, u
     array_new(manager->txRequests, 10);
     array_new(manager->publishedTx, 10);
     array_new(manager->publishedTxHashes, 10);
+    array_new(manager->filterBlockHashes, COMPACT_FILTER_MAX_COUNT);
+    array_new(manager->filterHashes, COMPACT_FILTER_MAX_COUNT);
+    array_new(manager->filterMatches, 10);
+    manager->filterHeight = manager->lastBlock->height;
+    array_new(manager->saveQueue, 10);
     pthread_mutex_init(&manager->lock, NULL);
     manager->threadCleanup = _dummyThreadCleanup;
     return manager;
@@ -1629,6 +2335,28 @@ void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t
     }
 }
 
+// not thread-safe, call before BRPeerManagerConnect() to sync using BIP157 compact block filters instead of BIP37 bloom
+// filters - only peers that serve compact filters are used, wallet scripts are matched against each block's filter
+// locally, and only the blocks that match are downloaded
+void BRPeerManagerSetCompactFilterSync(BRPeerManager *manager, int enabled)
+{
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    manager->compactFilters = enabled;
+    _BRPeerManagerResetCompactFilters(manager, manager->lastBlock->height);
+    pthread_mutex_unlock(&manager->lock);
+}
+
+// not thread-safe, call before BRPeerManagerConnect() to look up the previous difficulty transition of each transition
+// block in store, rather than walking back through the last 2016 blocks - store must outlive the manager
+void BRPeerManagerSetHeaderStore(BRPeerManager *manager, BRHeaderStore *store)
+{
+    assert(manager != NULL);
+    pthread_mutex_lock(&manager->lock);
+    manager->headerStore = store;
+    pthread_mutex_unlock(&manager->lock);
+}
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager)
 {
@@ -1656,6 +2384,16 @@ void BRPeerManagerConnect(BRPeerManager *manager)
     
     if ((! manager->downloadPeer || manager->lastBlock->height < manager->estimatedHeight) &&
         manager->syncStartHeight == 0) {
+        size_t count = _BRPeerManagerCatchUpHeaders(manager);
+
+        if (count > 0) _peer_log("BPM: caught up %zu headers from another manager, last block height %"PRIu32, count,
+                                 manager->lastBlock->height);
+
+        // caught up headers are all older than earliestKeyTime, so they don't need their filters matched
+        if (count > 0 && manager->compactFilters) {
+            _BRPeerManagerResetCompactFilters(manager, (array_count(manager->filterBlockHashes) == 0) ?
+                                              manager->lastBlock->height : manager->filterHeight);
+        }
         manager->syncStartHeight = manager->lastBlock->height + 1;
         pthread_mutex_unlock(&manager->lock);
         if (manager->syncStarted) manager->syncStarted(manager->info);
@@ -1705,12 +2443,19 @@ void BRPeerManagerConnect(BRPeerManager *manager)
                 BRPeerSetCallbacks(info->peer, info, _peerConnected, _peerDisconnected, _peerRelayedPeers,
                                    _peerRelayedTx, _peerHasTx, _peerRejectedTx, _peerRelayedBlock, _peerDataNotfound,
                                    _peerSetFeePerKb, _peerRequestedTx, _peerNetworkIsReachable, _peerThreadCleanup);
-                BRPeerSetEarliestKeyTime(info->peer, manager->earliestKeyTime);
-                BRPeerConnect(info->peer);
+                BRPeerSetRelayedHeadersCallback(info->peer, _peerRelayedHeaders);
+                if (manager->compactFilters) {
+                    BRPeerSetCompactFilterCallbacks(info->peer, _peerRelayedFilterHeaders, _peerRelayedFilter,
+                                                    _peerRelayedFullBlock);
+                }
 
-                if (BRPeerConnectStatus(info->peer) == BRPeerStatusDisconnected) {
+                BRPeerSetEarliestKeyTime(info->peer, manager->earliestKeyTime);
+                // once connecting has started, the peer's I/O thread may disconnect and free it at any time, so only a
+                // synchronous failure is cleaned up here
+                if (! BRPeerConnect(info->peer)) {
                     pthread_mutex_unlock(&manager->lock);
                     _peerDisconnected(info, ENOTCONN);
+                    free(info);
                     pthread_mutex_lock(&manager->lock);
                     manager->peerThreadCount--;
                 }
@@ -1772,6 +2517,7 @@ static int _BRPeerManagerRescan(BRPeerManager *manager, BRMerkleBlock *newLastBl
 
     manager->lastBlock = newLastBlock;
     _peer_log("BPM: rescanning with %u last block height", manager->lastBlock->height);
+    if (manager->compactFilters) _BRPeerManagerResetCompactFilters(manager, manager->lastBlock->height);
 
     if (manager->downloadPeer) { // disconnect the current download peer so a new random one will be selected
         for (size_t i = array_count(manager->peers); i > 0; i--) {
@@ -2069,6 +2815,7 @@ void BRPeerManagerFree(BRPeerManager *manager)
     BRTransaction *tx;
     
     assert(manager != NULL);
+    _BRPeerManagerGroupLeave(manager->group, manager); // first, so no other manager catches up from this one
     pthread_mutex_lock(&manager->lock);
     array_free(manager->peers);
     for (size_t i = array_count(manager->connectedPeers); i > 0; i--) BRPeerFree(manager->connectedPeers[i - 1]);
@@ -2077,7 +2824,6 @@ void BRPeerManagerFree(BRPeerManager *manager)
     BRSetFree(manager->blocks);
     BRSetApply(manager->orphans, NULL, _setApplyFreeBlock);
     BRSetFree(manager->orphans);
-    BRSetFree(manager->checkpoints);
     for (size_t i = array_count(manager->txRelays); i > 0; i--) array_free(manager->txRelays[i - 1].peers);
     array_free(manager->txRelays);
     for (size_t i = array_count(manager->txRequests); i > 0; i--) array_free(manager->txRequests[i - 1].peers);
@@ -2089,9 +2835,15 @@ void BRPeerManagerFree(BRPeerManager *manager)
     }
 
     if (manager->bloomFilter) BRBloomFilterFree(manager->bloomFilter);
+    _BRPeerManagerClearFilterBatch(manager);
+    array_free(manager->filterBlockHashes);
+    array_free(manager->filterHashes);
+    array_free(manager->filterMatches);
 
     array_free(manager->publishedTx);
     array_free(manager->publishedTxHashes);
+    for (size_t i = array_count(manager->saveQueue); i > 0; i--) BRMerkleBlockFree(manager->saveQueue[i - 1]);
+    array_free(manager->saveQueue);
     pthread_mutex_unlock(&manager->lock);
     pthread_mutex_destroy(&manager->lock);
     free(manager);
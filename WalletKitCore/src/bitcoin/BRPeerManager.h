@@ -30,6 +30,7 @@
 #include "BRTransaction.h"
 #include "BRWallet.h"
 #include "BRChainParams.h"
+#include "BRHeaderStore.h"
 #include <stddef.h>
 #include <inttypes.h>
 
@@ -69,6 +70,15 @@ void BRPeerManagerSetCallbacks(BRPeerManager *manager, void *info,
 // set address to UINT128_ZERO to revert to default behavior
 void BRPeerManagerSetFixedPeer(BRPeerManager *manager, UInt128 address, uint16_t port);
 
+// not thread-safe, call before BRPeerManagerConnect() to sync using BIP157 compact block filters instead of BIP37 bloom
+// filters - only peers that serve compact filters are used, wallet scripts are matched against each block's filter
+// locally, and only the blocks that match are downloaded
+void BRPeerManagerSetCompactFilterSync(BRPeerManager *manager, int enabled);
+
+// not thread-safe, call before BRPeerManagerConnect() to look up the previous difficulty transition of each transition
+// block in store, rather than walking back through the last 2016 blocks - store must outlive the manager
+void BRPeerManagerSetHeaderStore(BRPeerManager *manager, BRHeaderStore *store);
+
 // current connect status
 BRPeerStatus BRPeerManagerConnectStatus(BRPeerManager *manager);
 
@@ -422,6 +422,14 @@ BRPeerSyncManagerSetFixedPeer (BRPeerSyncManager manager,
                                UInt128 address,
                                uint16_t port);
 
+static void
+BRPeerSyncManagerSetHeaderStore (BRPeerSyncManager manager,
+                                 BRHeaderStore *store);
+
+static void
+BRPeerSyncManagerSetCompactFilterSync (BRPeerSyncManager manager,
+                                       int enabled);
+
 static void
 BRPeerSyncManagerConnect(BRPeerSyncManager manager);
 
@@ -632,6 +640,36 @@ BRSyncManagerSetFixedPeer (BRSyncManager manager,
     }
 }
 
+extern void
+BRSyncManagerSetHeaderStore (BRSyncManager manager,
+                             BRHeaderStore *store) {
+    switch (manager->mode) {
+        case CRYPTO_SYNC_MODE_API_ONLY:
+        break;
+        case CRYPTO_SYNC_MODE_P2P_ONLY:
+        BRPeerSyncManagerSetHeaderStore (BRSyncManagerAsPeerSyncManager(manager), store);
+        break;
+        default:
+        assert (0);
+        break;
+    }
+}
+
+extern void
+BRSyncManagerSetCompactFilterSync (BRSyncManager manager,
+                                   int enabled) {
+    switch (manager->mode) {
+        case CRYPTO_SYNC_MODE_API_ONLY:
+        break;
+        case CRYPTO_SYNC_MODE_P2P_ONLY:
+        BRPeerSyncManagerSetCompactFilterSync (BRSyncManagerAsPeerSyncManager(manager), enabled);
+        break;
+        default:
+        assert (0);
+        break;
+    }
+}
+
 extern void
 BRSyncManagerConnect(BRSyncManager manager) {
     switch (manager->mode) {
@@ -1755,6 +1793,18 @@ BRPeerSyncManagerSetFixedPeer (BRPeerSyncManager manager,
     BRPeerManagerSetFixedPeer (manager->peerManager, address, port);
 }
 
+static void
+BRPeerSyncManagerSetHeaderStore (BRPeerSyncManager manager,
+                                 BRHeaderStore *store) {
+    BRPeerManagerSetHeaderStore (manager->peerManager, store);
+}
+
+static void
+BRPeerSyncManagerSetCompactFilterSync (BRPeerSyncManager manager,
+                                       int enabled) {
+    BRPeerManagerSetCompactFilterSync (manager->peerManager, enabled);
+}
+
 static void
 BRPeerSyncManagerConnect(BRPeerSyncManager manager) {
     BRPeerManagerConnect (manager->peerManager);
@@ -14,6 +14,7 @@
 #include <inttypes.h>
 
 #include "BRChainParams.h"
+#include "BRHeaderStore.h"
 #include "BRMerkleBlock.h"
 #include "BRPeer.h"
 #include "BRWallet.h"
@@ -171,6 +172,14 @@ BRSyncManagerSetFixedPeer (BRSyncManager manager,
                            UInt128 address,
                            uint16_t port);
 
+extern void
+BRSyncManagerSetHeaderStore (BRSyncManager manager,
+                             BRHeaderStore *store);
+
+extern void
+BRSyncManagerSetCompactFilterSync (BRSyncManager manager,
+                                   int enabled);
+
 extern void
 BRSyncManagerConnect(BRSyncManager manager);
 
@@ -24,9 +24,11 @@
 
 #include "BRTransaction.h"
 #include "support/BRArray.h"
+#include "support/BRSet.h"
 #include <stdlib.h>
 #include <limits.h>
 #include <time.h>
+#include <pthread.h>
 
 #define TX_VERSION           0x00000001
 #define TX_LOCKTIME          0x00000000
@@ -36,6 +38,16 @@
 #define SIGHASH_ANYONECANPAY 0x80 // let other people add inputs, I don't care where the rest of the bitcoins come from
 #define SIGHASH_FORKID       0x40 // use BIP143 digest method (for b-cash/b-gold signatures)
 
+inline static size_t _pkhHash(const void *pkh)
+{
+    return (size_t)UInt32GetLE(pkh);
+}
+
+inline static int _pkhEq(const void *pkh, const void *otherPkh)
+{
+    return UInt160Eq(UInt160Get(pkh), UInt160Get(otherPkh));
+}
+
 size_t BRTxInputAddress(const BRTxInput *input, char *address, size_t addrLen, BRAddressParams params)
 {
     size_t r = BRAddressFromScriptPubKey(address, addrLen, params, input->script, input->scriptLen);
@@ -184,15 +196,65 @@ static size_t _BRTransactionOutputData(const BRTransaction *tx, uint8_t *data, s
     return (! data || off <= dataLen) ? off : 0;
 }
 
+// BIP143 hashes shared by the signature pre-images of every input in a tx, for any hash type that includes them
+typedef struct {
+    UInt256 prevoutsHash;
+    UInt256 sequenceHash;
+    UInt256 outputsHash;
+} BRTxSigHashCache;
+
+// double-SHA256 of all tx input outpoints
+static void _BRTransactionPrevoutsHash(const BRTransaction *tx, void *md32)
+{
+    uint8_t buf[(sizeof(UInt256) + sizeof(uint32_t))*tx->inCount];
+    
+    for (size_t i = 0; i < tx->inCount; i++) {
+        UInt256Set(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i], tx->inputs[i].txHash);
+        UInt32SetLE(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i + sizeof(UInt256)], tx->inputs[i].index);
+    }
+    
+    BRSHA256_2(md32, buf, sizeof(buf));
+}
+
+// double-SHA256 of all tx input sequence numbers
+static void _BRTransactionSequenceHash(const BRTransaction *tx, void *md32)
+{
+    uint8_t buf[sizeof(uint32_t)*tx->inCount];
+    
+    for (size_t i = 0; i < tx->inCount; i++) UInt32SetLE(&buf[sizeof(uint32_t)*i], tx->inputs[i].sequence);
+    BRSHA256_2(md32, buf, sizeof(buf));
+}
+
+// double-SHA256 of all tx outputs
+static void _BRTransactionOutputsHash(const BRTransaction *tx, void *md32)
+{
+    size_t bufLen = _BRTransactionOutputData(tx, NULL, 0, SIZE_MAX);
+    uint8_t _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
+    
+    bufLen = _BRTransactionOutputData(tx, buf, bufLen, SIZE_MAX);
+    BRSHA256_2(md32, buf, bufLen);
+    if (buf != _buf) free(buf);
+}
+
+// computes the shared BIP143 hashes once, so signing n inputs hashes O(n) bytes instead of O(n^2)
+static const BRTxSigHashCache *_BRTxSigHashCacheInit(BRTxSigHashCache *cache, const BRTransaction *tx)
+{
+    _BRTransactionPrevoutsHash(tx, &cache->prevoutsHash);
+    _BRTransactionSequenceHash(tx, &cache->sequenceHash);
+    _BRTransactionOutputsHash(tx, &cache->outputsHash);
+    return cache;
+}
+
 // writes the BIP143 witness program data that needs to be hashed and signed for the tx input at index
 // https://github.com/bitcoin/bips/blob/master/bip-0143.mediawiki
+// cache may be NULL, or the shared hashes previously computed for tx with _BRTxSigHashCacheInit()
 // returns number of bytes written, or total len needed if data is NULL
 static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t index,
-                                        int hashType)
+                                        int hashType, const BRTxSigHashCache *cache)
 {
     BRTxInput input;
     int anyoneCanPay = (hashType & SIGHASH_ANYONECANPAY), sigHash = (hashType & 0x1f);
-    size_t i, off = 0;
+    size_t off = 0;
     uint8_t scriptCode[] = { OP_DUP, OP_HASH160, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
                              0, 0, 0, 0, 0, 0, 0, 0, 0, OP_EQUALVERIFY, OP_CHECKSIG };
 
@@ -200,27 +262,19 @@ static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data,
     if (data && off + sizeof(uint32_t) <= dataLen) UInt32SetLE(&data[off], tx->version); // tx version
     off += sizeof(uint32_t);
     
-    if (! anyoneCanPay) {
-        uint8_t buf[(sizeof(UInt256) + sizeof(uint32_t))*tx->inCount];
-        
-        for (i = 0; i < tx->inCount; i++) {
-            UInt256Set(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i], tx->inputs[i].txHash);
-            UInt32SetLE(&buf[(sizeof(UInt256) + sizeof(uint32_t))*i + sizeof(UInt256)], tx->inputs[i].index);
-        }
-        
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, sizeof(buf)); // inputs hash
+    if (data && off + sizeof(UInt256) <= dataLen) {
+        if (anyoneCanPay) UInt256Set(&data[off], UINT256_ZERO); // anyone-can-pay
+        else if (cache) UInt256Set(&data[off], cache->prevoutsHash);
+        else _BRTransactionPrevoutsHash(tx, &data[off]); // inputs hash
     }
-    else if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], UINT256_ZERO); // anyone-can-pay
     
     off += sizeof(UInt256);
     
-    if (! anyoneCanPay && sigHash != SIGHASH_SINGLE && sigHash != SIGHASH_NONE) {
-        uint8_t buf[sizeof(uint32_t)*tx->inCount];
-        
-        for (i = 0; i < tx->inCount; i++) UInt32SetLE(&buf[sizeof(uint32_t)*i], tx->inputs[i].sequence);
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, sizeof(buf)); // sequence hash
+    if (data && off + sizeof(UInt256) <= dataLen) {
+        if (anyoneCanPay || sigHash == SIGHASH_SINGLE || sigHash == SIGHASH_NONE) UInt256Set(&data[off], UINT256_ZERO);
+        else if (cache) UInt256Set(&data[off], cache->sequenceHash);
+        else _BRTransactionSequenceHash(tx, &data[off]); // sequence hash
     }
-    else if (data && off + sizeof(UInt256) <= dataLen) UInt256Set(&data[off], UINT256_ZERO);
     
     off += sizeof(UInt256);
     input = tx->inputs[index];
@@ -236,12 +290,10 @@ static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data,
     off += _BRTxInputData(&input, (data ? &data[off] : NULL), (off <= dataLen ? dataLen - off : 0));
     
     if (sigHash != SIGHASH_SINGLE && sigHash != SIGHASH_NONE) {
-        size_t bufLen = _BRTransactionOutputData(tx, NULL, 0, SIZE_MAX);
-        uint8_t _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
-        
-        bufLen = _BRTransactionOutputData(tx, buf, bufLen, SIZE_MAX);
-        if (data && off + sizeof(UInt256) <= dataLen) BRSHA256_2(&data[off], buf, bufLen); // SIGHASH_ALL outputs hash
-        if (buf != _buf) free(buf);
+        if (data && off + sizeof(UInt256) <= dataLen) {
+            if (cache) UInt256Set(&data[off], cache->outputsHash);
+            else _BRTransactionOutputsHash(tx, &data[off]); // SIGHASH_ALL outputs hash
+        }
     }
     else if (sigHash == SIGHASH_SINGLE && index < tx->outCount) {
         uint8_t buf[_BRTransactionOutputData(tx, NULL, 0, index)];
@@ -261,14 +313,16 @@ static size_t _BRTransactionWitnessData(const BRTransaction *tx, uint8_t *data,
 
 // writes the data that needs to be hashed and signed for the tx input at index
 // an index of SIZE_MAX will write the entire signed transaction
+// cache may be NULL, or the shared hashes previously computed for tx with _BRTxSigHashCacheInit()
 // returns number of bytes written, or total dataLen needed if data is NULL
-static size_t _BRTransactionData(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t index, int hashType)
+static size_t _BRTransactionData(const BRTransaction *tx, uint8_t *data, size_t dataLen, size_t index, int hashType,
+                                 const BRTxSigHashCache *cache)
 {
     BRTxInput input;
     int anyoneCanPay = (hashType & SIGHASH_ANYONECANPAY), sigHash = (hashType & 0x1f), witnessFlag = 0;
     size_t i, count, len, woff, off = 0;
     
-    if (hashType & SIGHASH_FORKID) return _BRTransactionWitnessData(tx, data, dataLen, index, hashType);
+    if (hashType & SIGHASH_FORKID) return _BRTransactionWitnessData(tx, data, dataLen, index, hashType, cache);
     if (anyoneCanPay && index >= tx->inCount) return 0;
     
     for (i = 0; index == SIZE_MAX && ! witnessFlag && i < tx->inCount; i++) {
@@ -499,7 +553,7 @@ BRTransaction *BRTransactionParse(const uint8_t *buf, size_t bufLen)
 size_t BRTransactionSerialize(const BRTransaction *tx, uint8_t *buf, size_t bufLen)
 {
     assert(tx != NULL);
-    return (tx) ? _BRTransactionData(tx, buf, bufLen, SIZE_MAX, SIGHASH_ALL) : 0;
+    return (tx) ? _BRTransactionData(tx, buf, bufLen, SIZE_MAX, SIGHASH_ALL, NULL) : 0;
 }
 
 // adds an input to tx
@@ -637,74 +691,170 @@ int BRTransactionIsSigned(const BRTransaction *tx)
     return (tx) ? 1 : 0;
 }
 
+#define TX_SIGN_MIN_PER_THREAD 16
+
+typedef enum {
+    TX_SIGN_NONE = 0,
+    TX_SIGN_P2WPKH,
+    TX_SIGN_P2PKH,
+    TX_SIGN_P2PK
+} BRTxSignType;
+
+// a signature to make for a single tx input
+typedef struct {
+    BRTxSignType type;
+    const BRKey *key;
+    UInt256 md;
+    uint8_t sig[73];
+    size_t sigLen;
+} BRTxSignJob;
+
+typedef struct {
+    BRTxSignJob *jobs;
+    size_t count;
+} BRTxSignRange;
+
+static void *_BRTxSignRange(void *info)
+{
+    BRTxSignRange *range = info;
+    
+    for (size_t i = 0; i < range->count; i++) {
+        BRTxSignJob *job = &range->jobs[i];
+        
+        if (job->type != TX_SIGN_NONE) job->sigLen = BRKeySign(job->key, job->sig, sizeof(job->sig) - 1, job->md);
+    }
+    
+    return NULL;
+}
+
 // adds signatures to any inputs with NULL signatures that can be signed with any keys
 // forkId is 0 for bitcoin, 0x40 for b-cash, 0x4f for b-gold
 // returns true if tx is signed
 int BRTransactionSign(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount)
 {
-    UInt160 pkh[keysCount];
-    size_t i, j;
+    return BRTransactionSignWithThreads(tx, forkId, keys, keysCount, 1);
+}
+
+// same as BRTransactionSign(), but makes the input signatures on up to threadCount threads
+// signatures are deterministic (RFC6979), so the signed tx is identical to the one BRTransactionSign() produces
+// returns true if tx is signed
+int BRTransactionSignWithThreads(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount, size_t threadCount)
+{
+    UInt160 pkh[keysCount], *keyPKH;
+    BRSet *keySet = BRSetNew(_pkhHash, _pkhEq, keysCount);
+    BRTxSigHashCache sigHashCache;
+    const BRTxSigHashCache *cache = NULL;
+    BRTxSignJob *jobs = NULL;
+    size_t i, signCount = 0;
     
     assert(tx != NULL);
     assert(keys != NULL || keysCount == 0);
     
-    for (i = 0; tx && i < keysCount; i++) {
-        pkh[i] = BRKeyHash160(&keys[i]);
+    for (i = keysCount; tx && i > 0; i--) { // add in reverse, so the first of any duplicate keys is the one found
+        pkh[i - 1] = BRKeyHash160(&keys[i - 1]);
+        BRSetAdd(keySet, &pkh[i - 1]);
     }
     
-    for (i = 0; tx && i < tx->inCount; i++) {
+    if (tx && tx->inCount > 0) jobs = calloc(tx->inCount, sizeof(*jobs));
+    
+    // input signatures aren't part of any other input's signature pre-image, so all the sighashes can be computed up
+    // front, and the signatures made independently
+    for (i = 0; jobs && i < tx->inCount; i++) {
         BRTxInput *input = &tx->inputs[i];
         const uint8_t *hash = BRScriptPKH(input->script, input->scriptLen);
         
-        j = 0;
-        while (j < keysCount && (! hash || ! UInt160Eq(pkh[j], UInt160Get(hash)))) j++;
-        if (j >= keysCount) continue;
+        keyPKH = (hash) ? BRSetGet(keySet, hash) : NULL;
+        if (! keyPKH) continue;
+        if (! cache) cache = _BRTxSigHashCacheInit(&sigHashCache, tx);
         
         const uint8_t *elems[BRScriptElements(NULL, 0, input->script, input->scriptLen)];
         size_t elemsCount = BRScriptElements(elems, sizeof(elems)/sizeof(*elems), input->script, input->scriptLen);
-        uint8_t pubKey[BRKeyPubKey(&keys[j], NULL, 0)];
-        size_t pkLen = BRKeyPubKey(&keys[j], pubKey, sizeof(pubKey));
-        uint8_t sig[73], script[1 + sizeof(sig) + 1 + sizeof(pubKey)];
-        size_t sigLen, scriptLen;
-        UInt256 md = UINT256_ZERO;
         
         if (elemsCount == 2 && *elems[0] == OP_0 && *elems[1] == 20) { // pay-to-witness-pubkey-hash
-            uint8_t data[_BRTransactionWitnessData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionWitnessData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
+            uint8_t data[_BRTransactionWitnessData(tx, NULL, 0, i, forkId | SIGHASH_ALL, cache)];
+            size_t dataLen = _BRTransactionWitnessData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL, cache);
             
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+            BRSHA256_2(&jobs[i].md, data, dataLen);
+            jobs[i].type = TX_SIGN_P2WPKH;
+        }
+        else { // pay-to-pubkey-hash or pay-to-pubkey
+            uint8_t data[_BRTransactionData(tx, NULL, 0, i, forkId | SIGHASH_ALL, cache)];
+            size_t dataLen = _BRTransactionData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL, cache);
+            
+            BRSHA256_2(&jobs[i].md, data, dataLen);
+            jobs[i].type = (elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY) ? TX_SIGN_P2PKH : TX_SIGN_P2PK;
+        }
+        
+        jobs[i].key = &keys[keyPKH - pkh];
+        signCount++;
+    }
+    
+    BRSetFree(keySet);
+    if (threadCount > (signCount + TX_SIGN_MIN_PER_THREAD - 1)/TX_SIGN_MIN_PER_THREAD) {
+        threadCount = (signCount + TX_SIGN_MIN_PER_THREAD - 1)/TX_SIGN_MIN_PER_THREAD;
+    }
+    
+    if (jobs && threadCount <= 1) {
+        BRTxSignRange range = { jobs, tx->inCount };
+        
+        _BRTxSignRange(&range);
+    }
+    else if (jobs) {
+        BRTxSignRange ranges[threadCount];
+        pthread_t threads[threadCount];
+        int started[threadCount];
+        
+        for (i = 0; i < threadCount; i++) {
+            size_t lo = tx->inCount*i/threadCount, hi = tx->inCount*(i + 1)/threadCount;
+            
+            ranges[i] = (BRTxSignRange) { &jobs[lo], hi - lo };
+            // the caller's thread takes the first range, as well as any range that couldn't get a thread of its own
+            started[i] = (i > 0 && pthread_create(&threads[i], NULL, _BRTxSignRange, &ranges[i]) == 0);
+        }
+        
+        for (i = 0; i < threadCount; i++) {
+            if (! started[i]) _BRTxSignRange(&ranges[i]);
+        }
+        
+        for (i = 0; i < threadCount; i++) {
+            if (started[i]) pthread_join(threads[i], NULL);
+        }
+    }
+    
+    for (i = 0; jobs && i < tx->inCount; i++) {
+        BRTxInput *input = &tx->inputs[i];
+        BRTxSignJob *job = &jobs[i];
+        
+        if (job->type == TX_SIGN_NONE) continue;
+        
+        uint8_t pubKey[BRKeyPubKey((BRKey *)job->key, NULL, 0)];
+        size_t pkLen = BRKeyPubKey((BRKey *)job->key, pubKey, sizeof(pubKey));
+        uint8_t script[1 + sizeof(job->sig) + 1 + sizeof(pubKey)];
+        size_t scriptLen;
+        
+        job->sig[job->sigLen++] = forkId | SIGHASH_ALL;
+        scriptLen = BRScriptPushData(script, sizeof(script), job->sig, job->sigLen);
+        
+        if (job->type == TX_SIGN_P2WPKH) {
             scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
             BRTxInputSetSignature(input, script, 0);
             BRTxInputSetWitness(input, script, scriptLen);
         }
-        else if (elemsCount >= 2 && *elems[elemsCount - 2] == OP_EQUALVERIFY) { // pay-to-pubkey-hash
-            uint8_t data[_BRTransactionData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
-            
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
+        else if (job->type == TX_SIGN_P2PKH) {
             scriptLen += BRScriptPushData(&script[scriptLen], sizeof(script) - scriptLen, pubKey, pkLen);
             BRTxInputSetSignature(input, script, scriptLen);
             BRTxInputSetWitness(input, script, 0);
         }
         else { // pay-to-pubkey
-            uint8_t data[_BRTransactionData(tx, NULL, 0, i, forkId | SIGHASH_ALL)];
-            size_t dataLen = _BRTransactionData(tx, data, sizeof(data), i, forkId | SIGHASH_ALL);
-
-            BRSHA256_2(&md, data, dataLen);
-            sigLen = BRKeySign(&keys[j], sig, sizeof(sig) - 1, md);
-            sig[sigLen++] = forkId | SIGHASH_ALL;
-            scriptLen = BRScriptPushData(script, sizeof(script), sig, sigLen);
             BRTxInputSetSignature(input, script, scriptLen);
             BRTxInputSetWitness(input, script, 0);
         }
+        
+        var_clean(&job->md);
     }
     
+    if (jobs) free(jobs);
+    
     if (tx && BRTransactionIsSigned(tx)) {
         uint8_t data[BRTransactionSerialize(tx, NULL, 0)];
         size_t len = BRTransactionSerialize(tx, data, sizeof(data));
@@ -135,6 +135,11 @@ int BRTransactionIsSigned(const BRTransaction *tx);
 // returns true if tx is signed
 int BRTransactionSign(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount);
 
+// same as BRTransactionSign(), but makes the input signatures on up to threadCount threads
+// signatures are deterministic (RFC6979), so the signed tx is identical to the one BRTransactionSign() produces
+// returns true if tx is signed
+int BRTransactionSignWithThreads(BRTransaction *tx, int forkId, BRKey keys[], size_t keysCount, size_t threadCount);
+
 // true if tx meets IsStandard() rules: https://bitcoin.org/en/developer-guide#standard-transactions
 int BRTransactionIsStandard(const BRTransaction *tx);
 
@@ -51,27 +51,38 @@ inline static uint64_t _txFee(uint64_t feePerKb, size_t size)
     return (fee > standardFee) ? fee : standardFee;
 }
 
-// chain position of first tx output address that appears in chain
-inline static size_t _txChainIndex(const BRTransaction *tx, const UInt160 *chain)
-{
-    const uint8_t *pkh;
-    
-    for (size_t i = array_count(chain); i > 0; i--) {
-        for (size_t j = 0; j < tx->outCount; j++) {
-            pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
-            if (pkh && _pkhEq(pkh, &chain[i - 1])) return i - 1;
-        }
-    }
-    
-    return -1;
-}
+// how a transaction contributed to the wallet balance when it was applied
+typedef enum {
+    TX_BALANCE_APPLIED,
+    TX_BALANCE_INVALID,
+    TX_BALANCE_PENDING
+} BRTxBalanceState;
+
+// the balance engine state just before a transaction was applied, used to undo that transaction's effects
+typedef struct {
+    BRTxBalanceState state;
+    size_t utxoCount, spentCount, usedCount, removedCount;
+    uint64_t totalSent, totalReceived;
+} BRTxBalanceDelta;
+
+// a UTXO that was removed from wallet->utxos, and the index it was removed from
+typedef struct {
+    BRUTXO utxo;
+    size_t index;
+} BRRemovedUTXO;
 
 struct BRWalletStruct {
     uint64_t balance, totalSent, totalReceived, feePerKb, *balanceHist;
     uint32_t blockHeight;
+    size_t signThreadCount;
     BRUTXO *utxos;
     BRTransaction **transactions;
+    BRTxBalanceDelta *balanceDeltas; // one per applied transaction, parallel to balanceHist
+    const BRTxInput **spentLog; // inputs added to spentOutputs, in the order they were added
+    const uint8_t **usedLog; // pkhs added to usedPKH, in the order they were added
+    BRRemovedUTXO *removedLog; // utxos removed from the UTXO set, in the order they were removed
     BRMasterPubKey masterPubKey;
+    BRChainPubKey externalChainKey, internalChainKey;
     BRAddressParams addrParams;
     UInt160 *internalChain, *externalChain;
     BRSet *allTx, *invalidTx, *pendingTx, *spentOutputs, *usedPKH, *allPKH;
@@ -83,6 +94,23 @@ struct BRWalletStruct {
     pthread_mutex_t lock;
 };
 
+// chain position of the last address in chain that a tx output pays to, or -1 if there is none
+// wallet->allPKH holds pointers into the chain arrays, so each output is a set lookup rather than a scan of the chain
+inline static size_t _BRWalletTxChainIndex(BRWallet *wallet, const BRTransaction *tx, const UInt160 *chain)
+{
+    const uint8_t *pkh;
+    const UInt160 *p;
+    size_t i = -1;
+    
+    for (size_t j = 0; j < tx->outCount; j++) {
+        pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
+        p = (pkh) ? BRSetGet(wallet->allPKH, pkh) : NULL;
+        if (p && p >= chain && p < chain + array_count(chain) && (i == -1 || (size_t)(p - chain) > i)) i = p - chain;
+    }
+    
+    return i;
+}
+
 inline static int _BRWalletTxIsAscending(BRWallet *wallet, const BRTransaction *tx1, const BRTransaction *tx2)
 {
     if (! tx1 || ! tx2) return 0;
@@ -110,26 +138,14 @@ inline static int _BRWalletTxCompare(BRWallet *wallet, const BRTransaction *tx1,
 
     if (_BRWalletTxIsAscending(wallet, tx1, tx2)) return 1;
     if (_BRWalletTxIsAscending(wallet, tx2, tx1)) return -1;
-    if ((i = _txChainIndex(tx1, wallet->internalChain)) != -1) j = _txChainIndex(tx2, wallet->internalChain);
-    if (j == -1 && (i = _txChainIndex(tx1, wallet->externalChain)) != -1) j = _txChainIndex(tx2, wallet->externalChain);
+    if ((i = _BRWalletTxChainIndex(wallet, tx1, wallet->internalChain)) != -1)
+        j = _BRWalletTxChainIndex(wallet, tx2, wallet->internalChain);
+    if (j == -1 && (i = _BRWalletTxChainIndex(wallet, tx1, wallet->externalChain)) != -1)
+        j = _BRWalletTxChainIndex(wallet, tx2, wallet->externalChain);
     if (i != -1 && j != -1 && i != j) return (i > j) ? 1 : -1;
     return 0;
 }
 
-// inserts tx into wallet->transactions, keeping wallet->transactions sorted by date, oldest first (insertion sort)
-inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx)
-{
-    size_t i = array_count(wallet->transactions);
-    
-    array_set_count(wallet->transactions, i + 1);
-    
-    while (i > 0 && _BRWalletTxCompare(wallet, wallet->transactions[i - 1], tx) > 0) {
-        wallet->transactions[i] = wallet->transactions[i - 1];
-        i--;
-    }
-    
-    wallet->transactions[i] = tx;
-}
 
 // non-threadsafe version of BRWalletContainsTransaction()
 static int _BRWalletContainsTx(BRWallet *wallet, const BRTransaction *tx)
@@ -161,44 +177,88 @@ static int _BRWalletContainsTx(BRWallet *wallet, const BRTransaction *tx)
     return r;
 }
 
-static void _BRWalletUpdateBalance(BRWallet *wallet)
+// undoes the balance effects of wallet->transactions[idx] and every later applied transaction, most recent first
+// must be called before wallet->transactions is modified at or after idx
+static void _BRWalletRewindBalance(BRWallet *wallet, size_t idx)
 {
-    int isInvalid, isPending;
-    uint64_t balance = 0, prevBalance = 0;
-    time_t now = time(NULL);
-    size_t i, j;
-    BRTransaction *tx, *t;
-    const uint8_t *pkh;
+    size_t i = array_count(wallet->balanceHist), j;
+    const BRTxBalanceDelta *d;
     
-    array_clear(wallet->utxos);
-    array_clear(wallet->balanceHist);
-    BRSetClear(wallet->spentOutputs);
-    BRSetClear(wallet->invalidTx);
-    BRSetClear(wallet->pendingTx);
-    BRSetClear(wallet->usedPKH);
-    wallet->totalSent = 0;
-    wallet->totalReceived = 0;
-
-    for (i = 0; i < array_count(wallet->transactions); i++) {
-        tx = wallet->transactions[i];
-
-        // check if any inputs are invalid or already spent
-        if (tx->blockHeight == TX_UNCONFIRMED) {
-            for (j = 0, isInvalid = 0; ! isInvalid && j < tx->inCount; j++) {
-                if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
-                    BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash)) isInvalid = 1;
-            }
+    if (i <= idx) return;
+    
+    while (i > idx) {
+        i--;
+        d = &wallet->balanceDeltas[i];
         
-            if (isInvalid) {
-                BRSetAdd(wallet->invalidTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
-            }
+        for (j = array_count(wallet->removedLog); j > d->removedCount; j--) { // put back spent utxos where they were
+            array_insert(wallet->utxos, wallet->removedLog[j - 1].index, wallet->removedLog[j - 1].utxo);
         }
+        
+        for (j = array_count(wallet->spentLog); j > d->spentCount; j--) {
+            BRSetRemove(wallet->spentOutputs, wallet->spentLog[j - 1]);
+        }
+        
+        for (j = array_count(wallet->usedLog); j > d->usedCount; j--) {
+            BRSetRemove(wallet->usedPKH, wallet->usedLog[j - 1]);
+        }
+        
+        array_set_count(wallet->removedLog, d->removedCount);
+        array_set_count(wallet->spentLog, d->spentCount);
+        array_set_count(wallet->usedLog, d->usedCount);
+        array_set_count(wallet->utxos, d->utxoCount); // drop utxos added by the transaction
+        if (d->state == TX_BALANCE_INVALID) BRSetRemove(wallet->invalidTx, wallet->transactions[i]);
+        if (d->state == TX_BALANCE_PENDING) BRSetRemove(wallet->pendingTx, wallet->transactions[i]);
+        wallet->totalSent = d->totalSent;
+        wallet->totalReceived = d->totalReceived;
+    }
+    
+    array_set_count(wallet->balanceDeltas, idx);
+    array_set_count(wallet->balanceHist, idx);
+    wallet->balance = (idx > 0) ? wallet->balanceHist[idx - 1] : 0;
+}
+
+// removes utxos[idx] from the UTXO set, recording it so that it can be restored by _BRWalletRewindBalance()
+inline static uint64_t _BRWalletRemoveUTXO(BRWallet *wallet, size_t idx)
+{
+    BRUTXO o = wallet->utxos[idx];
+    BRTransaction *t = BRSetGet(wallet->allTx, &o.hash);
+    
+    array_add(wallet->removedLog, ((const BRRemovedUTXO) { o, idx }));
+    array_rm(wallet->utxos, idx);
+    return t->outputs[o.n].amount;
+}
+
+// applies the next transaction in wallet->transactions to the balance, UTXO set, and spent output set
+static void _BRWalletApplyTx(BRWallet *wallet, BRTransaction *tx, time_t now)
+{
+    size_t i = array_count(wallet->balanceHist), j, k, start;
+    uint64_t prevBalance = wallet->balance, balance = prevBalance;
+    BRTxBalanceDelta d = { TX_BALANCE_APPLIED, array_count(wallet->utxos), array_count(wallet->spentLog),
+                           array_count(wallet->usedLog), array_count(wallet->removedLog), wallet->totalSent,
+                           wallet->totalReceived };
+    int isInvalid = 0, isPending = 0;
+    const BRTxInput *in;
+    const uint8_t *pkh;
+    BRTransaction *t;
 
+    // check if any inputs are invalid or already spent
+    if (tx->blockHeight == TX_UNCONFIRMED) {
+        for (j = 0; ! isInvalid && j < tx->inCount; j++) {
+            if (BRSetContains(wallet->spentOutputs, &tx->inputs[j]) ||
+                BRSetContains(wallet->invalidTx, &tx->inputs[j].txHash)) isInvalid = 1;
+        }
+    }
+    
+    if (isInvalid) {
+        BRSetAdd(wallet->invalidTx, tx);
+        d.state = TX_BALANCE_INVALID;
+    }
+    else {
         // add inputs to spent output set
         for (j = 0; j < tx->inCount; j++) {
+            if (BRSetContains(wallet->spentOutputs, &tx->inputs[j])) continue;
             BRSetAdd(wallet->spentOutputs, &tx->inputs[j]);
+            array_add(wallet->spentLog, &tx->inputs[j]);
         }
 
         // check if tx is pending
@@ -217,14 +277,15 @@ static void _BRWalletUpdateBalance(BRWallet *wallet)
                 if (BRSetContains(wallet->pendingTx, &tx->inputs[j].txHash)) isPending = 1; // check for pending inputs
                 // TODO: XXX handle BIP68 check lock time verify rules
             }
-            
-            if (isPending) {
-                BRSetAdd(wallet->pendingTx, tx);
-                array_add(wallet->balanceHist, balance);
-                continue;
-            }
         }
-
+        
+        if (isPending) {
+            BRSetAdd(wallet->pendingTx, tx);
+            d.state = TX_BALANCE_PENDING;
+        }
+    }
+    
+    if (d.state == TX_BALANCE_APPLIED) {
         // add outputs to UTXO set
         // TODO: don't add outputs below TX_MIN_OUTPUT_AMOUNT
         // TODO: don't add coin generation outputs < 100 blocks deep
@@ -233,32 +294,169 @@ static void _BRWalletUpdateBalance(BRWallet *wallet)
             pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
 
             if (pkh && BRSetContains(wallet->allPKH, pkh)) {
-                BRSetAdd(wallet->usedPKH, (void *)pkh);
+                if (! BRSetContains(wallet->usedPKH, pkh)) {
+                    BRSetAdd(wallet->usedPKH, (void *)pkh);
+                    array_add(wallet->usedLog, pkh);
+                }
+                
                 array_add(wallet->utxos, ((const BRUTXO) { tx->txHash, (uint32_t)j }));
                 balance += tx->outputs[j].amount;
             }
         }
 
-        // transaction ordering is not guaranteed, so check the entire UTXO set against the entire spent output set
-        for (j = array_count(wallet->utxos); j > 0; j--) {
-            if (! BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1])) continue;
-            t = BRSetGet(wallet->allTx, &wallet->utxos[j - 1].hash);
-            balance -= t->outputs[wallet->utxos[j - 1].n].amount;
-            array_rm(wallet->utxos, j - 1);
+        // transaction ordering is not guaranteed, so a new output may already be in the spent output set
+        for (j = array_count(wallet->utxos); j > d.utxoCount; j--) {
+            if (BRSetContains(wallet->spentOutputs, &wallet->utxos[j - 1])) balance -= _BRWalletRemoveUTXO(wallet, j - 1);
+        }
+        
+        // every other utxo was checked against the spent output set when the previous tx was applied, so only outputs
+        // spent by this tx and by any pending tx applied since then need to be removed from the UTXO set
+        for (k = i; k > 0 && wallet->balanceDeltas[k - 1].state != TX_BALANCE_APPLIED; k--);
+        start = (k < i) ? wallet->balanceDeltas[k].spentCount : d.spentCount;
+        
+        for (size_t l = start; l < array_count(wallet->spentLog); l++) {
+            in = wallet->spentLog[l];
+            t = BRSetGet(wallet->allTx, &in->txHash);
+            if (! t || in->index >= t->outCount) continue;
+            pkh = BRScriptPKH(t->outputs[in->index].script, t->outputs[in->index].scriptLen);
+            if (! pkh || ! BRSetContains(wallet->allPKH, pkh)) continue;
+            
+            for (j = array_count(wallet->utxos); j > 0; j--) {
+                if (! BRUTXOEq(&wallet->utxos[j - 1], in)) continue;
+                balance -= _BRWalletRemoveUTXO(wallet, j - 1);
+                break;
+            }
         }
         
         if (prevBalance < balance) wallet->totalReceived += balance - prevBalance;
         if (balance < prevBalance) wallet->totalSent += prevBalance - balance;
-        array_add(wallet->balanceHist, balance);
-        prevBalance = balance;
+    }
+    
+    array_add(wallet->balanceDeltas, d);
+    array_add(wallet->balanceHist, balance);
+    wallet->balance = balance;
+}
+
+// brings the balance, UTXO set, and balance history up to date with wallet->transactions, replaying only the
+// transactions that were inserted, removed, or updated since the last call (see _BRWalletRewindBalance())
+static void _BRWalletUpdateBalance(BRWallet *wallet)
+{
+    time_t now = time(NULL);
+    size_t i;
+    
+    // pending checks depend on the current time and block height, so re-evaluate starting from the first pending tx
+    if (BRSetCount(wallet->pendingTx) > 0) {
+        for (i = 0; i < array_count(wallet->balanceDeltas); i++) {
+            if (wallet->balanceDeltas[i].state == TX_BALANCE_PENDING) break;
+        }
+        
+        _BRWalletRewindBalance(wallet, i);
+    }
+    
+    if (array_count(wallet->balanceHist) == 0) {
+        array_clear(wallet->utxos);
+        array_clear(wallet->spentLog);
+        array_clear(wallet->usedLog);
+        array_clear(wallet->removedLog);
+        BRSetClear(wallet->spentOutputs);
+        BRSetClear(wallet->invalidTx);
+        BRSetClear(wallet->pendingTx);
+        BRSetClear(wallet->usedPKH);
+        wallet->balance = 0;
+        wallet->totalSent = 0;
+        wallet->totalReceived = 0;
+    }
+
+    for (i = array_count(wallet->balanceHist); i < array_count(wallet->transactions); i++) {
+        _BRWalletApplyTx(wallet, wallet->transactions[i], now);
     }
 
     assert(array_count(wallet->balanceHist) == array_count(wallet->transactions));
-    wallet->balance = balance;
+}
+
+// re-applies the balance from the first applied tx with an output to any of the given (newly generated) addresses
+// returns true if the balance changed, in which case the caller must invoke balanceChanged() after releasing the lock
+static int _BRWalletUpdateBalanceForAddrs(BRWallet *wallet, const UInt160 *pkhs, size_t pkhCount)
+{
+    const BRTransaction *tx;
+    const uint8_t *pkh;
+    uint64_t balance = wallet->balance;
+    
+    for (size_t i = 0; pkhCount > 0 && i < array_count(wallet->balanceDeltas); i++) {
+        if (wallet->balanceDeltas[i].state != TX_BALANCE_APPLIED) continue;
+        tx = wallet->transactions[i];
+        
+        for (size_t j = 0; j < tx->outCount; j++) {
+            pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
+            
+            for (size_t k = 0; pkh && k < pkhCount; k++) {
+                if (! _pkhEq(pkh, &pkhs[k])) continue;
+                _BRWalletRewindBalance(wallet, i);
+                _BRWalletUpdateBalance(wallet);
+                return (wallet->balance != balance);
+            }
+        }
+    }
+    
+    return 0;
+}
+
+// wallet->transactions is sorted by blockHeight first (_BRWalletTxCompare() only orders transactions with the same
+// blockHeight by dependency and chain position), so it is an ordered index that can be binary searched by blockHeight
+// finding a tx or a height boundary is O(log n) plus the length of one height run, but inserting, removing or
+// repositioning a tx still shifts the array, and sorting within a height is an insertion sort, so those are O(n) - the
+// array stays because balanceHist and the incremental balance state are kept by position, parallel to it
+
+// index of the first tx in wallet->transactions with a blockHeight of at least blockHeight
+inline static size_t _BRWalletTxHeightIndex(BRWallet *wallet, uint32_t blockHeight)
+{
+    size_t lo = 0, hi = array_count(wallet->transactions), mid;
+    
+    while (lo < hi) {
+        mid = lo + (hi - lo)/2;
+        if (wallet->transactions[mid]->blockHeight < blockHeight) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    return lo;
+}
+
+// index of tx in wallet->transactions, or -1 if it isn't there
+// tx->blockHeight must still be the height it was inserted with
+inline static size_t _BRWalletTxIndex(BRWallet *wallet, const BRTransaction *tx)
+{
+    for (size_t i = _BRWalletTxHeightIndex(wallet, tx->blockHeight);
+         i < array_count(wallet->transactions) && wallet->transactions[i]->blockHeight == tx->blockHeight; i++) {
+        if (wallet->transactions[i] == tx) return i;
+    }
+    
+    return -1;
+}
+
+// inserts tx into wallet->transactions, keeping wallet->transactions sorted by date, oldest first
+inline static void _BRWalletInsertTx(BRWallet *wallet, BRTransaction *tx)
+{
+    size_t i = array_count(wallet->transactions), lo;
+    
+    // skip every tx with a later blockHeight, then insertion sort among those with the same blockHeight
+    if (i > 0 && wallet->transactions[i - 1]->blockHeight > tx->blockHeight) {
+        i = _BRWalletTxHeightIndex(wallet, (tx->blockHeight == UINT32_MAX) ? tx->blockHeight : tx->blockHeight + 1);
+    }
+    
+    lo = _BRWalletTxHeightIndex(wallet, tx->blockHeight);
+    while (i > lo && _BRWalletTxCompare(wallet, wallet->transactions[i - 1], tx) > 0) i--;
+    _BRWalletRewindBalance(wallet, i);
+    array_insert(wallet->transactions, i, tx);
 }
 
 // allocates and populates a BRWallet struct which must be freed by calling BRWalletFree()
 BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[], size_t txCount, BRMasterPubKey mpk)
+{
+    return BRWalletNewWithThreads(addrParams, transactions, txCount, mpk, 1);
+}
+
+BRWallet *BRWalletNewWithThreads(BRAddressParams addrParams, BRTransaction *transactions[], size_t txCount,
+                                 BRMasterPubKey mpk, size_t threadCount)
 {
     BRWallet *wallet = NULL;
     BRTransaction *tx;
@@ -270,11 +468,18 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
     array_new(wallet->utxos, 100);
     array_new(wallet->transactions, txCount + 100);
     wallet->feePerKb = DEFAULT_FEE_PER_KB;
+    wallet->signThreadCount = 1;
     wallet->masterPubKey = mpk;
+    wallet->externalChainKey = BRBIP32ChainPubKey(mpk, SEQUENCE_EXTERNAL_CHAIN);
+    wallet->internalChainKey = BRBIP32ChainPubKey(mpk, SEQUENCE_INTERNAL_CHAIN);
     wallet->addrParams = addrParams;
     array_new(wallet->internalChain, 100);
     array_new(wallet->externalChain, 100);
     array_new(wallet->balanceHist, txCount + 100);
+    array_new(wallet->balanceDeltas, txCount + 100);
+    array_new(wallet->spentLog, txCount + 100);
+    array_new(wallet->usedLog, txCount + 100);
+    array_new(wallet->removedLog, txCount + 100);
     wallet->allTx = BRSetNew(BRTransactionHash, BRTransactionEq, txCount + 100);
     wallet->invalidTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
     wallet->pendingTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
@@ -295,8 +500,8 @@ BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[],
         }
     }
     
-    BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED, SEQUENCE_EXTERNAL_CHAIN);
-    BRWalletUnusedAddrs(wallet, NULL, SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED, SEQUENCE_INTERNAL_CHAIN);
+    BRWalletGenerateAddrs(wallet, SEQUENCE_GAP_LIMIT_EXTERNAL_EXTENDED, SEQUENCE_EXTERNAL_CHAIN, threadCount);
+    BRWalletGenerateAddrs(wallet, SEQUENCE_GAP_LIMIT_INTERNAL_EXTENDED, SEQUENCE_INTERNAL_CHAIN, threadCount);
 
     _BRWalletUpdateBalance(wallet);
 
@@ -340,13 +545,16 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
 size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimit, uint32_t internal)
 {
     UInt160 *chain = NULL, *origChain;
-    size_t i, j = 0, count, startCount;
+    BRChainPubKey *cpk = NULL;
+    size_t i, j = 0, k, n, count, startCount;
+    uint64_t balance;
+    int balanceChanged = 0;
 
     assert(wallet != NULL);
     assert(gapLimit > 0);
     pthread_mutex_lock(&wallet->lock);
-    if (internal == SEQUENCE_EXTERNAL_CHAIN) chain = wallet->externalChain;
-    if (internal == SEQUENCE_INTERNAL_CHAIN) chain = wallet->internalChain;
+    if (internal == SEQUENCE_EXTERNAL_CHAIN) chain = wallet->externalChain, cpk = &wallet->externalChainKey;
+    if (internal == SEQUENCE_INTERNAL_CHAIN) chain = wallet->internalChain, cpk = &wallet->internalChainKey;
     assert(chain != NULL);
     origChain = chain;
     i = count = startCount = array_count(chain);
@@ -354,22 +562,26 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
     // keep only the trailing contiguous block of addresses with no transactions
     while (i > 0 && ! BRSetContains(wallet->usedPKH, &chain[i - 1])) i--;
     
-    while (i + gapLimit > count) { // generate new addresses up to gapLimit
-        BRKey key;
-        uint8_t pubKey[BRBIP32PubKey(NULL, 0, wallet->masterPubKey, internal, count)];
-        size_t len = BRBIP32PubKey(pubKey, sizeof(pubKey), wallet->masterPubKey, internal, (uint32_t)count);
+    while (i + gapLimit > count) { // generate new addresses up to gapLimit, a batch at a time
+        BRECPoint *pubKeys;
+        UInt160 pkh;
         
-        if (! BRKeySetPubKey(&key, pubKey, len)) break;
-        array_add(chain, BRKeyHash160(&key));
-        count++;
-        if (BRSetContains(wallet->usedPKH, &chain[array_count(chain) - 1])) i = count;
-    }
-
-    if (addrs && i + gapLimit <= count) {
-        for (j = 0; j < gapLimit; j++) {
-            BRAddressFromHash160(addrs[j].s, sizeof(*addrs), wallet->addrParams, &chain[i + j]);
+        n = i + gapLimit - count;
+        pubKeys = malloc(n*sizeof(*pubKeys));
+        assert(pubKeys != NULL);
+        BRBIP32ChainPubKeyList(pubKeys, n, *cpk, (uint32_t)count);
+        
+        for (k = 0; k < n; k++) { // derived keys are valid compressed points, so hash them directly
+            BRHash160(&pkh, pubKeys[k].p, sizeof(pubKeys[k].p));
+            array_add(chain, pkh);
+            count++;
+            if (BRSetContains(wallet->usedPKH, &chain[array_count(chain) - 1])) i = count;
         }
+        
+        free(pubKeys);
     }
+
+    if (addrs && i + gapLimit <= count) j = BRAddressesFromHash160s(addrs, wallet->addrParams, &chain[i], gapLimit);
     
     // was chain moved to a new memory location?
     if (chain == origChain) {
@@ -392,10 +604,163 @@ size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimi
         }
     }
 
+    // previously applied transactions may have outputs to the new addresses, which then count towards the balance
+    if (count > startCount) {
+        balanceChanged = _BRWalletUpdateBalanceForAddrs(wallet, &chain[startCount], count - startCount);
+    }
+    
+    balance = wallet->balance;
     pthread_mutex_unlock(&wallet->lock);
+    if (balanceChanged && wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, balance);
     return j;
 }
 
+#define ADDRS_MIN_PER_THREAD 64
+#define ADDRS_MAX_THREADS    32
+
+typedef struct {
+    BRChainPubKey cpk;
+    uint32_t start;
+    size_t count;
+    UInt160 *pkhs;
+} BRAddrsRange;
+
+static void *_BRWalletDeriveAddrsRange(void *info)
+{
+    BRAddrsRange *range = info;
+    BRECPoint *pubKeys = malloc(range->count*sizeof(*pubKeys));
+    
+    assert(pubKeys != NULL);
+    BRBIP32ChainPubKeyList(pubKeys, range->count, range->cpk, range->start);
+
+    for (size_t i = 0; i < range->count; i++) {
+        BRHash160(&range->pkhs[i], pubKeys[i].p, sizeof(pubKeys[i].p));
+    }
+    
+    free(pubKeys);
+    return NULL;
+}
+
+// derives the count chain address hashes starting at index first into pkhs, on up to threadCount threads
+static void _BRWalletDeriveAddrs(BRChainPubKey cpk, uint32_t first, size_t count, UInt160 *pkhs, size_t threadCount)
+{
+    if (threadCount > ADDRS_MAX_THREADS) threadCount = ADDRS_MAX_THREADS;
+    if (threadCount > count/ADDRS_MIN_PER_THREAD) threadCount = count/ADDRS_MIN_PER_THREAD;
+    
+    if (threadCount <= 1) {
+        BRAddrsRange range = { cpk, first, count, pkhs };
+        
+        _BRWalletDeriveAddrsRange(&range);
+    }
+    else {
+        BRAddrsRange ranges[threadCount];
+        pthread_t threads[threadCount];
+        int started[threadCount];
+        size_t i;
+        
+        for (i = 0; i < threadCount; i++) {
+            size_t lo = count*i/threadCount, hi = count*(i + 1)/threadCount;
+            
+            ranges[i] = (BRAddrsRange) { cpk, (uint32_t)(first + lo), hi - lo, &pkhs[lo] };
+            // the caller's thread takes the first range, as well as any range that couldn't get a thread of its own
+            started[i] = (i > 0 && pthread_create(&threads[i], NULL, _BRWalletDeriveAddrsRange, &ranges[i]) == 0);
+        }
+        
+        for (i = 0; i < threadCount; i++) {
+            if (! started[i]) _BRWalletDeriveAddrsRange(&ranges[i]);
+        }
+        
+        for (i = 0; i < threadCount; i++) {
+            if (started[i]) pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// generates addresses until there are gapLimit unused addresses following the last used address in the chain, leaving
+// the wallet exactly as BRWalletUnusedAddrs(wallet, NULL, gapLimit, internal) would
+// addresses are derived without holding the wallet lock, in batches split across up to threadCount threads; when the
+// wallet has used addresses, each batch runs ahead of the gap limit so a deep chain is found in a few batches, and any
+// addresses derived past the final gap are discarded
+// returns the number of new addresses added to the chain
+size_t BRWalletGenerateAddrs(BRWallet *wallet, uint32_t gapLimit, uint32_t internal, size_t threadCount)
+{
+    UInt160 *chain = NULL, *origChain, *pkhs = NULL;
+    BRChainPubKey cpk;
+    size_t i, k, first, count, startCount, origCount, batch = 0, n = 0;
+    uint64_t balance;
+    int balanceChanged = 0;
+    
+    assert(wallet != NULL);
+    assert(gapLimit > 0);
+    assert(internal == SEQUENCE_EXTERNAL_CHAIN || internal == SEQUENCE_INTERNAL_CHAIN);
+    cpk = (internal == SEQUENCE_EXTERNAL_CHAIN) ? wallet->externalChainKey : wallet->internalChainKey;
+    pthread_mutex_lock(&wallet->lock);
+    origCount = array_count((internal == SEQUENCE_EXTERNAL_CHAIN) ? wallet->externalChain : wallet->internalChain);
+    
+    while (1) {
+        chain = (internal == SEQUENCE_EXTERNAL_CHAIN) ? wallet->externalChain : wallet->internalChain;
+        i = count = startCount = array_count(chain);
+        while (i > 0 && ! BRSetContains(wallet->usedPKH, &chain[i - 1])) i--;
+        if (i + gapLimit <= count) break;
+        
+        // derive without holding the wallet lock
+        first = count;
+        batch = i + gapLimit - count;
+        if (BRSetCount(wallet->usedPKH) > 0 && threadCount > 1 && batch < threadCount*ADDRS_MIN_PER_THREAD) {
+            batch = ((threadCount < ADDRS_MAX_THREADS) ? threadCount : ADDRS_MAX_THREADS)*ADDRS_MIN_PER_THREAD;
+        }
+        
+        pthread_mutex_unlock(&wallet->lock);
+        pkhs = realloc(pkhs, batch*sizeof(*pkhs));
+        assert(pkhs != NULL);
+        _BRWalletDeriveAddrs(cpk, (uint32_t)first, batch, pkhs, threadCount);
+        pthread_mutex_lock(&wallet->lock);
+        
+        // if the chain grew while deriving, start over from its new end
+        chain = (internal == SEQUENCE_EXTERNAL_CHAIN) ? wallet->externalChain : wallet->internalChain;
+        if (array_count(chain) != first) continue;
+        origChain = chain;
+        
+        // append in index order, stopping at the gap limit just as BRWalletUnusedAddrs() would
+        for (k = 0; k < batch && i + gapLimit > count; k++) {
+            array_add(chain, pkhs[k]);
+            count++;
+            if (BRSetContains(wallet->usedPKH, &pkhs[k])) i = count;
+        }
+        
+        if (chain == origChain) {
+            for (k = startCount; k < count; k++) {
+                BRSetAdd(wallet->allPKH, &chain[k]);
+            }
+        }
+        else {
+            if (internal == SEQUENCE_EXTERNAL_CHAIN) wallet->externalChain = chain;
+            if (internal == SEQUENCE_INTERNAL_CHAIN) wallet->internalChain = chain;
+
+            BRSetClear(wallet->allPKH); // clear and rebuild allAddrs
+
+            for (k = array_count(wallet->internalChain); k > 0; k--) {
+                BRSetAdd(wallet->allPKH, &wallet->internalChain[k - 1]);
+            }
+            
+            for (k = array_count(wallet->externalChain); k > 0; k--) {
+                BRSetAdd(wallet->allPKH, &wallet->externalChain[k - 1]);
+            }
+        }
+        
+        n += count - startCount;
+    }
+    
+    // previously applied transactions may have outputs to the new addresses, which are only marked used afterwards, the
+    // same as with BRWalletUnusedAddrs()
+    if (n > 0) balanceChanged = _BRWalletUpdateBalanceForAddrs(wallet, &chain[origCount], count - origCount);
+    balance = wallet->balance;
+    pthread_mutex_unlock(&wallet->lock);
+    if (balanceChanged && wallet->balanceChanged) wallet->balanceChanged(wallet->callbackInfo, balance);
+    free(pkhs);
+    return n;
+}
+
 // current wallet balance, not including transactions known to be invalid
 uint64_t BRWalletBalance(BRWallet *wallet)
 {
@@ -449,7 +814,7 @@ size_t BRWalletTxUnconfirmedBefore(BRWallet *wallet, BRTransaction *transactions
     assert(wallet != NULL);
     pthread_mutex_lock(&wallet->lock);
     total = array_count(wallet->transactions);
-    while (n < total && wallet->transactions[(total - n) - 1]->blockHeight >= blockHeight) n++;
+    n = total - _BRWalletTxHeightIndex(wallet, blockHeight);
     if (! transactions || n < txCount) txCount = n;
 
     for (size_t i = 0; transactions && i < txCount; i++) {
@@ -504,6 +869,16 @@ void BRWalletSetFeePerKb(BRWallet *wallet, uint64_t feePerKb)
     pthread_mutex_unlock(&wallet->lock);
 }
 
+// number of threads BRWalletSignTransaction() uses to sign inputs, 1 (the default) to sign them all on the caller's
+// thread
+void BRWalletSetSignThreadCount(BRWallet *wallet, size_t threadCount)
+{
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    wallet->signThreadCount = (threadCount > 0) ? threadCount : 1;
+    pthread_mutex_unlock(&wallet->lock);
+}
+
 BRAddressParams BRWalletGetAddressParams (BRWallet *wallet) {
     return wallet->addrParams;
 }
@@ -548,23 +923,19 @@ BRAddress BRWalletAddressToLegacy (BRWallet *wallet, BRAddress *addrPtr) {
 // returns the number addresses written, or total number available if addrs is NULL
 size_t BRWalletAllAddrs(BRWallet *wallet, BRAddress addrs[], size_t addrsCount)
 {
-    size_t i, internalCount = 0, externalCount = 0;
+    size_t internalCount = 0, externalCount = 0;
     
     assert(wallet != NULL);
     pthread_mutex_lock(&wallet->lock);
     internalCount = (! addrs || array_count(wallet->internalChain) < addrsCount) ?
                     array_count(wallet->internalChain) : addrsCount;
 
-    for (i = 0; addrs && i < internalCount; i++) {
-        BRAddressFromHash160(addrs[i].s, sizeof(*addrs), wallet->addrParams, &wallet->internalChain[i]);
-    }
+    if (addrs) BRAddressesFromHash160s(addrs, wallet->addrParams, wallet->internalChain, internalCount);
 
     externalCount = (! addrs || array_count(wallet->externalChain) < addrsCount - internalCount) ?
                     array_count(wallet->externalChain) : addrsCount - internalCount;
 
-    for (i = 0; addrs && i < externalCount; i++) {
-        BRAddressFromHash160(addrs[internalCount + i].s, sizeof(*addrs), wallet->addrParams, &wallet->externalChain[i]);
-    }
+    if (addrs) BRAddressesFromHash160s(&addrs[internalCount], wallet->addrParams, wallet->externalChain, externalCount);
 
     pthread_mutex_unlock(&wallet->lock);
     return internalCount + externalCount;
@@ -732,7 +1103,7 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
 int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed, size_t seedLen)
 {
     uint32_t j, internalIdx[tx->inCount], externalIdx[tx->inCount];
-    size_t i, internalCount = 0, externalCount = 0;
+    size_t i, internalCount = 0, externalCount = 0, threadCount;
     int r = 0;
     
     assert(wallet != NULL);
@@ -751,6 +1122,7 @@ int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId,
         }
     }
 
+    threadCount = wallet->signThreadCount;
     pthread_mutex_unlock(&wallet->lock);
 
     BRKey keys[internalCount + externalCount];
@@ -760,7 +1132,7 @@ int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId,
         BRBIP32PrivKeyList(&keys[internalCount], externalCount, seed, seedLen, SEQUENCE_EXTERNAL_CHAIN, externalIdx);
         // TODO: XXX wipe seed callback
         seed = NULL;
-        if (tx) r = BRTransactionSign(tx, forkId, keys, internalCount + externalCount);
+        if (tx) r = BRTransactionSignWithThreads(tx, forkId, keys, internalCount + externalCount, threadCount);
         for (i = 0; i < internalCount + externalCount; i++) BRKeyClean(&keys[i]);
     }
     else r = -1; // user canceled authentication
@@ -862,10 +1234,11 @@ void BRWalletRemoveTransaction(BRWallet *wallet, UInt256 txHash)
             BRWalletRemoveTransaction(wallet, txHash);
         }
         else {
-            for (size_t i = array_count(wallet->transactions); i > 0; i--) {
-                if (! BRTransactionEq(wallet->transactions[i - 1], tx)) continue;
-                array_rm(wallet->transactions, i - 1);
-                break;
+            size_t i = _BRWalletTxIndex(wallet, tx);
+            
+            if (i != -1) {
+                _BRWalletRewindBalance(wallet, i);
+                array_rm(wallet->transactions, i);
             }
             
             _BRWalletUpdateBalance(wallet);
@@ -1062,7 +1435,6 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
     UInt256 hashesBuf[4096];
     UInt256 *hashes = (txCount <= 4096 ? hashesBuf : calloc (txCount, sizeof (UInt256)));
 
-    int needsUpdate = 0;
     size_t i, j, k;
     
     assert(wallet != NULL);
@@ -1073,19 +1445,18 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
     for (i = 0, j = 0; txHashes && i < txCount; i++) {
         tx = BRSetGet(wallet->allTx, &txHashes[i]);
         if (! tx || (tx->blockHeight == blockHeight && tx->timestamp == timestamp)) continue;
+        k = _BRWalletTxIndex(wallet, tx); // find tx before its blockHeight changes
         tx->timestamp = timestamp;
         tx->blockHeight = blockHeight;
         
         if (_BRWalletContainsTx(wallet, tx)) {
-            for (k = array_count(wallet->transactions); k > 0; k--) { // remove and re-insert tx to keep wallet sorted
-                if (! BRTransactionEq(wallet->transactions[k - 1], tx)) continue;
-                array_rm(wallet->transactions, k - 1);
+            if (k != -1) { // remove and re-insert tx to keep wallet sorted
+                _BRWalletRewindBalance(wallet, k);
+                array_rm(wallet->transactions, k);
                 _BRWalletInsertTx(wallet, tx);
-                break;
             }
             
             hashes[j++] = txHashes[i];
-            if (BRSetContains(wallet->pendingTx, tx) || BRSetContains(wallet->invalidTx, tx)) needsUpdate = 1;
         }
         else if (blockHeight != TX_UNCONFIRMED) { // remove and free confirmed non-wallet tx
             BRSetRemove(wallet->allTx, tx);
@@ -1093,7 +1464,7 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
         }
     }
     
-    if (needsUpdate) _BRWalletUpdateBalance(wallet);
+    _BRWalletUpdateBalance(wallet); // only replays transactions that were moved, or that are pending
     pthread_mutex_unlock(&wallet->lock);
     if (j > 0 && wallet->txUpdated) wallet->txUpdated(wallet->callbackInfo, hashes, j, blockHeight, timestamp);
     if (hashes != hashesBuf) free (hashes);
@@ -1107,24 +1478,159 @@ void BRWalletSetTxUnconfirmedAfter(BRWallet *wallet, uint32_t blockHeight)
     assert(wallet != NULL);
     pthread_mutex_lock(&wallet->lock);
     wallet->blockHeight = blockHeight;
-    count = i = array_count(wallet->transactions);
-    while (i > 0 && wallet->transactions[i - 1]->blockHeight > blockHeight) i--;
+    count = array_count(wallet->transactions);
+    i = (blockHeight < UINT32_MAX) ? _BRWalletTxHeightIndex(wallet, blockHeight + 1) : count;
     count -= i;
 
     UInt256 hashesBuf[4096];
     UInt256 *hashes = (count <= 4096 ? hashesBuf : calloc (count, sizeof (UInt256)));
 
+    _BRWalletRewindBalance(wallet, i);
+
     for (j = 0; j < count; j++) {
         wallet->transactions[i + j]->blockHeight = TX_UNCONFIRMED;
         hashes[j] = wallet->transactions[i + j]->txHash;
     }
     
-    if (count > 0) _BRWalletUpdateBalance(wallet);
+    _BRWalletUpdateBalance(wallet);
     pthread_mutex_unlock(&wallet->lock);
     if (count > 0 && wallet->txUpdated) wallet->txUpdated(wallet->callbackInfo, hashes, count, TX_UNCONFIRMED, 0);
     if (hashes != hashesBuf) free (hashes);
 }
 
+// discards the incrementally maintained balance state and replays every registered transaction from the start
+// the result is always identical to the incremental state; this is only useful to verify or benchmark it
+void BRWalletRebuildBalance(BRWallet *wallet)
+{
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    _BRWalletRewindBalance(wallet, 0);
+    _BRWalletUpdateBalance(wallet);
+    pthread_mutex_unlock(&wallet->lock);
+}
+
+// recomputes the balance, balance history, UTXO set, spent outputs, used addresses, and invalid and pending transactions
+// from scratch in a single pass over every registered transaction, without using any incrementally maintained state
+// returns true if the result is identical to the wallet's current state; this is only useful to verify that state
+int BRWalletVerifyBalance(BRWallet *wallet)
+{
+    BRUTXO *utxos;
+    BRSet *spentOutputs, *invalidTx, *pendingTx, *usedPKH;
+    uint64_t balance = 0, prevBalance, totalSent = 0, totalReceived = 0;
+    time_t now = time(NULL);
+    BRTransaction *tx, *t;
+    const uint8_t *pkh;
+    size_t i, j, k, count;
+    int isInvalid, isPending, r = 1;
+    
+    assert(wallet != NULL);
+    pthread_mutex_lock(&wallet->lock);
+    count = array_count(wallet->transactions);
+    array_new(utxos, 100);
+    spentOutputs = BRSetNew(BRUTXOHash, BRUTXOEq, count + 100);
+    invalidTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
+    pendingTx = BRSetNew(BRTransactionHash, BRTransactionEq, 10);
+    usedPKH = BRSetNew(_pkhHash, _pkhEq, count + 100);
+    if (array_count(wallet->balanceHist) != count) r = 0;
+    
+    for (i = 0; r && i < count; i++) {
+        tx = wallet->transactions[i];
+        isInvalid = isPending = 0;
+        prevBalance = balance;
+        
+        // check if any inputs are invalid or already spent
+        if (tx->blockHeight == TX_UNCONFIRMED) {
+            for (j = 0; ! isInvalid && j < tx->inCount; j++) {
+                if (BRSetContains(spentOutputs, &tx->inputs[j]) ||
+                    BRSetContains(invalidTx, &tx->inputs[j].txHash)) isInvalid = 1;
+            }
+        }
+        
+        if (isInvalid) BRSetAdd(invalidTx, tx);
+        
+        for (j = 0; ! isInvalid && j < tx->inCount; j++) { // add inputs to spent output set
+            BRSetAdd(spentOutputs, &tx->inputs[j]);
+        }
+        
+        // check if tx is pending
+        if (! isInvalid && tx->blockHeight == TX_UNCONFIRMED) {
+            isPending = (BRTransactionVSize(tx) > TX_MAX_SIZE) ? 1 : 0;
+            
+            for (j = 0; ! isPending && j < tx->outCount; j++) {
+                if (tx->outputs[j].amount < TX_MIN_OUTPUT_AMOUNT) isPending = 1;
+            }
+            
+            for (j = 0; ! isPending && j < tx->inCount; j++) {
+                if (tx->inputs[j].sequence < UINT32_MAX - 1) isPending = 1;
+                if (tx->inputs[j].sequence < UINT32_MAX && tx->lockTime < TX_MAX_LOCK_HEIGHT &&
+                    tx->lockTime > wallet->blockHeight + 1) isPending = 1;
+                if (tx->inputs[j].sequence < UINT32_MAX && tx->lockTime > now) isPending = 1;
+                if (BRSetContains(pendingTx, &tx->inputs[j].txHash)) isPending = 1;
+            }
+            
+            if (isPending) BRSetAdd(pendingTx, tx);
+        }
+        
+        if (! isInvalid && ! isPending) {
+            for (j = 0; j < tx->outCount; j++) { // add outputs to UTXO set
+                pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
+                if (! pkh || ! BRSetContains(wallet->allPKH, pkh)) continue;
+                BRSetAdd(usedPKH, (void *)pkh);
+                array_add(utxos, ((const BRUTXO) { tx->txHash, (uint32_t)j }));
+                balance += tx->outputs[j].amount;
+            }
+            
+            // check the entire UTXO set against the entire spent output set
+            for (j = array_count(utxos); j > 0; j--) {
+                if (! BRSetContains(spentOutputs, &utxos[j - 1])) continue;
+                t = BRSetGet(wallet->allTx, &utxos[j - 1].hash);
+                balance -= t->outputs[utxos[j - 1].n].amount;
+                array_rm(utxos, j - 1);
+            }
+            
+            if (prevBalance < balance) totalReceived += balance - prevBalance;
+            if (balance < prevBalance) totalSent += prevBalance - balance;
+        }
+        
+        if (wallet->balanceHist[i] != balance) r = 0;
+    }
+    
+    if (r && (balance != wallet->balance || totalSent != wallet->totalSent ||
+              totalReceived != wallet->totalReceived || array_count(utxos) != array_count(wallet->utxos) ||
+              BRSetCount(spentOutputs) != BRSetCount(wallet->spentOutputs) ||
+              BRSetCount(invalidTx) != BRSetCount(wallet->invalidTx) ||
+              BRSetCount(pendingTx) != BRSetCount(wallet->pendingTx) ||
+              BRSetCount(usedPKH) != BRSetCount(wallet->usedPKH))) r = 0;
+    
+    for (k = 0; r && k < array_count(utxos); k++) { // the UTXO set order determines coin selection, so it must match
+        if (! BRUTXOEq(&utxos[k], &wallet->utxos[k])) r = 0;
+    }
+    
+    for (i = 0; r && i < count; i++) {
+        tx = wallet->transactions[i];
+        if (BRSetContains(invalidTx, tx) != BRSetContains(wallet->invalidTx, tx) ||
+            BRSetContains(pendingTx, tx) != BRSetContains(wallet->pendingTx, tx)) r = 0;
+        
+        for (j = 0; r && j < tx->inCount; j++) {
+            if (BRSetContains(spentOutputs, &tx->inputs[j]) != BRSetContains(wallet->spentOutputs, &tx->inputs[j]))
+                r = 0;
+        }
+        
+        for (j = 0; r && j < tx->outCount; j++) {
+            pkh = BRScriptPKH(tx->outputs[j].script, tx->outputs[j].scriptLen);
+            if (pkh && BRSetContains(usedPKH, pkh) && ! BRSetContains(wallet->usedPKH, pkh)) r = 0;
+        }
+    }
+    
+    pthread_mutex_unlock(&wallet->lock);
+    BRSetFree(usedPKH);
+    BRSetFree(pendingTx);
+    BRSetFree(invalidTx);
+    BRSetFree(spentOutputs);
+    array_free(utxos);
+    return r;
+}
+
 // returns the amount received by the wallet from the transaction (total outputs to change and/or receive addresses)
 uint64_t BRWalletAmountReceivedFromTx(BRWallet *wallet, const BRTransaction *tx)
 {
@@ -1206,12 +1712,10 @@ uint64_t BRWalletBalanceAfterTx(BRWallet *wallet, const BRTransaction *tx)
     assert(tx != NULL && BRTransactionIsSigned(tx));
     pthread_mutex_lock(&wallet->lock);
     balance = wallet->balance;
+    tx = (tx) ? BRSetGet(wallet->allTx, tx) : NULL; // the registered tx, in case tx is a copy
     
-    for (size_t i = array_count(wallet->transactions); tx && i > 0; i--) {
-        if (! BRTransactionEq(tx, wallet->transactions[i - 1])) continue;
-        balance = wallet->balanceHist[i - 1];
-        break;
-    }
+    size_t i = (tx) ? _BRWalletTxIndex(wallet, tx) : -1;
+    if (i != -1) balance = wallet->balanceHist[i];
 
     pthread_mutex_unlock(&wallet->lock);
     return balance;
@@ -1340,6 +1844,10 @@ void BRWalletFree(BRWallet *wallet)
     array_free(wallet->internalChain);
     array_free(wallet->externalChain);
     array_free(wallet->balanceHist);
+    array_free(wallet->balanceDeltas);
+    array_free(wallet->spentLog);
+    array_free(wallet->usedLog);
+    array_free(wallet->removedLog);
     array_free(wallet->transactions);
     array_free(wallet->utxos);
     pthread_mutex_unlock(&wallet->lock);
@@ -61,6 +61,11 @@ typedef struct BRWalletStruct BRWallet;
 // allocates and populates a BRWallet struct that must be freed by calling BRWalletFree()
 BRWallet *BRWalletNew(BRAddressParams addrParams, BRTransaction *transactions[], size_t txCount, BRMasterPubKey mpk);
 
+// same as BRWalletNew(), but derives the address chains of a wallet restored from transactions on up to threadCount
+// threads
+BRWallet *BRWalletNewWithThreads(BRAddressParams addrParams, BRTransaction *transactions[], size_t txCount,
+                                 BRMasterPubKey mpk, size_t threadCount);
+
 // not thread-safe, set callbacks once after BRWalletNew(), before calling other BRWallet functions
 // info is a void pointer that will be passed along with each callback call
 // void balanceChanged(void *, uint64_t) - called when the wallet balance changes
@@ -83,6 +88,12 @@ void BRWalletSetCallbacks(BRWallet *wallet, void *info,
 // returns the number addresses written to addrs
 size_t BRWalletUnusedAddrs(BRWallet *wallet, BRAddress addrs[], uint32_t gapLimit, uint32_t internal);
 
+// generates addresses until there are gapLimit unused addresses following the last used address in the chain, leaving
+// the wallet exactly as BRWalletUnusedAddrs(wallet, NULL, gapLimit, internal) would
+// the addresses are derived on up to threadCount threads, for fast restore of wallets with deep address chains
+// returns the number of new addresses added to the chain
+size_t BRWalletGenerateAddrs(BRWallet *wallet, uint32_t gapLimit, uint32_t internal, size_t threadCount);
+
 BRAddressParams BRWalletGetAddressParams (BRWallet *wallet);
 
 // returns the first unused external address (bech32 pay-to-witness-pubkey-hash)
@@ -159,6 +170,11 @@ BRTransaction *BRWalletCreateTxForOutputsWithFeePerKb(BRWallet *wallet, uint64_t
 // returns true if all inputs were signed, or false if there was an error or not all inputs were able to be signed
 int BRWalletSignTransaction(BRWallet *wallet, BRTransaction *tx, uint8_t forkId, const void *seed, size_t seedLen);
 
+// number of threads BRWalletSignTransaction() uses to sign inputs, 1 (the default) to sign them all on the caller's
+// thread
+// signatures are deterministic, so the signed tx is the same for any thread count
+void BRWalletSetSignThreadCount(BRWallet *wallet, size_t threadCount);
+
 // true if the given transaction is associated with the wallet (even if it hasn't been registered)
 int BRWalletContainsTransaction(BRWallet *wallet, const BRTransaction *tx);
 
@@ -194,6 +210,14 @@ void BRWalletUpdateTransactions(BRWallet *wallet, const UInt256 txHashes[], size
 // marks all transactions confirmed after blockHeight as unconfirmed (useful for chain re-orgs)
 void BRWalletSetTxUnconfirmedAfter(BRWallet *wallet, uint32_t blockHeight);
 
+// discards the incrementally maintained balance state and replays every registered transaction from the start
+// the result is always identical to the incremental state; this is only useful to verify or benchmark it
+void BRWalletRebuildBalance(BRWallet *wallet);
+
+// recomputes the balance, balance history, UTXO set, and invalid and pending transactions from scratch, without using
+// any incrementally maintained state, and returns true if the result matches the wallet's current state
+int BRWalletVerifyBalance(BRWallet *wallet);
+
 // returns the amount received by the wallet from the transaction (total outputs to change and/or receive addresses)
 uint64_t BRWalletAmountReceivedFromTx(BRWallet *wallet, const BRTransaction *tx);
 
@@ -19,6 +19,7 @@
 #include "BRWalletManagerPrivate.h"
 #include "BRPeerManager.h"
 #include "BRMerkleBlock.h"
+#include "BRHeaderStore.h"
 #include "support/BRBase58.h"
 #include "BRChainParams.h"
 #include "bcash/BRBCashParams.h"
@@ -31,6 +32,9 @@
 #define BWM_SLEEP_SECONDS                        (1)
 #define BWM_SYNC_AFTER_WAKEUPS                   (60)
 
+// threads used to derive the wallet address chains when restoring from stored transactions
+#define BWM_WALLET_RESTORE_THREAD_COUNT          (4)
+
 // default to TRUE in case client's don't bother updating this value
 #define DEFAULT_NETWORK_IS_REACHABLE             (1)
 
@@ -671,25 +675,29 @@ fileServiceTypeTransactionV1Reader (BRFileServiceContext context,
     return transaction;
 }
 
+// Entities are unique by identifier in the fileService; append each directly, w/o a BRSet.
+static int
+initialEntitiesLoadHandler (BRFileServiceContext context,
+                            BRFileService fs,
+                            void *entity) {
+    BRArrayOf(void*) *entities = (BRArrayOf(void*) *) context;
+    array_add (*entities, entity);
+    return 1;
+}
+
 static BRArrayOf(BRTransaction*)
 initialTransactionsLoad (BRWalletManager manager) {
-    BRSetOf(BRTransaction*) transactionSet = BRSetNew(BRTransactionHash, BRTransactionEq, 100);
-    if (1 != fileServiceLoad (manager->fileService, transactionSet, fileServiceTypeTransactions, 1)) {
-        BRSetFreeAll(transactionSet, (void (*) (void*)) BRTransactionFree);
+    BRArrayOf(BRTransaction*) transactions;
+    array_new (transactions, 100);
+
+    if (1 != fileServiceLoadEach (manager->fileService, fileServiceTypeTransactions, 1,
+                                  &transactions, initialEntitiesLoadHandler)) {
+        array_free_all (transactions, BRTransactionFree);
         _peer_log ("BWM: failed to load transactions");
         return NULL;
     }
 
-    size_t transactionsCount = BRSetCount(transactionSet);
-
-    BRArrayOf(BRTransaction*) transactions;
-    array_new (transactions, transactionsCount);
-    array_set_count(transactions, transactionsCount);
-
-    BRSetAll(transactionSet, (void**) transactions, transactionsCount);
-    BRSetFree(transactionSet);
-
-    _peer_log ("BWM: loaded %zu transactions\n", transactionsCount);
+    _peer_log ("BWM: loaded %zu transactions\n", array_count (transactions));
     return transactions;
 }
 
@@ -756,25 +764,119 @@ fileServiceTypeBlockV1Reader (BRFileServiceContext context,
     return block;
 }
 
+/// MARK: - Header Store
+
+static char *
+headerStoreCreatePath (const char *baseStoragePath,
+                       const char *currencyName,
+                       const char *networkName) {
+    size_t pathLength = strlen (baseStoragePath) + strlen (currencyName) + strlen (networkName) + strlen ("//--headers") + 1;
+    char *path = malloc (pathLength);
+    snprintf (path, pathLength, "%s/%s-%s-headers", baseStoragePath, currencyName, networkName);
+    return path;
+}
+
+static int
+headerStoreBlockHeightCompareDescending (const void *b1, const void *b2) {
+    uint32_t h1 = (*(const BRMerkleBlock **) b1)->height;
+    uint32_t h2 = (*(const BRMerkleBlock **) b2)->height;
+    return (h1 > h2 ? -1 : (h1 < h2 ? 1 : 0));
+}
+
+// Blocks arrive from the BRPeerManager in descending height order; the header store wants them
+// in ascending order, each connecting to the one before it.  Returns 1 if the store holds
+// `blocks`, in which case the file service need not.  Otherwise returns 0 and the caller saves
+// `blocks` to the file service; if the store failed, its recent blocks are moved to the file
+// service and the store is cleared - it restarts at a later difficulty transition.
+static int
+headerStoreAddBlocks (BRWalletManager manager,
+                      BRMerkleBlock **blocks,
+                      size_t blocksCount,
+                      int replace) {
+    BRHeaderStore *store = manager->headerStore;
+    if (NULL == store) return 0;
+
+    // Nothing to add; a replace clears the store, and the file service, of all blocks.
+    if (0 == blocksCount) {
+        if (replace) BRHeaderStoreClear (store);
+        return 0;
+    }
+
+    int added = 1;
+    for (size_t index = blocksCount; added && index > 0; index--)
+        added = BRHeaderStoreAdd (store, blocks[index - 1]);
+
+    if (added) {
+        if (replace) BRHeaderStoreRewind (store, blocks[0]->height);
+        return 1;
+    }
+
+    _peer_log ("BWM: header store failed to add blocks; saving to the file service\n");
+
+    // A replace overwrites everything in the file service anyway.
+    size_t recentCount = (replace ? 0 : BRHeaderStoreRecentBlocks (store, NULL, 0));
+    if (recentCount > 0) {
+        BRArrayOf(BRMerkleBlock*) recent;
+        array_new (recent, recentCount);
+        array_set_count (recent, BRHeaderStoreRecentBlocks (store, recent, recentCount));
+
+        fileServiceReplace (manager->fileService, fileServiceTypeBlocks,
+                            (const void **) recent,
+                            array_count (recent));
+        array_free_all (recent, BRMerkleBlockFree);
+    }
+
+    BRHeaderStoreClear (store);
+    return 0;
+}
+
+// An empty header store, say one just created, starts with the blocks from the file service.
+static void
+headerStoreSeedBlocks (BRWalletManager manager,
+                       BRArrayOf(BRMerkleBlock*) blocks) {
+    if (NULL == manager->headerStore || 0 != BRHeaderStoreCount (manager->headerStore)) return;
+
+    BRArrayOf(BRMerkleBlock*) sorted;
+    array_new (sorted, MAX (1, array_count (blocks)));
+    array_add_array (sorted, blocks, array_count (blocks));
+    qsort (sorted, array_count (sorted), sizeof (BRMerkleBlock*), headerStoreBlockHeightCompareDescending);
+
+    // As a replace, a failure leaves the file service as is.
+    if (headerStoreAddBlocks (manager, sorted, array_count (sorted), 1))
+        _peer_log ("BWM: seeded header store with %zu blocks\n", array_count (sorted));
+
+    array_free (sorted);
+}
+
 static BRArrayOf(BRMerkleBlock*)
 initialBlocksLoad (BRWalletManager manager) {
-    BRSetOf(BRMerkleBlock*) blockSet = BRSetNew(BRMerkleBlockHash, BRMerkleBlockEq, 100);
-    if (1 != fileServiceLoad (manager->fileService, blockSet, fileServiceTypeBlocks, 1)) {
-        BRSetFreeAll(blockSet, (void (*) (void*)) BRMerkleBlockFree);
-        _peer_log ("BWM: failed to load blocks");
-        return NULL;
+    BRArrayOf(BRMerkleBlock*) blocks;
+
+    // Prefer the header store; the file service holds the same blocks but each must be parsed
+    // and hashed.  An empty store (say, one just created) falls back to the file service.
+    size_t blocksCount = (NULL != manager->headerStore
+                          ? BRHeaderStoreRecentBlocks (manager->headerStore, NULL, 0)
+                          : 0);
+    if (blocksCount > 0) {
+        array_new (blocks, blocksCount);
+        array_set_count (blocks, BRHeaderStoreRecentBlocks (manager->headerStore, blocks, blocksCount));
+
+        _peer_log ("BWM: loaded %zu blocks from header store\n", array_count (blocks));
+        return blocks;
     }
 
-    size_t blocksCount = BRSetCount(blockSet);
+    array_new (blocks, 100);
 
-    BRArrayOf(BRMerkleBlock*) blocks;
-    array_new (blocks, blocksCount);
-    array_set_count(blocks, blocksCount);
+    if (1 != fileServiceLoadEach (manager->fileService, fileServiceTypeBlocks, 1,
+                                  &blocks, initialEntitiesLoadHandler)) {
+        array_free_all (blocks, BRMerkleBlockFree);
+        _peer_log ("BWM: failed to load blocks");
+        return NULL;
+    }
 
-    BRSetAll(blockSet, (void**) blocks, blocksCount);
-    BRSetFree(blockSet);
+    _peer_log ("BWM: loaded %zu blocks\n", array_count (blocks));
 
-    _peer_log ("BWM: loaded %zu blocks\n", blocksCount);
+    headerStoreSeedBlocks (manager, blocks);
     return blocks;
 }
 
@@ -979,6 +1081,10 @@ bwmCreateErrorHandler (BRWalletManager bwm, int fileService, const char* reason)
             BRSyncManagerFree (bwm->syncManager);
         }
 
+        if (NULL != bwm->headerStore) {
+            BRHeaderStoreClose (bwm->headerStore);
+        }
+
         if (NULL != bwm->transactions) {
             BRWalletManagerFreeTransactions (bwm);
         }
@@ -1057,6 +1163,17 @@ BRWalletManagerNew (BRWalletManagerClient client,
         return bwmCreateErrorHandler (bwm, 1, "create");
     }
 
+    // Sync writes blocks and transactions in bursts; avoid an fsync on every commit.  Neither
+    // is required - on failure we'll persist with SQLite's defaults.
+    fileServiceSetJournalMode (bwm->fileService, FILE_SERVICE_JOURNAL_MODE_WAL);
+    fileServiceSetSynchronous (bwm->fileService, FILE_SERVICE_SYNCHRONOUS_NORMAL);
+
+    // The header store is optional; without it blocks are loaded from the file service.
+    char *headerStorePath = headerStoreCreatePath (baseStoragePath, currencyName, networkName);
+    bwm->headerStore = BRHeaderStoreOpen (headerStorePath);
+    if (NULL == bwm->headerStore) _peer_log ("BWM: failed to open header store: %s\n", headerStorePath);
+    free (headerStorePath);
+
     /// Load transactions for the wallet manager.
     BRArrayOf(BRTransaction*) transactions = initialTransactionsLoad(bwm);
     /// Load blocks and peers for the peer manager.
@@ -1081,7 +1198,8 @@ BRWalletManagerNew (BRWalletManagerClient client,
 
     // Create the Wallet being managed and populate with the loaded transactions
     _peer_log ("BWM: initializing wallet with %zu transactions\n", array_count(transactions));
-    bwm->wallet = BRWalletNew (params->addrParams, transactions, array_count(transactions), mpk);
+    bwm->wallet = BRWalletNewWithThreads (params->addrParams, transactions, array_count(transactions), mpk,
+                                          BWM_WALLET_RESTORE_THREAD_COUNT);
     if (NULL == bwm->wallet) {
         array_free(transactions); array_free(blocks); array_free(peers);
         return bwmCreateErrorHandler (bwm, 0, "wallet");
@@ -1115,6 +1233,8 @@ BRWalletManagerNew (BRWalletManagerClient client,
                                                 DEFAULT_NETWORK_IS_REACHABLE,
                                                 blocks, array_count(blocks),
                                                 peers,  array_count(peers));
+    if (NULL != bwm->headerStore) BRSyncManagerSetHeaderStore (bwm->syncManager, bwm->headerStore);
+    BRSyncManagerSetCompactFilterSync (bwm->syncManager, bwm->compactFilterSync);
 
     // No longer need the loaded txns/blocks/peers
     array_free(transactions); array_free(blocks); array_free(peers);
@@ -1195,6 +1315,7 @@ BRWalletManagerFree (BRWalletManager manager) {
         BRWalletManagerFreeTransactions (manager);
         eventHandlerDestroy (manager->handler);
         fileServiceRelease (manager->fileService);
+        if (NULL != manager->headerStore) BRHeaderStoreClose (manager->headerStore);
     }
     pthread_mutex_unlock (&manager->lock);
 
@@ -1253,12 +1374,25 @@ BRWalletManagerSetFixedPeer (BRWalletManager manager,
     pthread_mutex_unlock (&manager->lock);
 }
 
+extern void
+BRWalletManagerSetCompactFilterSync (BRWalletManager manager,
+                                     int enabled) {
+    pthread_mutex_lock (&manager->lock);
+    manager->compactFilterSync = enabled;
+    BRSyncManagerSetCompactFilterSync (manager->syncManager, enabled);
+    pthread_mutex_unlock (&manager->lock);
+}
+
 extern void
 BRWalletManagerWipe (const BRChainParams *params,
                       const char *baseStoragePath) {
     const char *networkName  = getNetworkName  (params);
     const char *currencyName = getCurrencyName (params);
     fileServiceWipe (baseStoragePath, currencyName, networkName);
+
+    char *headerStorePath = headerStoreCreatePath (baseStoragePath, currencyName, networkName);
+    remove (headerStorePath);
+    free (headerStorePath);
 }
 
 extern void
@@ -1342,6 +1476,8 @@ BRWalletManagerSetMode (BRWalletManager manager, BRCryptoSyncMode mode) {
                                                         isNetworkReachable,
                                                         blocks, array_count (blocks),
                                                         peers, array_count (peers));
+        if (NULL != manager->headerStore) BRSyncManagerSetHeaderStore (manager->syncManager, manager->headerStore);
+        BRSyncManagerSetCompactFilterSync (manager->syncManager, manager->compactFilterSync);
 
         // No longer need the loaded blocks/peers
         array_free(blocks); array_free(peers);
@@ -1677,6 +1813,9 @@ _BRWalletManagerTxUpdated (void *info,
                            uint32_t timestamp) {
     BRWalletManager manager = (BRWalletManager) info;
 
+    // Save all the updated transactions in one DB transaction
+    fileServiceBeginBatch (manager->fileService);
+
     for (size_t index = 0; index < count; index++) {
         BRTransaction *transaction = BRWalletTransactionCopyForHash(manager->wallet, hashes[index]);
         if (NULL != transaction) {
@@ -1689,6 +1828,8 @@ _BRWalletManagerTxUpdated (void *info,
             BRTransactionFree (transaction);
         }
     }
+
+    fileServiceCommitBatch (manager->fileService);
 }
 
 static void
@@ -1933,16 +2074,21 @@ _BRWalletManagerSyncEvent(void * context,
     BRWalletManager bwm = (BRWalletManager) context;
     switch (event.type) {
         case SYNC_MANAGER_SET_BLOCKS: {
-            // filesystem changes are NOT queued; they are acted upon immediately
-            fileServiceReplace (bwm->fileService, fileServiceTypeBlocks,
-                                (const void **) event.u.blocks.blocks,
-                                event.u.blocks.count);
+            // filesystem changes are NOT queued; they are acted upon immediately.  The file
+            // service only holds blocks that the header store doesn't.
+            if (!headerStoreAddBlocks (bwm, event.u.blocks.blocks, event.u.blocks.count, 1))
+                fileServiceReplace (bwm->fileService, fileServiceTypeBlocks,
+                                    (const void **) event.u.blocks.blocks,
+                                    event.u.blocks.count);
             break;
         }
         case SYNC_MANAGER_ADD_BLOCKS: {
-            // filesystem changes are NOT queued; they are acted upon immediately
-            for (size_t index = 0; index < event.u.blocks.count; index++)
-                fileServiceSave (bwm->fileService, fileServiceTypeBlocks, event.u.blocks.blocks[index]);
+            // filesystem changes are NOT queued; they are acted upon immediately.  The file
+            // service only holds blocks that the header store doesn't.
+            if (!headerStoreAddBlocks (bwm, event.u.blocks.blocks, event.u.blocks.count, 0))
+                fileServiceSaveMany (bwm->fileService, fileServiceTypeBlocks,
+                                     (const void **) event.u.blocks.blocks,
+                                     event.u.blocks.count);
             break;
         }
         case SYNC_MANAGER_SET_PEERS: {
@@ -1969,8 +2115,20 @@ _BRWalletManagerSyncEvent(void * context,
         }
         case SYNC_MANAGER_ADD_PEERS: {
             // filesystem changes are NOT queued; they are acted upon immediately
-            for (size_t index = 0; index < event.u.peers.count; index++)
-                fileServiceSave (bwm->fileService, fileServiceTypePeers, &event.u.peers.peers[index]);
+            if (event.u.peers.count > 0) {
+                // fileServiceSaveMany expects an array of pointers to entities; see above
+                BRPeer **peers = calloc (event.u.peers.count,
+                                         sizeof(BRPeer *));
+
+                for (size_t i = 0; i < event.u.peers.count; i++) {
+                    peers[i] = &event.u.peers.peers[i];
+                }
+
+                fileServiceSaveMany (bwm->fileService, fileServiceTypePeers,
+                                     (const void **) peers,
+                                     event.u.peers.count);
+                free (peers);
+            }
             break;
         }
         case SYNC_MANAGER_CONNECTED: {
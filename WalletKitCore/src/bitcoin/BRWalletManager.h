@@ -295,6 +295,14 @@ BRWalletManagerSetFixedPeer (BRWalletManager manager,
                              UInt128 address,
                              uint16_t port);
 
+/**
+ * Sync with BIP157 compact block filters, from peers that serve them, instead of BIP37 bloom
+ * filters.  Call before BRWalletManagerConnect(); the setting carries over to a new mode.
+ */
+extern void
+BRWalletManagerSetCompactFilterSync (BRWalletManager manager,
+                                     int enabled);
+
 extern void
 BRWalletManagerScan (BRWalletManager manager);
 
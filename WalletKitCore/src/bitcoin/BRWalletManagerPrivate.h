@@ -17,6 +17,7 @@
 #include "support/BRBase.h"
 #include "support/BRArray.h"
 #include "support/BRFileService.h"
+#include "BRHeaderStore.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,18 @@ struct BRWalletManagerStruct {
     /** The file service */
     BRFileService fileService;
 
+    /**
+     * The memory-mapped header store, from the last difficulty transition on.  Used to restore
+     * the peer manager's blocks without parsing them out of the file service.  May be NULL.
+     */
+    BRHeaderStore *headerStore;
+
+    /**
+     * If true, P2P syncs match BIP157 compact block filters locally rather than loading BIP37
+     * bloom filters into peers.  Applied to each sync manager as it is created.
+     */
+    int compactFilterSync;
+
     /**
      * The chain parameters associated with the wallet
      */
@@ -752,6 +752,31 @@ cryptoTransferEqual (BRCryptoTransfer t1, BRCryptoTransfer t2) {
                                             (BLOCK_CHAIN_TYPE_GEN == t1->type && cryptoTransferEqualAsGEN (t1, t2)))));
 }
 
+private_extern size_t
+cryptoTransferGetHashForSet (const void *transferPtr) {
+    BRCryptoTransfer transfer = (BRCryptoTransfer) transferPtr;
+
+    // Consistent with `cryptoTransferEqual()`: BTC and ETH transfers are equal when they share
+    // a native transfer, GEN transfers when they share a hash (transfers with the same `uids`
+    // are in the same transaction, and thus share a hash too).  A GEN transfer is only added to
+    // a wallet once it is signed, so its hash does not change while it is in a set.
+    switch (transfer->type) {
+        case BLOCK_CHAIN_TYPE_BTC:
+            return (size_t) (uintptr_t) transfer->u.btc.tid;
+        case BLOCK_CHAIN_TYPE_ETH:
+            return (size_t) (uintptr_t) transfer->u.eth.tid;
+        case BLOCK_CHAIN_TYPE_GEN:
+            return genericHashSetValue (genTransferGetHash (transfer->u.gen));
+    }
+    return 0;
+}
+
+private_extern int
+cryptoTransferIsEqualForSet (const void *transferPtr1, const void *transferPtr2) {
+    return CRYPTO_TRUE == cryptoTransferEqual ((BRCryptoTransfer) transferPtr1,
+                                               (BRCryptoTransfer) transferPtr2);
+}
+
 extern BRCryptoComparison
 cryptoTransferCompare (BRCryptoTransfer transfer1, BRCryptoTransfer transfer2) {
     // early bail when comparing the same transfer
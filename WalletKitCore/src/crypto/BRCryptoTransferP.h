@@ -126,6 +126,13 @@ private_extern BRCryptoBoolean
 cryptoTransferHasGEN (BRCryptoTransfer transfer,
                       BRGenericTransfer gen);
 
+/// Hash and equality functions for a BRSet of transfers, consistent with `cryptoTransferEqual()`
+private_extern size_t
+cryptoTransferGetHashForSet (const void *transferPtr);
+
+private_extern int
+cryptoTransferIsEqualForSet (const void *transferPtr1, const void *transferPtr2);
+
 private_extern void
 cryptoTransferSetAttributes (BRCryptoTransfer transfer,
                              OwnershipKept BRArrayOf(BRCryptoTransferAttribute) attributes);
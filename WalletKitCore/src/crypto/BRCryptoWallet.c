@@ -34,6 +34,7 @@ cryptoWalletCreateInternal (BRCryptoBlockChainType type,
     wallet->unit  = cryptoUnitTake (unit);
     wallet->unitForFee = cryptoUnitTake (unitForFee);
     array_new (wallet->transfers, 5);
+    wallet->transfersIndex = BRSetNew (cryptoTransferGetHashForSet, cryptoTransferIsEqualForSet, 5);
 
     wallet->ref = CRYPTO_REF_ASSIGN (cryptoWalletRelease);
 
@@ -94,6 +95,7 @@ cryptoWalletRelease (BRCryptoWallet wallet) {
     for (size_t index = 0; index < array_count(wallet->transfers); index++)
         cryptoTransferGive (wallet->transfers[index]);
     array_free (wallet->transfers);
+    BRSetFree (wallet->transfersIndex);
 
     switch (wallet->type) {
         case BLOCK_CHAIN_TYPE_BTC:
@@ -217,66 +219,56 @@ cryptoWalletGetBalanceMaximum (BRCryptoWallet wallet) {
 extern BRCryptoBoolean
 cryptoWalletHasTransfer (BRCryptoWallet wallet,
                          BRCryptoTransfer transfer) {
-    BRCryptoBoolean r = CRYPTO_FALSE;
     pthread_mutex_lock (&wallet->lock);
-    for (size_t index = 0; index < array_count(wallet->transfers) && CRYPTO_FALSE == r; index++) {
-        r = cryptoTransferEqual (transfer, wallet->transfers[index]);
-    }
+    BRCryptoBoolean r = AS_CRYPTO_BOOLEAN (BRSetContains (wallet->transfersIndex, transfer));
     pthread_mutex_unlock (&wallet->lock);
     return r;
 }
 
-private_extern BRCryptoTransfer
-cryptoWalletFindTransferAsBTC (BRCryptoWallet wallet,
-                               BRTransaction *btc) {
-    BRCryptoTransfer transfer = NULL;
+static BRCryptoTransfer
+cryptoWalletFindTransferAs (BRCryptoWallet wallet,
+                            BRCryptoTransfer probe) {
     pthread_mutex_lock (&wallet->lock);
-    for (size_t index = 0; index < array_count(wallet->transfers); index++) {
-        if (CRYPTO_TRUE == cryptoTransferHasBTC (wallet->transfers[index], btc)) {
-            transfer = cryptoTransferTake (wallet->transfers[index]);
-            break;
-        }
-    }
+    BRCryptoTransfer transfer = BRSetGet (wallet->transfersIndex, probe);
+    if (NULL != transfer) transfer = cryptoTransferTake (transfer);
     pthread_mutex_unlock (&wallet->lock);
     return transfer;
 }
 
+private_extern BRCryptoTransfer
+cryptoWalletFindTransferAsBTC (BRCryptoWallet wallet,
+                               BRTransaction *btc) {
+    struct BRCryptoTransferRecord probe;
+    probe.type = BLOCK_CHAIN_TYPE_BTC;
+    probe.u.btc.tid = btc;
+    return cryptoWalletFindTransferAs (wallet, &probe);
+}
+
 private_extern BRCryptoTransfer
 cryptoWalletFindTransferAsETH (BRCryptoWallet wallet,
                                BREthereumTransfer eth) {
-    BRCryptoTransfer transfer = NULL;
-    pthread_mutex_lock (&wallet->lock);
-    for (size_t index = 0; index < array_count(wallet->transfers); index++) {
-        if (CRYPTO_TRUE == cryptoTransferHasETH (wallet->transfers[index], eth)) {
-            transfer = cryptoTransferTake (wallet->transfers[index]);
-            break;
-        }
-    }
-    pthread_mutex_unlock (&wallet->lock);
-    return transfer;
+    struct BRCryptoTransferRecord probe;
+    probe.type = BLOCK_CHAIN_TYPE_ETH;
+    probe.u.eth.tid = eth;
+    return cryptoWalletFindTransferAs (wallet, &probe);
 }
 
 private_extern BRCryptoTransfer
 cryptoWalletFindTransferAsGEN (BRCryptoWallet wallet,
                                BRGenericTransfer gen) {
-    BRCryptoTransfer transfer = NULL;
-    pthread_mutex_lock (&wallet->lock);
-    for (size_t index = 0; index < array_count(wallet->transfers); index++) {
-        if (CRYPTO_TRUE == cryptoTransferHasGEN (wallet->transfers[index], gen)) {
-            transfer = cryptoTransferTake (wallet->transfers[index]);
-            break;
-        }
-    }
-    pthread_mutex_unlock (&wallet->lock);
-    return transfer;
+    struct BRCryptoTransferRecord probe;
+    probe.type = BLOCK_CHAIN_TYPE_GEN;
+    probe.u.gen = gen;
+    return cryptoWalletFindTransferAs (wallet, &probe);
 }
 
 extern void
 cryptoWalletAddTransfer (BRCryptoWallet wallet,
                          BRCryptoTransfer transfer) {
     pthread_mutex_lock (&wallet->lock);
-    if (CRYPTO_FALSE == cryptoWalletHasTransfer (wallet, transfer)) {
+    if (!BRSetContains (wallet->transfersIndex, transfer)) {
         array_add (wallet->transfers, cryptoTransferTake(transfer));
+        BRSetAdd (wallet->transfersIndex, transfer);
     }
     pthread_mutex_unlock (&wallet->lock);
 }
@@ -285,17 +277,20 @@ extern void
 cryptoWalletRemTransfer (BRCryptoWallet wallet, BRCryptoTransfer transfer) {
     BRCryptoTransfer walletTransfer = NULL;
     pthread_mutex_lock (&wallet->lock);
-    for (size_t index = 0; index < array_count(wallet->transfers); index++) {
-        if (CRYPTO_TRUE == cryptoTransferEqual (wallet->transfers[index], transfer)) {
-            walletTransfer = wallet->transfers[index];
-            array_rm (wallet->transfers, index);
-            break;
+    walletTransfer = BRSetRemove (wallet->transfersIndex, transfer);
+    if (NULL != walletTransfer) {
+        // keep `transfers` in order; this only compares pointers
+        for (size_t index = 0; index < array_count(wallet->transfers); index++) {
+            if (walletTransfer == wallet->transfers[index]) {
+                array_rm (wallet->transfers, index);
+                break;
+            }
         }
     }
     pthread_mutex_unlock (&wallet->lock);
 
     // drop reference outside of lock to avoid potential case where release function runs
-    if (NULL != walletTransfer) cryptoTransferGive (transfer);
+    if (NULL != walletTransfer) cryptoTransferGive (walletTransfer);
 }
 
 extern BRCryptoTransfer *
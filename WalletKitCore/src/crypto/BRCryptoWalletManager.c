@@ -487,6 +487,18 @@ cryptoWalletManagerSetNetworkReachable (BRCryptoWalletManager cwm,
     }
 }
 
+extern void
+cryptoWalletManagerSetCompactFilterSync (BRCryptoWalletManager cwm,
+                                         BRCryptoBoolean useCompactFilters) {
+    switch (cwm->type) {
+        case BLOCK_CHAIN_TYPE_BTC:
+            BRWalletManagerSetCompactFilterSync (cwm->u.btc, CRYPTO_TRUE == useCompactFilters);
+            break;
+        default:
+            break;
+    }
+}
+
 //extern BRCryptoPeer
 //cryptoWalletManagerGetPeer (BRCryptoWalletManager cwm) {
 //    return (NULL == cwm->peer ? NULL : cryptoPeerTake (cwm->peer));
@@ -960,6 +972,18 @@ cryptoWalletManagerSign (BRCryptoWalletManager cwm,
     return success;
 }
 
+extern void
+cryptoWalletManagerSetSignThreadCount (BRCryptoWalletManager cwm,
+                                       size_t threadCount) {
+    switch (cwm->type) {
+        case BLOCK_CHAIN_TYPE_BTC:
+            BRWalletSetSignThreadCount (cryptoWalletAsBTC (cwm->wallet), threadCount);
+            break;
+        default:
+            break;
+    }
+}
+
 extern void
 cryptoWalletManagerSubmit (BRCryptoWalletManager cwm,
                            BRCryptoWallet wallet,
@@ -1927,10 +1927,12 @@ cwmAnnounceGetTransactionsItem (OwnershipKept BRCryptoWalletManager cwm,
 
             if (transfers != NULL) {
                 pthread_mutex_lock (&cwm->lock);
+                genManagerBeginSaveBatch (cwm->u.gen);
                 for (size_t index = 0; index < array_count (transfers); index++) {
                     // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
                     cryptoWalletManagerHandleTransferGEN (cwm, transfers[index]);
                 }
+                genManagerCommitSaveBatch (cwm->u.gen);
                 pthread_mutex_unlock (&cwm->lock);
 
                 // The wallet manager takes ownership of the actual transfers - so just
@@ -2002,6 +2004,7 @@ cwmAnnounceGetTransactionsItemGEN (BRCryptoWalletManager cwm,
 
     if (transfers != NULL) {
         pthread_mutex_lock (&cwm->lock);
+        genManagerBeginSaveBatch (cwm->u.gen);
         for (size_t index = 0; index < array_count (transfers); index++) {
             BRGenericTransfer genTransfer = transfers[index];
             // TODO: A BRGenericTransfer must allow us to determine the Wallet (via a Currency).
@@ -2012,6 +2015,7 @@ cwmAnnounceGetTransactionsItemGEN (BRCryptoWalletManager cwm,
             // Generate required events.
             cryptoWalletManagerHandleTransferGEN (cwm, genTransfer);
         }
+        genManagerCommitSaveBatch (cwm->u.gen);
         pthread_mutex_unlock (&cwm->lock);
 
         // The wallet manager takes ownership of the actual transfers - so just
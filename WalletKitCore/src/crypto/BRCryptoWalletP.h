@@ -16,6 +16,7 @@
 #include "BRCryptoWallet.h"
 #include "BRCryptoBaseP.h"
 
+#include "support/BRSet.h"
 #include "bitcoin/BRWallet.h"
 #include "bitcoin/BRWalletManager.h"
 
@@ -62,6 +63,10 @@ struct BRCryptoWalletRecord {
     //
     BRArrayOf (BRCryptoTransfer) transfers;
 
+    // An index of `transfers`, by native transfer (BTC, ETH) or transaction hash (GEN), so that
+    // finding the transfer for each transaction event doesn't scan every transfer.
+    BRSetOf (BRCryptoTransfer) transfersIndex;
+
     BRCryptoRef ref;
 };
 
@@ -72,6 +72,32 @@ ethAddressCreateKey (const BRKey *key) {
     return address;
 }
 
+extern void
+ethAddressCreateKeys (BREthereumAddress *addresses,
+                      const BRKey *keys,
+                      size_t count) {
+    const void *datas[count + 1];
+    size_t dataLens[count + 1];
+    uint8_t (*hashes)[32] = malloc ((count + 1) * sizeof (*hashes));
+
+    // As ethAddressCreateKey(), with the public keys hashed in one batch.  The extra, unused
+    // entry keeps the arrays non-empty (and initialized) when `count` is zero.
+    datas[count]    = NULL;
+    dataLens[count] = 0;
+
+    for (size_t index = 0; index < count; index++) {
+        datas[index]    = &keys[index].pubKey[1];
+        dataLens[index] = sizeof (keys[index].pubKey) - 1;
+    }
+
+    BRKeccak256Batch (hashes, datas, dataLens, count);
+
+    for (size_t index = 0; index < count; index++)
+        memcpy (addresses[index].bytes, &hashes[index][12], 20);
+
+    free (hashes);
+}
+
 
 extern char *
 ethAddressGetEncodedString (BREthereumAddress address, int useChecksum) {
@@ -167,6 +193,13 @@ ethAddressRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return address;
 }
 
+extern BREthereumAddress
+ethAddressRlpDecodeCursor (BRRlpCursor *cursor) {
+    BREthereumAddress address;
+    rlpCursorNextBytesFixed (cursor, address.bytes, 20, 1);
+    return address;
+}
+
 extern BRRlpItem
 ethAddressRlpEncode(BREthereumAddress address,
                  BRRlpCoder coder) {
@@ -58,6 +58,15 @@ ethAddressValidateString(const char *string);
 extern BREthereumAddress
 ethAddressCreateKey (const BRKey *keyWithPubKeyProvided);
 
+/**
+ * Fill `addresses` with the EthereumAddress of each of `count` `keys`, as ethAddressCreateKey(),
+ * hashing all the public keys in one batch.
+ */
+extern void
+ethAddressCreateKeys (BREthereumAddress *addresses,
+                      const BRKey *keysWithPubKeyProvided,
+                      size_t count);
+
 #define ADDRESS_ENCODED_CHARS    (2*ADDRESS_BYTES + 2 + 1)  // "0x" prefaced
 
 /**
@@ -92,6 +101,9 @@ extern BREthereumAddress
 ethAddressRlpDecode (BRRlpItem item,
                      BRRlpCoder coder);
 
+extern BREthereumAddress
+ethAddressRlpDecodeCursor (BRRlpCursor *cursor);
+
 extern BRRlpItem
 ethAddressRlpEncode(BREthereumAddress address,
                     BRRlpCoder coder);
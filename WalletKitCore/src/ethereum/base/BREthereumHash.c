@@ -100,6 +100,13 @@ ethHashRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return hash;
 }
 
+extern BREthereumHash
+ethHashRlpDecodeCursor (BRRlpCursor *cursor) {
+    BREthereumHash hash;
+    rlpCursorNextBytesFixed (cursor, hash.bytes, ETHEREUM_HASH_BYTES, 0);
+    return hash;
+}
+
 extern BRRlpItem
 ethHashEncodeList (BRArrayOf (BREthereumHash) hashes, BRRlpCoder coder) {
     size_t itemCount = array_count(hashes);
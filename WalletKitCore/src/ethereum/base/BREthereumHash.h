@@ -94,6 +94,9 @@ ethHashRlpEncode(BREthereumHash hash, BRRlpCoder coder);
 extern BREthereumHash
 ethHashRlpDecode (BRRlpItem item, BRRlpCoder coder);
 
+extern BREthereumHash
+ethHashRlpDecodeCursor (BRRlpCursor *cursor);
+
 extern BRRlpItem
 ethHashEncodeList (BRArrayOf(BREthereumHash) hashes, BRRlpCoder coder);
 
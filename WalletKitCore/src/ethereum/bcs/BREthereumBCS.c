@@ -20,6 +20,8 @@
 #define BCS_ORPHAN_BLOCKS_INITIAL_CAPACITY (10)
 #define BCS_PENDING_TRANSACTION_INITIAL_CAPACITY  (10)
 #define BCS_PENDING_LOGS_INITIAL_CAPACITY  (10)
+#define BCS_POW_PENDING_INITIAL_CAPACITY  (10)
+#define BCS_POW_PENDING_LIMIT  (1024)
 
 #define BCS_TRANSACTIONS_INITIAL_CAPACITY (50)
 #define BCS_LOGS_INITIAL_CAPACITY (50)
@@ -180,7 +182,8 @@ bcsCreate (BREthereumNetwork network,
            OwnershipGiven BRSetOf(BREthereumNodeConfig) peers,
            OwnershipGiven BRSetOf(BREthereumBlock) blocks,
            OwnershipGiven BRSetOf(BREthereumTransaction) transactions,
-           OwnershipGiven BRSetOf(BREthereumLog) logs) {
+           OwnershipGiven BRSetOf(BREthereumLog) logs,
+           const char *powCachePath) {
 
     BREthereumBCS bcs = (BREthereumBCS) calloc (1, sizeof(struct BREthereumBCSStruct));
 
@@ -298,7 +301,20 @@ bcsCreate (BREthereumNetwork network,
                                bcs->les,
                                bcs->handler);
 
-    bcs->pow = proofOfWorkCreate();
+    // Rinkeby is proof-of-authority; its headers carry no Ethash proof-of-work.
+    bcs->pow = (ethNetworkRinkeby != network ? proofOfWorkCreate (powCachePath) : NULL);
+
+    bcs->powPending = BRSetNew (blockHashValue,
+                                blockHashEqual,
+                                BCS_POW_PENDING_INITIAL_CAPACITY);
+    bcs->powPendingWaiting = NULL;
+
+    // Start on the cache for the chain's epoch, in the background, so that announced headers
+    // can be verified once synced.  Without saved blocks the chain is genesis; the epoch of the
+    // network's head is prepared on the first status instead - see bcsHandleStatus().
+    if (NULL != bcs->pow && bcs->chain != bcs->genesis &&
+        (CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC == mode || CRYPTO_SYNC_MODE_P2P_ONLY == mode))
+        proofOfWorkPrepare (bcs->pow, blockGetNumber (bcs->chain));
 
     return bcs;
 }
@@ -353,6 +369,9 @@ bcsDestroy (BREthereumBCS bcs) {
     array_free (bcs->pendingTransactions);
     array_free (bcs->pendingLogs);
 
+    // PoW pending blocks are in bcs->blocks; thus already released.
+    BRSetFree (bcs->powPending);
+
     bcs->genesis = NULL;
     
     // Destroy the Event w/ queue
@@ -634,6 +653,10 @@ bcsHandleStatus (BREthereumBCS bcs,
         return;
     }
 
+    // Headers near `headNumber` are coming; start on the cache for their epoch.
+    if (NULL != bcs->pow)
+        proofOfWorkPrepare (bcs->pow, headNumber);
+
     bcsSyncRange (bcs, node, blockGetNumber(bcs->chain), headNumber);
 }
 
@@ -689,12 +712,27 @@ bcsHandleAnnounce (BREthereumBCS bcs,
 
 /// MARK: - Chain
 
+static void
+bcsPowPendingRemove (BREthereumBCS bcs,
+                     BREthereumBlock block) {
+    BRSetRemove (bcs->powPending, block);
+    if (block == bcs->powPendingWaiting) bcs->powPendingWaiting = NULL;
+}
+
+static int
+bcsPowPendingCompare (const void *b1, const void *b2) {
+    uint64_t n1 = blockGetNumber (*(BREthereumBlock *) b1);
+    uint64_t n2 = blockGetNumber (*(BREthereumBlock *) b2);
+    return (n1 < n2 ? -1 : (n1 > n2 ? 1 : 0));
+}
+
 static void
 bcsReclaimBlock (BREthereumBCS bcs,
                  BREthereumBlock block,
                  int useLog) {
     BRSetRemove (bcs->orphans, block);  // needed, or overly cautious?
     BRSetRemove (bcs->blocks,  block);
+    bcsPowPendingRemove (bcs, block);
     if (useLog) eth_log("BCS", "Block %" PRIu64 " Reclaimed", blockGetNumber(block));
 
     // TODO: Avoid dangling references - need to identify one/some first.
@@ -1124,6 +1162,37 @@ bcsExtendChainIfPossible (BREthereumBCS bcs,
     BREthereumHash blockParentHash = blockHeaderGetParentHash(blockGetHeader(block));
     BREthereumBlock blockParent = BRSetGet(bcs->blocks, &blockParentHash);
 
+    // If we have a parent, but can't yet compute `block`'s PoW, because the cache for its epoch
+    // is being generated, or the parent itself awaits a cache, then hold `block`.  It is checked
+    // again, once ready, from bcsPeriodicDispatcher(); unchecked headers are never chained.
+    if (NULL != blockParent && NULL != bcs->pow) {
+        int parentPending = BRSetContains (bcs->powPending, blockParent);
+        int powReady = (parentPending ||
+                        ETHEREUM_BOOLEAN_IS_TRUE (proofOfWorkIsReady (bcs->pow, blockGetHeader(block))));
+
+        if (parentPending || !powReady) {
+            if (BRSetContains (bcs->powPending, block)) return;
+
+            // Past the limit, drop `block`.  Once the held blocks are chained, a later header will
+            // find its parent missing, as an orphan, and sync the range again - see 2) below.
+            if (BRSetCount (bcs->powPending) >= BCS_POW_PENDING_LIMIT) {
+                eth_log("BCS", "Block %" PRIu64 " PoW Pending Dropped", blockGetNumber(block));
+                bcsReclaimBlock (bcs, block, 0);
+                return;
+            }
+
+            BRSetAdd (bcs->powPending, block);
+
+            // Track the lowest block that waits on its own epoch's cache; retries wait on it.
+            if (!powReady && (NULL == bcs->powPendingWaiting ||
+                              blockGetNumber(block) < blockGetNumber(bcs->powPendingWaiting)))
+                bcs->powPendingWaiting = block;
+
+            eth_log("BCS", "Block %" PRIu64 " PoW Pending", blockGetNumber(block));
+            return;
+        }
+    }
+
     // If we have a parent, but `header` is inconsistent with its parent, then ignore `header`
     if (NULL != blockParent &&
         ETHEREUM_BOOLEAN_IS_FALSE (blockHeaderIsValid (blockGetHeader(block),
@@ -1248,6 +1317,45 @@ bcsExtendChainIfPossible (BREthereumBCS bcs,
     bcsReclaimAndSaveBlocksIfAppropriate (bcs);
 }
 
+/**
+ * Try again to chain the blocks held for a PoW cache, once the cache that the lowest waiting block
+ * needs is ready - lowest numbered first so that a parent is checked before its children.  Those
+ * still without a cache are held again.
+ */
+static void
+bcsExtendChainWithPowPending (BREthereumBCS bcs) {
+    if (NULL == bcs->powPending || 0 == BRSetCount (bcs->powPending)) return;
+
+    // Nothing has changed until the waiting block's cache is ready.  With no waiting block, say
+    // because it was reclaimed, retry anyway; that will find a new one.
+    if (NULL != bcs->powPendingWaiting &&
+        ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkIsReady (bcs->pow, blockGetHeader (bcs->powPendingWaiting))))
+        return;
+
+    size_t count = BRSetCount (bcs->powPending);
+    BREthereumBlock *blocks = malloc (count * sizeof (BREthereumBlock));
+    count = BRSetAll (bcs->powPending, (void**) blocks, count);
+
+    BRSetClear (bcs->powPending);
+    bcs->powPendingWaiting = NULL;
+
+    qsort (blocks, count, sizeof (BREthereumBlock), bcsPowPendingCompare);
+
+    // Chaining one block may reclaim another (as when a sync adopts a new chain); so retry by hash
+    // and skip those no longer in `blocks`.
+    BREthereumHash *hashes = malloc (count * sizeof (BREthereumHash));
+    for (size_t index = 0; index < count; index++)
+        hashes[index] = blockGetHash (blocks[index]);
+
+    for (size_t index = 0; index < count; index++) {
+        BREthereumBlock block = BRSetGet (bcs->blocks, &hashes[index]);
+        if (NULL != block) bcsExtendChainIfPossible (bcs, NODE_REFERENCE_ALL, block, 0);
+    }
+
+    free (hashes);
+    free (blocks);
+}
+
 /// MARK: - Block Header
 
 static BREthereumBoolean
@@ -1257,22 +1365,35 @@ bcsBlockHasMatchingTransactions (BREthereumBCS bcs,
     // return ETHEREUM_BOOLEAN_FALSE;
 }
 
-static BREthereumBoolean
-bcsBlockHasMatchingLogs (BREthereumBCS bcs,
-                         BREthereumBlock block) {
-    return blockHeaderMatch (blockGetHeader (block), bcs->filterForAddressOnLogs);
-}
-
 static BREthereumBoolean
 bcsBlockNeedsAccountState (BREthereumBCS bcs,
                            BREthereumBlock block) {
     return ETHEREUM_BOOLEAN_FALSE;
 }
 
+/**
+ * The trusted CHT root for the block with `number` or EMPTY_HASH_INIT if none is trusted.  A
+ * header proof is only requested for a block with a trusted CHT root; the proof is checked
+ * against that root.
+ */
+static BREthereumHash
+bcsGetTrustedCHTRoot (BREthereumBCS bcs,
+                      uint64_t number) {
+    return ethNetworkGetTrustedCHTRoot (bcs->network, messageLESGetChtNumber (number));
+}
+
+static BREthereumBoolean
+bcsHasTrustedCHTRoot (BREthereumBCS bcs,
+                      BREthereumBlock block) {
+    return AS_ETHEREUM_BOOLEAN (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (bcsGetTrustedCHTRoot (bcs, blockGetNumber (block)),
+                                                                         EMPTY_HASH_INIT)));
+}
+
 static BREthereumBoolean
 bcsBlockNeedsHeaderProof (BREthereumBCS bcs,
                           BREthereumBlock block) {
-    return blockHeaderIsCHTRoot (blockGetHeader (block));
+    return AS_ETHEREUM_BOOLEAN (ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderIsCHTRoot (blockGetHeader (block))) &&
+                                ETHEREUM_BOOLEAN_IS_TRUE (bcsHasTrustedCHTRoot (bcs, block)));
 }
 
 /**
@@ -1283,6 +1404,7 @@ bcsHandleBlockHeaderInternal (BREthereumBCS bcs,
                               BREthereumNodeReference node,
                               OwnershipGiven BREthereumBlockHeader header,
                               int isFromSync,
+                              BREthereumBoolean hasMatchingLogs,
                               BRArrayOf(BREthereumHash) *bodiesHashes,
                               BRArrayOf(BREthereumHash) *receiptsHashes,
                               BRArrayOf(BREthereumHash) *accountsHashes,
@@ -1312,15 +1434,16 @@ bcsHandleBlockHeaderInternal (BREthereumBCS bcs,
     BRSetAdd(bcs->blocks, block);
 
     // Check if we need 'transaction receipts', 'block bodies', 'account state' or a 'header proof'.
-    // We'll use the header's logsBloom for the recipts check; we've got nothing in the header to
-    // check for needing bodies nor for needing account state.  We'll get block bodies by default
+    // We'll use the header's logsBloom for the recipts check (as `hasMatchingLogs`, batched over
+    // all the headers handled together); we've got nothing in the header to check for needing
+    // bodies nor for needing account state.  We'll get block bodies by default
     // and avoid account state (getting account state might allow us to avoid getting block bodies;
     // however, the client cost to get the account state is ~2.5 times more then getting block
     // bodies so we'll just get block bodies and compute the account state).  We'll need the 'header
     // proof' occassionally so that we can build on the block chain's total difficulty and
     // ultimately our Proof-of-Work validations.
     BREthereumBoolean needBodies   = bcsBlockHasMatchingTransactions(bcs, block);
-    BREthereumBoolean needReceipts = bcsBlockHasMatchingLogs(bcs, block);
+    BREthereumBoolean needReceipts = hasMatchingLogs;
     BREthereumBoolean needAccount  = bcsBlockNeedsAccountState(bcs, block);
     BREthereumBoolean needProof    = bcsBlockNeedsHeaderProof(bcs, block);
 
@@ -1375,16 +1498,23 @@ bcsHandleBlockHeaders (BREthereumBCS bcs,
     BRArrayOf(BREthereumHash) accountsHashes = NULL;
     BRArrayOf(uint64_t) proofNumbers = NULL;
 
-    for (size_t index = 0; index < array_count(headers); index++)
+    // Match every header's logsBloom against the account's log filter in one batch.
+    size_t headersCount = array_count(headers);
+    uint64_t *matchingLogs = calloc (headersCount + 1, sizeof (uint64_t));
+    blockHeadersMatch (headers, headersCount, &bcs->filterForAddressOnLogs, 1, matchingLogs);
+
+    for (size_t index = 0; index < headersCount; index++)
         // Each `headers[index]` has 'OwnershipGiven'
         bcsHandleBlockHeaderInternal (bcs, node,
                                       headers[index],
                                       isFromSync,
+                                      AS_ETHEREUM_BOOLEAN (0 != matchingLogs[index]),
                                       &bodiesHashes,
                                       &receiptsHashes,
                                       &accountsHashes,
                                       &proofNumbers);
 
+    free (matchingLogs);
     array_free(headers);
 
     if (NULL != bodiesHashes && array_count(bodiesHashes) > 0)
@@ -1399,18 +1529,36 @@ bcsHandleBlockHeaders (BREthereumBCS bcs,
                             (BREthereumLESProvisionCallback) bcsSignalProvision,
                             receiptsHashes);
 
-    if (NULL != accountsHashes && array_count(accountsHashes) > 0)
+    if (NULL != accountsHashes && array_count(accountsHashes) > 0) {
+        // Each account state proof is checked against its block's stateRoot
+        BRArrayOf(BREthereumHash) accountsRoots;
+        array_new (accountsRoots, array_count(accountsHashes));
+        for (size_t index = 0; index < array_count(accountsHashes); index++) {
+            BREthereumBlock block = BRSetGet (bcs->blocks, &accountsHashes[index]);
+            array_add (accountsRoots, blockHeaderGetStateRoot (blockGetHeader (block)));
+        }
+
         lesProvideAccountStates (bcs->les, node,
                                  (BREthereumLESProvisionContext) bcs,
                                  (BREthereumLESProvisionCallback) bcsSignalProvision,
                                  bcs->address,
-                                 accountsHashes);
+                                 accountsHashes,
+                                 accountsRoots);
+    }
+
+    if (NULL != proofNumbers && array_count(proofNumbers) > 0) {
+        // Each header proof is checked against its trusted CHT root
+        BRArrayOf(BREthereumHash) proofRoots;
+        array_new (proofRoots, array_count(proofNumbers));
+        for (size_t index = 0; index < array_count(proofNumbers); index++)
+            array_add (proofRoots, bcsGetTrustedCHTRoot (bcs, proofNumbers[index]));
 
-    if (NULL != proofNumbers && array_count(proofNumbers) > 0)
         lesProvideBlockProofs (bcs->les, node,
                                (BREthereumLESProvisionContext) bcs,
                                (BREthereumLESProvisionCallback) bcsSignalProvision,
-                               proofNumbers);
+                               proofNumbers,
+                               proofRoots);
+    }
 }
 
 /// MARK: - Account State
@@ -1575,13 +1723,16 @@ bcsHandleBlockBody (BREthereumBCS bcs,
                                    blockGetHash(block));
         }
 
-        // 2) We want a header proof too; to ensure a valid block w/ transaction.
-        if (ETHEREUM_BOOLEAN_IS_TRUE (blockHasStatusHeaderProofRequest(block, BLOCK_REQUEST_NOT_NEEDED))) {
+        // 2) We want a header proof too; to ensure a valid block w/ transaction.  Without a
+        //    trusted CHT root, there is nothing to check a proof against.
+        if (ETHEREUM_BOOLEAN_IS_TRUE (blockHasStatusHeaderProofRequest(block, BLOCK_REQUEST_NOT_NEEDED)) &&
+            ETHEREUM_BOOLEAN_IS_TRUE (bcsHasTrustedCHTRoot (bcs, block))) {
             blockReportStatusHeaderProofRequest (block, BLOCK_REQUEST_PENDING);
             lesProvideBlockProofsOne (bcs->les, node,
                                       (BREthereumLESProvisionContext) bcs,
                                       (BREthereumLESProvisionCallback) bcsSignalProvision,
-                                      blockGetNumber(block));
+                                      blockGetNumber(block),
+                                      bcsGetTrustedCHTRoot (bcs, blockGetNumber(block)));
         }
 
         // 3) We want the account state too - because we've found a transaction for bcs->address
@@ -1592,7 +1743,8 @@ bcsHandleBlockBody (BREthereumBCS bcs,
                                         (BREthereumLESProvisionContext) bcs,
                                         (BREthereumLESProvisionCallback) bcsSignalProvision,
                                         bcs->address,
-                                        blockGetHash(block));
+                                        blockGetHash(block),
+                                        blockHeaderGetStateRoot (blockGetHeader (block)));
         }
     }
 
@@ -1820,12 +1972,14 @@ bcsHandleTransactionReceipts (BREthereumBCS bcs,
         }
 
         // 2) We want a header proof too; to ensure a valid block w/ transactions + logs.
-        if (ETHEREUM_BOOLEAN_IS_TRUE (blockHasStatusHeaderProofRequest(block, BLOCK_REQUEST_NOT_NEEDED))) {
+        if (ETHEREUM_BOOLEAN_IS_TRUE (blockHasStatusHeaderProofRequest(block, BLOCK_REQUEST_NOT_NEEDED)) &&
+            ETHEREUM_BOOLEAN_IS_TRUE (bcsHasTrustedCHTRoot (bcs, block))) {
             blockReportStatusHeaderProofRequest (block, BLOCK_REQUEST_PENDING);
             lesProvideBlockProofsOne (bcs->les, node,
                                       (BREthereumLESProvisionContext) bcs,
                                       (BREthereumLESProvisionCallback) bcsSignalProvision,
-                                      blockGetNumber(block));
+                                      blockGetNumber(block),
+                                      bcsGetTrustedCHTRoot (bcs, blockGetNumber(block)));
         }
     }
 
@@ -2035,6 +2189,9 @@ bcsPeriodicDispatcher (BREventHandler handler,
     // TODO: Avoid-ish a race condition on bcsRelease. This is the wrong approach.
     if (NULL == bcs->les) return;
 
+    // Retry the blocks that were waiting on a PoW cache.
+    bcsExtendChainWithPowPending (bcs);
+
     // If nothing to do; simply skip out.
     if ((NULL == bcs->pendingTransactions || 0 == array_count (bcs->pendingTransactions)) &&
         (NULL == bcs->pendingLogs         || 0 == array_count (bcs->pendingLogs)))
@@ -165,6 +165,7 @@ typedef struct {
  *
  * @parameters
  * @parameter headers - is this a BRArray; assume so for now.
+ * @parameter powCachePath - a directory for saved Ethash caches, or NULL; see proofOfWorkCreate()
  */
 extern BREthereumBCS
 bcsCreate (BREthereumNetwork network,
@@ -174,7 +175,8 @@ bcsCreate (BREthereumNetwork network,
            BRSetOf(BREthereumNodeConfig) peers,
            BRSetOf(BREthereumBlock) blocks,
            BRSetOf(BREthereumTransaction) transactions,
-           BRSetOf(BREthereumLog) logs);
+           BRSetOf(BREthereumLog) logs,
+           const char *powCachePath);
 
 extern void
 bcsStart (BREthereumBCS bcs);
@@ -204,6 +204,18 @@ struct BREthereumBCSStruct {
      * Proof of Work
      */
     BREthereumProofOfWork pow;
+
+    /**
+     * Blocks, in `blocks`, that await the cache for their epoch before their proof of work can
+     * be validated and they can be chained.  At most BCS_POW_PENDING_LIMIT are held.
+     */
+    BRSetOf(BREthereumBlock) powPending;
+
+    /**
+     * The lowest numbered block in `powPending` whose own epoch cache was missing.  The others
+     * wait on it; all are retried once its cache is ready.
+     */
+    BREthereumBlock powPendingWaiting;
 };
 
 extern const BREventType *bcsEventTypes[];
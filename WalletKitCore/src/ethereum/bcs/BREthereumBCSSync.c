@@ -767,19 +767,25 @@ bcsSyncHandleBlockHeaders (BREthereumBCSSyncRange range,
             // Save the headers... for use with account states.
             range->headers = headers;
 
-            // Setup a call to lesProvideAccountStates()
+            // Setup a call to lesProvideAccountStates(); each proof is checked against its
+            // header's stateRoot.
             BRArrayOf(BREthereumHash) hashes;
+            BRArrayOf(BREthereumHash) roots;
 
             array_new (hashes, count);
+            array_new (roots,  count);
 
-            for (size_t index = 0; index < count; index++)
-                array_add (hashes,  blockHeaderGetHash (headers[index]));
+            for (size_t index = 0; index < count; index++) {
+                array_add (hashes, blockHeaderGetHash      (headers[index]));
+                array_add (roots,  blockHeaderGetStateRoot (headers[index]));
+            }
 
             lesProvideAccountStates (range->les, node,
                                      (BREthereumLESProvisionContext) range,
                                      (BREthereumLESProvisionCallback) bcsSyncSignalProvision,
                                      range->address,
-                                     hashes);
+                                     hashes,
+                                     roots);
             break;
         }
 
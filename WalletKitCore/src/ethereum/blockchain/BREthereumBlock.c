@@ -265,6 +265,11 @@ blockHeaderGetGasUsed (BREthereumBlockHeader header) {
     return header->gasUsed;
 }
 
+extern BREthereumHash
+blockHeaderGetStateRoot (BREthereumBlockHeader header) {
+    return header->stateRoot;
+}
+
 extern BREthereumHash
 blockHeaderGetMixHash (BREthereumBlockHeader header) {
     return header->mixHash;
@@ -310,9 +315,67 @@ blockHeaderMatch (BREthereumBlockHeader header,
 extern BREthereumBoolean
 blockHeaderMatchAddress (BREthereumBlockHeader header,
                          BREthereumAddress address) {
-    return AS_ETHEREUM_BOOLEAN
-    (ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderMatch (header, bloomFilterCreateAddress (address))) ||
-     ETHEREUM_BOOLEAN_IS_TRUE (blockHeaderMatch (header, logTopicGetBloomFilterAddress (address))));
+    BREthereumBoolean match;
+    blockHeadersMatchAddress (&header, 1, address, &match);
+    return match;
+}
+
+#define BLOCK_HEADERS_MATCH_CHUNK     (256)
+
+extern size_t
+blockHeadersMatch (BREthereumBlockHeader *headers,
+                   size_t count,
+                   const BREthereumBloomFilter *filters,
+                   size_t filtersCount,
+                   uint64_t *matches) {
+    // Batch the headers' logsBlooms in fixed-size chunks; `count` is unbounded during a sync.
+    const BREthereumBloomFilter *blooms[BLOCK_HEADERS_MATCH_CHUNK];
+    size_t matched = 0;
+
+    for (size_t start = 0; start < count; start += BLOCK_HEADERS_MATCH_CHUNK) {
+        size_t chunk = (count - start < BLOCK_HEADERS_MATCH_CHUNK
+                        ? count - start
+                        : BLOCK_HEADERS_MATCH_CHUNK);
+
+        for (size_t index = 0; index < chunk; index++)
+            blooms[index] = &headers[start + index]->logsBloom;
+
+        matched += bloomFilterMatchBatch (blooms, chunk, filters, filtersCount, &matches[start]);
+    }
+    return matched;
+}
+
+extern void
+blockHeadersMatchAddress (BREthereumBlockHeader *headers,
+                          size_t count,
+                          BREthereumAddress address,
+                          BREthereumBoolean *matches) {
+    // The address as is and as a log topic (left-padded with zeros), hashed together, once for
+    // all the headers.
+    uint8_t topic[32] = { 0 };
+    memcpy (&topic[sizeof (topic) - sizeof (address.bytes)], address.bytes, sizeof (address.bytes));
+
+    BRRlpData datas[2] = {
+        { sizeof (address.bytes), address.bytes },
+        { sizeof (topic),         topic }
+    };
+
+    BREthereumBloomFilter filters[2];
+    bloomFilterCreateDatas (filters, datas, 2);
+
+    // Match in fixed-size chunks, as blockHeadersMatch() does; `count` is unbounded.
+    uint64_t bitmaps[BLOCK_HEADERS_MATCH_CHUNK];
+
+    for (size_t start = 0; start < count; start += BLOCK_HEADERS_MATCH_CHUNK) {
+        size_t chunk = (count - start < BLOCK_HEADERS_MATCH_CHUNK
+                        ? count - start
+                        : BLOCK_HEADERS_MATCH_CHUNK);
+
+        blockHeadersMatch (&headers[start], chunk, filters, 2, bitmaps);
+
+        for (size_t index = 0; index < chunk; index++)
+            matches[start + index] = AS_ETHEREUM_BOOLEAN (0 != bitmaps[index]);
+    }
 }
 
 extern uint64_t
@@ -491,8 +554,11 @@ blockHeaderValidateAll (BREthereumBlockHeader this,
     UInt256 n = UINT256_ZERO;
     BREthereumHash m = EMPTY_HASH_INIT;
 
-    if (NULL != pow)
-        proofOfWorkCompute (pow, this, &n, &m);
+    // Headers with zero difficulty carry no PoW.  Otherwise, if the epoch's cache is still
+    // being generated, PoW can't be computed and `this` is invalid - for now.
+    int hasPoW = (NULL != pow && !UInt256IsZero (this->difficulty));
+    if (hasPoW && ETHEREUM_BOOLEAN_IS_FALSE (proofOfWorkCompute (pow, this, &n, &m)))
+        return 0;
 
     return (blockHeaderValidateTimestamp  (this, parent) &&
             blockHeaderValidateNumber     (this, parent) &&
@@ -501,8 +567,8 @@ blockHeaderValidateAll (BREthereumBlockHeader this,
             blockHeaderValidateExtraData  (this, parent) &&
             // TODO: Disabled, see CORE-203 (parentOmmersCount isn't correct if non-zero).
             // blockHeaderValidateDifficulty (this, parent, parentOmmersCount, genesis) &&
-            (NULL == pow || blockHeaderValidatePoWMixHash (this, m)) &&
-            (NULL == pow || blockHeaderValidatePoWNFactor (this, n)));
+            (!hasPoW || blockHeaderValidatePoWMixHash (this, m)) &&
+            (!hasPoW || blockHeaderValidatePoWNFactor (this, n)));
 }
 
 extern BREthereumBoolean
@@ -560,6 +626,52 @@ blockHeaderRlpEncode (BREthereumBlockHeader header,
     return rlpEncodeListItems(coder, items, itemsCount);
 }
 
+// A header without mixHash and nonce: six hashes, an address, a bloom filter, five integers and
+// at most 32 bytes of extraData.
+#define BLOCK_HEADER_SEAL_RLP_BYTES_LIMIT     (640)
+
+extern BREthereumHash
+blockHeaderGetSealHash (BREthereumBlockHeader header) {
+    // Integers are encoded as on the network, with zero as the empty string; this differs from
+    // blockHeaderRlpEncode() when, for example, `gasUsed` is zero.
+    size_t itemsBytesCount =
+        rlpSizeBytes   (header->parentHash.bytes,       ETHEREUM_HASH_BYTES) +
+        rlpSizeBytes   (header->ommersHash.bytes,       ETHEREUM_HASH_BYTES) +
+        rlpSizeBytes   (header->beneficiary.bytes,      ADDRESS_BYTES) +
+        rlpSizeBytes   (header->stateRoot.bytes,        ETHEREUM_HASH_BYTES) +
+        rlpSizeBytes   (header->transactionsRoot.bytes, ETHEREUM_HASH_BYTES) +
+        rlpSizeBytes   (header->receiptsRoot.bytes,     ETHEREUM_HASH_BYTES) +
+        rlpSizeBytes   (header->logsBloom.bytes,        ETHEREUM_BLOOM_FILTER_BYTES) +
+        rlpSizeUInt256 (header->difficulty, 1) +
+        rlpSizeUInt64  (header->number,     1) +
+        rlpSizeUInt64  (header->gasLimit,   1) +
+        rlpSizeUInt64  (header->gasUsed,    1) +
+        rlpSizeUInt64  (header->timestamp,  1) +
+        rlpSizeBytes   (header->extraData, header->extraDataCount);
+
+    uint8_t bytes[BLOCK_HEADER_SEAL_RLP_BYTES_LIMIT];
+    assert (rlpSizeList (itemsBytesCount) <= sizeof (bytes));
+
+    BRRlpWriter writer = rlpWriterCreate (bytes, sizeof (bytes));
+    rlpWriteList    (&writer, itemsBytesCount);
+    rlpWriteBytes   (&writer, header->parentHash.bytes,       ETHEREUM_HASH_BYTES);
+    rlpWriteBytes   (&writer, header->ommersHash.bytes,       ETHEREUM_HASH_BYTES);
+    rlpWriteBytes   (&writer, header->beneficiary.bytes,      ADDRESS_BYTES);
+    rlpWriteBytes   (&writer, header->stateRoot.bytes,        ETHEREUM_HASH_BYTES);
+    rlpWriteBytes   (&writer, header->transactionsRoot.bytes, ETHEREUM_HASH_BYTES);
+    rlpWriteBytes   (&writer, header->receiptsRoot.bytes,     ETHEREUM_HASH_BYTES);
+    rlpWriteBytes   (&writer, header->logsBloom.bytes,        ETHEREUM_BLOOM_FILTER_BYTES);
+    rlpWriteUInt256 (&writer, header->difficulty, 1);
+    rlpWriteUInt64  (&writer, header->number,     1);
+    rlpWriteUInt64  (&writer, header->gasLimit,   1);
+    rlpWriteUInt64  (&writer, header->gasUsed,    1);
+    rlpWriteUInt64  (&writer, header->timestamp,  1);
+    rlpWriteBytes   (&writer, header->extraData, header->extraDataCount);
+    assert (!rlpWriterHasFailed (&writer));
+
+    return ethHashCreateFromData (rlpWriterGetDataSharedDontRelease (&writer));
+}
+
 extern BREthereumBlockHeader
 blockHeaderRlpDecode (BRRlpItem item,
                       BREthereumRlpType type,
@@ -608,6 +720,56 @@ blockHeaderRlpDecode (BRRlpItem item,
 
 }
 
+extern BREthereumBlockHeader
+blockHeaderRlpDecodeCursor (BRRlpCursor *cursor,
+                            BREthereumRlpType type) {
+    BRRlpView view = rlpCursorNext (cursor);
+    BRRlpCursor items = rlpCursorEnter (cursor, view);
+
+    size_t itemsCount = rlpCursorCount (&items);
+    if (13 != itemsCount && 15 != itemsCount) { rlpCursorSetFailed (&items); return NULL; }
+
+    struct BREthereumBlockHeaderRecord record;
+    memset (&record, 0, sizeof (struct BREthereumBlockHeaderRecord));
+
+    record.parentHash = ethHashRlpDecodeCursor (&items);
+    record.ommersHash = ethHashRlpDecodeCursor (&items);
+    record.beneficiary = ethAddressRlpDecodeCursor (&items);
+    record.stateRoot = ethHashRlpDecodeCursor (&items);
+    record.transactionsRoot = ethHashRlpDecodeCursor (&items);
+    record.receiptsRoot = ethHashRlpDecodeCursor (&items);
+    record.logsBloom = bloomFilterRlpDecodeCursor (&items);
+    record.difficulty = rlpCursorNextUInt256 (&items);
+    record.number = rlpCursorNextUInt64 (&items);
+    record.gasLimit = rlpCursorNextUInt64 (&items);
+    record.gasUsed = rlpCursorNextUInt64 (&items);
+    record.timestamp = rlpCursorNextUInt64 (&items);
+
+    BRRlpData extraData = rlpCursorNextBytesSharedDontRelease (&items);
+    if (extraData.bytesCount > sizeof (record.extraData)) rlpCursorSetFailed (&items);
+    else {
+        memcpy (record.extraData, extraData.bytes, extraData.bytesCount);
+        record.extraDataCount = extraData.bytesCount;
+    }
+
+    if (15 == itemsCount) {
+        record.mixHash = ethHashRlpDecodeCursor (&items);
+        record.nonce = rlpCursorNextUInt64 (&items);
+    }
+
+    if (rlpCursorHasFailed (&items)) return NULL;
+
+#if defined (BLOCK_HEADER_LOG_ALLOC_COUNT)
+    eth_log ("MEM", "Block Header Create RLP: %d", ++blockHeaderAllocCount);
+#endif
+
+    record.hash = ethHashCreateFromData (view.encoding);
+
+    BREthereumBlockHeader header = (BREthereumBlockHeader) malloc (sizeof(struct BREthereumBlockHeaderRecord));
+    memcpy (header, &record, sizeof(struct BREthereumBlockHeaderRecord));
+    return header;
+}
+
 /// MARK: - Block
 
 //
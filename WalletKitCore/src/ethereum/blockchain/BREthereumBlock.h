@@ -70,7 +70,8 @@ blockHeaderIsInternallyValid (BREthereumBlockHeader header);
 /**
  * Check if the block header is valid.  If `parent` is NULL, then `header` is consisder
  * consistent (we'll check again at some point once we have the parent).  If `pow` is provided
- * then ProofOfWork is computed and used in validity.
+ * then ProofOfWork is computed and used in validity; a header with non-zero difficulty is not
+ * valid while the cache for its epoch is unavailable - use proofOfWorkIsReady() to wait.
  *
  * @note Section 4.3.3 'Block Header Validity in https://ethereum.github.io/yellowpaper/paper.pdf
  *
@@ -94,6 +95,14 @@ blockHeaderRlpDecode (BRRlpItem item,
                       BREthereumRlpType type,
                       BRRlpCoder coder);
 
+/**
+ * Decode a header in place from `cursor`; the header's hash is computed over the header's RLP
+ * encoding, also in place.  Returns NULL, with `cursor` failed, if the RLP is malformed.
+ */
+extern BREthereumBlockHeader
+blockHeaderRlpDecodeCursor (BRRlpCursor *cursor,
+                            BREthereumRlpType type);
+
 extern BRRlpItem
 blockHeaderRlpEncode (BREthereumBlockHeader header,
                       BREthereumBoolean withNonce,
@@ -118,6 +127,9 @@ blockHeaderGetTimestamp (BREthereumBlockHeader header);
 extern BREthereumHash
 blockHeaderGetParentHash (BREthereumBlockHeader header);
 
+extern BREthereumHash
+blockHeaderGetStateRoot (BREthereumBlockHeader header);
+
 extern BREthereumHash
 blockHeaderGetMixHash (BREthereumBlockHeader header);
 
@@ -129,6 +141,12 @@ blockHeaderIsCHTRoot (BREthereumBlockHeader header);
 extern uint64_t
 blockHeaderGetNonce (BREthereumBlockHeader header);
 
+/**
+ * The hash of `header` without its mixHash and nonce - the input to Ethash.
+ */
+extern BREthereumHash
+blockHeaderGetSealHash (BREthereumBlockHeader header);
+
 extern BREthereumBoolean
 blockHeaderMatch (BREthereumBlockHeader header,
                   BREthereumBloomFilter filter);
@@ -137,6 +155,30 @@ extern BREthereumBoolean
 blockHeaderMatchAddress (BREthereumBlockHeader header,
                          BREthereumAddress address);
 
+/**
+ * Fill `matches` with a bitmap for each of `count` `headers`; bit `f` is set if `filters[f]`
+ * matches the header's logsBloom.  All the headers are checked against all of the (at most
+ * BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT) `filters` in one pass - see bloomFilterMatchBatch().
+ *
+ * @returns the number of `headers` matching at least one of `filters`
+ */
+extern size_t
+blockHeadersMatch (BREthereumBlockHeader *headers,
+                   size_t count,
+                   const BREthereumBloomFilter *filters,
+                   size_t filtersCount,
+                   uint64_t *matches);
+
+/**
+ * Fill `matches` with blockHeaderMatchAddress() for each of `count` `headers`; the address' bloom
+ * filters are computed once.
+ */
+extern void
+blockHeadersMatchAddress (BREthereumBlockHeader *headers,
+                          size_t count,
+                          BREthereumAddress address,
+                          BREthereumBoolean *matches);
+
 // Support BRSet
 extern size_t
 blockHeaderHashValue (const void *h);
@@ -569,17 +611,64 @@ blockFree (BREthereumBlock block);
 
 /// MARK: - Proof of Work
 
+/**
+ * Create a ProofOfWork verifier using Ethash's 'light' algorithm - each header is checked
+ * against the ~16-64 MB cache for its 30000 block epoch.  Caches are generated on a background
+ * thread and the most recently used are kept.  If `cachePath` is not NULL, then it is a
+ * directory where generated caches are saved and from which they are memory-mapped on later
+ * use; otherwise caches are generated anew for each ProofOfWork.
+ *
+ * @param cachePath - a directory for saved caches, or NULL
+ */
 extern BREthereumProofOfWork
-proofOfWorkCreate (void);
+proofOfWorkCreate (const char *cachePath);
 
+/**
+ * Release `pow`, waiting for any background cache generation to stop.
+ */
 extern void
 proofOfWorkRelease (BREthereumProofOfWork pow);
 
+/**
+ * Remove the caches saved in `cachePath`.
+ */
+extern void
+proofOfWorkWipe (const char *cachePath);
+
+/**
+ * Generate, on the calling thread, the cache for `header`'s epoch if it is not already
+ * available.  If the cache is being generated in the background, wait for it.
+ */
 extern void
 proofOfWorkGenerate (BREthereumProofOfWork pow,
                      BREthereumBlockHeader header);
 
+/**
+ * Schedule background generation of the cache for `blockNumber`'s epoch if it is not already
+ * available; return immediately.
+ */
 extern void
+proofOfWorkPrepare (BREthereumProofOfWork pow,
+                    uint64_t blockNumber);
+
+/**
+ * Check if `header`'s proof of work can be computed without blocking - the cache for its epoch
+ * is available or `header` has zero difficulty.  If not, schedule generation of the cache (see
+ * proofOfWorkPrepare()) and return FALSE.
+ */
+extern BREthereumBoolean
+proofOfWorkIsReady (BREthereumProofOfWork pow,
+                    BREthereumBlockHeader header);
+
+/**
+ * Compute Ethash for `header`, filling `n` with the result and `m` with the mix hash.  If the
+ * cache for `header`'s epoch is not yet available, then schedule its generation (see
+ * proofOfWorkPrepare()) and return FALSE without blocking.  Returns FALSE for headers with
+ * zero difficulty, which carry no proof of work.
+ *
+ * @return ETHEREUM_BOOLEAN_TRUE if `n` and `m` were computed.
+ */
+extern BREthereumBoolean
 proofOfWorkCompute (BREthereumProofOfWork pow,
                     BREthereumBlockHeader header,
                     UInt256 *n,
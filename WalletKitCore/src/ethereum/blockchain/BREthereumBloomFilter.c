@@ -10,8 +10,16 @@
 
 #include <assert.h>
 #include <string.h>
+#include "support/BRCrypto.h"
 #include "BREthereumBloomFilter.h"
 
+// x86-64 sse2 and avx2 match kernels; avx2 is compiled with a per-function target attribute and
+// selected at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BLOOM_FILTER_X86 1
+#include <immintrin.h>
+#endif
+
 /* Forward Declarations */
 static void
 bloomFilterExtractLocation (unsigned int index, unsigned int *byteIndex, unsigned int *bitIndex);
@@ -52,6 +60,29 @@ bloomFilterCreateData (const BRRlpData data) {
     return bloomFilterCreateHash(ethHashCreateFromData(data));
 }
 
+extern void
+bloomFilterCreateDatas (BREthereumBloomFilter *filters,
+                        const BRRlpData *datas,
+                        size_t count) {
+    const void *bytes[count + 1];
+    size_t bytesCounts[count + 1];
+    BREthereumHash hashes[count + 1];
+
+    // The extra, unused entry keeps the arrays non-empty (and initialized) when `count` is zero.
+    bytes[count]       = NULL;
+    bytesCounts[count] = 0;
+
+    for (size_t index = 0; index < count; index++) {
+        bytes[index]       = datas[index].bytes;
+        bytesCounts[index] = datas[index].bytesCount;
+    }
+
+    BRKeccak256Batch (hashes, bytes, bytesCounts, count);
+
+    for (size_t index = 0; index < count; index++)
+        filters[index] = bloomFilterCreateHash (hashes[index]);
+}
+
 extern BREthereumBloomFilter
 bloomFilterCreateAddress (const BREthereumAddress address) {
     BRRlpData data;
@@ -91,7 +122,134 @@ bloomFilterEqual (const BREthereumBloomFilter filter1, const BREthereumBloomFilt
 
 extern BREthereumBoolean
 bloomFilterMatch (const BREthereumBloomFilter filter, const BREthereumBloomFilter other) {
-    return bloomFilterEqual(filter, bloomFilterOr(filter, other));
+    const BREthereumBloomFilter *filters[1] = { &filter };
+    uint64_t match;
+
+    bloomFilterMatchBatch (filters, 1, &other, 1, &match);
+    return AS_ETHEREUM_BOOLEAN (0 != match);
+}
+
+//
+// Batch Match
+//
+// A filter is handled as eight 32-byte lanes.  An interest filter (an address, a topic) sets
+// just three bits and thus occupies at most three lanes; only those lanes are tested, with one
+// AVX2 `vptest`, or two SSE2 compares, or four 64-bit word tests per lane.
+//
+#define BLOOM_FILTER_LANE_BYTES    (32)
+#define BLOOM_FILTER_LANE_COUNT    (ETHEREUM_BLOOM_FILTER_BYTES / BLOOM_FILTER_LANE_BYTES)
+
+typedef uint8_t BREthereumBloomFilterLanes;     // Bit `l` set if lane `l` has any bit set
+
+static BREthereumBloomFilterLanes
+bloomFilterGetLanes (const BREthereumBloomFilter *filter) {
+    BREthereumBloomFilterLanes lanes = 0;
+    for (size_t lane = 0; lane < BLOOM_FILTER_LANE_COUNT; lane++) {
+        const uint8_t *bytes = &filter->bytes[lane * BLOOM_FILTER_LANE_BYTES];
+        uint8_t any = 0;
+        for (size_t index = 0; index < BLOOM_FILTER_LANE_BYTES; index++)
+            any |= bytes[index];
+        if (any) lanes |= (1u << lane);
+    }
+    return lanes;
+}
+
+// TRUE if every bit of `other` in the lane starting at `other` is set in `filter`
+static inline int
+bloomFilterLaneContains (const uint8_t *filter, const uint8_t *other) {
+#if BLOOM_FILTER_X86
+    __m128i missing = _mm_or_si128 (_mm_andnot_si128 (_mm_loadu_si128 ((const __m128i *) &filter[ 0]),
+                                                      _mm_loadu_si128 ((const __m128i *) &other[ 0])),
+                                    _mm_andnot_si128 (_mm_loadu_si128 ((const __m128i *) &filter[16]),
+                                                      _mm_loadu_si128 ((const __m128i *) &other[16])));
+    return 0xffff == _mm_movemask_epi8 (_mm_cmpeq_epi8 (missing, _mm_setzero_si128()));
+#else
+    uint64_t f, o, missing = 0;
+    for (size_t index = 0; index < BLOOM_FILTER_LANE_BYTES; index += sizeof (uint64_t)) {
+        memcpy (&f, &filter[index], sizeof (uint64_t));
+        memcpy (&o, &other[index],  sizeof (uint64_t));
+        missing |= o & ~f;
+    }
+    return 0 == missing;
+#endif
+}
+
+static void
+bloomFilterMatchBatchLanes (const BREthereumBloomFilter *const filters[],
+                            size_t filtersCount,
+                            const BREthereumBloomFilter *others,
+                            const BREthereumBloomFilterLanes *othersLanes,
+                            size_t othersCount,
+                            uint64_t *matches) {
+    for (size_t f = 0; f < filtersCount; f++) {
+        const uint8_t *filter = filters[f]->bytes;
+        uint64_t match = 0;
+
+        for (size_t o = 0; o < othersCount; o++) {
+            int contains = 1;
+            for (size_t lane = 0; contains && lane < BLOOM_FILTER_LANE_COUNT; lane++)
+                if (othersLanes[o] & (1u << lane))
+                    contains = bloomFilterLaneContains (&filter[lane * BLOOM_FILTER_LANE_BYTES],
+                                                        &others[o].bytes[lane * BLOOM_FILTER_LANE_BYTES]);
+            if (contains) match |= (UINT64_C(1) << o);
+        }
+        matches[f] = match;
+    }
+}
+
+#if BLOOM_FILTER_X86
+__attribute__((target("avx2")))
+static void
+bloomFilterMatchBatchLanesAVX2 (const BREthereumBloomFilter *const filters[],
+                                size_t filtersCount,
+                                const BREthereumBloomFilter *others,
+                                const BREthereumBloomFilterLanes *othersLanes,
+                                size_t othersCount,
+                                uint64_t *matches) {
+    for (size_t f = 0; f < filtersCount; f++) {
+        const uint8_t *filter = filters[f]->bytes;
+        uint64_t match = 0;
+
+        for (size_t o = 0; o < othersCount; o++) {
+            int contains = 1;
+            for (size_t lane = 0; contains && lane < BLOOM_FILTER_LANE_COUNT; lane++)
+                if (othersLanes[o] & (1u << lane))
+                    // `vptest` sets CF iff (~filter & other) == 0
+                    contains = _mm256_testc_si256
+                    (_mm256_loadu_si256 ((const __m256i *) &filter[lane * BLOOM_FILTER_LANE_BYTES]),
+                     _mm256_loadu_si256 ((const __m256i *) &others[o].bytes[lane * BLOOM_FILTER_LANE_BYTES]));
+            if (contains) match |= (UINT64_C(1) << o);
+        }
+        matches[f] = match;
+    }
+}
+#endif
+
+extern size_t
+bloomFilterMatchBatch (const BREthereumBloomFilter *const filters[],
+                       size_t filtersCount,
+                       const BREthereumBloomFilter *others,
+                       size_t othersCount,
+                       uint64_t *matches) {
+    assert (othersCount <= BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT);
+    assert ((NULL != filters && NULL != matches) || 0 == filtersCount);
+    assert (NULL != others || 0 == othersCount);
+
+    BREthereumBloomFilterLanes othersLanes[BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT];
+    for (size_t o = 0; o < othersCount; o++)
+        othersLanes[o] = bloomFilterGetLanes (&others[o]);
+
+#if BLOOM_FILTER_X86
+    if (__builtin_cpu_supports ("avx2"))
+        bloomFilterMatchBatchLanesAVX2 (filters, filtersCount, others, othersLanes, othersCount, matches);
+    else
+#endif
+        bloomFilterMatchBatchLanes (filters, filtersCount, others, othersLanes, othersCount, matches);
+
+    size_t matched = 0;
+    for (size_t f = 0; f < filtersCount; f++)
+        if (0 != matches[f]) matched++;
+    return matched;
 }
 
 //
@@ -115,6 +273,13 @@ bloomFilterRlpDecode (BRRlpItem item, BRRlpCoder coder) {
     return filter;
 }
 
+extern BREthereumBloomFilter
+bloomFilterRlpDecodeCursor (BRRlpCursor *cursor) {
+    BREthereumBloomFilter filter;
+    rlpCursorNextBytesFixed (cursor, filter.bytes, 256, 0);
+    return filter;
+}
+
 //
 // As String
 //
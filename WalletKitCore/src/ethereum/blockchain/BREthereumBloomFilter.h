@@ -64,6 +64,14 @@ bloomFilterCreateHash (const BREthereumHash hash);
 extern BREthereumBloomFilter
 bloomFilterCreateData (const BRRlpData data);
 
+/**
+ * Fill `filters` with a BloomFilter for each of `count` `datas` - hashes all the datas in one batch
+ */
+extern void
+bloomFilterCreateDatas (BREthereumBloomFilter *filters,
+                        const BRRlpData *datas,
+                        size_t count);
+
 /**
  * Create a BloomFilter from `address` - computes the hash of `address`
  */
@@ -99,12 +107,41 @@ bloomFilterEqual (const BREthereumBloomFilter filter1, const BREthereumBloomFilt
 extern BREthereumBoolean
 bloomFilterMatch (const BREthereumBloomFilter filter, const BREthereumBloomFilter other);
 
+/**
+ * The maximum number of `others` in one bloomFilterMatchBatch() - one bit per other.
+ */
+#define BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT   (64)
+
+/**
+ * Check each of `filtersCount` `filters` against each of `othersCount` `others` in one pass.
+ * Typically `filters` would be the bloom filters for a run of block headers and `others` the
+ * addresses and topics of interest (the account, its tokens).
+ *
+ * @parameter filters
+ *
+ * @parameter others - at most BLOOM_FILTER_MATCH_BATCH_OTHERS_LIMIT
+ *
+ * @parameter matches - filled with `filtersCount` bitmaps; bit `o` of `matches[f]` is set if
+ *    `others[o]` matches `filters[f]`, as per bloomFilterMatch()
+ *
+ * @returns the number of `filters` matching at least one of `others`
+ */
+extern size_t
+bloomFilterMatchBatch (const BREthereumBloomFilter *const filters[],
+                       size_t filtersCount,
+                       const BREthereumBloomFilter *others,
+                       size_t othersCount,
+                       uint64_t *matches);
+
 extern BRRlpItem
 bloomFilterRlpEncode(BREthereumBloomFilter filter, BRRlpCoder coder);
 
 extern BREthereumBloomFilter
 bloomFilterRlpDecode (BRRlpItem item, BRRlpCoder coder);
 
+extern BREthereumBloomFilter
+bloomFilterRlpDecodeCursor (BRRlpCursor *cursor);
+
 /**
  * Return a hex-encode string representation of `filter`.
  */
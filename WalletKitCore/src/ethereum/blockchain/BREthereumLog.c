@@ -475,6 +475,38 @@ logRlpDecode (BRRlpItem item,
     return log;
 }
 
+extern BREthereumLog
+logRlpDecodeCursor (BRRlpCursor *cursor) {
+    BRRlpView view = rlpCursorNext (cursor);
+    BRRlpCursor items = rlpCursorEnter (cursor, view);
+    if (3 != rlpCursorCount (&items)) { rlpCursorSetFailed (&items); return NULL; }
+
+    BREthereumLog log = (BREthereumLog) calloc (1, sizeof (struct BREthereumLogRecord));
+
+    log->address = ethAddressRlpDecodeCursor (&items);
+
+    BRRlpCursor topics = rlpCursorNextList (&items);
+    array_new (log->topics, rlpCursorCount (&topics));
+    while (rlpCursorHasNext (&topics)) {
+        BREthereumLogTopic topic;
+        rlpCursorNextBytesFixed (&topics, topic.bytes, 32, 0);
+        array_add (log->topics, topic);
+    }
+
+    // As in logRlpDecode(), `data` is the complete RLP encoding of the third item.
+    BRRlpView data = rlpCursorNext (&items);
+
+    if (!rlpCursorFinish (&items)) {
+        logRelease (log);
+        return NULL;
+    }
+
+    log->data = rlpDataCopy (data.encoding);
+    log->identifier.transactionReceiptIndex = LOG_TRANSACTION_RECEIPT_INDEX_UNKNOWN;
+
+    return log;
+}
+
 extern BRRlpItem
 logRlpEncode(BREthereumLog log,
              BREthereumRlpType type,
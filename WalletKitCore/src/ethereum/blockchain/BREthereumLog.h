@@ -163,6 +163,13 @@ extern BREthereumLog
 logRlpDecode (BRRlpItem item,
               BREthereumRlpType type,
               BRRlpCoder coder);
+
+/**
+ * Decode a log, in the RLP_TYPE_NETWORK form, in place from `cursor`.  Returns NULL, with
+ * `cursor` failed, if the RLP is malformed.
+ */
+extern BREthereumLog
+logRlpDecodeCursor (BRRlpCursor *cursor);
 /**
  * [QUASI-INTERNAL - used by BREthereumBlock]
  */
@@ -32,6 +32,11 @@ struct BREthereumNetworkRecord {
 
     const char *enodesLCLParity[4];
     const char *enodesLCLGeth[4];
+
+    // A CHT root, as numbered by LES (see messageLESGetChtNumber()), trusted to root header
+    // proofs.  None is yet recorded; the root is EMPTY_HASH_INIT.
+    uint64_t trustedCHTNumber;
+    BREthereumHash trustedCHTRoot;
 };
 
 extern BREthereumChainId
@@ -52,6 +57,15 @@ ethNetworkGetTrustedCheckpointBlockHeaderHash (BREthereumNetwork network) {
     return network->trustedCheckpointBlockHeaderHash;
 }
 
+extern BREthereumHash
+ethNetworkGetTrustedCHTRoot (BREthereumNetwork network,
+                             uint64_t chtNumber) {
+    networkInitilizeAllIfAppropriate();
+    return (chtNumber == network->trustedCHTNumber
+            ? network->trustedCHTRoot
+            : EMPTY_HASH_INIT);
+}
+
 extern const char *
 ethNetworkGetName (BREthereumNetwork network) {
     return network->name;
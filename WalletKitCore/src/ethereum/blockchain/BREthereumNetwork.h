@@ -48,6 +48,14 @@ ethNetworkGetGenesisBlockHeaderHash (BREthereumNetwork network);
 extern BREthereumHash
 ethNetworkGetTrustedCheckpointBlockHeaderHash (BREthereumNetwork network);
 
+/**
+ * Get the trusted CHT root for `chtNumber`, the root against which a header proof for a block in
+ * that CHT is checked.  If no root is trusted, returns EMPTY_HASH_INIT.
+ */
+extern BREthereumHash
+ethNetworkGetTrustedCHTRoot (BREthereumNetwork network,
+                             uint64_t chtNumber);
+
 
 /**
  * Get an array of DNS seeds, with TXT records, for network
@@ -9,12 +9,24 @@
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
 #include <stdlib.h>
-#include <stdarg.h>
-#include "support/BRArray.h"
-#include "support/BRSet.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "support/BRInt.h"
+#include "support/BRCrypto.h"
 #include "ethereum/rlp/BRRlp.h"
 #include "BREthereumBlock.h"
 
+// See https://github.com/ethereum/wiki/wiki/Ethash
+
 #define POW_WORD_BYTES            (4)
 #define POW_DATA_SET_INIT         (1 << 30)
 #define POW_DATA_SET_GROWTH       (1 << 23)
@@ -27,141 +39,536 @@
 #define POW_CACHE_ROUNDS          (3)
 #define POW_ACCESSES              (64)
 
+#define POW_NODE_WORDS            (POW_HASH_BYTES / POW_WORD_BYTES)
+#define POW_MIX_WORDS             (POW_MIX_BYTES  / POW_WORD_BYTES)
+#define POW_FNV_PRIME             (0x01000193)
+
+// The epoch caches kept in memory - typically the current epoch and, near an epoch boundary,
+// its successor.  Each is 16 MB plus 128 KB per epoch.
+#define POW_CACHE_COUNT           (2)
+
+// Check if background generation should stop after this many cache nodes.
+#define POW_QUIT_CHECK_NODES      (1 << 14)
+
+// A saved cache is a 64 byte prefix - magic, version, epoch, cache size and zero padding -
+// followed by the cache itself.
+#define POW_FILE_MAGIC            (0x48534845) // "EHSH"
+#define POW_FILE_VERSION          (1)
+#define POW_FILE_PREFIX           (64)
+#define POW_FILE_NAME_PREFIX      "epoch-"
+
+//
+// Epoch Cache
+//
+typedef struct {
+    uint64_t epoch;
+    uint64_t cacheSize;     // bytes; a multiple of POW_HASH_BYTES
+    uint64_t datasetSize;   // bytes; the full dataset is never built, only its size is needed
+    uint8_t *cache;         // `cacheSize` bytes of little-endian words
+
+    uint8_t *map;           // if memory-mapped from a saved cache; `cache` points into `map`
+    size_t mapSize;
+
+    uint64_t used;          // the ProofOfWork's `uses` at the last use; 0 if an empty slot
+} BREthereumEpochCache;
+
 //
 // Proof Of Work
 //
 struct BREthereumProofOfWorkStruct {
-    int foo;
-};
+    char *cachePath;
 
-extern BREthereumProofOfWork
-proofOfWorkCreate (void) {
-    BREthereumProofOfWork pow = calloc (1, sizeof (struct BREthereumProofOfWorkStruct));
+    BREthereumEpochCache caches[POW_CACHE_COUNT];
+    uint64_t uses;
 
-    pow->foo = 0;
+    // At most one epoch cache is generated in the background at a time.
+    int generating;
+    uint64_t generatingEpoch;
+    int quit;
 
-    return pow;
-}
+    pthread_mutex_t lock;
+    pthread_cond_t  generated;
+};
 
-extern void
-proofOfWorkRelease (BREthereumProofOfWork pow) {
-    free (pow);
+/// MARK: - Sizes
+
+static int
+powIsPrime (uint64_t x) {
+    if (x < 2) return 0;
+    for (uint64_t d = 2; d * d <= x; d++)
+        if (0 == x % d) return 0;
+    return 1;
 }
 
-#if defined (INCLUDE_UNUSED_FUNCTIONS)
 static uint64_t
-powEpoch (BREthereumBlockHeader header) {
-    return blockHeaderGetNonce(header) / POW_EPOCH;
+powCacheSize (uint64_t epoch) {
+    uint64_t size = POW_CACHE_INIT + POW_CACHE_GROWTH * epoch - POW_HASH_BYTES;
+    while (!powIsPrime (size / POW_HASH_BYTES)) size -= 2 * POW_HASH_BYTES;
+    return size;
 }
 
 static uint64_t
-powPrime (uint64_t x, uint64_t y) {
-    return (0 == x % y
-            ? x
-            : powPrime (x - 2 * y, y));
+powDatasetSize (uint64_t epoch) {
+    uint64_t size = POW_DATA_SET_INIT + POW_DATA_SET_GROWTH * epoch - POW_MIX_BYTES;
+    while (!powIsPrime (size / POW_MIX_BYTES)) size -= 2 * POW_MIX_BYTES;
+    return size;
 }
 
-static uint64_t
-powDatasetSize (BREthereumBlockHeader header) {
-    return powPrime (POW_DATA_SET_INIT + POW_DATA_SET_GROWTH * powEpoch(header) - POW_MIX_BYTES,
-                     POW_MIX_BYTES);
+static void
+powSeedHash (uint64_t epoch, uint8_t seed[32]) {
+    memset (seed, 0, 32);
+    for (uint64_t index = 0; index < epoch; index++)
+        BRKeccak256 (seed, seed, 32);
 }
 
-static uint64_t
-powCacheSize (BREthereumBlockHeader header) {
-    return powPrime (POW_CACHE_INIT + POW_CACHE_GROWTH * powEpoch(header) - POW_HASH_BYTES,
-                     POW_HASH_BYTES);
+/// MARK: - Hashimoto
+
+static inline uint32_t
+powFNV (uint32_t x, uint32_t y) {
+    return (x * POW_FNV_PRIME) ^ y;
+}
+
+static void
+powNodeHash (uint32_t node[POW_NODE_WORDS]) {
+    uint8_t bytes[POW_HASH_BYTES];
+
+    for (size_t index = 0; index < POW_NODE_WORDS; index++) UInt32SetLE (&bytes[4 * index], node[index]);
+    BRKeccak512 (bytes, bytes, POW_HASH_BYTES);
+    for (size_t index = 0; index < POW_NODE_WORDS; index++) node[index] = UInt32GetLE (&bytes[4 * index]);
+}
+
+// Compute item `index` of the full dataset from the cache.
+static void
+powDatasetItem (const uint8_t *cache,
+                uint32_t nodes,
+                uint32_t index,
+                uint32_t item[POW_NODE_WORDS]) {
+    const uint8_t *node = &cache[POW_HASH_BYTES * (index % nodes)];
+
+    for (size_t k = 0; k < POW_NODE_WORDS; k++) item[k] = UInt32GetLE (&node[4 * k]);
+    item[0] ^= index;
+    powNodeHash (item);
+
+    for (uint32_t j = 0; j < POW_PARENTS; j++) {
+        node = &cache[POW_HASH_BYTES * (powFNV (index ^ j, item[j % POW_NODE_WORDS]) % nodes)];
+        for (size_t k = 0; k < POW_NODE_WORDS; k++) item[k] = powFNV (item[k], UInt32GetLE (&node[4 * k]));
+    }
+    powNodeHash (item);
+}
+
+static void
+powHashimotoLight (const BREthereumEpochCache *ec,
+                   const uint8_t headerHash[32],
+                   uint64_t nonce,
+                   uint8_t mixHash[32],
+                   uint8_t result[32]) {
+    uint32_t nodes = (uint32_t) (ec->cacheSize   / POW_HASH_BYTES);
+    uint32_t pages = (uint32_t) (ec->datasetSize / POW_MIX_BYTES);
+
+    // The seed, `s`, followed by the compressed mix
+    uint8_t bytes[POW_HASH_BYTES + POW_MIX_BYTES / 4];
+    uint32_t s[POW_NODE_WORDS], mix[POW_MIX_WORDS], item[POW_NODE_WORDS];
+
+    memcpy (bytes, headerHash, 32);
+    UInt64SetLE (&bytes[32], nonce);
+    BRKeccak512 (bytes, bytes, 40);
+
+    for (size_t k = 0; k < POW_NODE_WORDS; k++) s[k] = UInt32GetLE (&bytes[4 * k]);
+    for (size_t k = 0; k < POW_MIX_WORDS;  k++) mix[k] = s[k % POW_NODE_WORDS];
+
+    for (uint32_t i = 0; i < POW_ACCESSES; i++) {
+        uint32_t page = powFNV (i ^ s[0], mix[i % POW_MIX_WORDS]) % pages;
+
+        for (uint32_t h = 0; h < POW_MIX_BYTES / POW_HASH_BYTES; h++) {
+            powDatasetItem (ec->cache, nodes, page * (POW_MIX_BYTES / POW_HASH_BYTES) + h, item);
+            for (size_t k = 0; k < POW_NODE_WORDS; k++)
+                mix[h * POW_NODE_WORDS + k] = powFNV (mix[h * POW_NODE_WORDS + k], item[k]);
+        }
+    }
+
+    for (size_t k = 0; k < POW_MIX_WORDS; k += 4)
+        UInt32SetLE (&bytes[POW_HASH_BYTES + k],
+                     powFNV (powFNV (powFNV (mix[k], mix[k + 1]), mix[k + 2]), mix[k + 3]));
+
+    memcpy (mixHash, &bytes[POW_HASH_BYTES], 32);
+    BRKeccak256 (result, bytes, sizeof (bytes));
+}
+
+/// MARK: - Epoch Cache
+
+static int
+powHasQuit (BREthereumProofOfWork pow) {
+    pthread_mutex_lock (&pow->lock);
+    int quit = pow->quit;
+    pthread_mutex_unlock (&pow->lock);
+    return quit;
+}
+
+// Fill `ec->cache`; returns 0 if `pow` quit before the cache was complete.
+static int
+powEpochCacheGenerate (BREthereumProofOfWork pow,
+                       BREthereumEpochCache *ec) {
+    uint8_t *cache = ec->cache;
+    uint64_t nodes = ec->cacheSize / POW_HASH_BYTES;
+    uint8_t seed[32], x[POW_HASH_BYTES];
+
+    powSeedHash (ec->epoch, seed);
+    BRKeccak512 (cache, seed, sizeof (seed));
+    for (uint64_t i = 1; i < nodes; i++) {
+        BRKeccak512 (&cache[POW_HASH_BYTES * i], &cache[POW_HASH_BYTES * (i - 1)], POW_HASH_BYTES);
+        if (0 == i % POW_QUIT_CHECK_NODES && powHasQuit (pow)) return 0;
+    }
+
+    for (size_t round = 0; round < POW_CACHE_ROUNDS; round++)
+        for (uint64_t i = 0; i < nodes; i++) {
+            const uint8_t *u = &cache[POW_HASH_BYTES * ((i + nodes - 1) % nodes)];
+            const uint8_t *v = &cache[POW_HASH_BYTES * (UInt32GetLE (&cache[POW_HASH_BYTES * i]) % nodes)];
+
+            for (size_t k = 0; k < POW_HASH_BYTES; k++) x[k] = u[k] ^ v[k];
+            BRKeccak512 (&cache[POW_HASH_BYTES * i], x, POW_HASH_BYTES);
+            if (0 == i % POW_QUIT_CHECK_NODES && powHasQuit (pow)) return 0;
+        }
+
+    return 1;
+}
+
+static char *
+powEpochCacheCreateFilename (const char *cachePath, uint64_t epoch, const char *suffix) {
+    size_t filenameLength = strlen (cachePath) + strlen ("/" POW_FILE_NAME_PREFIX) + 20 + strlen (suffix) + 1;
+    char *filename = malloc (filenameLength);
+    snprintf (filename, filenameLength, "%s/" POW_FILE_NAME_PREFIX "%" PRIu64 "%s", cachePath, epoch, suffix);
+    return filename;
+}
+
+// Map the cache for `ec->epoch` saved in `cachePath`; returns 0 if there is no valid saved cache.
+static int
+powEpochCacheLoad (BREthereumEpochCache *ec,
+                   const char *cachePath) {
+    char *filename = powEpochCacheCreateFilename (cachePath, ec->epoch, "");
+    int fd = open (filename, O_RDONLY | O_CLOEXEC);
+    free (filename);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    size_t mapSize = POW_FILE_PREFIX + ec->cacheSize;
+    if (fstat (fd, &st) < 0 || (size_t) st.st_size != mapSize) { close (fd); return 0; }
+
+    uint8_t *map = mmap (NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (MAP_FAILED == map) return 0;
+
+    // A truncated or stale file fails the prefix check; the first node guards against a file
+    // written for a different seed.
+    uint8_t seed[32], node[POW_HASH_BYTES];
+    powSeedHash (ec->epoch, seed);
+    BRKeccak512 (node, seed, sizeof (seed));
+
+    if (POW_FILE_MAGIC   != UInt32GetLE (&map[0]) ||
+        POW_FILE_VERSION != UInt32GetLE (&map[4]) ||
+        ec->epoch        != UInt64GetLE (&map[8]) ||
+        ec->cacheSize    != UInt64GetLE (&map[16]) ||
+        0 != memcmp (node, &map[POW_FILE_PREFIX], POW_HASH_BYTES)) {
+        munmap (map, mapSize);
+        return 0;
+    }
+
+    ec->map     = map;
+    ec->mapSize = mapSize;
+    ec->cache   = &map[POW_FILE_PREFIX];
+    return 1;
+}
+
+static int
+powWriteAll (int fd, const uint8_t *bytes, size_t bytesCount) {
+    while (bytesCount > 0) {
+        ssize_t written = write (fd, bytes, bytesCount);
+        if (written < 0 && EINTR == errno) continue;
+        if (written <= 0) return 0;
+        bytes      += written;
+        bytesCount -= (size_t) written;
+    }
+    return 1;
 }
 
-static BREthereumHash
-powSeedHashInternal (uint64_t number) {
-    BREthereumHash bytes;
+// Save `ec` to `cachePath`, written to a temporary file and then renamed so that a partially
+// written cache is never loaded.  Failing to save is not an error; the cache is regenerated.
+static void
+powEpochCacheSave (const BREthereumEpochCache *ec,
+                   const char *cachePath) {
+    mkdir (cachePath, 0700);
+
+    char *filename    = powEpochCacheCreateFilename (cachePath, ec->epoch, "");
+    char *filenameTmp = powEpochCacheCreateFilename (cachePath, ec->epoch, ".tmp");
+
+    int fd = open (filenameTmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        uint8_t prefix[POW_FILE_PREFIX];
+        memset (prefix, 0, sizeof (prefix));
+        UInt32SetLE (&prefix[0],  POW_FILE_MAGIC);
+        UInt32SetLE (&prefix[4],  POW_FILE_VERSION);
+        UInt64SetLE (&prefix[8],  ec->epoch);
+        UInt64SetLE (&prefix[16], ec->cacheSize);
+
+        int saved = (powWriteAll (fd, prefix, sizeof (prefix)) &&
+                     powWriteAll (fd, ec->cache, ec->cacheSize));
 
-    if (0 == number)
-        memset (bytes.bytes, 0, 32);
-    else
-        bytes = powSeedHashInternal(number - POW_EPOCH);
+        close (fd);
+        if (!saved || 0 != rename (filenameTmp, filename))
+            unlink (filenameTmp);
+    }
 
-    return hashCreateFromData ((BRRlpData) { 32, bytes.bytes });
+    free (filenameTmp);
+    free (filename);
 }
 
-static BREthereumHash
-powSeedHash (BREthereumBlockHeader header) {
-    return powSeedHashInternal(blockHeaderGetNumber(header));
+// Create the cache for `epoch`, from a saved cache if possible.  Called without `pow->lock`;
+// returns 0 if `pow` quit first.
+static int
+powEpochCacheCreate (BREthereumProofOfWork pow,
+                     uint64_t epoch,
+                     BREthereumEpochCache *ec) {
+    ec->epoch       = epoch;
+    ec->cacheSize   = powCacheSize (epoch);
+    ec->datasetSize = powDatasetSize (epoch);
+    ec->cache       = NULL;
+    ec->map         = NULL;
+    ec->mapSize     = 0;
+    ec->used        = 0;
+
+    if (NULL != pow->cachePath && powEpochCacheLoad (ec, pow->cachePath)) return 1;
+
+    ec->cache = malloc (ec->cacheSize);
+    if (NULL == ec->cache) return 0;
+
+    if (!powEpochCacheGenerate (pow, ec)) {
+        free (ec->cache);
+        return 0;
+    }
+
+    if (NULL != pow->cachePath) powEpochCacheSave (ec, pow->cachePath);
+    return 1;
+}
+
+static void
+powEpochCacheRelease (BREthereumEpochCache *ec) {
+    if (NULL != ec->map) munmap (ec->map, ec->mapSize);
+    else free (ec->cache);
+    memset (ec, 0, sizeof (BREthereumEpochCache));
 }
 
-static BREthereumData
-powLittleRMH (BREthereumData x, uint64_t i, uint64_t n) {
-    return x;
+// Find the cache for `epoch`, marking it as used.  Requires `pow->lock`.
+static BREthereumEpochCache *
+powEpochCacheLookup (BREthereumProofOfWork pow,
+                     uint64_t epoch) {
+    for (size_t index = 0; index < POW_CACHE_COUNT; index++)
+        if (0 != pow->caches[index].used && epoch == pow->caches[index].epoch) {
+            pow->caches[index].used = ++pow->uses;
+            return &pow->caches[index];
+        }
+    return NULL;
 }
 
-static BREthereumData
-powBigRMH (BREthereumData x, uint64_t n) {
-    for (uint64_t i = 0; i < n; i++)
-        powLittleRMH(x, i, n);
-    return x;
+// Add `ec`, evicting the least recently used cache if needed.  Requires `pow->lock`.
+static void
+powEpochCacheInsert (BREthereumProofOfWork pow,
+                     BREthereumEpochCache *ec) {
+    if (NULL != powEpochCacheLookup (pow, ec->epoch)) {
+        powEpochCacheRelease (ec);
+        return;
+    }
+
+    BREthereumEpochCache *slot = &pow->caches[0];
+    for (size_t index = 1; index < POW_CACHE_COUNT; index++)
+        if (pow->caches[index].used < slot->used) slot = &pow->caches[index];
+
+    if (0 != slot->used) {
+        // The saved cache goes with the in-memory one; only recently used epochs stay on disk.
+        if (NULL != pow->cachePath) {
+            char *filename = powEpochCacheCreateFilename (pow->cachePath, slot->epoch, "");
+            unlink (filename);
+            free (filename);
+        }
+        powEpochCacheRelease (slot);
+    }
+
+    *slot = *ec;
+    slot->used = ++pow->uses;
 }
 
-static BREthereumData
-powCacheRounds (BREthereumData x, uint64_t y, uint64_t n) {
-    return (0 == y
-            ? x
-            : (1 == y
-               ? powBigRMH (x, n)
-               : powCacheRounds (powBigRMH (x, n), y - 1, n)));
+/// MARK: - Background Generation
+
+static void *
+powGenerateThread (BREthereumProofOfWork pow) {
+    pthread_mutex_lock (&pow->lock);
+    uint64_t epoch = pow->generatingEpoch;
+    pthread_mutex_unlock (&pow->lock);
+
+    BREthereumEpochCache ec;
+    int created = powEpochCacheCreate (pow, epoch, &ec);
+
+    pthread_mutex_lock (&pow->lock);
+    if (created) powEpochCacheInsert (pow, &ec);
+    pow->generating = 0;
+    pthread_cond_broadcast (&pow->generated);
+    pthread_mutex_unlock (&pow->lock);
+
+    return NULL;
 }
 
+// Start generating the cache for `epoch` unless it exists or some cache is being generated
+// already - in which case a later request will start it.  Requires `pow->lock`.
 static void
-powBigFNV (BREthereumData x,
-           BREthereumData y) {
+powScheduleGenerate (BREthereumProofOfWork pow,
+                     uint64_t epoch) {
+    if (pow->quit || pow->generating || NULL != powEpochCacheLookup (pow, epoch)) return;
+
+    pow->generating = 1;
+    pow->generatingEpoch = epoch;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+    if (0 != pthread_create (&thread, &attr, (void* (*) (void*)) powGenerateThread, pow))
+        pow->generating = 0;
+
+    pthread_attr_destroy (&attr);
 }
 
-static BREthereumData
-powMix (BREthereumData m,
-        BREthereumData c,
-        uint64_t i,
-        uint64_t p) {
-    return (0 == p
-            ? m
-            : m);
+/// MARK: - Proof Of Work
+
+extern BREthereumProofOfWork
+proofOfWorkCreate (const char *cachePath) {
+    BREthereumProofOfWork pow = calloc (1, sizeof (struct BREthereumProofOfWorkStruct));
+
+    pow->cachePath = (NULL == cachePath ? NULL : strdup (cachePath));
+    pow->uses = 0;
+    pow->generating = 0;
+    pow->quit = 0;
+
+    pthread_mutex_init (&pow->lock, NULL);
+    pthread_cond_init  (&pow->generated, NULL);
+
+    return pow;
 }
 
-static BREthereumData
-powParents (BREthereumData c,
-            uint64_t i,
-            uint64_t p,
-            BREthereumData m) {
-    return (p < POW_PARENTS - 1
-            ? powParents(c, i, p + 1, powMix (m, c, i, p + 1))
-            : powMix (m, c, i, p + 1));
+extern void
+proofOfWorkRelease (BREthereumProofOfWork pow) {
+    if (NULL == pow) return;
+
+    pthread_mutex_lock (&pow->lock);
+    pow->quit = 1;
+    while (pow->generating)
+        pthread_cond_wait (&pow->generated, &pow->lock);
+    pthread_mutex_unlock (&pow->lock);
+
+    for (size_t index = 0; index < POW_CACHE_COUNT; index++)
+        if (0 != pow->caches[index].used)
+            powEpochCacheRelease (&pow->caches[index]);
+
+    pthread_cond_destroy  (&pow->generated);
+    pthread_mutex_destroy (&pow->lock);
+
+    if (NULL != pow->cachePath) free (pow->cachePath);
+    free (pow);
 }
 
-static BREthereumData
-powDatasetItem (BREthereumData c,
-                uint64_t i) {
-    return powParents(c, i, -i, (BREthereumData) { 0, NULL });
+extern void
+proofOfWorkWipe (const char *cachePath) {
+    DIR *dir = opendir (cachePath);
+    if (NULL == dir) return;
+
+    struct dirent *entry;
+    while (NULL != (entry = readdir (dir))) {
+        if (0 != strncmp (entry->d_name, POW_FILE_NAME_PREFIX, strlen (POW_FILE_NAME_PREFIX))) continue;
+
+        size_t filenameLength = strlen (cachePath) + 1 + strlen (entry->d_name) + 1;
+        char *filename = malloc (filenameLength);
+        snprintf (filename, filenameLength, "%s/%s", cachePath, entry->d_name);
+        unlink (filename);
+        free (filename);
+    }
+
+    closedir (dir);
+    rmdir (cachePath);
 }
-// On and On and On....
-#endif
 
 extern void
-proofOfWorkGenerate(BREthereumProofOfWork pow,
-                       BREthereumBlockHeader header) {
-    //
+proofOfWorkGenerate (BREthereumProofOfWork pow,
+                     BREthereumBlockHeader header) {
+    uint64_t epoch = blockHeaderGetNumber (header) / POW_EPOCH;
+
+    pthread_mutex_lock (&pow->lock);
+    while (pow->generating && epoch == pow->generatingEpoch)
+        pthread_cond_wait (&pow->generated, &pow->lock);
+    int exists = (NULL != powEpochCacheLookup (pow, epoch));
+    pthread_mutex_unlock (&pow->lock);
+
+    if (exists) return;
+
+    BREthereumEpochCache ec;
+    if (powEpochCacheCreate (pow, epoch, &ec)) {
+        pthread_mutex_lock (&pow->lock);
+        powEpochCacheInsert (pow, &ec);
+        pthread_mutex_unlock (&pow->lock);
+    }
 }
 
 extern void
+proofOfWorkPrepare (BREthereumProofOfWork pow,
+                    uint64_t blockNumber) {
+    pthread_mutex_lock (&pow->lock);
+    powScheduleGenerate (pow, blockNumber / POW_EPOCH);
+    pthread_mutex_unlock (&pow->lock);
+}
+
+extern BREthereumBoolean
+proofOfWorkIsReady (BREthereumProofOfWork pow,
+                    BREthereumBlockHeader header) {
+    if (UInt256IsZero (blockHeaderGetDifficulty (header))) return ETHEREUM_BOOLEAN_TRUE;
+
+    uint64_t epoch = blockHeaderGetNumber (header) / POW_EPOCH;
+
+    pthread_mutex_lock (&pow->lock);
+    int ready = NULL != powEpochCacheLookup (pow, epoch);
+    if (!ready) powScheduleGenerate (pow, epoch);
+    pthread_mutex_unlock (&pow->lock);
+
+    return AS_ETHEREUM_BOOLEAN (ready);
+}
+
+extern BREthereumBoolean
 proofOfWorkCompute (BREthereumProofOfWork pow,
-                       BREthereumBlockHeader header,
-                       UInt256 *n,
-                       BREthereumHash *m) {
+                    BREthereumBlockHeader header,
+                    UInt256 *n,
+                    BREthereumHash *m) {
     assert (NULL != n && NULL != m);
 
-    // On and on and on
+    // Since 'The Merge' headers have zero difficulty, a zero nonce and carry PREVRANDAO in the
+    // mixHash field; there is nothing to compute.
+    if (UInt256IsZero (blockHeaderGetDifficulty (header))) return ETHEREUM_BOOLEAN_FALSE;
+
+    uint64_t epoch = blockHeaderGetNumber (header) / POW_EPOCH;
+
+    BREthereumHash headerHash = blockHeaderGetSealHash (header);
+
+    uint8_t mixHash[32], result[32];
+
+    // Hold the lock so that `ec` can't be evicted while in use.
+    pthread_mutex_lock (&pow->lock);
+    BREthereumEpochCache *ec = powEpochCacheLookup (pow, epoch);
+    if (NULL == ec) {
+        powScheduleGenerate (pow, epoch);
+        pthread_mutex_unlock (&pow->lock);
+        return ETHEREUM_BOOLEAN_FALSE;
+    }
+    powHashimotoLight (ec, headerHash.bytes, blockHeaderGetNonce (header), mixHash, result);
+    pthread_mutex_unlock (&pow->lock);
 
-    // TODO: Actually compute something.
+    // `result` is a big-endian number
+    memcpy (m->bytes, mixHash, 32);
+    *n = UInt256Reverse (UInt256Get (result));
 
-    // For now, return values that allow subsequent use to succeed
-    *n = UINT256_ZERO;
-    *m = blockHeaderGetMixHash (header);
+    return ETHEREUM_BOOLEAN_TRUE;
 }
@@ -307,6 +307,23 @@ transactionSetHash (BREthereumTransaction transaction,
     transaction->hash = hash;
 }
 
+// Transactions are typically a few hundred bytes; encode those on the stack.
+#define TRANSACTION_RLP_STACK_BYTES     (1024)
+
+extern BRRlpData
+transactionRlpEncodeData (BREthereumTransaction transaction,
+                          BREthereumNetwork network,
+                          BREthereumRlpType type,
+                          uint8_t *bytes,
+                          size_t bytesCount) {
+    size_t count = transactionRlpEncodeBytes (transaction, network, type, bytes, bytesCount);
+    if (count > bytesCount) {
+        bytes = malloc (count);
+        transactionRlpEncodeBytes (transaction, network, type, bytes, count);
+    }
+    return (BRRlpData) { count, bytes };
+}
+
 extern BREthereumSignature
 transactionGetSignature (BREthereumTransaction transaction) {
     return transaction->signature;
@@ -323,16 +340,16 @@ transactionExtractAddress(BREthereumTransaction transaction,
 
     int success = 1;
 
-    BRRlpItem item = transactionRlpEncode (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED, coder);
-    BRRlpData data = rlpItemGetData(coder, item);
+    uint8_t bytes[TRANSACTION_RLP_STACK_BYTES];
+    BRRlpData data = transactionRlpEncodeData (transaction, network, RLP_TYPE_TRANSACTION_UNSIGNED,
+                                               bytes, sizeof (bytes));
 
     BREthereumAddress address = ethSignatureExtractAddress(transaction->signature,
                                    data.bytes,
                                    data.bytesCount,
                                    &success);
     
-    rlpDataRelease(data);
-    rlpItemRelease(coder, item);
+    if (data.bytes != bytes) rlpDataRelease(data);
     return address;
 }
 
@@ -409,6 +426,74 @@ transactionRlpEncode(BREthereumTransaction transaction,
     return result;
 }
 
+extern size_t
+transactionRlpEncodeBytes (BREthereumTransaction transaction,
+                           BREthereumNetwork network,
+                           BREthereumRlpType type,
+                           uint8_t *bytes,
+                           size_t bytesCount) {
+    assert (RLP_TYPE_TRANSACTION_UNSIGNED == type || RLP_TYPE_TRANSACTION_SIGNED == type);
+    int isSigned = (RLP_TYPE_TRANSACTION_SIGNED == type);
+
+    // As in transactionRlpEncode(), including EIP-155 for { v, r, s }
+    transaction->chainId = ethNetworkGetChainId(network);
+
+    uint64_t v = (isSigned
+                  ? transaction->signature.sig.vrs.v + 8 + 2 * transaction->chainId
+                  : (uint64_t) transaction->chainId);
+    uint8_t *r = transaction->signature.sig.vrs.r;
+    uint8_t *s = transaction->signature.sig.vrs.s;
+
+    size_t itemsBytesCount =
+    (rlpSizeUInt64  (transaction->nonce, 1) +
+     rlpSizeUInt256 (transaction->gasPrice.etherPerGas.valueInWEI, 1) +
+     rlpSizeUInt64  (transaction->gasLimit.amountOfGas, 1) +
+     rlpSizeBytes   (transaction->targetAddress.bytes, sizeof (transaction->targetAddress.bytes)) +
+     rlpSizeUInt256 (transaction->amount.valueInWEI, 1) +
+     rlpSizeHexString (transaction->data) +
+     rlpSizeUInt64  (v, 1) +
+     (isSigned ? rlpSizeBytesPurgeLeadingZeros (r, 32) : rlpSizeBytes (NULL, 0)) +
+     (isSigned ? rlpSizeBytesPurgeLeadingZeros (s, 32) : rlpSizeBytes (NULL, 0)));
+
+    size_t count = rlpSizeList (itemsBytesCount);
+    if (NULL == bytes || bytesCount < count) return count;
+
+    BRRlpWriter writer = rlpWriterCreate (bytes, count);
+
+    rlpWriteList    (&writer, itemsBytesCount);
+    rlpWriteUInt64  (&writer, transaction->nonce, 1);
+    rlpWriteUInt256 (&writer, transaction->gasPrice.etherPerGas.valueInWEI, 1);
+    rlpWriteUInt64  (&writer, transaction->gasLimit.amountOfGas, 1);
+    rlpWriteBytes   (&writer, transaction->targetAddress.bytes, sizeof (transaction->targetAddress.bytes));
+    rlpWriteUInt256 (&writer, transaction->amount.valueInWEI, 1);
+    rlpWriteHexString (&writer, transaction->data);
+    rlpWriteUInt64  (&writer, v, 1);
+    if (isSigned) {
+        rlpWriteBytesPurgeLeadingZeros (&writer, r, 32);
+        rlpWriteBytesPurgeLeadingZeros (&writer, s, 32);
+    }
+    else {
+        rlpWriteBytes (&writer, NULL, 0);
+        rlpWriteBytes (&writer, NULL, 0);
+    }
+
+    assert (!rlpWriterHasFailed (&writer) && count == writer.bytesIndex);
+    return count;
+}
+
+extern BREthereumHash
+transactionGetRlpHash (BREthereumTransaction transaction,
+                       BREthereumNetwork network,
+                       BREthereumRlpType type) {
+    uint8_t bytes[TRANSACTION_RLP_STACK_BYTES];
+    BRRlpData data = transactionRlpEncodeData (transaction, network, type, bytes, sizeof (bytes));
+
+    BREthereumHash hash = ethHashCreateFromData (data);
+
+    if (data.bytes != bytes) rlpDataRelease (data);
+    return hash;
+}
+
 //
 // Tranaction RLP Decode
 //
@@ -502,6 +587,9 @@ extern BRRlpData
 transactionGetRlpData (BREthereumTransaction transaction,
                        BREthereumNetwork network,
                        BREthereumRlpType type) {
+    if (RLP_TYPE_ARCHIVE != type)
+        return transactionRlpEncodeData (transaction, network, type, NULL, 0);
+
     BRRlpCoder coder = rlpCoderCreate();
     BRRlpItem item   = transactionRlpEncode (transaction, network, type, coder);
     BRRlpData data   = rlpItemGetData (coder, item);
@@ -519,9 +607,7 @@ transactionGetRlpHexEncoded (BREthereumTransaction transaction,
                              const char *prefix) {
     if (NULL == prefix) prefix = "";
 
-    BRRlpCoder coder = rlpCoderCreate();
-    BRRlpItem item = transactionRlpEncode (transaction, network, type, coder);
-    BRRlpData data = rlpItemGetDataSharedDontRelease(coder, item);
+    BRRlpData data = transactionGetRlpData (transaction, network, type);
 
     char *result;
 
@@ -534,8 +620,7 @@ transactionGetRlpHexEncoded (BREthereumTransaction transaction,
         hexEncode(&result[strlen(prefix)], 2 * data.bytesCount + 1, data.bytes, data.bytesCount);
     }
 
-    rlpItemRelease(coder, item);
-    rlpCoderRelease(coder);
+    rlpDataRelease(data);
     return result;
 }
 
@@ -180,6 +180,40 @@ transactionRlpEncode(BREthereumTransaction transaction,
                      BREthereumRlpType type,
                      BRRlpCoder coder);
 
+/**
+ * Encode `transaction`, as RLP_TYPE_TRANSACTION_UNSIGNED or RLP_TYPE_TRANSACTION_SIGNED, directly
+ * into `bytes` without a coder.  Returns the number of bytes written, or the total bytesCount
+ * needed if `bytes` is NULL or too small (in which case nothing is written).  The encoding is
+ * identical to that of transactionRlpEncode().
+ */
+extern size_t
+transactionRlpEncodeBytes (BREthereumTransaction transaction,
+                           BREthereumNetwork network,
+                           BREthereumRlpType type,
+                           uint8_t *bytes,
+                           size_t bytesCount);
+
+/**
+ * Encode `transaction`, as with transactionRlpEncodeBytes(), into `bytes` if it fits, otherwise
+ * into newly allocated memory.  The caller releases the result if `result.bytes != bytes`; with
+ * a suitably sized stack buffer the encoding is then allocation-free.
+ */
+extern BRRlpData
+transactionRlpEncodeData (BREthereumTransaction transaction,
+                          BREthereumNetwork network,
+                          BREthereumRlpType type,
+                          uint8_t *bytes,
+                          size_t bytesCount);
+
+/**
+ * The hash of the `type` RLP encoding of `transaction`.  For RLP_TYPE_TRANSACTION_SIGNED this is
+ * the transaction's hash; for RLP_TYPE_TRANSACTION_UNSIGNED it is the hash that is signed.
+ */
+extern BREthereumHash
+transactionGetRlpHash (BREthereumTransaction transaction,
+                       BREthereumNetwork network,
+                       BREthereumRlpType type);
+
 extern BRRlpData
 transactionGetRlpData (BREthereumTransaction transaction,
                        BREthereumNetwork network,
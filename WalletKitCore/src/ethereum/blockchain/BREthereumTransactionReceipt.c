@@ -141,6 +141,32 @@ transactionReceiptRlpDecode (BRRlpItem item,
     return receipt;
 }
 
+extern BREthereumTransactionReceipt
+transactionReceiptRlpDecodeCursor (BRRlpCursor *cursor) {
+    BRRlpCursor items = rlpCursorNextList (cursor);
+    if (4 != rlpCursorCount (&items)) { rlpCursorSetFailed (&items); return NULL; }
+
+    BREthereumTransactionReceipt receipt = calloc (1, sizeof(struct BREthereumTransactionReceiptRecord));
+
+    receipt->stateRoot = rlpDataCopy (rlpCursorNextBytesSharedDontRelease (&items));
+    receipt->gasUsed = rlpCursorNextUInt64 (&items);
+    receipt->bloomFilter = bloomFilterRlpDecodeCursor (&items);
+
+    BRRlpCursor logs = rlpCursorNextList (&items);
+    array_new (receipt->logs, rlpCursorCount (&logs));
+    while (rlpCursorHasNext (&logs)) {
+        BREthereumLog log = logRlpDecodeCursor (&logs);
+        if (NULL != log) array_add (receipt->logs, log);
+    }
+
+    if (!rlpCursorFinish (&items)) {
+        transactionReceiptRelease (receipt);
+        return NULL;
+    }
+
+    return receipt;
+}
+
 //
 // Transaction Receipt - RLP Encode
 //
@@ -170,6 +196,25 @@ transactionReceiptDecodeList (BRRlpItem item,
     return receipts;
 }
 
+extern BRArrayOf (BREthereumTransactionReceipt)
+transactionReceiptDecodeListCursor (BRRlpCursor *cursor) {
+    BRRlpCursor items = rlpCursorNextList (cursor);
+
+    BRArrayOf (BREthereumTransactionReceipt) receipts;
+    array_new (receipts, rlpCursorCount (&items));
+    while (rlpCursorHasNext (&items)) {
+        BREthereumTransactionReceipt receipt = transactionReceiptRlpDecodeCursor (&items);
+        if (NULL != receipt) array_add (receipts, receipt);
+    }
+
+    if (rlpCursorHasFailed (&items)) {
+        transactionReceiptsRelease (receipts);
+        return NULL;
+    }
+
+    return receipts;
+}
+
 extern void
 transactionReceiptsRelease (BRArrayOf(BREthereumTransactionReceipt) receipts) {
     if (NULL != receipts) {
@@ -62,6 +62,20 @@ extern BRArrayOf (BREthereumTransactionReceipt)
 transactionReceiptDecodeList (BRRlpItem item,
                               BRRlpCoder coder);
 
+/**
+ * Decode a receipt in place from `cursor`.  Returns NULL, with `cursor` failed, if the RLP is
+ * malformed.
+ */
+extern BREthereumTransactionReceipt
+transactionReceiptRlpDecodeCursor (BRRlpCursor *cursor);
+
+/**
+ * Decode a list of receipts in place from `cursor`.  Returns NULL, with `cursor` failed, if
+ * any receipt is malformed.
+ */
+extern BRArrayOf (BREthereumTransactionReceipt)
+transactionReceiptDecodeListCursor (BRRlpCursor *cursor);
+
 extern void
 transactionReceiptRelease (BREthereumTransactionReceipt receipt);
 
@@ -10,24 +10,53 @@
 //
 
 #include <string.h>
+#include <stddef.h>
+#include <sched.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "BREventQueue.h"
 
-#define EVENT_QUEUE_DEFAULT_INITIAL_CAPACITY   (1)
-
+///
+/// A queued event.  Each is allocated by the enqueueing thread and freed by the dequeuing one.
+/// The event is copied in, at its `type->eventSize`, and copied out, at the queue's `size`.
+///
+typedef struct BREventQueueNodeRecord {
+    _Atomic(struct BREventQueueNodeRecord *) next;
+    BREvent event;    // Followed by the remainder of the queue's `size`
+} BREventQueueNode;
+
+///
+/// Enqueueing is lock-free and O(1), from any number of threads; dequeuing is from one thread
+/// at a time (serialized by `lock`).
+///
+/// Tail events are on an intrusive multi-producer/single-consumer linked queue (D. Vyukov's):
+/// a producer swaps itself in as `tail` and then links the prior tail to itself; the consumer
+/// pops from `head`.  The queue always holds at least `stub`; it is empty when both `head` and
+/// `tail` are `stub`.
+///
+/// Head (out-of-band) events are pushed onto a lock-free LIFO stack, `oob`.  The consumer takes
+/// the entire stack, which is already in dequeue order, and prepends it to `oobPending`.  All of
+/// those are dequeued before any tail event.
+///
 struct BREventQueueRecord {
-    // A linked-list (through event->next) of pending events.
-    BREvent *pending;
+    // The MPSC queue of tail events
+    _Atomic(BREventQueueNode *) tail;
+    BREventQueueNode *head;
+    BREventQueueNode *stub;
 
-    // A linked-list (through event->next) of available events
-    BREvent *available;
+    // The LIFO stack of head events, and those taken by the consumer but not yet dequeued.
+    _Atomic(BREventQueueNode *) oob;
+    BREventQueueNode *oobPending;
 
-    // If not provided with a lock, use this one.
+    // Serializes the consumer(s); guards `abort` and the 'cond var'
     pthread_mutex_t lock;
 
     // A 'cond var'
     pthread_cond_t cond;
 
+    // Set while the consumer waits on `cond`; only then must a 'signal' enqueue take the lock.
+    atomic_int waiting;
+
     // An 'abort wait' flag
     int abort;
 
@@ -35,20 +64,27 @@ struct BREventQueueRecord {
     size_t size;
 };
 
+static BREventQueueNode *
+eventQueueNodeCreate (BREventQueue queue) {
+    return calloc (1, offsetof (BREventQueueNode, event) + queue->size);
+}
+
 extern BREventQueue
 eventQueueCreate (size_t size) {
     BREventQueue queue = calloc (1, sizeof (struct BREventQueueRecord));
 
-    queue->pending = NULL;
-    queue->available = NULL;
     queue->abort = 0;
     queue->size  = size;
 
-    for (int i = 0; i < EVENT_QUEUE_DEFAULT_INITIAL_CAPACITY; i++) {
-        BREvent *event = calloc (1, queue->size);
-        event->next = queue->available;
-        queue->available = event;
-    }
+    queue->stub = eventQueueNodeCreate (queue);
+    atomic_init (&queue->stub->next, NULL);
+    atomic_init (&queue->tail, queue->stub);
+    queue->head = queue->stub;
+
+    atomic_init (&queue->oob, NULL);
+    queue->oobPending = NULL;
+
+    atomic_init (&queue->waiting, 0);
 
     // Create the PTHREAD CONDition variable
     {
@@ -69,47 +105,24 @@ eventQueueCreate (size_t size) {
     return queue;
 }
 
-static void
-eventFreeAll (BREvent *event,
-              int destroy) {
-    while (NULL != event) {
-        // Save the next event so that the upcoming `free` doesn't zero it out.
-        BREvent *next = event->next;
+/// MARK: - Producers
 
-        // Apply the `destroyer` if appropriate.
-        if (destroy) {
-            BREventDestroyer destroyer = event->type->eventDestroyer;
-            if (NULL != destroyer) destroyer (event);
-        }
-        // Actual free and then iterate.
-        free (event);
-        event = next;
-    }
-}
-
-extern void
-eventQueueClear (BREventQueue queue) {
-    pthread_mutex_lock(&queue->lock);
-
-    eventFreeAll(queue->pending, 1);
-    eventFreeAll(queue->available, 0);
-
-    queue->pending = NULL;
-    queue->available = NULL;
-
-    pthread_mutex_unlock(&queue->lock);
+static void
+_eventQueuePushTail (BREventQueue queue,
+                     BREventQueueNode *node) {
+    atomic_store (&node->next, NULL);
+    BREventQueueNode *prev = atomic_exchange (&queue->tail, node);
+    // Between the exchange and this store the queue is 'inconsistent'; see _eventQueuePopTail()
+    atomic_store (&prev->next, node);
 }
 
-extern void
-eventQueueDestroy (BREventQueue queue) {
-    // Clear the pending and available queues.
-    eventQueueClear (queue);
-
-    pthread_cond_destroy(&queue->cond);
-    pthread_mutex_destroy(&queue->lock);
-
-    memset (queue, 0, sizeof (struct BREventQueueRecord));
-    free (queue);
+static void
+_eventQueuePushHead (BREventQueue queue,
+                     BREventQueueNode *node) {
+    BREventQueueNode *oob = atomic_load (&queue->oob);
+    do {
+        atomic_store (&node->next, oob);
+    } while (!atomic_compare_exchange_weak (&queue->oob, &oob, node));
 }
 
 static void
@@ -117,37 +130,22 @@ eventQueueEnqueue (BREventQueue queue,
                    const BREvent *event,
                    int tail,
                    int signal) {
-    pthread_mutex_lock(&queue->lock);
+    BREventQueueNode *node = eventQueueNodeCreate (queue);
 
-    // Get the next available event
-    BREvent *this = queue->available;
-    if (NULL == this) {
-        this = (BREvent*) calloc (1, queue->size);
-        this->next = NULL;
-    }
-    // Make the next event no longer available.
-    queue->available = this->next;
-
-    // Fill in `this` with event
-    memcpy (this, event, event->type->eventSize);
-    this->next = NULL;
-
-    // Nothing pending, simply add.
-    if (NULL == queue->pending)
-        queue->pending = this;
-    else if (tail) {
-        // Find the last event
-        BREvent *last = queue->pending;
-        while (NULL != last->next) last = last->next;
-        last->next = this;
-    }
-    else /* (head) */ {
-        this->next = queue->pending;
-        queue->pending = this;
-    }
+    // Fill in `node` with event
+    memcpy (&node->event, event, event->type->eventSize);
+    node->event.next = NULL;
 
-    if (signal) pthread_cond_signal (&queue->cond);
-    pthread_mutex_unlock(&queue->lock);
+    if (tail) _eventQueuePushTail (queue, node);
+    else      _eventQueuePushHead (queue, node);
+
+    // If the consumer is waiting, or is about to, wake it.  If it isn't, then it will see `node`
+    // before it waits.
+    if (signal && atomic_load (&queue->waiting)) {
+        pthread_mutex_lock (&queue->lock);
+        pthread_cond_signal (&queue->cond);
+        pthread_mutex_unlock (&queue->lock);
+    }
 }
 
 extern void
@@ -173,26 +171,87 @@ eventQueueEnqueueHeadSignal (BREventQueue queue,
     eventQueueEnqueue (queue, event, 0, 1);
 }
 
+/// MARK: - Consumer
+
+/// Called with the lock held.  Return the next tail event, or NULL if there is none.
+static BREventQueueNode *
+_eventQueuePopTail (BREventQueue queue) {
+    while (1) {
+        BREventQueueNode *head = queue->head;
+        BREventQueueNode *next = atomic_load (&head->next);
+
+        // Skip over `stub`
+        if (head == queue->stub) {
+            if (NULL == next) {
+                // Empty, unless a producer is between its exchange and its link
+                if (head == atomic_load (&queue->tail)) return NULL;
+                sched_yield ();
+                continue;
+            }
+            queue->head = head = next;
+            next = atomic_load (&head->next);
+        }
+
+        // More than one; take `head`.
+        if (NULL != next) {
+            queue->head = next;
+            return head;
+        }
+
+        // Just `head`, unless a producer is between its exchange and its link.
+        if (head != atomic_load (&queue->tail)) {
+            sched_yield ();
+            continue;
+        }
+
+        // Just `head`; re-add `stub` so that `head` is not the last
+        _eventQueuePushTail (queue, queue->stub);
+
+        next = atomic_load (&head->next);
+        if (NULL != next) {
+            queue->head = next;
+            return head;
+        }
+
+        // Another producer swapped in before `stub`; wait for its link.
+        sched_yield ();
+    }
+}
+
+/// Called with the lock held.  Return the next head event, or NULL if there is none.
+static BREventQueueNode *
+_eventQueuePopHead (BREventQueue queue) {
+    // Take any newly pushed head events; they precede those taken before.
+    BREventQueueNode *oob = atomic_exchange (&queue->oob, NULL);
+    if (NULL != oob) {
+        BREventQueueNode *last = oob;
+        while (NULL != atomic_load (&last->next)) last = atomic_load (&last->next);
+        atomic_store (&last->next, queue->oobPending);
+        queue->oobPending = oob;
+    }
+
+    BREventQueueNode *node = queue->oobPending;
+    if (NULL != node)
+        queue->oobPending = atomic_load (&node->next);
+
+    return node;
+}
+
 static int
 _eventQueueDequeue (BREventQueue queue,
                     BREvent *event) {
     // Get the next pending event
-    BREvent *this = queue->pending;
+    BREventQueueNode *node = _eventQueuePopHead (queue);
+    if (NULL == node) node = _eventQueuePopTail (queue);
 
     // if there is one, process it
-    if (NULL == this) return 0;
-
-    // Remove `this` from the pending list.
-    queue->pending = this->next;
+    if (NULL == node) return 0;
 
     // Fill in the provided event;
-    this->next = NULL;
-    memcpy (event, this, queue->size);
-
-    // Return `this` to the available list.
-    this->next = queue->available;
-    queue->available = this;
+    memcpy (event, &node->event, queue->size);
+    event->next = NULL;
 
+    free (node);
     return 1;
 }
 
@@ -220,11 +279,23 @@ eventQueueDequeueWait (BREventQueue queue,
     BREventStatus status = EVENT_STATUS_SUCCESS;
 
     pthread_mutex_lock (&queue->lock);
-    while (!queue->abort && !_eventQueueDequeue (queue, event))
-        if (0 != pthread_cond_wait (&queue->cond, &queue->lock)) {
+    while (!queue->abort && !_eventQueueDequeue (queue, event)) {
+        // Announce the wait and then check again.  A 'signal' enqueue either sees `waiting`, and
+        // signals once we are waiting (as it needs the lock), or it enqueued before the check.
+        atomic_store (&queue->waiting, 1);
+        if (_eventQueueDequeue (queue, event)) {
+            atomic_store (&queue->waiting, 0);
+            break;
+        }
+
+        int error = pthread_cond_wait (&queue->cond, &queue->lock);
+        atomic_store (&queue->waiting, 0);
+
+        if (0 != error) {
             status = EVENT_STATUS_WAIT_ERROR;
             break; /* from while */
         }
+    }
     if (queue->abort) status = EVENT_STATUS_WAIT_ABORT;
     pthread_mutex_unlock(&queue->lock);
 
@@ -251,7 +322,40 @@ extern int
 eventQueueHasPending (BREventQueue queue) {
     int pending = 0;
     pthread_mutex_lock(&queue->lock);
-    pending = NULL != queue->pending;
+    pending = (NULL != queue->oobPending ||
+               NULL != atomic_load (&queue->oob) ||
+               queue->stub != queue->head ||
+               queue->stub != atomic_load (&queue->tail));
     pthread_mutex_unlock(&queue->lock);
     return pending;
 }
+
+extern void
+eventQueueClear (BREventQueue queue) {
+    pthread_mutex_lock(&queue->lock);
+
+    BREventQueueNode *node;
+    while (NULL != (node = _eventQueuePopHead (queue)) ||
+           NULL != (node = _eventQueuePopTail (queue))) {
+        // Apply the `destroyer` if appropriate.
+        BREventDestroyer destroyer = node->event.type->eventDestroyer;
+        if (NULL != destroyer) destroyer (&node->event);
+
+        free (node);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+}
+
+extern void
+eventQueueDestroy (BREventQueue queue) {
+    // Clear the pending events.
+    eventQueueClear (queue);
+    free (queue->stub);
+
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+
+    memset (queue, 0, sizeof (struct BREventQueueRecord));
+    free (queue);
+}
@@ -173,6 +173,16 @@ ewmCreateErrorHandler (BREthereumEWM ewm, int fileService, const char* reason) {
     return NULL;
 }
 
+static char *
+ewmCreatePoWCachePath (const char *storagePath,
+                       BREthereumNetwork network) {
+    const char *networkName = ethNetworkGetName (network);
+    size_t pathLength = strlen (storagePath) + strlen (networkName) + strlen ("/eth--ethash") + 1;
+    char *path = malloc (pathLength);
+    snprintf (path, pathLength, "%s/eth-%s-ethash", storagePath, networkName);
+    return path;
+}
+
 static void
 ewmAssertRecovery (BREthereumEWM ewm);
 
@@ -311,6 +321,12 @@ ewmCreate (BREthereumNetwork network,
                                                       ewmFileServiceSpecifications);
     if (NULL == ewm->fs) return ewmCreateErrorHandler(ewm, 1, "create");
 
+    // Sync saves blocks, transactions and logs in bursts; avoid an fsync on every commit.
+    fileServiceSetJournalMode (ewm->fs, FILE_SERVICE_JOURNAL_MODE_WAL);
+    fileServiceSetSynchronous (ewm->fs, FILE_SERVICE_SYNCHRONOUS_NORMAL);
+
+    ewm->powCachePath = ewmCreatePoWCachePath (storagePath, network);
+
     // Load all the persistent entities
     BRSetOf(BREthereumTransaction) transactions;
     BRSetOf(BREthereumLog) logs;
@@ -404,7 +420,8 @@ ewmCreate (BREthereumNetwork network,
                                   nodes,
                                   NULL,
                                   NULL,
-                                  NULL);
+                                  NULL,
+                                  ewm->powCachePath);
 
             // Announce all the provided transactions...
             FOR_SET (BREthereumTransaction, transaction, transactions)
@@ -507,7 +524,8 @@ ewmCreate (BREthereumNetwork network,
                                   nodes,
                                   blocks,
                                   transactions,
-                                  logs);
+                                  logs,
+                                  ewm->powCachePath);
 
             // TODO: BCS is dead; won't ever handle 'Internal Transactions'.  Can it?
             BRSetFree (exchanges);
@@ -580,6 +598,7 @@ ewmDestroy (BREthereumEWM ewm) {
     ewm->tokens = NULL;
 
     fileServiceRelease (ewm->fs);
+    free (ewm->powCachePath);
     eventHandlerDestroy(ewm->handler);
     rlpCoderRelease(ewm->coder);
 
@@ -1092,7 +1111,8 @@ ewmUpdateMode (BREthereumEWM ewm,
                                       NULL,
                                       NULL,
                                       NULL,
-                                      NULL);
+                                      NULL,
+                                      ewm->powCachePath);
                 break;
 
             case CRYPTO_SYNC_MODE_P2P_WITH_API_SYNC:
@@ -1107,7 +1127,8 @@ ewmUpdateMode (BREthereumEWM ewm,
                                       nodes,
                                       blocks,
                                       transactions,
-                                      logs);
+                                      logs,
+                                      ewm->powCachePath);
 
                 BRSetFreeAll (states, (void (*) (void*)) walletStateRelease);
                 BRSetFreeAll (exchanges, (void (*) (void*)) ethExchangeRelease);
@@ -1123,6 +1144,10 @@ extern void
 ewmWipe (BREthereumNetwork network,
          const char *storagePath) {
     fileServiceWipe (storagePath, "eth", ethNetworkGetName (network));
+
+    char *powCachePath = ewmCreatePoWCachePath (storagePath, network);
+    proofOfWorkWipe (powCachePath);
+    free (powCachePath);
 }
 
 /// MARK: - Blocks
@@ -2251,12 +2276,17 @@ ewmHandleSaveTransaction (BREthereumEWM ewm,
             CLIENT_CHANGE_TYPE_NAME (type),
             fileName);
 
+    // An update is a remove and a save; commit them together.
+    fileServiceBeginBatch (ewm->fs);
+
     if (CLIENT_CHANGE_REM == type || CLIENT_CHANGE_UPD == type)
         fileServiceRemove (ewm->fs, ewmFileServiceTypeTransactions,
                            fileServiceGetIdentifier(ewm->fs, ewmFileServiceTypeTransactions, transaction));
 
     if (CLIENT_CHANGE_ADD == type || CLIENT_CHANGE_UPD == type)
         fileServiceSave (ewm->fs, ewmFileServiceTypeTransactions, transaction);
+
+    fileServiceCommitBatch (ewm->fs);
 }
 
 extern void
@@ -2271,12 +2301,17 @@ ewmHandleSaveLog (BREthereumEWM ewm,
             CLIENT_CHANGE_TYPE_NAME (type),
             filename);
 
+    // An update is a remove and a save; commit them together.
+    fileServiceBeginBatch (ewm->fs);
+
     if (CLIENT_CHANGE_REM == type || CLIENT_CHANGE_UPD == type)
         fileServiceRemove (ewm->fs, ewmFileServiceTypeLogs,
                            fileServiceGetIdentifier (ewm->fs, ewmFileServiceTypeLogs, log));
 
     if (CLIENT_CHANGE_ADD == type || CLIENT_CHANGE_UPD == type)
         fileServiceSave (ewm->fs, ewmFileServiceTypeLogs, log);
+
+    fileServiceCommitBatch (ewm->fs);
 }
 
 extern void
@@ -2291,12 +2326,17 @@ ewmHandleSaveExchange (BREthereumEWM ewm,
             CLIENT_CHANGE_TYPE_NAME (type),
             filename);
 
+    // An update is a remove and a save; commit them together.
+    fileServiceBeginBatch (ewm->fs);
+
     if (CLIENT_CHANGE_REM == type || CLIENT_CHANGE_UPD == type)
         fileServiceRemove (ewm->fs, ewmFileServiceTypeExchanges,
                            fileServiceGetIdentifier (ewm->fs, ewmFileServiceTypeExchanges, exchange));
 
     if (CLIENT_CHANGE_ADD == type || CLIENT_CHANGE_UPD == type)
         fileServiceSave (ewm->fs, ewmFileServiceTypeExchanges, exchange);
+
+    fileServiceCommitBatch (ewm->fs);
 }
 
 extern void
@@ -2701,18 +2741,14 @@ ewmTransferFillRawData (BREthereumEWM ewm,
     assert (ETHEREUM_BOOLEAN_IS_TRUE (transactionIsSigned(transaction)));
     pthread_mutex_unlock (&ewm->lock);
 
-    BRRlpItem item = transactionRlpEncode(transaction,
-                                          ewm->network,
-                                          (transactionIsSigned(transaction)
-                                           ? RLP_TYPE_TRANSACTION_SIGNED
-                                           : RLP_TYPE_TRANSACTION_UNSIGNED),
-                                          ewm->coder);
-    BRRlpData data = rlpItemGetData (ewm->coder, item);
+    BRRlpData data = transactionGetRlpData (transaction,
+                                            ewm->network,
+                                            (transactionIsSigned(transaction)
+                                             ? RLP_TYPE_TRANSACTION_SIGNED
+                                             : RLP_TYPE_TRANSACTION_UNSIGNED));
 
     *bytesCountPtr = data.bytesCount;
     *bytesPtr = data.bytes;
-
-    rlpItemRelease(ewm->coder, item);
 }
 
 extern const char *
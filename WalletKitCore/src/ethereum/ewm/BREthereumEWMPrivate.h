@@ -143,6 +143,11 @@ struct BREthereumEWMRecord {
      */
     BRFileService fs;
 
+    /**
+     * The directory for saved Ethash caches; used by BCS to verify proof-of-work.
+     */
+    char *powCachePath;
+
     /**
      * If we are syncing with BRD, instead of as P2P with BCS, then we'll keep a record to
      * ensure we've successfully completed the getTransactions() and getLogs() callbacks to
@@ -468,6 +468,9 @@ transferGetBasisExchange (BREthereumTransfer transfer) {
             : NULL);
 }
 
+// Transactions are typically a few hundred bytes; encode those, for signing, on the stack.
+#define TRANSFER_RLP_STACK_BYTES     (1024)
+
 extern void
 transferSign (BREthereumTransfer transfer,
               BREthereumNetwork network,
@@ -480,12 +483,11 @@ transferSign (BREthereumTransfer transfer,
                              ethAccountGetThenIncrementAddressNonce(account, address));
     
     // RLP Encode the UNSIGNED transfer
-    BRRlpCoder coder = rlpCoderCreate();
-    BRRlpItem item = transactionRlpEncode (transfer->originatingTransaction,
-                                           network,
-                                           RLP_TYPE_TRANSACTION_UNSIGNED,
-                                           coder);
-    BRRlpData data = rlpItemGetDataSharedDontRelease(coder, item);
+    uint8_t bytes[TRANSFER_RLP_STACK_BYTES];
+    BRRlpData data = transactionRlpEncodeData (transfer->originatingTransaction,
+                                               network,
+                                               RLP_TYPE_TRANSACTION_UNSIGNED,
+                                               bytes, sizeof (bytes));
     
     // Sign the RLP Encoded bytes.
     BREthereumSignature signature = ethAccountSignBytes (account,
@@ -495,20 +497,15 @@ transferSign (BREthereumTransfer transfer,
                                                       data.bytesCount,
                                                       paperKey);
     
-    rlpItemRelease(coder, item);
+    if (data.bytes != bytes) rlpDataRelease (data);
 
     // Attach the signature
     transactionSign (transfer->originatingTransaction, signature);
     // Compute the hash
-    item = transactionRlpEncode (transfer->originatingTransaction,
-                                 network,
-                                 RLP_TYPE_TRANSACTION_SIGNED,
-                                 coder);
     transactionSetHash (transfer->originatingTransaction,
-                        ethHashCreateFromData (rlpItemGetDataSharedDontRelease (coder, item)));
-
-    rlpItemRelease(coder, item);
-    rlpCoderRelease(coder);
+                        transactionGetRlpHash (transfer->originatingTransaction,
+                                               network,
+                                               RLP_TYPE_TRANSACTION_SIGNED));
 }
 
 extern void
@@ -523,12 +520,11 @@ transferSignWithKey (BREthereumTransfer transfer,
                              ethAccountGetThenIncrementAddressNonce(account, address));
     
     // RLP Encode the UNSIGNED transfer
-    BRRlpCoder coder = rlpCoderCreate();
-    BRRlpItem item = transactionRlpEncode (transfer->originatingTransaction,
-                                           network,
-                                           RLP_TYPE_TRANSACTION_UNSIGNED,
-                                           coder);
-    BRRlpData data = rlpItemGetDataSharedDontRelease (coder, item);
+    uint8_t bytes[TRANSFER_RLP_STACK_BYTES];
+    BRRlpData data = transactionRlpEncodeData (transfer->originatingTransaction,
+                                               network,
+                                               RLP_TYPE_TRANSACTION_UNSIGNED,
+                                               bytes, sizeof (bytes));
     
     // Sign the RLP Encoded bytes.
     BREthereumSignature signature = ethAccountSignBytesWithPrivateKey (account,
@@ -538,21 +534,16 @@ transferSignWithKey (BREthereumTransfer transfer,
                                                                     data.bytesCount,
                                                                     privateKey);
     
-    rlpItemRelease(coder, item);
+    if (data.bytes != bytes) rlpDataRelease (data);
 
     // Attach the signature
     transactionSign(transfer->originatingTransaction, signature);
 
     // Compute the hash
-    item = transactionRlpEncode (transfer->originatingTransaction,
-                                 network,
-                                 RLP_TYPE_TRANSACTION_SIGNED,
-                                 coder);
     transactionSetHash (transfer->originatingTransaction,
-                        ethHashCreateFromData (rlpItemGetDataSharedDontRelease (coder, item)));
-
-    rlpItemRelease(coder, item);
-    rlpCoderRelease(coder);
+                        transactionGetRlpHash (transfer->originatingTransaction,
+                                               network,
+                                               RLP_TYPE_TRANSACTION_SIGNED));
 }
 
 /**
@@ -1645,12 +1645,14 @@ lesProvideBlockProofs (BREthereumLES les,
                        BREthereumNodeReference node,
                        BREthereumLESProvisionContext context,
                        BREthereumLESProvisionCallback callback,
-                       OwnershipGiven BRArrayOf(uint64_t) blockNumbers) {
+                       OwnershipGiven BRArrayOf(uint64_t) blockNumbers,
+                       OwnershipGiven BRArrayOf(BREthereumHash) chtRoots) {
+    assert (array_count (blockNumbers) == array_count (chtRoots));
     lesAddRequest (les, node, context, callback,
                    (BREthereumProvision) {
                        PROVISION_IDENTIFIER_UNDEFINED,
                        PROVISION_BLOCK_PROOFS,
-                       { .proofs = { blockNumbers, NULL }}
+                       { .proofs = { blockNumbers, chtRoots, NULL }}
                    });
 }
 
@@ -1659,11 +1661,13 @@ lesProvideBlockProofsOne (BREthereumLES les,
                           BREthereumNodeReference node,
                           BREthereumLESProvisionContext context,
                           BREthereumLESProvisionCallback callback,
-                          uint64_t blockNumber) {
+                          uint64_t blockNumber,
+                          BREthereumHash chtRoot) {
     BRArrayOf(uint64_t) blockNumbers;
     array_new (blockNumbers, 1);
     array_add (blockNumbers, blockNumber);
-    lesProvideBlockProofs (les, node, context, callback, blockNumbers);
+    lesProvideBlockProofs (les, node, context, callback, blockNumbers,
+                           lesCreateHashArray (les, chtRoot));
 }
 
 extern void
@@ -1720,12 +1724,14 @@ lesProvideAccountStates (BREthereumLES les,
                          BREthereumLESProvisionContext context,
                          BREthereumLESProvisionCallback callback,
                          BREthereumAddress address,
-                         OwnershipGiven BRArrayOf(BREthereumHash) blockHashes) {
+                         OwnershipGiven BRArrayOf(BREthereumHash) blockHashes,
+                         OwnershipGiven BRArrayOf(BREthereumHash) stateRoots) {
+    assert (array_count (blockHashes) == array_count (stateRoots));
     lesAddRequest (les, node, context, callback,
                    (BREthereumProvision) {
                        PROVISION_IDENTIFIER_UNDEFINED,
                        PROVISION_ACCOUNTS,
-                       { .accounts = { address, blockHashes, NULL }}
+                       { .accounts = { address, blockHashes, stateRoots, NULL }}
                    });
 }
 
@@ -1735,9 +1741,11 @@ lesProvideAccountStatesOne (BREthereumLES les,
                             BREthereumLESProvisionContext context,
                             BREthereumLESProvisionCallback callback,
                             BREthereumAddress address,
-                            BREthereumHash blockHash) {
+                            BREthereumHash blockHash,
+                            BREthereumHash stateRoot) {
     lesProvideAccountStates (les, node, context, callback, address,
-                             lesCreateHashArray(les, blockHash));
+                             lesCreateHashArray(les, blockHash),
+                             lesCreateHashArray(les, stateRoot));
 }
 
 extern void
@@ -280,20 +280,24 @@ lesProvideBlockHeaders (BREthereumLES les,
  * @param context
  * @param callback
  * @param uint64_t
+ * @param chtRoots - the trusted CHT root for each block number; a proof not rooted at its
+ *    CHT root fails the provision.
  */
 extern void
 lesProvideBlockProofs (BREthereumLES les,
                        BREthereumNodeReference node,
                        BREthereumLESProvisionContext context,
                        BREthereumLESProvisionCallback callback,
-                       OwnershipGiven BRArrayOf(uint64_t) blockNumbers);
+                       OwnershipGiven BRArrayOf(uint64_t) blockNumbers,
+                       OwnershipGiven BRArrayOf(BREthereumHash) chtRoots);
 
 extern void
 lesProvideBlockProofsOne (BREthereumLES les,
                           BREthereumNodeReference node,
                           BREthereumLESProvisionContext context,
                           BREthereumLESProvisionCallback callback,
-                          uint64_t blockNumber);
+                          uint64_t blockNumber,
+                          BREthereumHash chtRoot);
 
 /*!
  * @function lesProvdeBlockBodies
@@ -349,6 +353,8 @@ lesProvideReceiptsOne (BREthereumLES les,
  * @param callback
  * @param address
  * @param BREthereumHash
+ * @param stateRoots - the stateRoot of each block; a proof not rooted at its block's stateRoot
+ *    fails the provision.
  */
 extern void
 lesProvideAccountStates (BREthereumLES les,
@@ -356,7 +362,8 @@ lesProvideAccountStates (BREthereumLES les,
                          BREthereumLESProvisionContext context,
                          BREthereumLESProvisionCallback callback,
                          BREthereumAddress address,
-                         OwnershipGiven BRArrayOf(BREthereumHash) blockHashes);
+                         OwnershipGiven BRArrayOf(BREthereumHash) blockHashes,
+                         OwnershipGiven BRArrayOf(BREthereumHash) stateRoots);
 
 extern void
 lesProvideAccountStatesOne (BREthereumLES les,
@@ -364,7 +371,8 @@ lesProvideAccountStatesOne (BREthereumLES les,
                             BREthereumLESProvisionContext context,
                             BREthereumLESProvisionCallback callback,
                             BREthereumAddress address,
-                            BREthereumHash blockHash);
+                            BREthereumHash blockHash,
+                            BREthereumHash stateRoot);
 
 /**
  * @function lesProvideTransactionStauts
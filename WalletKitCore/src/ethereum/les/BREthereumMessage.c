@@ -61,6 +61,31 @@ messageDecode (BRRlpItem item,
     }
 }
 
+extern int
+messageHasDecodeCursor (BREthereumMessageIdentifier type,
+                        BREthereumANYMessageIdentifier subtype) {
+    return (MESSAGE_LES == type &&
+            messageLESHasDecodeCursor ((BREthereumLESMessageIdentifier) subtype));
+}
+
+extern BREthereumMessage
+messageDecodeCursor (BRRlpData data,
+                     BREthereumMessageCoder coder,
+                     BREthereumMessageIdentifier type,
+                     BREthereumANYMessageIdentifier subtype) {
+    assert (messageHasDecodeCursor (type, subtype));
+
+    BRRlpCursor cursor = rlpCursorCreate (data);
+
+    BREthereumMessage message = {
+        MESSAGE_LES,
+        { .les = messageLESDecodeCursor (&cursor, (BREthereumLESMessageIdentifier) subtype) }
+    };
+
+    if (!rlpCursorFinish (&cursor)) rlpCoderSetFailed (coder.rlp);
+    return message;
+}
+
 extern int
 messageHasIdentifier (BREthereumMessage *message,
                       BREthereumMessageIdentifier identifer) {
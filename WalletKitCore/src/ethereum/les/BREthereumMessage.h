@@ -66,6 +66,23 @@ messageDecode (BRRlpItem item,
                BREthereumMessageIdentifier type,
                BREthereumANYMessageIdentifier subtype);
 
+/**
+ * Return true if the message of `type` and `subtype` can be decoded with messageDecodeCursor().
+ */
+extern int
+messageHasDecodeCursor (BREthereumMessageIdentifier type,
+                        BREthereumANYMessageIdentifier subtype);
+
+/**
+ * Decode the message in place, directly from `data`, without building a BRRlpItem tree.  On
+ * malformed RLP the `coder` is marked as failed, as with messageDecode().
+ */
+extern BREthereumMessage
+messageDecodeCursor (BRRlpData data,
+                     BREthereumMessageCoder coder,
+                     BREthereumMessageIdentifier type,
+                     BREthereumANYMessageIdentifier subtype);
+
 extern void
 messageRelease (BREthereumMessage *message);
 
@@ -2162,16 +2162,22 @@ nodeRecv (BREthereumNode node,
 
             // Actual body
             BRRlpData data = { headerCount - 1, &bytes[1] };
-            BRRlpItem item = rlpDataGetItem (node->coder.rlp, data);
 
 #if defined (NEED_TO_PRINT_SEND_RECV_DATA)
             eth_log (LES_LOG_TOPIC, "Size: Recv: TCP: Type: %u, Subtype: %d", type, subtype);
 #endif
 
-            // Finally, decode the message
-            message = messageDecode (item, node->coder, type, subtype);
+            // Finally, decode the message.  Headers and receipts, the bulk of a sync, are decoded
+            // in place from `bytes`; everything else through a BRRlpItem tree.
+            BRRlpItem item = NULL;
+            if (messageHasDecodeCursor (type, subtype))
+                message = messageDecodeCursor (data, node->coder, type, subtype);
+            else {
+                item    = rlpDataGetItem (node->coder.rlp, data);
+                message = messageDecode (item, node->coder, type, subtype);
+            }
 #if defined (NODE_SHOW_RECV_RLP_ITEMS)
-            if (!rlpCoderHasFailed(node->coder.rlp) &&
+            if (NULL != item && !rlpCoderHasFailed(node->coder.rlp) &&
                 ((MESSAGE_PIP == message.identifier && PIP_MESSAGE_STATUS != message.u.pip.type) ||
                  (MESSAGE_LES == message.identifier && LES_MESSAGE_STATUS != message.u.les.identifier)))
                 rlpShowItem(node->coder.rlp, item, "RECV");
@@ -2183,7 +2189,7 @@ nodeRecv (BREthereumNode node,
                 messageLESHasUse (&message.u.les, LES_MESSAGE_USE_RESPONSE))
                 node->credits = messageLESGetCredits (&message.u.les);
             
-            rlpItemRelease (node->coder.rlp, item);
+            if (NULL != item) rlpItemRelease (node->coder.rlp, item);
             rlpItemRelease (node->coder.rlp, identifierItem);
 
             break;
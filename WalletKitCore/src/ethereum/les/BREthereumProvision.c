@@ -339,6 +339,14 @@ provisionHandleMessageLES (BREthereumProvision *provisionMulti,
                     //BREthereumBlockHeader header = messageHeaders[index];
                     BREthereumMPTNodePath path   = messagePaths[index];
 
+                    // The proof must be rooted at the trusted CHT root; otherwise the node has
+                    // provided a forged or unrelated trie.  Fail the provision.
+                    if (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (mptNodePathGetRootHash (path),
+                                                                 provision->roots[offset + index]))) {
+                        status = PROVISION_ERROR;
+                        break;
+                    }
+
                     // Result location
                     BREthereumBlockHeaderProof *proof = &provisionProofs[offset + index];
 
@@ -450,6 +458,15 @@ provisionHandleMessageLES (BREthereumProvision *provisionMulti,
                     // is be have an empty array for messagePaths - that is, no proofs and no
                     // non-proofs.  That is surely an error (boot the node), but...
                     BREthereumMPTNodePath path = messagePaths[index];
+
+                    // The proof must be rooted at the block's stateRoot; otherwise an absent
+                    // account - and thus an empty account state - could be 'proven' by any trie.
+                    if (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (mptNodePathGetRootHash (path),
+                                                                 provision->roots[offset + index]))) {
+                        status = PROVISION_ERROR;
+                        break;
+                    }
+
                     BREthereumBoolean foundValue = ETHEREUM_BOOLEAN_FALSE;
                     BRRlpData data = mptNodePathGetValue (path, key, &foundValue);
                     if (ETHEREUM_BOOLEAN_IS_TRUE(foundValue)) {
@@ -804,7 +821,7 @@ provisionHandleMessagePIP (BREthereumProvision *provisionMulti,
                     assert (PIP_REQUEST_HEADER_PROOF == outputs[index].identifier);
 
                     // The MPT 'key' is the RLP encoding of the block number
-                    BRRlpItem item = rlpEncodeUInt64(coder, provision->numbers[index], 0);
+                    BRRlpItem item = rlpEncodeUInt64(coder, provision->numbers[offset + index], 0);
                     BRRlpData data = rlpItemGetDataSharedDontRelease (coder, item);
                     BREthereumData key = { data.bytesCount, data.bytes };
 
@@ -812,7 +829,14 @@ provisionHandleMessagePIP (BREthereumProvision *provisionMulti,
 
                     messagePIPRequestHeaderProofOutputConsume (&outputs[index].u.headerProof, &path);
 
-                    if (ETHEREUM_BOOLEAN_IS_TRUE (mptNodePathIsValid (path, key))) {
+                    // The proof must be rooted at the trusted CHT root; otherwise fail the provision.
+                    // Continue on, to consume (and release) every output's path.
+                    if (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (mptNodePathGetRootHash (path),
+                                                                 provision->roots[offset + index])))
+                        status = PROVISION_ERROR;
+
+                    if (PROVISION_SUCCESS == status &&
+                        ETHEREUM_BOOLEAN_IS_TRUE (mptNodePathIsValid (path, key))) {
                         provisionProofs[offset + index].hash = outputs[index].u.headerProof.blockHash;
                         provisionProofs[offset + index].totalDifficulty = outputs[index].u.headerProof.blockTotalDifficulty;
                     }
@@ -1035,6 +1059,7 @@ provisionCopy (BREthereumProvision *provision,
                 provision->type,
                 { .proofs = {
                     numbersCopy(provision->u.proofs.numbers),
+                    ethHashesCopy(provision->u.proofs.roots),
                     NULL }}
             };
 
@@ -1063,6 +1088,7 @@ provisionCopy (BREthereumProvision *provision,
                 { .accounts = {
                     provision->u.accounts.address,
                     ethHashesCopy(provision->u.accounts.hashes),
+                    ethHashesCopy(provision->u.accounts.roots),
                     NULL }}
             };
 
@@ -1139,6 +1165,8 @@ provisionRelease (BREthereumProvision *provision,
         case PROVISION_BLOCK_PROOFS:
             if (NULL != provision->u.proofs.numbers)
                 array_free (provision->u.proofs.numbers);
+            if (NULL != provision->u.proofs.roots)
+                array_free (provision->u.proofs.roots);
             break;
             
         case PROVISION_BLOCK_BODIES:
@@ -1154,6 +1182,8 @@ provisionRelease (BREthereumProvision *provision,
         case PROVISION_ACCOUNTS:
             if (NULL != provision->u.accounts.hashes)
                 array_free (provision->u.accounts.hashes);
+            if (NULL != provision->u.accounts.roots)
+                array_free (provision->u.accounts.roots);
             break;
 
         case PROVISION_TRANSACTION_STATUSES:
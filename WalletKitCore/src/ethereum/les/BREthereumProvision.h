@@ -78,6 +78,7 @@ provisionHeadersConsume (BREthereumProvisionHeaders *provision,
 typedef struct {
     // Request
     BRArrayOf(uint64_t) numbers;
+    BRArrayOf(BREthereumHash) roots;    // The trusted CHT root for each number
     // Response
     BRArrayOf(BREthereumBlockHeaderProof) proofs;
 } BREthereumProvisionProofs;
@@ -124,6 +125,7 @@ typedef struct {
     // Request
     BREthereumAddress address;
     BRArrayOf(BREthereumHash) hashes;
+    BRArrayOf(BREthereumHash) roots;    // The stateRoot of each block
     // Response
     BRArrayOf(BREthereumAccountState) accounts;
 } BREthereumProvisionAccounts;
@@ -273,6 +273,34 @@ messageLESBlockHeadersDecode (BRRlpItem item,
     };
 }
 
+extern BREthereumLESMessageBlockHeaders
+messageLESBlockHeadersDecodeCursor (BRRlpCursor *cursor) {
+    BRRlpCursor items = rlpCursorNextList (cursor);
+
+    uint64_t reqId = rlpCursorNextUInt64 (&items);
+    uint64_t bv    = rlpCursorNextUInt64 (&items);
+
+    BRRlpCursor headerItems = rlpCursorNextList (&items);
+
+    BRArrayOf(BREthereumBlockHeader) headers;
+    array_new (headers, rlpCursorCount (&headerItems));
+    while (rlpCursorHasNext (&headerItems)) {
+        BREthereumBlockHeader header = blockHeaderRlpDecodeCursor (&headerItems, RLP_TYPE_NETWORK);
+        if (NULL != header) array_add (headers, header);
+    }
+
+    if (!rlpCursorFinish (&items)) {
+        blockHeadersRelease (headers);
+        headers = NULL;
+    }
+
+    return (BREthereumLESMessageBlockHeaders) {
+        reqId,
+        bv,
+        headers
+    };
+}
+
 /// MARK: LES GetBlockBodies
 
 static BRRlpItem
@@ -368,6 +396,38 @@ messageLESReceiptsDecode (BRRlpItem item,
     };
 }
 
+static BREthereumLESMessageReceipts
+messageLESReceiptsDecodeCursor (BRRlpCursor *cursor) {
+    BRRlpCursor items = rlpCursorNextList (cursor);
+
+    uint64_t reqId = rlpCursorNextUInt64 (&items);
+    uint64_t bv    = rlpCursorNextUInt64 (&items);
+
+    BRRlpCursor arrayItems = rlpCursorNextList (&items);
+
+    BRArrayOf(BREthereumLESMessageReceiptsArray) arrays;
+    array_new(arrays, rlpCursorCount (&arrayItems));
+    while (rlpCursorHasNext (&arrayItems)) {
+        BREthereumLESMessageReceiptsArray array = {
+            transactionReceiptDecodeListCursor (&arrayItems)
+        };
+        if (NULL != array.receipts) array_add (arrays, array);
+    }
+
+    if (!rlpCursorFinish (&items)) {
+        for (size_t index = 0; index < array_count (arrays); index++)
+            transactionReceiptsRelease (arrays[index].receipts);
+        array_free (arrays);
+        arrays = NULL;
+    }
+
+    return (BREthereumLESMessageReceipts) {
+        reqId,
+        bv,
+        arrays
+    };
+}
+
 /// MARK: LES GetProofs
 
 static BRRlpItem
@@ -765,6 +825,38 @@ messageLESEncode (BREthereumLESMessage message,
                            body);
 }
 
+extern int
+messageLESHasDecodeCursor (BREthereumLESMessageIdentifier identifier) {
+    switch (identifier) {
+        case LES_MESSAGE_BLOCK_HEADERS:
+        case LES_MESSAGE_RECEIPTS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+extern BREthereumLESMessage
+messageLESDecodeCursor (BRRlpCursor *cursor,
+                        BREthereumLESMessageIdentifier identifier) {
+    switch (identifier) {
+        case LES_MESSAGE_BLOCK_HEADERS:
+            return (BREthereumLESMessage) {
+                LES_MESSAGE_BLOCK_HEADERS,
+                { .blockHeaders = messageLESBlockHeadersDecodeCursor (cursor)} };
+
+        case LES_MESSAGE_RECEIPTS:
+            return (BREthereumLESMessage) {
+                LES_MESSAGE_RECEIPTS,
+                { .receipts = messageLESReceiptsDecodeCursor (cursor)} };
+
+        default:
+            assert (0);
+            rlpCursorSetFailed (cursor);
+            return (BREthereumLESMessage) { identifier };
+    }
+}
+
 extern void
 messageLESRelease (BREthereumLESMessage *message) {
     switch (message->identifier) {
@@ -164,6 +164,9 @@ extern BREthereumLESMessageBlockHeaders
 messageLESBlockHeadersDecode (BRRlpItem item,
                               BREthereumMessageCoder coder);
 
+extern BREthereumLESMessageBlockHeaders
+messageLESBlockHeadersDecodeCursor (BRRlpCursor *cursor);
+
 /// MARK: LES GetBlockBodies
 
 /**
@@ -451,6 +454,22 @@ messageLESDecode (BRRlpItem item,
                   BREthereumMessageCoder coder,
                   BREthereumLESMessageIdentifier identifier);
 
+/**
+ * Return true if a LES message with `identifier` can be decoded in place, with a cursor.  These
+ * are the bulk responses - block headers and receipts - where building a BRRlpItem tree costs
+ * the most.
+ */
+extern int
+messageLESHasDecodeCursor (BREthereumLESMessageIdentifier identifier);
+
+/**
+ * Decode a LES message in place from `cursor`.  If the RLP is malformed `cursor` fails and the
+ * returned message holds nothing to release.
+ */
+extern BREthereumLESMessage
+messageLESDecodeCursor (BRRlpCursor *cursor,
+                        BREthereumLESMessageIdentifier identifier);
+
 
 /**
  * Encode a LES message
@@ -8,7 +8,10 @@
 //  See the LICENSE file at the project root for license information.
 //  See the CONTRIBUTORS file at the project root for a list of contributors.
 
+#include <pthread.h>
 #include "support/BRAssert.h"
+#include "support/BRCrypto.h"
+#include "support/BRSet.h"
 #include "BREthereumMPT.h"
 
 #undef MPT_SHOW_PROOF_NODES
@@ -28,15 +31,21 @@ struct BREthereumMPTNodeRecord {
         struct {
             BREthereumData path;  // data w/ each byte a nibble a/ preface stripped!
             BREthereumHash key;
+            BRRlpData embedded;
         } extension;
 
         struct {
             BREthereumHash keys[16];
+            BRRlpData embedded[16];
             BRRlpData value;
         } branch;
     } u;
 };
 
+// A child node whose RLP encoding is shorter than a hash is embedded in its parent, in place of
+// the child's hash.  For such a child, the parent's `key` is EMPTY_HASH_INIT and `embedded` holds
+// the child's encoding; otherwise `embedded` is empty.
+
 static BREthereumMPTNode
 mptNodeCreate (BREthereumMPTNodeType type) {
     BREthereumMPTNode node = calloc (1, sizeof (struct BREthereumMPTNodeRecord));
@@ -55,15 +64,43 @@ mptNodeRelease (BREthereumMPTNode node) {
 
         case MPT_NODE_EXTENSION:
             ethDataRelease (node->u.extension.path);
+            rlpDataRelease (node->u.extension.embedded);
             break;
 
         case MPT_NODE_BRANCH:
+            for (size_t index = 0; index < 16; index++)
+                rlpDataRelease (node->u.branch.embedded[index]);
             rlpDataRelease (node->u.branch.value);
             break;
     }
     free (node);
 }
 
+static BREthereumMPTNode
+mptNodeCopy (BREthereumMPTNode node) {
+    BREthereumMPTNode copy = mptNodeCreate (node->type);
+    switch (node->type) {
+        case MPT_NODE_LEAF:
+            copy->u.leaf.path  = ethDataCreateFromBytes (node->u.leaf.path.count, node->u.leaf.path.bytes, 0);
+            copy->u.leaf.value = rlpDataCopy (node->u.leaf.value);
+            break;
+
+        case MPT_NODE_EXTENSION:
+            copy->u.extension.path = ethDataCreateFromBytes (node->u.extension.path.count, node->u.extension.path.bytes, 0);
+            copy->u.extension.key  = node->u.extension.key;
+            copy->u.extension.embedded = rlpDataCopy (node->u.extension.embedded);
+            break;
+
+        case MPT_NODE_BRANCH:
+            memcpy (copy->u.branch.keys, node->u.branch.keys, sizeof (node->u.branch.keys));
+            for (size_t index = 0; index < 16; index++)
+                copy->u.branch.embedded[index] = rlpDataCopy (node->u.branch.embedded[index]);
+            copy->u.branch.value = rlpDataCopy (node->u.branch.value);
+            break;
+    }
+    return copy;
+}
+
 static BRRlpData
 mptNodeGetValue (BREthereumMPTNode node,
                  BREthereumBoolean *found) {
@@ -104,9 +141,10 @@ mptNodeConsume (BREthereumMPTNode node, uint8_t *key) {
         }
 
         case MPT_NODE_BRANCH: {
-            // We'll consume one byte if the node's key is not an empty hash
+            // We'll consume one byte if the node references a child, by hash or embedded
             return (ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (node->u.branch.keys[key[0]],
-                                                         EMPTY_HASH_INIT))
+                                                         EMPTY_HASH_INIT)) &&
+                    0 == node->u.branch.embedded[key[0]].bytesCount
                     ? 0
                     : 1);
         }
@@ -118,6 +156,26 @@ mptNodeConsume (BREthereumMPTNode node, uint8_t *key) {
 
 #define NIBBLE_GET(x, upper) (0x0f & ((x) >> ((upper) ? 4 : 0)))
 
+/**
+ * Decode a child reference from `item` as either a hash, filling `key`, or an embedded node,
+ * filling `embedded` with the node's encoding.  An empty item references no child.
+ */
+static void
+mptNodeDecodeReference (BRRlpItem item,
+                        BRRlpCoder coder,
+                        BREthereumHash *key,
+                        BRRlpData *embedded) {
+    BRRlpData data = rlpItemGetDataSharedDontRelease (coder, item);
+
+    *key      = EMPTY_HASH_INIT;
+    *embedded = (BRRlpData) { 0, NULL };
+
+    // Either empty (0x), an embedded node (a list, shorter than a hash) or a hash (0x<32 bytes>)
+    if (0 == data.bytesCount || 1 == data.bytesCount) return;
+    else if (data.bytesCount < 1 + ETHEREUM_HASH_BYTES) *embedded = rlpDataCopy (data);
+    else *key = ethHashRlpDecode (item, coder);
+}
+
 static BREthereumMPTNode
 mptNodeDecode (BRRlpItem item,
                BRRlpCoder coder) {
@@ -176,7 +234,9 @@ mptNodeDecode (BRRlpItem item,
 
                 case MPT_NODE_EXTENSION:
                     node->u.extension.path = path;
-                    node->u.extension.key = ethHashRlpDecode (items[1], coder);
+                    mptNodeDecodeReference (items[1], coder,
+                                            &node->u.extension.key,
+                                            &node->u.extension.embedded);
                     break;
 
                 case MPT_NODE_BRANCH:
@@ -187,13 +247,10 @@ mptNodeDecode (BRRlpItem item,
 
         case 17: {
             node = mptNodeCreate(MPT_NODE_BRANCH);
-            for (size_t index = 0; index < 16; index++) {
-                BRRlpData data = rlpItemGetDataSharedDontRelease (coder, items[index]);
-                // Either a hash (0x<32 bytes>) or empty (0x)
-                node->u.branch.keys[index] = (0 == data.bytesCount || 1 == data.bytesCount
-                                              ? EMPTY_HASH_INIT
-                                              : ethHashRlpDecode(items[index], coder));
-            }
+            for (size_t index = 0; index < 16; index++)
+                mptNodeDecodeReference (items[index], coder,
+                                        &node->u.branch.keys[index],
+                                        &node->u.branch.embedded[index]);
             node->u.branch.value = rlpItemGetData (coder, items[16]);
             break;
         }
@@ -201,24 +258,210 @@ mptNodeDecode (BRRlpItem item,
     return node;
 }
 
+static BREthereumMPTNode
+mptNodeDecodeFromBytes (BRRlpData data,
+                        BRRlpCoder coder) {
+    BRRlpItem item = rlpDataGetItem (coder, data);
+    BREthereumMPTNode node = mptNodeDecode (item, coder);
+#if defined (MPT_SHOW_PROOF_NODES)
+    rlpShowItem (coder, item, "MPTN");
+#endif
+    rlpItemRelease (coder, item);
+    return node;
+}
+
+/**
+ * Return the hashes of the child nodes that `node` references - sixteen for a branch (some
+ * EMPTY_HASH_INIT), one for an extension and none for a leaf.
+ */
+static const BREthereumHash *
+mptNodeGetReferences (BREthereumMPTNode node, size_t *count) {
+    switch (node->type) {
+        case MPT_NODE_LEAF:      *count = 0;  return NULL;
+        case MPT_NODE_EXTENSION: *count = 1;  return &node->u.extension.key;
+        case MPT_NODE_BRANCH:    *count = 16; return node->u.branch.keys;
+        default:                 *count = 0;  return NULL;
+    }
+}
+
+/// MARK: - MPT Node Cache
+
+//
+// A bounded, process-wide cache of proof nodes, content-addressed by the Keccak256 hash of each
+// node's RLP encoding.  Proofs of keys in one trie - successive account states at one block,
+// header proofs under one CHT root - share their upper nodes; a proof's node that is found in the
+// cache takes the cached hash and a copy of the cached decoding rather than being decoded and
+// hashed again.
+//
+// A node is looked up by the hashes its parent node references, or by the recent roots for a
+// path's first node, and is found only if its encoding is identical to the cached node's encoding.
+// Thus a found node's hash is exactly the hash of its encoding; the cache never vouches for a
+// node that has not been hashed.  The oldest nodes are evicted first.
+//
+#define MPT_NODE_CACHE_LIMIT           (512)
+#define MPT_NODE_CACHE_ROOTS_LIMIT       (8)
+
+typedef struct {
+    BREthereumHash hash;            // First, for BRSet; the hash of `encoding`
+    BRRlpData encoding;
+    BREthereumMPTNode node;
+} BREthereumMPTNodeCacheEntry;
+
+static size_t
+mptNodeCacheEntryHashValue (const void *entry) {
+    return ethHashSetValue (&((const BREthereumMPTNodeCacheEntry *) entry)->hash);
+}
+
+static int
+mptNodeCacheEntryHashEqual (const void *entry1, const void *entry2) {
+    return entry1 == entry2 || ethHashSetEqual (&((const BREthereumMPTNodeCacheEntry *) entry1)->hash,
+                                                &((const BREthereumMPTNodeCacheEntry *) entry2)->hash);
+}
+
+static void
+mptNodeCacheEntryRelease (BREthereumMPTNodeCacheEntry *entry) {
+    rlpDataRelease (entry->encoding);
+    mptNodeRelease (entry->node);
+    free (entry);
+}
+
+static struct {
+    BRSetOf(BREthereumMPTNodeCacheEntry*) entries;
+
+    // The entries in the order added; the oldest, next to be evicted, at `entriesNext`
+    BREthereumMPTNodeCacheEntry *entriesOrdered[MPT_NODE_CACHE_LIMIT];
+    size_t entriesNext;
+
+    // The most recent root hashes; candidates for a path's first node
+    BREthereumHash roots[MPT_NODE_CACHE_ROOTS_LIMIT];
+    size_t rootsNext;
+
+    pthread_mutex_t lock;
+} mptNodeCache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/**
+ * Find the node with `encoding` in the cache, as either one of the nodes that `parent` references
+ * or, if `parent` is NULL, one of the recent roots.  If found, fill `hash` and return a copy of the
+ * cached node; otherwise return NULL.
+ */
+static BREthereumMPTNode
+mptNodeCacheFind (BREthereumMPTNode parent,
+                  BRRlpData encoding,
+                  BREthereumHash *hash) {
+    // A node embedded in its parent is not hashed and is never cached.
+    if (encoding.bytesCount < ETHEREUM_HASH_BYTES) return NULL;
+
+    BREthereumMPTNode node = NULL;
+    pthread_mutex_lock (&mptNodeCache.lock);
+
+    size_t candidatesCount = MPT_NODE_CACHE_ROOTS_LIMIT;
+    const BREthereumHash *candidates = (NULL == parent
+                                        ? mptNodeCache.roots
+                                        : mptNodeGetReferences (parent, &candidatesCount));
+
+    for (size_t index = 0; NULL != mptNodeCache.entries && NULL == node && index < candidatesCount; index++) {
+        BREthereumMPTNodeCacheEntry *entry = BRSetGet (mptNodeCache.entries, &candidates[index]);
+        if (NULL != entry &&
+            entry->encoding.bytesCount == encoding.bytesCount &&
+            0 == memcmp (entry->encoding.bytes, encoding.bytes, encoding.bytesCount)) {
+            *hash = entry->hash;
+            node  = mptNodeCopy (entry->node);
+        }
+    }
+
+    pthread_mutex_unlock (&mptNodeCache.lock);
+    return node;
+}
+
+/**
+ * Add the `count` nodes at `indices` in `nodes` to the cache, each with its `hashes` and
+ * `encodings`, and make `root` the most recent root.  Nodes without a hash (embedded) or that
+ * failed to decode are skipped.
+ */
+static void
+mptNodeCacheAdd (BREthereumMPTNode *nodes,
+                 const BREthereumHash *hashes,
+                 const BRRlpData *encodings,
+                 const size_t *indices,
+                 size_t count,
+                 BREthereumHash root) {
+    pthread_mutex_lock (&mptNodeCache.lock);
+
+    if (NULL == mptNodeCache.entries)
+        mptNodeCache.entries = BRSetNew (mptNodeCacheEntryHashValue,
+                                         mptNodeCacheEntryHashEqual,
+                                         MPT_NODE_CACHE_LIMIT);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t index = indices[i];
+        if (NULL == nodes[index] ||
+            encodings[index].bytesCount < ETHEREUM_HASH_BYTES ||
+            ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (hashes[index], EMPTY_HASH_INIT)) ||
+            NULL != BRSetGet (mptNodeCache.entries, &hashes[index]))
+            continue;
+
+        // Evict the oldest
+        BREthereumMPTNodeCacheEntry *oldest = mptNodeCache.entriesOrdered[mptNodeCache.entriesNext];
+        if (NULL != oldest) {
+            BRSetRemove (mptNodeCache.entries, oldest);
+            mptNodeCacheEntryRelease (oldest);
+        }
+
+        BREthereumMPTNodeCacheEntry *entry = malloc (sizeof (BREthereumMPTNodeCacheEntry));
+        entry->hash     = hashes[index];
+        entry->encoding = rlpDataCopy (encodings[index]);
+        entry->node     = mptNodeCopy (nodes[index]);
+
+        BRSetAdd (mptNodeCache.entries, entry);
+        mptNodeCache.entriesOrdered[mptNodeCache.entriesNext] = entry;
+        mptNodeCache.entriesNext = (mptNodeCache.entriesNext + 1) % MPT_NODE_CACHE_LIMIT;
+    }
+
+    int rootIsRecent = ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (root, EMPTY_HASH_INIT));
+    for (size_t index = 0; !rootIsRecent && index < MPT_NODE_CACHE_ROOTS_LIMIT; index++)
+        rootIsRecent = ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (root, mptNodeCache.roots[index]));
+
+    if (!rootIsRecent) {
+        mptNodeCache.roots[mptNodeCache.rootsNext] = root;
+        mptNodeCache.rootsNext = (mptNodeCache.rootsNext + 1) % MPT_NODE_CACHE_ROOTS_LIMIT;
+    }
+
+    pthread_mutex_unlock (&mptNodeCache.lock);
+}
+
 /// MARK: - MPT Node Path
 
 struct BREthereumMPTNodePathRecord {
     BRArrayOf(BREthereumMPTNode) nodes;
+
+    // The Keccak256 hash of each node's RLP encoding, as referenced by its parent node.  A
+    // non-root node whose encoding is shorter than a hash is embedded in its parent, not
+    // referenced; its 'hash' is EMPTY_HASH_INIT and its encoding is in `embeddings`.  The root
+    // is always hashed.
+    BRArrayOf(BREthereumHash) hashes;
+    BRArrayOf(BRRlpData) embeddings;
 };
 
 static BREthereumMPTNodePath
-mptNodePathCreate (BRArrayOf(BREthereumMPTNode) nodes) {
+mptNodePathCreate (BRArrayOf(BREthereumMPTNode) nodes,
+                   BRArrayOf(BREthereumHash) hashes,
+                   BRArrayOf(BRRlpData) embeddings) {
     BREthereumMPTNodePath path = malloc (sizeof (struct BREthereumMPTNodePathRecord));
-    path->nodes = nodes;
+    path->nodes  = nodes;
+    path->hashes = hashes;
+    path->embeddings = embeddings;
     return path;
 }
 
 extern void
 mptNodePathRelease (BREthereumMPTNodePath path) {
-    for (size_t index = 0; index < array_count (path->nodes); index++)
+    for (size_t index = 0; index < array_count (path->nodes); index++) {
         mptNodeRelease (path->nodes[index]);
+        rlpDataRelease (path->embeddings[index]);
+    }
     array_free (path->nodes);
+    array_free (path->hashes);
+    array_free (path->embeddings);
     free (path);
 }
 
@@ -232,43 +475,154 @@ mptNodePathsRelease (BRArrayOf(BREthereumMPTNodePath) paths) {
     }
 }
 
+/**
+ * Create a path from `count` node `encodings`, decoding each node from `items` or, if `items` is
+ * NULL, from its encoding.  Nodes found in the cache are copied from it.  The others are decoded
+ * and then hashed in one batch - a proof holds a handful of nodes, most of them 17-item branches
+ * spanning four Keccak blocks, and the multi-buffer Keccak256 hashes them together - and cached.
+ */
+static BREthereumMPTNodePath
+mptNodePathCreateFromEncodings (const BRRlpData *encodings,
+                                const BRRlpItem *items,
+                                size_t count,
+                                BRRlpCoder coder) {
+    BRArrayOf(BREthereumMPTNode) nodes;
+    BRArrayOf(BREthereumHash) hashes;
+    BRArrayOf(BRRlpData) embeddings;
+
+    array_new (nodes,  count);
+    array_new (hashes, count);
+    array_new (embeddings, count);
+
+    size_t missed[count + 1];
+    size_t missedCount = 0;
+
+    for (size_t index = 0; index < count; index++) {
+        BREthereumMPTNode parent = (0 == index ? NULL : nodes[index - 1]);
+        BREthereumHash hash = EMPTY_HASH_INIT;
+
+        // If a parent failed to decode, it has no references to look up.
+        BREthereumMPTNode node = (0 == index || NULL != parent
+                                  ? mptNodeCacheFind (parent, encodings[index], &hash)
+                                  : NULL);
+        if (NULL == node) {
+            node = (NULL != items
+                    ? mptNodeDecode (items[index], coder)
+                    : mptNodeDecodeFromBytes (encodings[index], coder));
+            missed[missedCount++] = index;
+        }
+
+        array_add (nodes,  node);
+        array_add (hashes, hash);
+        array_add (embeddings, (0 != index && encodings[index].bytesCount < ETHEREUM_HASH_BYTES
+                                ? rlpDataCopy (encodings[index])
+                                : (BRRlpData) { 0, NULL }));
+    }
+
+    if (missedCount > 0) {
+        const void *datas[missedCount];
+        size_t dataLens[missedCount];
+        BREthereumHash missedHashes[missedCount];
+
+        for (size_t i = 0; i < missedCount; i++) {
+            datas[i]    = encodings[missed[i]].bytes;
+            dataLens[i] = encodings[missed[i]].bytesCount;
+        }
+
+        BRKeccak256Batch (missedHashes, datas, dataLens, missedCount);
+
+        for (size_t i = 0; i < missedCount; i++)
+            hashes[missed[i]] = (0 != missed[i] && dataLens[i] < ETHEREUM_HASH_BYTES
+                                 ? EMPTY_HASH_INIT
+                                 : missedHashes[i]);
+    }
+
+    mptNodeCacheAdd (nodes, hashes, encodings, missed, missedCount,
+                     (0 == count ? EMPTY_HASH_INIT : hashes[0]));
+
+    return mptNodePathCreate (nodes, hashes, embeddings);
+}
+
 extern BREthereumMPTNodePath
 mptNodePathDecode (BRRlpItem item,
                    BRRlpCoder coder) {
     size_t itemsCount;
     const BRRlpItem *items = rlpDecodeList (coder, item, &itemsCount);
 
-    BRArrayOf (BREthereumMPTNode) nodes;
-    array_new (nodes, itemsCount);
+    BRRlpData encodings[itemsCount + 1];
     for (size_t index = 0; index < itemsCount; index++)
-        array_add (nodes, mptNodeDecode (items[index], coder));
+        encodings[index] = rlpItemGetDataSharedDontRelease (coder, items[index]);
 
-    return mptNodePathCreate(nodes);
+    return mptNodePathCreateFromEncodings (encodings, items, itemsCount, coder);
 }
 
 extern BREthereumMPTNodePath
 mptNodePathDecodeFromBytes (BRRlpItem item,
                             BRRlpCoder coder) {
     size_t itemsCount = 0;
-    BRRlpItem *items = (BRRlpItem *) rlpDecodeList(coder, item, &itemsCount);
-
-    BRArrayOf (BREthereumMPTNode) nodes;
-    array_new (nodes, itemsCount);
-    for (size_t index = 0; index < itemsCount; index++) {
-        // items[index] holds bytes as the RLP encoding of MPT nodes.  We'll decode the bytes
-        // and then RLP encode the bytes (but this time as RLP items.... got it??).
-        BRRlpData data = rlpDecodeBytesSharedDontRelease (coder, items[index]);
-        BRRlpItem item = rlpDataGetItem(coder, data);
-        array_add (nodes, mptNodeDecode (item, coder));
-#if defined (MPT_SHOW_PROOF_NODES)
-        rlpShowItem (coder, item, "MPTN");
-#endif
-        rlpItemRelease (coder, item);
+    const BRRlpItem *items = rlpDecodeList(coder, item, &itemsCount);
+
+    // items[index] holds bytes as the RLP encoding of MPT nodes.  We'll decode the bytes
+    // and then RLP encode the bytes (but this time as RLP items.... got it??).
+    BRRlpData encodings[itemsCount + 1];
+    for (size_t index = 0; index < itemsCount; index++)
+        encodings[index] = rlpDecodeBytesSharedDontRelease (coder, items[index]);
+
+    // TODO: If any item is decoded improperly, then the path's nodes will have NULL values.
+
+    return mptNodePathCreateFromEncodings (encodings, NULL, itemsCount, coder);
+}
+
+/**
+ * Return the hash of the child node that `node` references for the key nibble `nibble`, or
+ * EMPTY_HASH_INIT if `node` references none or embeds the child.  Fill `embedded` with the
+ * encoding of an embedded child, if any.
+ */
+static BREthereumHash
+mptNodeGetReference (BREthereumMPTNode node, uint8_t nibble, BRRlpData *embedded) {
+    *embedded = (BRRlpData) { 0, NULL };
+    switch (node->type) {
+        case MPT_NODE_LEAF:
+            return EMPTY_HASH_INIT;
+
+        case MPT_NODE_EXTENSION:
+            *embedded = node->u.extension.embedded;
+            return node->u.extension.key;
+
+        case MPT_NODE_BRANCH:
+            *embedded = node->u.branch.embedded[nibble];
+            return node->u.branch.keys[nibble];
     }
+    return EMPTY_HASH_INIT;
+}
 
-    // TODO: If any above item is decoded improperly, then `nodes` will have NULL values.
+/**
+ * Check that the path's node at `index` is the node that `parent` references for the key nibble
+ * `nibble`.  A referenced node's hash must match the parent's reference; an embedded node's
+ * encoding must match, byte for byte, the node embedded in the parent.
+ */
+static int
+mptNodePathIsReferenced (BREthereumMPTNodePath path,
+                         size_t index,
+                         BREthereumMPTNode parent,
+                         uint8_t nibble) {
+    BRRlpData embedded;
+    BREthereumHash reference = mptNodeGetReference (parent, nibble, &embedded);
+
+    if (ETHEREUM_BOOLEAN_IS_FALSE (ethHashEqual (path->hashes[index], EMPTY_HASH_INIT)))
+        return ETHEREUM_BOOLEAN_IS_TRUE (ethHashEqual (path->hashes[index], reference));
+
+    BRRlpData encoding = path->embeddings[index];
+    return (0 != encoding.bytesCount &&
+            encoding.bytesCount == embedded.bytesCount &&
+            0 == memcmp (encoding.bytes, embedded.bytes, encoding.bytesCount));
+}
 
-    return mptNodePathCreate(nodes);
+extern BREthereumHash
+mptNodePathGetRootHash (BREthereumMPTNodePath path) {
+    return (0 == array_count (path->hashes)
+            ? EMPTY_HASH_INIT
+            : path->hashes[0]);
 }
 
 extern BREthereumMPTNode
@@ -285,10 +639,17 @@ mptNodePathGetNode (BREthereumMPTNodePath path,
     }
 
     uint8_t keyEncodedIndex = 0;
+    uint8_t keyNibble = 0;
 
-    // Walk the nodes, consuming the key if possible.
+    // Walk the nodes, consuming the key if possible.  Each node must be the one its parent
+    // references; otherwise the proof is forged or corrupt and the key is not proven.
     for (size_t index = 0; index < array_count (path->nodes); index++) {
         BREthereumMPTNode node = path->nodes[index];
+        if (NULL == node ||
+            (index > 0 && !mptNodePathIsReferenced (path, index, path->nodes[index - 1], keyNibble)))
+            break;
+
+        keyNibble = keyEncoded[keyEncodedIndex];
         size_t keyEncodedIncrement = mptNodeConsume (node, &keyEncoded[keyEncodedIndex]);
 
         // nothing consumed, definitively node missed
@@ -303,8 +664,10 @@ mptNodePathGetNode (BREthereumMPTNodePath path,
             // path, holding the 'value'.  Not sure why (Parity bug submitted); we'll try to
             // pick out that node
             if (index + 1 + 1 == array_count(path->nodes) &&       // one node remains...
+                NULL != path->nodes[index + 1] &&
                 MPT_NODE_LEAF == path->nodes[index + 1]->type &&   // it is a leaf node
-                0 == path->nodes[index + 1]->u.leaf.path.count)    // it has no path
+                0 == path->nodes[index + 1]->u.leaf.path.count &&  // it has no path
+                mptNodePathIsReferenced (path, index + 1, node, keyNibble))
                 return path->nodes[index + 1];
 
             return node;
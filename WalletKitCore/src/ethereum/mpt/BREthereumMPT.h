@@ -65,6 +65,14 @@ extern BREthereumBoolean
 mptNodePathIsValid (BREthereumMPTNodePath path,
                     BREthereumData key);
 
+/**
+ * Return the hash of the path's first node - for a valid proof, the root of the trie that proves
+ * the key (a state root, a CHT root).  The path only checks that each node is referenced by its
+ * parent; comparing this to a trusted root is up to the caller.
+ */
+extern BREthereumHash
+mptNodePathGetRootHash (BREthereumMPTNodePath path);
+
 extern BREthereumMPTNodePath
 mptNodePathDecode (BRRlpItem item,
                    BRRlpCoder coder);
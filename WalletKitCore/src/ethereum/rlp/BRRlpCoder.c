@@ -970,6 +970,364 @@ rlpDataGetItem (BRRlpCoder coder, BRRlpData data) {
     return result;
 }
 
+//
+// RLP Cursor
+//
+extern BRRlpCursor
+rlpCursorCreate (BRRlpData data) {
+    return (BRRlpCursor) {
+        data.bytes,
+        data.bytes + data.bytesCount,
+        0,
+        NULL
+    };
+}
+
+extern int
+rlpCursorHasFailed (const BRRlpCursor *cursor) {
+    return cursor->failed;
+}
+
+extern void
+rlpCursorSetFailed (BRRlpCursor *cursor) {
+    for (; NULL != cursor; cursor = cursor->parent)
+        cursor->failed = 1;
+}
+
+extern int
+rlpCursorHasNext (const BRRlpCursor *cursor) {
+    return !cursor->failed && cursor->bytes < cursor->bytesLimit;
+}
+
+/**
+ * Fill `view` with the item at `bytes`, which must fit within `bytesLimit`.  This is the
+ * bounds-checked counterpart of decodeLength(); return false if the item is malformed.
+ */
+static int
+cursorDecodeView (uint8_t *bytes, uint8_t *bytesLimit, BRRlpView *view) {
+    size_t available = bytesLimit - bytes;
+    if (0 == available) return 0;
+
+    uint8_t prefix   = bytes[0];
+    uint8_t baseline = (prefix < RLP_PREFIX_LIST ? RLP_PREFIX_BYTES : RLP_PREFIX_LIST);
+
+    size_t   offset = 0;
+    uint64_t length = 1;
+
+    if (prefix < RLP_PREFIX_BYTES) ;
+
+    else if ((prefix - baseline) <= RLP_PREFIX_LENGTH_LIMIT) {
+        offset = 1;
+        length = prefix - baseline;
+    }
+
+    else {
+        size_t lengthByteCount = (prefix - baseline) - RLP_PREFIX_LENGTH_LIMIT;
+        if (1 + lengthByteCount > available) return 0;
+
+        offset = 1 + lengthByteCount;
+        length = 0;
+        for (size_t index = 1; index < offset; index++)
+            length = (length << 8) | bytes[index];
+    }
+
+    if (length > available - offset) return 0;
+
+    view->isList   = (baseline == RLP_PREFIX_LIST);
+    view->encoding = (BRRlpData) { offset + (size_t) length, bytes };
+    view->payload  = (BRRlpData) { (size_t) length, bytes + offset };
+    return 1;
+}
+
+extern size_t
+rlpCursorCount (const BRRlpCursor *cursor) {
+    if (cursor->failed) return 0;
+
+    size_t count = 0;
+    BRRlpView view;
+    for (uint8_t *bytes = cursor->bytes; bytes < cursor->bytesLimit; bytes += view.encoding.bytesCount) {
+        if (!cursorDecodeView (bytes, cursor->bytesLimit, &view)) {
+            rlpCursorSetFailed ((BRRlpCursor *) cursor);
+            return 0;
+        }
+        count++;
+    }
+    return count;
+}
+
+extern BRRlpView
+rlpCursorNext (BRRlpCursor *cursor) {
+    BRRlpView view = { 0, { 0, NULL }, { 0, NULL } };
+
+    if (cursor->failed) return view;
+
+    if (!cursorDecodeView (cursor->bytes, cursor->bytesLimit, &view)) {
+        rlpCursorSetFailed (cursor);
+        return (BRRlpView) { 0, { 0, NULL }, { 0, NULL } };
+    }
+
+    cursor->bytes += view.encoding.bytesCount;
+    return view;
+}
+
+extern BRRlpCursor
+rlpCursorEnter (BRRlpCursor *cursor, BRRlpView list) {
+    if (!cursor->failed && !list.isList) rlpCursorSetFailed (cursor);
+
+    return (BRRlpCursor) {
+        list.payload.bytes,
+        list.payload.bytes + list.payload.bytesCount,
+        cursor->failed,
+        cursor
+    };
+}
+
+extern BRRlpCursor
+rlpCursorNextList (BRRlpCursor *cursor) {
+    return rlpCursorEnter (cursor, rlpCursorNext (cursor));
+}
+
+extern int
+rlpCursorFinish (BRRlpCursor *cursor) {
+    if (rlpCursorHasNext (cursor)) rlpCursorSetFailed (cursor);
+    return !cursor->failed;
+}
+
+/**
+ * Return the next item's bytes, failing if the item is a list or has more than `bytesLimit`.
+ */
+static BRRlpData
+cursorNextBytes (BRRlpCursor *cursor, size_t bytesLimit) {
+    BRRlpView view = rlpCursorNext (cursor);
+
+    if (!cursor->failed && (view.isList || view.payload.bytesCount > bytesLimit))
+        rlpCursorSetFailed (cursor);
+
+    return (cursor->failed ? (BRRlpData) { 0, NULL } : view.payload);
+}
+
+extern uint64_t
+rlpCursorNextUInt64 (BRRlpCursor *cursor) {
+    BRRlpData data = cursorNextBytes (cursor, sizeof (uint64_t));
+
+    uint64_t result = 0;
+    for (size_t index = 0; index < data.bytesCount; index++)
+        result = (result << 8) | data.bytes[index];
+    return result;
+}
+
+extern UInt256
+rlpCursorNextUInt256 (BRRlpCursor *cursor) {
+    BRRlpData data = cursorNextBytes (cursor, sizeof (UInt256));
+
+    UInt256 result = UINT256_ZERO;
+    if (0 != data.bytesCount)
+        convertFromBigEndian (result.u8, sizeof (result), data.bytes, data.bytesCount);
+    return result;
+}
+
+extern BRRlpData
+rlpCursorNextBytesSharedDontRelease (BRRlpCursor *cursor) {
+    return cursorNextBytes (cursor, SIZE_MAX);
+}
+
+extern void
+rlpCursorNextBytesFixed (BRRlpCursor *cursor, uint8_t *bytes, size_t bytesCount, int allowEmpty) {
+    BRRlpData data = cursorNextBytes (cursor, bytesCount);
+
+    if (!cursor->failed && data.bytesCount != bytesCount && !(allowEmpty && 0 == data.bytesCount))
+        rlpCursorSetFailed (cursor);
+
+    if (cursor->failed || 0 == data.bytesCount)
+        memset (bytes, 0, bytesCount);
+    else
+        memcpy (bytes, data.bytes, bytesCount);
+}
+
+//
+// RLP Writer
+//
+
+/**
+ * The size of the RLP prefix for an item with `length` bytes, as per encodeLengthIntoBytes().
+ */
+static size_t
+sizeLength (uint64_t length) {
+    size_t size = 1;
+    if (length > RLP_PREFIX_LENGTH_LIMIT)
+        for (; 0 != length; length >>= 8) size++;
+    return size;
+}
+
+static size_t
+sizeNumber (uint8_t *source, size_t sourceCount) {
+    uint8_t bytes [sourceCount];
+    size_t bytesIndex, bytesCount;
+
+    convertToBigEndianAndNormalize (bytes, source, sourceCount, &bytesIndex, &bytesCount);
+    return rlpSizeBytes (&bytes[bytesIndex], bytesCount);
+}
+
+extern size_t
+rlpSizeUInt64 (uint64_t value, int zeroAsEmptyString) {
+    return (1 == zeroAsEmptyString && 0 == value
+            ? 1
+            : sizeNumber ((uint8_t *) &value, sizeof (value)));
+}
+
+extern size_t
+rlpSizeUInt256 (UInt256 value, int zeroAsEmptyString) {
+    return (1 == zeroAsEmptyString && 0 == uint256Compare (value, UINT256_ZERO)
+            ? 1
+            : sizeNumber (value.u8, sizeof (value)));
+}
+
+extern size_t
+rlpSizeBytes (const uint8_t *bytes, size_t bytesCount) {
+    return (1 == bytesCount && bytes[0] < RLP_PREFIX_BYTES
+            ? 1
+            : sizeLength (bytesCount) + bytesCount);
+}
+
+extern size_t
+rlpSizeBytesPurgeLeadingZeros (const uint8_t *bytes, size_t bytesCount) {
+    size_t offset = findNonZeroIndex ((uint8_t *) bytes, bytesCount);
+    return rlpSizeBytes (&bytes[offset], bytesCount - offset);
+}
+
+/**
+ * Strip "0x" from `string` and return the count of bytes that it encodes.
+ */
+static size_t
+hexStringBytesCount (const char **string) {
+    if (NULL == *string) return 0;
+
+    if (0 == strncmp (*string, "0x", 2))
+        *string = &(*string)[2];
+
+    size_t stringLen = strlen (*string);
+    assert (0 == stringLen % 2);
+    return stringLen / 2;
+}
+
+extern size_t
+rlpSizeHexString (const char *string) {
+    size_t bytesCount = hexStringBytesCount (&string);
+    if (1 != bytesCount) return sizeLength (bytesCount) + bytesCount;
+
+    uint8_t byte;
+    hexDecode (&byte, 1, string, 2);
+    return rlpSizeBytes (&byte, 1);
+}
+
+extern size_t
+rlpSizeList (size_t itemsBytesCount) {
+    return sizeLength (itemsBytesCount) + itemsBytesCount;
+}
+
+extern BRRlpWriter
+rlpWriterCreate (uint8_t *bytes, size_t bytesCount) {
+    return (BRRlpWriter) { bytes, bytesCount, 0, 0 };
+}
+
+extern int
+rlpWriterHasFailed (const BRRlpWriter *writer) {
+    return writer->failed;
+}
+
+extern BRRlpData
+rlpWriterGetDataSharedDontRelease (const BRRlpWriter *writer) {
+    return (BRRlpData) { writer->bytesIndex, writer->bytes };
+}
+
+/**
+ * Reserve `bytesCount` bytes in `writer`; return NULL, and fail, if they don't fit.
+ */
+static uint8_t *
+writerReserve (BRRlpWriter *writer, size_t bytesCount) {
+    if (writer->failed || bytesCount > writer->bytesCount - writer->bytesIndex) {
+        writer->failed = 1;
+        return NULL;
+    }
+
+    uint8_t *bytes = &writer->bytes[writer->bytesIndex];
+    writer->bytesIndex += bytesCount;
+    return bytes;
+}
+
+static void
+writerWriteLength (BRRlpWriter *writer, uint64_t length, uint8_t baseline) {
+    uint8_t bytes9Count, bytes9[9];
+    encodeLengthIntoBytes (length, baseline, bytes9, &bytes9Count);
+
+    uint8_t *bytes = writerReserve (writer, bytes9Count);
+    if (NULL != bytes) memcpy (bytes, bytes9, bytes9Count);
+}
+
+static void
+writerWriteNumber (BRRlpWriter *writer, uint8_t *source, size_t sourceCount) {
+    uint8_t bytes [sourceCount];
+    size_t bytesIndex, bytesCount;
+
+    convertToBigEndianAndNormalize (bytes, source, sourceCount, &bytesIndex, &bytesCount);
+    rlpWriteBytes (writer, &bytes[bytesIndex], bytesCount);
+}
+
+extern void
+rlpWriteUInt64 (BRRlpWriter *writer, uint64_t value, int zeroAsEmptyString) {
+    if (1 == zeroAsEmptyString && 0 == value)
+        rlpWriteBytes (writer, NULL, 0);
+    else
+        writerWriteNumber (writer, (uint8_t *) &value, sizeof (value));
+}
+
+extern void
+rlpWriteUInt256 (BRRlpWriter *writer, UInt256 value, int zeroAsEmptyString) {
+    if (1 == zeroAsEmptyString && 0 == uint256Compare (value, UINT256_ZERO))
+        rlpWriteBytes (writer, NULL, 0);
+    else
+        writerWriteNumber (writer, value.u8, sizeof (value));
+}
+
+extern void
+rlpWriteBytes (BRRlpWriter *writer, const uint8_t *bytes, size_t bytesCount) {
+    // Encode a single byte directly; otherwise encode the length and then the bytes themselves
+    if (1 != bytesCount || bytes[0] >= RLP_PREFIX_BYTES)
+        writerWriteLength (writer, bytesCount, RLP_PREFIX_BYTES);
+
+    uint8_t *target = writerReserve (writer, bytesCount);
+    if (NULL != target && 0 != bytesCount) memcpy (target, bytes, bytesCount);
+}
+
+extern void
+rlpWriteBytesPurgeLeadingZeros (BRRlpWriter *writer, const uint8_t *bytes, size_t bytesCount) {
+    size_t offset = findNonZeroIndex ((uint8_t *) bytes, bytesCount);
+    rlpWriteBytes (writer, &bytes[offset], bytesCount - offset);
+}
+
+extern void
+rlpWriteHexString (BRRlpWriter *writer, const char *string) {
+    size_t bytesCount = hexStringBytesCount (&string);
+
+    // A single byte might encode as itself; otherwise decode the hex directly into `writer`.
+    if (1 == bytesCount) {
+        uint8_t byte;
+        hexDecode (&byte, 1, string, 2);
+        rlpWriteBytes (writer, &byte, 1);
+        return;
+    }
+
+    writerWriteLength (writer, bytesCount, RLP_PREFIX_BYTES);
+
+    uint8_t *target = writerReserve (writer, bytesCount);
+    if (NULL != target && 0 != bytesCount) hexDecode (target, bytesCount, string, 2 * bytesCount);
+}
+
+extern void
+rlpWriteList (BRRlpWriter *writer, size_t itemsBytesCount) {
+    writerWriteLength (writer, itemsBytesCount, RLP_PREFIX_LIST);
+}
+
 //
 // Show
 //
@@ -210,6 +210,170 @@ rlpDataDecodeUInt256 (BRRlpData data);
 extern uint64_t
 rlpDataDecodeUInt64 (BRRlpData data);
 
+//
+// RLP Cursor
+//
+// A cursor decodes RLP in place, over bytes owned by the caller.  Unlike rlpDataGetItem() no
+// BRRlpItem tree is built, so there is no coder, no lock and no allocation.  Each item is
+// validated as the cursor steps over it; a malformed item, or a typed decode that doesn't fit
+// its target, marks the cursor - and every cursor it was entered from - as failed.  Once failed
+// every further decode returns zero/empty.  Views and shared data alias the caller's bytes and
+// are valid only as long as those bytes are.
+//
+typedef struct BRRlpCursorRecord {
+    uint8_t *bytes;
+    uint8_t *bytesLimit;
+    int failed;
+    struct BRRlpCursorRecord *parent;
+} BRRlpCursor;
+
+typedef struct {
+    int isList;
+    BRRlpData encoding;     // The complete item, including the RLP prefix and length
+    BRRlpData payload;      // The item's bytes, or the list's encoded items, w/o the length
+} BRRlpView;
+
+/**
+ * Create a cursor over `data`, which holds zero or more RLP encoded items.
+ */
+extern BRRlpCursor
+rlpCursorCreate (BRRlpData data);
+
+extern int
+rlpCursorHasFailed (const BRRlpCursor *cursor);
+
+/**
+ * Mark `cursor`, and the cursors it was entered from, as failed.  Used by typed decoders when
+ * well-formed RLP has the wrong shape (e.g. an unexpected number of list items).
+ */
+extern void
+rlpCursorSetFailed (BRRlpCursor *cursor);
+
+/**
+ * Return true if `cursor` has not failed and has another item.
+ */
+extern int
+rlpCursorHasNext (const BRRlpCursor *cursor);
+
+/**
+ * Return the count of the remaining items, validating each one.  The cursor is not advanced.
+ */
+extern size_t
+rlpCursorCount (const BRRlpCursor *cursor);
+
+/**
+ * Return a view of the next item and advance past it.
+ */
+extern BRRlpView
+rlpCursorNext (BRRlpCursor *cursor);
+
+/**
+ * Return a cursor over the items of `list`, a view previously returned from `cursor`.  If `list`
+ * is not a list the cursor fails.
+ */
+extern BRRlpCursor
+rlpCursorEnter (BRRlpCursor *cursor, BRRlpView list);
+
+/**
+ * Return a cursor over the items of the next item, which must be a list.
+ */
+extern BRRlpCursor
+rlpCursorNextList (BRRlpCursor *cursor);
+
+/**
+ * Fail `cursor` if any items remain; return true if `cursor` has not failed.
+ */
+extern int
+rlpCursorFinish (BRRlpCursor *cursor);
+
+extern uint64_t
+rlpCursorNextUInt64 (BRRlpCursor *cursor);
+
+extern UInt256
+rlpCursorNextUInt256 (BRRlpCursor *cursor);
+
+/**
+ * Return the next item's bytes, w/o the RLP length; the result aliases the cursor's bytes.
+ */
+extern BRRlpData
+rlpCursorNextBytesSharedDontRelease (BRRlpCursor *cursor);
+
+/**
+ * Fill `bytes` with the next item's bytes, which must number exactly `bytesCount`.  If
+ * `allowEmpty` an empty item is also accepted and fills `bytes` with zeros.
+ */
+extern void
+rlpCursorNextBytesFixed (BRRlpCursor *cursor, uint8_t *bytes, size_t bytesCount, int allowEmpty);
+
+//
+// RLP Writer
+//
+// A writer encodes RLP directly into bytes provided by the caller, without a coder and without
+// building a BRRlpItem tree.  Sizes come first: each rlpSizeXXX() returns the exact encoded size
+// of an item, the same size as the corresponding rlpEncodeXXX() item; rlpSizeList() returns the
+// size of a list given the summed sizes of its items.  With the total size known, the caller
+// provides a buffer and the writer fills it in one pass - a list is written as rlpWriteList(),
+// with the summed sizes of its items, followed by the items themselves.  A write that doesn't
+// fit marks the writer as failed; nothing is written past the end of the buffer.
+//
+typedef struct {
+    uint8_t *bytes;
+    size_t bytesCount;
+    size_t bytesIndex;
+    int failed;
+} BRRlpWriter;
+
+extern size_t
+rlpSizeUInt64 (uint64_t value, int zeroAsEmptyString);
+
+extern size_t
+rlpSizeUInt256 (UInt256 value, int zeroAsEmptyString);
+
+extern size_t
+rlpSizeBytes (const uint8_t *bytes, size_t bytesCount);
+
+extern size_t
+rlpSizeBytesPurgeLeadingZeros (const uint8_t *bytes, size_t bytesCount);
+
+extern size_t
+rlpSizeHexString (const char *string);
+
+extern size_t
+rlpSizeList (size_t itemsBytesCount);
+
+extern BRRlpWriter
+rlpWriterCreate (uint8_t *bytes, size_t bytesCount);
+
+extern int
+rlpWriterHasFailed (const BRRlpWriter *writer);
+
+/**
+ * Return the bytes written so far; the result shares the writer's bytes.
+ */
+extern BRRlpData
+rlpWriterGetDataSharedDontRelease (const BRRlpWriter *writer);
+
+extern void
+rlpWriteUInt64 (BRRlpWriter *writer, uint64_t value, int zeroAsEmptyString);
+
+extern void
+rlpWriteUInt256 (BRRlpWriter *writer, UInt256 value, int zeroAsEmptyString);
+
+extern void
+rlpWriteBytes (BRRlpWriter *writer, const uint8_t *bytes, size_t bytesCount);
+
+extern void
+rlpWriteBytesPurgeLeadingZeros (BRRlpWriter *writer, const uint8_t *bytes, size_t bytesCount);
+
+extern void
+rlpWriteHexString (BRRlpWriter *writer, const char *string);
+
+/**
+ * Write the start of a list whose items, written next, have a summed size of `itemsBytesCount`.
+ */
+extern void
+rlpWriteList (BRRlpWriter *writer, size_t itemsBytesCount);
+
 #ifdef __cplusplus
 }
 #endif
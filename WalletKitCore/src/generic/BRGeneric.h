@@ -372,4 +372,14 @@ extern "C" {
     genManagerSaveTransfer (BRGenericManager gwm,
                             BRGenericTransfer transfer);
 
+    /**
+     * Begin a batch of transfer saves; all saves until genManagerCommitSaveBatch() are
+     * committed to storage together.  Batches nest.
+     */
+    extern void
+    genManagerBeginSaveBatch (BRGenericManager gwm);
+
+    extern void
+    genManagerCommitSaveBatch (BRGenericManager gwm);
+
 #endif /* BRGeneric_h */
@@ -354,6 +354,10 @@ genManagerCreate (BRGenericClient client,
                                                                 fileServiceSpecificationsCount,
                                                                 fileServiceSpecifications);
 
+    // Announced transfers arrive in bursts; avoid an fsync on every commit.
+    fileServiceSetJournalMode (gwm->fileService, FILE_SERVICE_JOURNAL_MODE_WAL);
+    fileServiceSetSynchronous (gwm->fileService, FILE_SERVICE_SYNCHRONOUS_NORMAL);
+
     // Wallet ??
 
     // Earliest blockHeight from accountTimestamp.
@@ -616,6 +620,16 @@ genManagerSaveTransfer (BRGenericManager gwm,
     fileServiceSave (gwm->fileService, fileServiceTypeTransactions, transfer);
 }
 
+extern void
+genManagerBeginSaveBatch (BRGenericManager gwm) {
+    fileServiceBeginBatch (gwm->fileService);
+}
+
+extern void
+genManagerCommitSaveBatch (BRGenericManager gwm) {
+    fileServiceCommitBatch (gwm->fileService);
+}
+
 /// MARK: Periodic Dispatcher
 
 static void
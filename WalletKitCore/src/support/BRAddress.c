@@ -344,13 +344,13 @@ size_t BRAddressFromScriptPubKey(char *addr, size_t addrLen, BRAddressParams par
         // pay-to-pubkey-hash scriptPubKey
         data[0] = params.pubKeyPrefix;
         memcpy(&data[1], BRScriptData(elems[2], &l), 20);
-        r = BRBase58CheckEncode(addr, addrLen, data, 21);
+        r = BRBase58CheckEncodePublic(addr, addrLen, data, 21);
     }
     else if (count == 3 && *elems[0] == OP_HASH160 && *elems[1] == 20 && *elems[2] == OP_EQUAL) {
         // pay-to-script-hash scriptPubKey
         data[0] = params.scriptPrefix;
         memcpy(&data[1], BRScriptData(elems[1], &l), 20);
-        r = BRBase58CheckEncode(addr, addrLen, data, 21);
+        r = BRBase58CheckEncodePublic(addr, addrLen, data, 21);
     }
 //    else if (count == 2 && (*elems[0] == 65 || *elems[0] == 33) && *elems[1] == OP_CHECKSIG) {
 //        // pay-to-pubkey scriptPubKey
@@ -396,7 +396,7 @@ size_t BRAddressFromScriptSig(char *addr, size_t addrLen, BRAddressParams params
 //    }
     // pay-to-witness scriptSig's are empty
     
-    return (d) ? BRBase58CheckEncode(addr, addrLen, data, 21) : 0;
+    return (d) ? BRBase58CheckEncodePublic(addr, addrLen, data, 21) : 0;
 }
 
 // writes the bitcoin address for a witness to addr
@@ -450,13 +450,44 @@ size_t BRAddressFromHash160(char *addr, size_t addrLen, BRAddressParams params,
     else {
         data[0] = params.pubKeyPrefix;
         memcpy(&data[1], md20, 20);
-        r = BRBase58CheckEncode(a, sizeof(a), data, 21);
+        r = BRBase58CheckEncodePublic(a, sizeof(a), data, 21);
     }
     
     if (addr && r <= addrLen) memcpy(addr, a, r);
     return (! addr || r <= addrLen) ? r : 0;
 }
 
+// writes the address for each of count consecutive 20 byte hash160s in md20s to addrs, as BRAddressFromHash160()
+// returns the number of addresses written
+size_t BRAddressesFromHash160s(BRAddress addrs[], BRAddressParams params, const void *md20s, size_t count)
+{
+    uint8_t _data[21*0x100], *data = (count <= 0x100) ? _data : malloc(21*count);
+    size_t i, r = 0;
+    
+    assert(addrs != NULL || count == 0);
+    assert(md20s != NULL || count == 0);
+    assert(data != NULL);
+    
+    if (params.bech32Prefix) {
+        for (i = 0; i < count; i++) {
+            if (BRAddressFromHash160(addrs[i].s, sizeof(*addrs), params, (const uint8_t *)md20s + i*20) == 0) break;
+        }
+        
+        r = i;
+    }
+    else {
+        for (i = 0; i < count; i++) {
+            data[i*21] = params.pubKeyPrefix;
+            memcpy(&data[i*21 + 1], (const uint8_t *)md20s + i*20, 20);
+        }
+        
+        r = BRBase58CheckEncodeBatch((char *)addrs, sizeof(*addrs), data, 21, 21, count);
+    }
+    
+    if (data != _data) free(data);
+    return r;
+}
+
 // writes the scriptPubKey for addr to script
 // returns the number of bytes written, or scriptLen needed if script is NULL
 size_t BRAddressScriptPubKey(uint8_t *script, size_t scriptLen, BRAddressParams params, const char *addr)
@@ -467,7 +498,7 @@ size_t BRAddressScriptPubKey(uint8_t *script, size_t scriptLen, BRAddressParams
     
     assert(addr != NULL);
     
-    if (BRBase58CheckDecode(data, sizeof(data), addr) == 21) {
+    if (BRBase58CheckDecodePublic(data, sizeof(data), addr) == 21) {
         if (data[0] == params.pubKeyPrefix) {
             if (script && 25 <= scriptLen) {
                 script[0] = OP_DUP;
@@ -514,7 +545,7 @@ int BRAddressHash160(void *md20, BRAddressParams params, const char *addr)
     assert(md20 != NULL);
     assert(addr != NULL);
     
-    if (BRBase58CheckDecode(&data[1], sizeof(data) - 1, addr) == 21) {
+    if (BRBase58CheckDecodePublic(&data[1], sizeof(data) - 1, addr) == 21) {
         r = (data[1] == params.pubKeyPrefix || data[1] == params.scriptPrefix);
     }
     else if (BRBech32Decode(hrp, data, addr) == 22) {
@@ -534,7 +565,7 @@ int BRAddressIsValid(BRAddressParams params, const char *addr)
     
     assert(addr != NULL);
     
-    if (BRBase58CheckDecode(data, sizeof(data), addr) == 21) {
+    if (BRBase58CheckDecodePublic(data, sizeof(data), addr) == 21) {
         r = (data[0] == params.pubKeyPrefix || data[0] == params.scriptPrefix);
     }
     else if (BRBech32Decode(hrp, data, addr) > 2) {
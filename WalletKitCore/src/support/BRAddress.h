@@ -139,6 +139,10 @@ size_t BRAddressFromWitness(char *addr, size_t addrLen, BRAddressParams params,
 // returns the number of bytes written, or addrLen needed if addr is NULL
 size_t BRAddressFromHash160(char *addr, size_t addrLen, BRAddressParams params, const void *md20);
 
+// writes the address for each of count consecutive 20 byte hash160s in md20s to addrs, as BRAddressFromHash160()
+// returns the number of addresses written
+size_t BRAddressesFromHash160s(BRAddress addrs[], BRAddressParams params, const void *md20s, size_t count);
+
 // writes the scriptPubKey for addr to script
 // returns the number of bytes written, or scriptLen needed if script is NULL
 size_t BRAddressScriptPubKey(uint8_t *script, size_t scriptLen, BRAddressParams params, const char *addr);
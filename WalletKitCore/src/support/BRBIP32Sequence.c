@@ -25,6 +25,7 @@
 #include "BRBIP32Sequence.h"
 #include "BRCrypto.h"
 #include "BRBase58.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -154,6 +155,48 @@ size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint
     return (! pubKey || sizeof(BRECPoint) <= pubKeyLen) ? sizeof(BRECPoint) : 0;
 }
 
+// returns the extended public key for path N(m/0H/chain)
+BRChainPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain)
+{
+    BRChainPubKey cpk = { chain, mpk.chainCode, *(BRECPoint *)mpk.pubKey };
+    
+    assert(memcmp(&mpk, &BR_MASTER_PUBKEY_NONE, sizeof(mpk)) != 0);
+    _CKDpub(&cpk.pubKey, &cpk.chainCode, chain); // path N(m/0H/chain)
+    return cpk;
+}
+
+// writes the public keys for paths N(m/0H/chain/index) through N(m/0H/chain/index + count - 1) to pubKeys
+// the whole range is derived as a batch, which is much faster than calling BRBIP32PubKey() for each index
+void BRBIP32ChainPubKeyList(BRECPoint pubKeys[], size_t count, BRChainPubKey cpk, uint32_t index)
+{
+    uint8_t buf[sizeof(BRECPoint) + sizeof(index)];
+    UInt256 *IL;
+    UInt512 I;
+    
+    assert(pubKeys != NULL || count == 0);
+    
+    if (pubKeys && count > 0) {
+        IL = calloc(count, sizeof(*IL));
+        assert(IL != NULL);
+        *(BRECPoint *)buf = cpk.pubKey;
+        
+        for (size_t j = 0; j < count; j++) {
+            // can't derive private child key from public parent key, so hardened indexes get a zero tweak and are
+            // left equal to the parent key, same as _CKDpub()
+            if (((index + j) & BIP32_HARD) == BIP32_HARD) continue;
+            UInt32SetBE(&buf[sizeof(BRECPoint)], (uint32_t)(index + j));
+            BRHMAC(&I, BRSHA512, sizeof(UInt512), &cpk.chainCode, sizeof(cpk.chainCode), buf, sizeof(buf));
+            IL[j] = *(UInt256 *)&I; // K = P(IL) + K, child chain codes aren't needed at the last step
+        }
+        
+        BRSecp256k1PointAddList(pubKeys, &cpk.pubKey, IL, count);
+        var_clean(&I);
+        var_clean(&cpk.chainCode);
+        mem_clean(IL, count*sizeof(*IL));
+        free(IL);
+    }
+}
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index)
 {
@@ -282,7 +325,7 @@ BRMasterPubKey BRBIP32ParseMasterPubKey(const char *str)
 {
     BRMasterPubKey mpk = BR_MASTER_PUBKEY_NONE;
     uint8_t data[4 + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(UInt256) + 33];
-    size_t dataLen = BRBase58CheckDecode(data, sizeof(data), str);
+    size_t dataLen = BRBase58CheckDecodePublic(data, sizeof(data), str);
     
     if (dataLen == sizeof(data) && memcmp(data, BIP32_XPUB, 4) == 0) {
         mpk.fingerPrint = ((union { uint8_t u8[4]; uint32_t u32; }){ data[5], data[6], data[7], data[8] }).u32;
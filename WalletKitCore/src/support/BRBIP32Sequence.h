@@ -82,6 +82,20 @@ BRMasterPubKey BRBIP32MasterPubKey(const void *seed, size_t seedLen);
 // returns number of bytes written, or pubKeyLen needed if pubKey is NULL
 size_t BRBIP32PubKey(uint8_t *pubKey, size_t pubKeyLen, BRMasterPubKey mpk, uint32_t chain, uint32_t index);
 
+// the extended public key for path N(m/0H/chain), to derive many keys in the same chain without repeating the first step
+typedef struct {
+    uint32_t chain;
+    UInt256 chainCode;
+    BRECPoint pubKey;
+} BRChainPubKey;
+
+// returns the extended public key for path N(m/0H/chain)
+BRChainPubKey BRBIP32ChainPubKey(BRMasterPubKey mpk, uint32_t chain);
+
+// writes the public keys for paths N(m/0H/chain/index) through N(m/0H/chain/index + count - 1) to pubKeys
+// the whole range is derived as a batch, which is much faster than calling BRBIP32PubKey() for each index
+void BRBIP32ChainPubKeyList(BRECPoint pubKeys[], size_t count, BRChainPubKey cpk, uint32_t index);
+
 // sets the private key for path m/0H/chain/index to key
 void BRBIP32PrivKey(BRKey *key, const void *seed, size_t seedLen, uint32_t chain, uint32_t index);
 
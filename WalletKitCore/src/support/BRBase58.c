@@ -31,127 +31,154 @@
 #include <string.h>
 #include <assert.h>
 
+
 // base58 and base58check encoding: https://en.bitcoin.it/wiki/Base58Check_encoding
 static const char * bitcoinAlphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+// value of each character in bitcoinAlphabet, -1 for characters that are not base58 digits
+static const int8_t bitcoinDigits[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8, -1, -1, -1, -1, -1, -1,
+    -1,  9, 10, 11, 12, 13, 14, 15, 16, -1, 17, 18, 19, 20, 21, -1,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, -1, -1, -1, -1, -1,
+    -1, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, -1, 44, 45, 46,
+    47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+// conversion is done in limbs of five base58 digits (58^5 < 2^32) and four bytes, so each step of the schoolbook
+// base conversion moves 32 bits at a time through 64bit intermediates rather than a single byte or digit
+#define BASE58_LIMB 656356768u // 58^5
+
+// writes the base58 encoding of data using the digits chars, and wipes intermediate values if clean is set
 // returns the number of characters written to str including NULL terminator, or total strLen needed if str is NULL
-size_t BRBase58EncodeEx(char *str, size_t strLen, const uint8_t *data, size_t dataLen, const char *alphabet)
+static size_t _BRBase58Encode(char *str, size_t strLen, const uint8_t *data, size_t dataLen, const char *chars,
+                              int clean)
 {
-    const char * chars = alphabet;
-    assert(strlen(alphabet) >= 58);
-
-    size_t i, j, len, zcount = 0;
+    size_t i, j, k, len, zcount = 0, count = 0;
+    uint64_t carry;
+    uint32_t n;
     
-    assert(data != NULL);
-    while (zcount < dataLen && data && data[zcount] == 0) zcount++; // count leading zeroes
-
-    uint8_t buf[(dataLen - zcount)*138/100 + 1]; // log(256)/log(58), rounded up
+    assert(data != NULL || dataLen == 0);
+    while (zcount < dataLen && data[zcount] == 0) zcount++; // count leading zeroes
     
-    memset(buf, 0, sizeof(buf));
+    uint32_t limbs[(dataLen - zcount)*138/500 + 2]; // base 58^5, least significant first, log(256)/log(58^5) rounded up
     
-    for (i = zcount; data && i < dataLen; i++) {
-        uint32_t carry = data[i];
+    for (i = zcount; i < dataLen; i += k) {
+        k = (dataLen - i < 4) ? dataLen - i : 4;
+        for (carry = 0, j = 0; j < k; j++) carry = (carry << 8) | data[i + j];
         
-        for (j = sizeof(buf); j > 0; j--) {
-            carry += (uint32_t)buf[j - 1] << 8;
-            buf[j - 1] = carry % 58;
-            carry /= 58;
+        for (j = 0; j < count; j++) {
+            carry += (uint64_t)limbs[j] << (k*8);
+            limbs[j] = (uint32_t)(carry % BASE58_LIMB);
+            carry /= BASE58_LIMB;
         }
         
-        var_clean(&carry);
+        while (carry > 0) limbs[count++] = (uint32_t)(carry % BASE58_LIMB), carry /= BASE58_LIMB;
     }
     
-    i = 0;
-    while (i < sizeof(buf) && buf[i] == 0) i++; // skip leading zeroes
-    len = (zcount + sizeof(buf) - i) + 1;
-
+    for (k = 0, n = (count > 0) ? limbs[count - 1] : 0; n > 0; n /= 58) k++; // digits in the most significant limb
+    len = zcount + ((count > 0) ? (count - 1)*5 + k : 0) + 1;
+    
     if (str && len <= strLen) {
-        while (zcount-- > 0) *(str++) = chars[0];
-        while (i < sizeof(buf)) *(str++) = chars[buf[i++]];
-        *str = '\0';
+        for (i = 0; i < zcount; i++) str[i] = chars[0];
+        
+        for (i = len - 1, j = 0; j < count; j++) {
+            for (n = limbs[j], k = 0; k < 5 && i > zcount; k++, n /= 58) str[--i] = chars[n % 58];
+        }
+        
+        str[len - 1] = '\0';
+    }
+    
+    if (clean) {
+        mem_clean(limbs, sizeof(limbs));
+        var_clean(&carry);
+        var_clean(&n);
     }
     
-    mem_clean(buf, sizeof(buf));
     return (! str || len <= strLen) ? len : 0;
 }
 
-size_t BRBase58Encode(char *str, size_t strLen, const uint8_t *data, size_t dataLen)
-{
-    return BRBase58EncodeEx(str, strLen, data, dataLen, bitcoinAlphabet);
-}
-
+// decodes the first strLen characters of str, which must all be digits in the given digit value table, and wipes
+// intermediate values if clean is set
 // returns the number of bytes written to data, or total dataLen needed if data is NULL
-size_t BRBase58Decode(uint8_t *data, size_t dataLen, const char *str)
+static size_t _BRBase58Decode(uint8_t *data, size_t dataLen, const char *str, size_t strLen, const int8_t *digits,
+                              int clean)
 {
-    size_t i = 0, j, len, zcount = 0;
-
-    assert(str != NULL);
-    while (str && *str == '1') str++, zcount++; // count leading zeroes
+    size_t i, j, k, len, zcount = 0, count = 0;
+    uint64_t carry, scale;
+    uint32_t n;
     
-    uint8_t buf[(str) ? strlen(str)*733/1000 + 1 : 0]; // log(58)/log(256), rounded up
+    while (zcount < strLen && digits[(uint8_t)str[zcount]] == 0) zcount++; // count leading zeroes
     
-    memset(buf, 0, sizeof(buf));
+    uint32_t limbs[(strLen - zcount)*733/4000 + 2]; // base 2^32, least significant first, log(58)/log(2^32) rounded up
     
-    while (str && *str) {
-        uint32_t carry = *(const uint8_t *)(str++);
+    for (i = zcount; i < strLen; i += k) {
+        k = (strLen - i < 5) ? strLen - i : 5;
+        for (carry = 0, scale = 1, j = 0; j < k; j++) carry = carry*58 + digits[(uint8_t)str[i + j]], scale *= 58;
         
-        switch (carry) {
-            case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-                carry -= '1';
-                break;
-                
-            case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
-                carry += 9 - 'A';
-                break;
-                
-            case 'J': case 'K': case 'L': case 'M': case 'N':
-                carry += 17 - 'J';
-                break;
-                
-            case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X': case 'Y':
-            case 'Z':
-                carry += 22 - 'P';
-                break;
-                
-            case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j':
-            case 'k':
-                carry += 33 - 'a';
-                break;
-                
-            case 'm': case 'n': case 'o': case 'p': case 'q': case 'r': case 's': case 't': case 'u': case 'v':
-            case 'w': case 'x': case 'y': case 'z':
-                carry += 44 - 'm';
-                break;
-                
-            default:
-                carry = UINT32_MAX;
+        for (j = 0; j < count; j++) {
+            carry += limbs[j]*scale;
+            limbs[j] = (uint32_t)carry;
+            carry >>= 32;
         }
         
-        if (carry >= 58) break; // invalid base58 digit
-        
-        for (j = sizeof(buf); j > 0; j--) {
-            carry += (uint32_t)buf[j - 1]*58;
-            buf[j - 1] = carry & 0xff;
-            carry >>= 8;
-        }
-        
-        var_clean(&carry);
+        while (carry > 0) limbs[count++] = (uint32_t)carry, carry >>= 32;
     }
     
-    while (i < sizeof(buf) && buf[i] == 0) i++; // skip leading zeroes
-    len = zcount + sizeof(buf) - i;
-
+    for (k = 0, n = (count > 0) ? limbs[count - 1] : 0; n > 0; n >>= 8) k++; // bytes in the most significant limb
+    len = zcount + ((count > 0) ? (count - 1)*4 + k : 0);
+    
     if (data && len <= dataLen) {
         if (zcount > 0) memset(data, 0, zcount);
-        memcpy(&data[zcount], &buf[i], sizeof(buf) - i);
+        
+        for (i = len, j = 0; j < count; j++) {
+            for (n = limbs[j], k = 0; k < 4 && i > zcount; k++, n >>= 8) data[--i] = (uint8_t)n;
+        }
     }
-
-    mem_clean(buf, sizeof(buf));
+    
+    if (clean) {
+        mem_clean(limbs, sizeof(limbs));
+        var_clean(&carry);
+        var_clean(&n);
+    }
+    
     return (! data || len <= dataLen) ? len : 0;
 }
 
 // returns the number of characters written to str including NULL terminator, or total strLen needed if str is NULL
-size_t BRBase58CheckEncode(char *str, size_t strLen, const uint8_t *data, size_t dataLen)
+size_t BRBase58EncodeEx(char *str, size_t strLen, const uint8_t *data, size_t dataLen, const char *alphabet)
+{
+    assert(strlen(alphabet) >= 58);
+    assert(data != NULL);
+    return _BRBase58Encode(str, strLen, data, dataLen, alphabet, 1);
+}
+
+size_t BRBase58Encode(char *str, size_t strLen, const uint8_t *data, size_t dataLen)
+{
+    return BRBase58EncodeEx(str, strLen, data, dataLen, bitcoinAlphabet);
+}
+
+// returns the number of bytes written to data, or total dataLen needed if data is NULL
+size_t BRBase58Decode(uint8_t *data, size_t dataLen, const char *str)
+{
+    size_t strLen = 0;
+    
+    assert(str != NULL);
+    while (str && bitcoinDigits[(uint8_t)str[strLen]] >= 0) strLen++; // decoding stops at the first invalid digit
+    return (str) ? _BRBase58Decode(data, dataLen, str, strLen, bitcoinDigits, 1) : 0;
+}
+
+static size_t _BRBase58CheckEncode(char *str, size_t strLen, const uint8_t *data, size_t dataLen, int clean)
 {
     size_t len = 0, bufLen = dataLen + 256/8;
     uint8_t _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
@@ -160,25 +187,62 @@ size_t BRBase58CheckEncode(char *str, size_t strLen, const uint8_t *data, size_t
     assert(data != NULL || dataLen == 0);
 
     if (data || dataLen == 0) {
-        memcpy(buf, data, dataLen);
+        if (dataLen > 0) memcpy(buf, data, dataLen);
         BRSHA256_2(&buf[dataLen], data, dataLen);
-        len = BRBase58Encode(str, strLen, buf, dataLen + 4);
+        len = _BRBase58Encode(str, strLen, buf, dataLen + 4, bitcoinAlphabet, clean);
     }
     
-    mem_clean(buf, bufLen);
+    if (clean) mem_clean(buf, bufLen);
     if (buf != _buf) free(buf);
     return len;
 }
 
-// returns the number of bytes written to data, or total dataLen needed if data is NULL
-size_t BRBase58CheckDecode(uint8_t *data, size_t dataLen, const char *str)
+// returns the number of characters written to str including NULL terminator, or total strLen needed if str is NULL
+size_t BRBase58CheckEncode(char *str, size_t strLen, const uint8_t *data, size_t dataLen)
+{
+    return _BRBase58CheckEncode(str, strLen, data, dataLen, 1);
+}
+
+// returns the number of characters written to str including NULL terminator, or total strLen needed if str is NULL
+size_t BRBase58CheckEncodePublic(char *str, size_t strLen, const uint8_t *data, size_t dataLen)
+{
+    return _BRBase58CheckEncode(str, strLen, data, dataLen, 0);
+}
+
+// returns the number of strings written
+size_t BRBase58CheckEncodeBatch(char *strs, size_t strStride, const uint8_t *data, size_t dataLen, size_t stride,
+                                size_t count)
+{
+    size_t i, bufLen = dataLen + 4;
+    uint8_t _buf[0x1000], *buf = (bufLen*count <= 0x1000) ? _buf : malloc(bufLen*count);
+    uint8_t _md[0x400], *md = (32*count <= 0x400) ? _md : malloc(32*count);
+    
+    assert(strs != NULL || count == 0);
+    assert(data != NULL || dataLen == 0 || count == 0);
+    assert(buf != NULL && md != NULL);
+    
+    BRSHA256_2Batch(md, data, dataLen, stride, count); // checksum all messages at once
+    
+    for (i = 0; i < count; i++) {
+        if (dataLen > 0) memcpy(&buf[i*bufLen], &data[i*stride], dataLen);
+        memcpy(&buf[i*bufLen + dataLen], &md[i*32], 4);
+        if (_BRBase58Encode(&strs[i*strStride], strStride, &buf[i*bufLen], bufLen, bitcoinAlphabet, 0) == 0) break;
+    }
+    
+    if (buf != _buf) free(buf);
+    if (md != _md) free(md);
+    return i;
+}
+
+static size_t _BRBase58CheckDecode(uint8_t *data, size_t dataLen, const char *str, int clean)
 {
-    size_t len, bufLen = (str) ? strlen(str) : 0;
+    size_t len = 0, bufLen = (str) ? strlen(str) : 0;
     uint8_t md[256/8], _buf[0x1000], *buf = (bufLen <= 0x1000) ? _buf : malloc(bufLen);
 
     assert(str != NULL);
     assert(buf != NULL);
-    len = BRBase58Decode(buf, bufLen, str);
+    while (len < bufLen && bitcoinDigits[(uint8_t)str[len]] >= 0) len++; // as BRBase58Decode(), up to an invalid digit
+    len = (str) ? _BRBase58Decode(buf, bufLen, str, len, bitcoinDigits, clean) : 0;
     
     if (len >= 4) {
         len -= 4;
@@ -188,57 +252,37 @@ size_t BRBase58CheckDecode(uint8_t *data, size_t dataLen, const char *str)
     }
     else len = 0;
     
-    mem_clean(buf, bufLen);
+    if (clean) mem_clean(buf, bufLen);
     if (buf != _buf) free(buf);
     return (! data || len <= dataLen) ? len : 0;
 }
 
-size_t BRBase58DecodeEx(uint8_t* data, size_t dataLen, const char *str, const char* alphabet)
+// returns the number of bytes written to data, or total dataLen needed if data is NULL
+size_t BRBase58CheckDecode(uint8_t *data, size_t dataLen, const char *str)
 {
-    int reverseLookup[256];
-    memset(&reverseLookup[0], -1, sizeof(reverseLookup));
-    int map_num = 0;
-    for (int i = 0; i < strlen(alphabet); i++) {
-        reverseLookup[(int) alphabet[i]] = map_num++;
-    }
-
-    // Skip and count leading zeroes
-    size_t zcount = 0;
-    while (str && reverseLookup[(int) *str] == 0) str++, zcount++;
-
-    // Create buffer large enough to hold the decode bytes
-    int bufSize = (str) ? (int)(strlen(str)*733/1000 + 1) : 0;
-    uint8_t buf[bufSize];
-    memset(buf, 0, sizeof(buf));
-
-    // Do the decoding
-    while (str && *str)
-    {
-        int carry = reverseLookup[(int) *str];
-        if (carry == -1) return 0;
-
-        for (int i = bufSize - 1; i >= 0; i--)
-        {
-            carry += 58 * buf[i];
-            buf[i] = carry % 256;
-            carry /= 256;
-        }
-        str++;
-    }
-
-    // Skip leading zeros in buf
-    size_t i = 0;
-    while(buf[i] == 0) { i++; }
-
-    // Calculate the length
-    size_t len = zcount + sizeof(buf) - i;
+    return _BRBase58CheckDecode(data, dataLen, str, 1);
+}
 
-    // If the caller has passed in buffer large enough then copy to it
-    if (data && len <= dataLen) {
-        if (zcount > 0) memset(data, 0, zcount);
-        memcpy(&data[zcount], &buf[i], sizeof(buf) - i);
-    }
+// returns the number of bytes written to data, or total dataLen needed if data is NULL
+size_t BRBase58CheckDecodePublic(uint8_t *data, size_t dataLen, const char *str)
+{
+    return _BRBase58CheckDecode(data, dataLen, str, 0);
+}
 
-    // ONLY return 0 if the user passed in a buffer but it was not large enough
-    return (! data || len <= dataLen) ? len : 0;
+size_t BRBase58DecodeEx(uint8_t* data, size_t dataLen, const char *str, const char* alphabet)
+{
+    int8_t digits[256];
+    size_t strLen = 0;
+    
+    // Map each alphabet character to its digit value
+    memset(digits, -1, sizeof(digits));
+    for (int i = 0; i < 58 && alphabet[i]; i++) digits[(uint8_t)alphabet[i]] = (int8_t)i;
+    
+    if (NULL == str) return 0;
+    
+    // Unlike BRBase58Decode(), any invalid character fails the decoding entirely
+    for (strLen = 0; str[strLen]; strLen++)
+        if (digits[(uint8_t)str[strLen]] < 0) return 0;
+    
+    return _BRBase58Decode(data, dataLen, str, strLen, digits, 0);
 }
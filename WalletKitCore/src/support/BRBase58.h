@@ -51,6 +51,17 @@ size_t BRBase58CheckEncode(char *str, size_t strLen, const uint8_t *data, size_t
 // returns the number of bytes written to data, or total dataLen needed if data is NULL
 size_t BRBase58CheckDecode(uint8_t *data, size_t dataLen, const char *str);
 
+// BRBase58CheckEncode() and BRBase58CheckDecode() wipe their intermediate buffers, as the data may be a private key;
+// these variants skip the wiping and are only for public data, such as addresses and extended public keys
+size_t BRBase58CheckEncodePublic(char *str, size_t strLen, const uint8_t *data, size_t dataLen);
+size_t BRBase58CheckDecodePublic(uint8_t *data, size_t dataLen, const char *str);
+
+// base58check encodes count messages of public data, each dataLen bytes long and spaced stride bytes apart in data,
+// writing each NULL terminated string to strs at strStride byte intervals, and checksumming all messages at once
+// returns the number of strings written, stopping at the first that does not fit in strStride
+size_t BRBase58CheckEncodeBatch(char *strs, size_t strStride, const uint8_t *data, size_t dataLen, size_t stride,
+                                size_t count);
+
 // Extended versions of base58 encode/decode that allow caller to control
 // the alphabet being used.  This is needed for Ripple (and perhaps others)
 
@@ -26,6 +26,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+
+// x86-64 sha-ni, avx2 and aes-ni kernels are compiled with per-function target attributes and selected at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BR_CRYPTO_X86 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
 
 // endian swapping
 #if __BIG_ENDIAN__ || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
@@ -110,19 +118,19 @@ void BRSHA1(void *md20, const void *data, size_t dataLen)
 #define s2(x) (ror32((x), 7) ^ ror32((x), 18) ^ ((x) >> 3))
 #define s3(x) (ror32((x), 17) ^ ror32((x), 19) ^ ((x) >> 10))
 
+static const uint32_t _sha256K[] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
 static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
 {
-    static const uint32_t k[] = {
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-    };
-    
     int i;
     uint32_t a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7], t1, t2, w[64];
     
@@ -130,7 +138,7 @@ static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
     for (; i < 64; i++) w[i] = s3(w[i - 2]) + w[i - 7] + s2(w[i - 15]) + w[i - 16];
     
     for (i = 0; i < 64; i++) {
-        t1 = h + s1(e) + ch(e, f, g) + k[i] + w[i];
+        t1 = h + s1(e) + ch(e, f, g) + _sha256K[i] + w[i];
         t2 = s0(a) + maj(a, b, c);
         h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
     }
@@ -140,54 +148,221 @@ static void _BRSHA256Compress(uint32_t *r, const uint32_t *x)
     mem_clean(w, sizeof(w));
 }
 
+static void _BRSHA256CompressScalar(uint32_t *r, const void *data, size_t blockCount)
+{
+    uint32_t x[16];
+    
+    for (size_t i = 0; i < blockCount; i++) {
+        memcpy(x, (const uint8_t *)data + i*64, 64);
+        _BRSHA256Compress(r, x);
+    }
+    
+    mem_clean(x, sizeof(x));
+}
+
+#if BR_CRYPTO_X86
+
+// sha-ni rounds, four at a time: https://www.intel.com/content/www/us/en/developer/articles/technical/intel-sha-extensions.html
+#define sha256ni4(m, i) (t = _mm_add_epi32((m), _mm_loadu_si128((const __m128i *)&_sha256K[(i)*4])),\
+                         s1 = _mm_sha256rnds2_epu32(s1, s0, t), t = _mm_shuffle_epi32(t, 0x0e),\
+                         s0 = _mm_sha256rnds2_epu32(s0, s1, t))
+
+// sha-ni message schedule, m0 = w[i - 16..i - 13] becomes w[i..i + 3]
+#define sha256niw(m0, m1, m2, m3) ((m0) = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32((m0), (m1)),\
+                                                                             _mm_alignr_epi8((m3), (m2), 4)), (m3)))
+
+__attribute__((target("sha,sse4.1")))
+static void _BRSHA256CompressSHANI(uint32_t *r, const void *data, size_t blockCount)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL); // big endian words
+    const uint8_t *x = data;
+    __m128i s0, s1, t, abef, cdgh, m0, m1, m2, m3;
+    
+    t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[0]), 0xb1); // cdab
+    s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&r[4]), 0x1b); // efgh
+    s0 = _mm_alignr_epi8(t, s1, 8); // abef
+    s1 = _mm_blend_epi16(s1, t, 0xf0); // cdgh
+    
+    for (size_t i = 0; i < blockCount; i++, x += 64) {
+        abef = s0, cdgh = s1;
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&x[0]), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&x[16]), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&x[32]), mask);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&x[48]), mask);
+        sha256ni4(m0, 0), sha256ni4(m1, 1), sha256ni4(m2, 2), sha256ni4(m3, 3);
+        
+        for (int j = 4; j < 16; j += 4) {
+            sha256niw(m0, m1, m2, m3), sha256ni4(m0, j);
+            sha256niw(m1, m2, m3, m0), sha256ni4(m1, j + 1);
+            sha256niw(m2, m3, m0, m1), sha256ni4(m2, j + 2);
+            sha256niw(m3, m0, m1, m2), sha256ni4(m3, j + 3);
+        }
+        
+        s0 = _mm_add_epi32(s0, abef), s1 = _mm_add_epi32(s1, cdgh);
+    }
+    
+    t = _mm_shuffle_epi32(s0, 0x1b); // feba
+    s1 = _mm_shuffle_epi32(s1, 0xb1); // dchg
+    _mm_storeu_si128((__m128i *)&r[0], _mm_blend_epi16(t, s1, 0xf0)); // dcba
+    _mm_storeu_si128((__m128i *)&r[4], _mm_alignr_epi8(s1, t, 8)); // hgfe
+}
+
+// avx2 versions of the basic sha256 functions, operating on the same word of eight independent messages
+#define ror32x8(a, b) _mm256_or_si256(_mm256_srli_epi32((a), (b)), _mm256_slli_epi32((a), 32 - (b)))
+#define xor32x8(a, b, c) _mm256_xor_si256(_mm256_xor_si256((a), (b)), (c))
+#define add32x8(a, b) _mm256_add_epi32((a), (b))
+#define chx8(x, y, z) _mm256_xor_si256(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define majx8(x, y, z) _mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256((z), _mm256_or_si256((x), (y))))
+#define s0x8(x) xor32x8(ror32x8((x), 2), ror32x8((x), 13), ror32x8((x), 22))
+#define s1x8(x) xor32x8(ror32x8((x), 6), ror32x8((x), 11), ror32x8((x), 25))
+#define s2x8(x) xor32x8(ror32x8((x), 7), ror32x8((x), 18), _mm256_srli_epi32((x), 3))
+#define s3x8(x) xor32x8(ror32x8((x), 17), ror32x8((x), 19), _mm256_srli_epi32((x), 10))
+
+// loads big endian word i of the 64 byte block at x from each of eight messages spaced stride bytes apart
+#define be32x8(x, stride, i) _mm256_setr_epi32((int)_be32get((x) + (i)*4), (int)_be32get((x) + (stride) + (i)*4),\
+    (int)_be32get((x) + 2*(stride) + (i)*4), (int)_be32get((x) + 3*(stride) + (i)*4),\
+    (int)_be32get((x) + 4*(stride) + (i)*4), (int)_be32get((x) + 5*(stride) + (i)*4),\
+    (int)_be32get((x) + 6*(stride) + (i)*4), (int)_be32get((x) + 7*(stride) + (i)*4))
+
+static inline uint32_t _be32get(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// w[0..15] must contain the message words, and is expanded in place to the full 64 word schedule
+__attribute__((target("avx2")))
+static void _BRSHA256CompressAVX2(__m256i *r, __m256i *w)
+{
+    __m256i a = r[0], b = r[1], c = r[2], d = r[3], e = r[4], f = r[5], g = r[6], h = r[7], t1, t2;
+    int i;
+    
+    for (i = 16; i < 64; i++) w[i] = add32x8(add32x8(s3x8(w[i - 2]), w[i - 7]), add32x8(s2x8(w[i - 15]), w[i - 16]));
+    
+    for (i = 0; i < 64; i++) {
+        t1 = add32x8(add32x8(add32x8(h, s1x8(e)), add32x8(chx8(e, f, g), _mm256_set1_epi32((int)_sha256K[i]))), w[i]);
+        t2 = add32x8(s0x8(a), majx8(a, b, c));
+        h = g, g = f, f = e, e = add32x8(d, t1), d = c, c = b, b = a, a = add32x8(t1, t2);
+    }
+    
+    r[0] = add32x8(r[0], a), r[1] = add32x8(r[1], b), r[2] = add32x8(r[2], c), r[3] = add32x8(r[3], d);
+    r[4] = add32x8(r[4], e), r[5] = add32x8(r[5], f), r[6] = add32x8(r[6], g), r[7] = add32x8(r[7], h);
+}
+
+// double-sha-256 of eight dataLen byte messages spaced stride bytes apart, one message per 32bit avx2 lane
+__attribute__((target("avx2")))
+static void _BRSHA256_2AVX2(uint8_t *md32s, const uint8_t *data, size_t dataLen, size_t stride)
+{
+    static const uint32_t iv[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                   0x1f83d9ab, 0x5be0cd19 };
+    const size_t n = dataLen/64, rem = dataLen % 64, tailLen = (rem < 56) ? 64 : 128;
+    uint8_t tail[8*128];
+    uint32_t buf[8][8];
+    __m256i r[8], w[64];
+    size_t i, j;
+    
+    for (j = 0; j < 8; j++) r[j] = _mm256_set1_epi32((int)iv[j]);
+    
+    for (i = 0; i < n; i++) { // process data in 64 byte blocks
+        for (j = 0; j < 16; j++) w[j] = be32x8(data + i*64, stride, j);
+        _BRSHA256CompressAVX2(r, w);
+    }
+    
+    for (i = 0; i < 8; i++) { // pad each message, with the length going to the next block if needed
+        memset(&tail[i*tailLen], 0, tailLen);
+        if (rem > 0) memcpy(&tail[i*tailLen], data + i*stride + n*64, rem);
+        tail[i*tailLen + rem] = 0x80;
+        for (j = 0; j < 8; j++) tail[i*tailLen + tailLen - 1 - j] = (uint8_t)(((uint64_t)dataLen << 3) >> j*8);
+    }
+    
+    for (i = 0; i < tailLen; i += 64) {
+        for (j = 0; j < 16; j++) w[j] = be32x8(&tail[i], tailLen, j);
+        _BRSHA256CompressAVX2(r, w);
+    }
+    
+    for (j = 0; j < 8; j++) w[j] = r[j], r[j] = _mm256_set1_epi32((int)iv[j]); // hash the 32 byte first round digests
+    w[8] = _mm256_set1_epi32((int)0x80000000);
+    for (j = 9; j < 15; j++) w[j] = _mm256_setzero_si256();
+    w[15] = _mm256_set1_epi32(256);
+    _BRSHA256CompressAVX2(r, w);
+    
+    for (j = 0; j < 8; j++) _mm256_storeu_si256((__m256i *)buf[j], r[j]);
+    
+    for (i = 0; i < 8; i++) { // write to md, transposing lanes back to messages
+        for (j = 0; j < 8; j++) {
+            md32s[i*32 + j*4] = (uint8_t)(buf[j][i] >> 24), md32s[i*32 + j*4 + 1] = (uint8_t)(buf[j][i] >> 16);
+            md32s[i*32 + j*4 + 2] = (uint8_t)(buf[j][i] >> 8), md32s[i*32 + j*4 + 3] = (uint8_t)buf[j][i];
+        }
+    }
+    
+    mem_clean(tail, sizeof(tail));
+    mem_clean(w, sizeof(w));
+    mem_clean(buf, sizeof(buf));
+}
+
+#endif // BR_CRYPTO_X86
+
+static void (*_BRSHA256CompressBlocks)(uint32_t *r, const void *data, size_t blockCount) = _BRSHA256CompressScalar;
+static int _avx2 = 0, _aesni = 0;
+static pthread_once_t _cpu_once = PTHREAD_ONCE_INIT;
+
+// selects the fastest sha-256, keccak-256 and aes kernels the cpu and os support
+static void _BRCPUInit(void)
+{
+#if BR_CRYPTO_X86
+    unsigned a = 0, b = 0, c = 0, d = 0, c1 = 0, b7 = 0, xcr0 = 0;
+    
+    if (__get_cpuid(1, &a, &b, &c, &d)) c1 = c;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) b7 = b;
+    if (c1 & (1u << 27)) __asm__ ("xgetbv" : "=a" (xcr0), "=d" (d) : "c" (0)); // osxsave, check for ymm state
+    if ((b7 & (1u << 29)) && (c1 & (1u << 19))) _BRSHA256CompressBlocks = _BRSHA256CompressSHANI; // sha, sse4.1
+    _avx2 = ((b7 & (1u << 5)) && (c1 & (1u << 28)) && (xcr0 & 0x06) == 0x06); // avx2, avx, xmm/ymm state
+    _aesni = ((c1 & (1u << 25)) != 0);
+#endif
+}
+
+// sha-256 compression of the padded message into buf, which must contain the initial buffer values
+static void _BRSHA256Hash(uint32_t *buf, const void *data, size_t dataLen)
+{
+    size_t i = dataLen - dataLen % 64;
+    uint32_t x[32];
+    
+    pthread_once(&_cpu_once, _BRCPUInit);
+    _BRSHA256CompressBlocks(buf, data, dataLen/64); // process data in 64 byte blocks
+    memset(x, 0, sizeof(x));
+    if (dataLen > i) memcpy(x, (const uint8_t *)data + i, dataLen - i);
+    ((uint8_t *)x)[dataLen - i] = 0x80; // append padding
+    i = (dataLen - i >= 56) ? 16 : 0; // length goes to next block
+    x[i + 14] = be32((uint32_t)(dataLen >> 29)), x[i + 15] = be32((uint32_t)(dataLen << 3)); // append length in bits
+    _BRSHA256CompressBlocks(buf, x, i/16 + 1); // finalize
+    mem_clean(x, sizeof(x));
+}
+
 void BRSHA224(void *md28, const void *data, size_t dataLen) {
     size_t i;
-    uint32_t x[16], buf[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
-                              0x64f98fa7, 0xbefa4fa4 }; // initial buffer values
+    uint32_t buf[] = { 0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511,
+                       0x64f98fa7, 0xbefa4fa4 }; // initial buffer values
 
     assert(md28 != NULL);
     assert(data != NULL || dataLen == 0);
 
-    for (i = 0; i < dataLen; i += 64) { // process data in 64 byte blocks
-        memcpy(x, (const uint8_t *)data + i, (i + 64 < dataLen) ? 64 : dataLen - i);
-        if (i + 64 > dataLen) break;
-        _BRSHA256Compress(buf, x);
-    }
-
-    memset((uint8_t *)x + (dataLen - i), 0, 64 - (dataLen - i)); // clear remainder of x
-    ((uint8_t *)x)[dataLen - i] = 0x80; // append padding
-    if (dataLen - i >= 56) _BRSHA256Compress(buf, x), memset(x, 0, 64); // length goes to next block
-    x[14] = be32((uint32_t)(dataLen >> 29)), x[15] = be32((uint32_t)(dataLen << 3)); // append length in bits
-    _BRSHA256Compress(buf, x); // finalize
+    _BRSHA256Hash(buf, data, dataLen);
     for (i = 0; i < 7; i++) buf[i] = be32(buf[i]); // endian swap
     memcpy(md28, buf, 28); // write to md
-    mem_clean(x, sizeof(x));
     mem_clean(buf, sizeof(buf));
 }
 
 void BRSHA256(void *md32, const void *data, size_t dataLen)
 {
     size_t i;
-    uint32_t x[16], buf[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
-                              0x1f83d9ab, 0x5be0cd19 }; // initial buffer values
+    uint32_t buf[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c,
+                       0x1f83d9ab, 0x5be0cd19 }; // initial buffer values
     
     assert(md32 != NULL);
     assert(data != NULL || dataLen == 0);
 
-    for (i = 0; i < dataLen; i += 64) { // process data in 64 byte blocks
-        memcpy(x, (const uint8_t *)data + i, (i + 64 < dataLen) ? 64 : dataLen - i);
-        if (i + 64 > dataLen) break;
-        _BRSHA256Compress(buf, x);
-    }
-    
-    memset((uint8_t *)x + (dataLen - i), 0, 64 - (dataLen - i)); // clear remainder of x
-    ((uint8_t *)x)[dataLen - i] = 0x80; // append padding
-    if (dataLen - i >= 56) _BRSHA256Compress(buf, x), memset(x, 0, 64); // length goes to next block
-    x[14] = be32((uint32_t)(dataLen >> 29)), x[15] = be32((uint32_t)(dataLen << 3)); // append length in bits
-    _BRSHA256Compress(buf, x); // finalize
+    _BRSHA256Hash(buf, data, dataLen);
     for (i = 0; i < 8; i++) buf[i] = be32(buf[i]); // endian swap
     memcpy(md32, buf, 32); // write to md
-    mem_clean(x, sizeof(x));
     mem_clean(buf, sizeof(buf));
 }
 
@@ -202,6 +377,28 @@ void BRSHA256_2(void *md32, const void *data, size_t dataLen)
     BRSHA256(md32, t, sizeof(t));
 }
 
+// double-sha-256 of count messages of dataLen bytes each, spaced stride bytes apart in data
+void BRSHA256_2Batch(void *md32s, const void *data, size_t dataLen, size_t stride, size_t count)
+{
+    size_t i = 0;
+    
+    assert(md32s != NULL || count == 0);
+    assert(data != NULL || dataLen == 0 || count == 0);
+    assert(stride >= dataLen || count <= 1);
+    pthread_once(&_cpu_once, _BRCPUInit);
+
+#if BR_CRYPTO_X86
+    // a single sha-ni stream outpaces eight avx2 lanes, so the multi-buffer kernel is only used without sha-ni
+    if (_avx2 && _BRSHA256CompressBlocks == _BRSHA256CompressScalar) {
+        for (; i + 8 <= count; i += 8) {
+            _BRSHA256_2AVX2((uint8_t *)md32s + i*32, (const uint8_t *)data + i*stride, dataLen, stride);
+        }
+    }
+#endif
+
+    for (; i < count; i++) BRSHA256_2((uint8_t *)md32s + i*32, (const uint8_t *)data + i*stride, dataLen);
+}
+
 // bitwise right rotation
 #define ror64(a, b) (((a) >> (b)) | ((a) << (64 - (b))))
 
@@ -399,16 +596,16 @@ void BRHash160(void *md20, const void *data, size_t datalen)
 // bitwise left rotation
 #define rol64(a, b) ((a) << (b) ^ ((a) >> (64 - (b))))
 
+static const uint64_t _keccakK[] = { // keccak round constants
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000, 0x000000000000808b,
+    0x0000000080000001, 0x8000000080008081, 0x8000000000008009, 0x000000000000008a, 0x0000000000000088,
+    0x0000000080008009, 0x000000008000000a, 0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+    0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+
 static void _BRSHA3Compress(uint64_t *r, const uint64_t *x, size_t blockSize)
 {
-    static const uint64_t k[] = { // keccak round constants
-        0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000, 0x000000000000808b,
-        0x0000000080000001, 0x8000000080008081, 0x8000000000008009, 0x000000000000008a, 0x0000000000000088,
-        0x0000000080008009, 0x000000008000000a, 0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
-        0x8000000000008003, 0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
-        0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
-    };
-    
     size_t i, j;
     uint64_t a[5], b[5], r0, r1;
     
@@ -440,7 +637,7 @@ static void _BRSHA3Compress(uint64_t *r, const uint64_t *x, size_t blockSize)
             r[2 + j] ^= ~r[3 + j] & r[4 + j], r[3 + j] ^= ~r[4 + j] & r0, r[4 + j] ^= ~r0 & r1;
         }
         
-        *r ^= k[i]; // iota(r, i)
+        *r ^= _keccakK[i]; // iota(r, i)
     }
     
     mem_clean(a, sizeof(a));
@@ -448,6 +645,106 @@ static void _BRSHA3Compress(uint64_t *r, const uint64_t *x, size_t blockSize)
     var_clean(&r0, &r1);
 }
 
+#if BR_CRYPTO_X86
+
+#define rol64x4(a, b) _mm256_or_si256(_mm256_slli_epi64((a), (b)), _mm256_srli_epi64((a), 64 - (b)))
+
+// keccak-f[1600] on four independent states, one per 64bit lane, following the steps of _BRSHA3Compress()
+__attribute__((target("avx2")))
+static void _BRKeccakPermuteAVX2(__m256i *r)
+{
+    size_t i, j;
+    __m256i a[5], b[5], r0, r1;
+    
+    for (i = 0; i < 24; i++) {
+        // theta(r)
+        for (j = 0; j < 5; j++) {
+            a[j] = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(r[j], r[j + 5]), _mm256_xor_si256(r[j + 10],
+                                    r[j + 15])), r[j + 20]);
+        }
+        
+        for (j = 0; j < 5; j++) b[j] = _mm256_xor_si256(rol64x4(a[(j + 1) % 5], 1), a[(j + 4) % 5]);
+        
+        for (j = 0; j < 25; j++) r[j] = _mm256_xor_si256(r[j], b[j % 5]);
+        
+        // rho(r)
+        r[1] = rol64x4(r[1], 1), r[2] = rol64x4(r[2], 62), r[3] = rol64x4(r[3], 28), r[4] = rol64x4(r[4], 27);
+        r[5] = rol64x4(r[5], 36), r[6] = rol64x4(r[6], 44), r[7] = rol64x4(r[7], 6), r[8] = rol64x4(r[8], 55);
+        r[9] = rol64x4(r[9], 20), r[10] = rol64x4(r[10], 3), r[11] = rol64x4(r[11], 10);
+        r[12] = rol64x4(r[12], 43), r[13] = rol64x4(r[13], 25), r[14] = rol64x4(r[14], 39);
+        r[15] = rol64x4(r[15], 41), r[16] = rol64x4(r[16], 45), r[17] = rol64x4(r[17], 15);
+        r[18] = rol64x4(r[18], 21), r[19] = rol64x4(r[19], 8), r[20] = rol64x4(r[20], 18);
+        r[21] = rol64x4(r[21], 2), r[22] = rol64x4(r[22], 61), r[23] = rol64x4(r[23], 56);
+        r[24] = rol64x4(r[24], 14);
+        
+        // pi(r)
+        r1 = r[1], r[1] = r[6], r[6] = r[9], r[9] = r[22], r[22] = r[14], r[14] = r[20], r[20] = r[2], r[2] = r[12],
+        r[12] = r[13], r[13] = r[19], r[19] = r[23], r[23] = r[15], r[15] = r[4], r[4] = r[24], r[24] = r[21];
+        r[21] = r[8], r[8] = r[16], r[16] = r[5], r[5] = r[3], r[3] = r[18], r[18] = r[17], r[17] = r[11], r[11] = r[7];
+        r[7] = r[10], r[10] = r1; // r[0] left as is
+        
+        for (j = 0; j < 25; j += 5) { // chi(r)
+            r0 = r[0 + j], r1 = r[1 + j];
+            r[0 + j] = _mm256_xor_si256(r[0 + j], _mm256_andnot_si256(r1, r[2 + j]));
+            r[1 + j] = _mm256_xor_si256(r[1 + j], _mm256_andnot_si256(r[2 + j], r[3 + j]));
+            r[2 + j] = _mm256_xor_si256(r[2 + j], _mm256_andnot_si256(r[3 + j], r[4 + j]));
+            r[3 + j] = _mm256_xor_si256(r[3 + j], _mm256_andnot_si256(r[4 + j], r0));
+            r[4 + j] = _mm256_xor_si256(r[4 + j], _mm256_andnot_si256(r0, r1));
+        }
+        
+        r[0] = _mm256_xor_si256(r[0], _mm256_set1_epi64x((long long)_keccakK[i])); // iota(r, i)
+    }
+}
+
+// keccak-256 of four independent messages, one per lane: each lane absorbs its own blocks and its digest is taken after
+// its final padded block, while lanes that have already finished absorb zeros
+__attribute__((target("avx2")))
+static void _BRKeccak256AVX2(uint8_t *md32s, const void *const datas[], const size_t dataLens[])
+{
+    size_t i, j, n, blocks = 0;
+    uint64_t x[4][17], md[4];
+    __m256i r[25];
+    
+    for (j = 0; j < 4; j++) if (dataLens[j]/136 + 1 > blocks) blocks = dataLens[j]/136 + 1;
+    for (i = 0; i < 25; i++) r[i] = _mm256_setzero_si256();
+    
+    for (n = 0; n < blocks; n++) {
+        for (j = 0; j < 4; j++) {
+            if (n*136 + 136 <= dataLens[j]) memcpy(x[j], (const uint8_t *)datas[j] + n*136, 136);
+            else if (n == dataLens[j]/136) { // final block with keccak padding
+                memset(x[j], 0, sizeof(x[j]));
+                memcpy(x[j], (const uint8_t *)datas[j] + n*136, dataLens[j] - n*136);
+                ((uint8_t *)x[j])[dataLens[j] - n*136] |= 0x01;
+                ((uint8_t *)x[j])[135] |= 0x80;
+            }
+            else memset(x[j], 0, sizeof(x[j]));
+        }
+        
+        for (i = 0; i < 17; i++) {
+            r[i] = _mm256_xor_si256(r[i], _mm256_set_epi64x((long long)le64(x[3][i]), (long long)le64(x[2][i]),
+                                                            (long long)le64(x[1][i]), (long long)le64(x[0][i])));
+        }
+        
+        _BRKeccakPermuteAVX2(r);
+        
+        for (j = 0; j < 4; j++) {
+            if (n != dataLens[j]/136) continue;
+            
+            for (i = 0; i < 4; i++) {
+                _mm256_storeu_si256((__m256i *)md, r[i]);
+                md[j] = le64(md[j]);
+                memcpy(md32s + j*32 + i*8, &md[j], 8);
+            }
+        }
+    }
+    
+    mem_clean(x, sizeof(x));
+    mem_clean(md, sizeof(md));
+    mem_clean(r, sizeof(r));
+}
+
+#endif // BR_CRYPTO_X86
+
 // sha3-256: http://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.202.pdf
 void BRSHA3_256(void *md32, const void *data, size_t dataLen)
 {
@@ -498,6 +795,48 @@ void BRKeccak256(void *md32, const void *data, size_t dataLen)
     mem_clean(buf, sizeof(buf));
 }
 
+// keccak-256 of count independent messages, datas[i] holding dataLens[i] bytes, written to md32s at 32 byte intervals
+void BRKeccak256Batch(void *md32s, const void *const datas[], const size_t dataLens[], size_t count)
+{
+    size_t i = 0;
+    
+    assert(md32s != NULL || count == 0);
+    assert((datas != NULL && dataLens != NULL) || count == 0);
+    pthread_once(&_cpu_once, _BRCPUInit);
+    
+#if BR_CRYPTO_X86
+    if (_avx2) {
+        for (; i + 4 <= count; i += 4) _BRKeccak256AVX2((uint8_t *)md32s + i*32, &datas[i], &dataLens[i]);
+    }
+#endif
+    
+    for (; i < count; i++) BRKeccak256((uint8_t *)md32s + i*32, datas[i], dataLens[i]);
+}
+
+void BRKeccak512(void *md64, const void *data, size_t dataLen)
+{
+    size_t i;
+    uint64_t x[9], buf[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    
+    assert(md64 != NULL);
+    assert(data != NULL || dataLen == 0);
+    
+    for (i = 0; i <= dataLen; i += 72) { // process data in 72 byte blocks
+        memcpy(x, (const uint8_t *)data + i, (i + 72 < dataLen) ? 72 : dataLen - i);
+        if (i + 72 > dataLen) break;
+        _BRSHA3Compress(buf, x, 72);
+    }
+    
+    memset((uint8_t *)x + (dataLen - i), 0, 72 - (dataLen - i)); // clear remainder of x
+    ((uint8_t *)x)[dataLen - i] |= 0x01; // append padding
+    ((uint8_t *)x)[71] |= 0x80;
+    _BRSHA3Compress(buf, x, 72); // finalize
+    for (i = 0; i < 8; i++) buf[i] = le64(buf[i]); // endian swap
+    memcpy(md64, buf, 64); // write to md
+    mem_clean(x, sizeof(x));
+    mem_clean(buf, sizeof(buf));
+}
+
 // basic md5 functions
 #define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
 #define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
@@ -1011,92 +1350,219 @@ static void _BRAESDecipher(uint8_t x[16], const uint8_t k[256], size_t kl)
     var_clean(&a, &b, &c, &d, &e, &f, &g);
 }
 
-// aes-ecb block cipher
-void BRAESECBEncrypt(void *buf16, const void *key, size_t keyLen)
+#if BR_CRYPTO_X86
+
+// aes-ni inverse cipher round keys: the encryption round keys in reverse order, with inverse mix columns applied to all
+// but the first and last
+__attribute__((target("aes")))
+static void _BRAESExpandKeyNI(uint8_t kd[256], const uint8_t k[256], size_t rounds)
 {
-    uint8_t k[256];
+    _mm_storeu_si128((__m128i *)kd, _mm_loadu_si128((const __m128i *)&k[rounds*16]));
     
-    assert(buf16 != NULL);
+    for (size_t i = 1; i < rounds; i++) {
+        _mm_storeu_si128((__m128i *)&kd[i*16], _mm_aesimc_si128(_mm_loadu_si128((const __m128i *)&k[(rounds - i)*16])));
+    }
+    
+    _mm_storeu_si128((__m128i *)&kd[rounds*16], _mm_loadu_si128((const __m128i *)k));
+}
+
+__attribute__((target("aes")))
+static void _BRAESCipherNI(uint8_t x[16], const uint8_t k[256], size_t rounds)
+{
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)x), _mm_loadu_si128((const __m128i *)k));
+    
+    for (size_t i = 1; i < rounds; i++) b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)&k[i*16]));
+    _mm_storeu_si128((__m128i *)x, _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)&k[rounds*16])));
+}
+
+__attribute__((target("aes")))
+static void _BRAESDecipherNI(uint8_t x[16], const uint8_t kd[256], size_t rounds)
+{
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)x), _mm_loadu_si128((const __m128i *)kd));
+    
+    for (size_t i = 1; i < rounds; i++) b = _mm_aesdec_si128(b, _mm_loadu_si128((const __m128i *)&kd[i*16]));
+    _mm_storeu_si128((__m128i *)x, _mm_aesdeclast_si128(b, _mm_loadu_si128((const __m128i *)&kd[rounds*16])));
+}
+
+// big endian 128bit counter block
+#define aesctr(hi, lo) _mm_set_epi64x((long long)__builtin_bswap64(lo), (long long)__builtin_bswap64(hi))
+
+// aes-ni ctr mode, encrypting eight counter blocks at a time to keep the aes pipeline full
+__attribute__((target("aes")))
+static void _BRAESCTRNI(const uint8_t k[256], size_t rounds, uint8_t iv[16], uint8_t *out, const uint8_t *data,
+                        size_t dataLen)
+{
+    __m128i rk[15], b[8];
+    uint64_t hi, lo;
+    uint8_t x[16];
+    size_t off = 0, i, j;
+    
+    memcpy(&hi, iv, sizeof(hi)), memcpy(&lo, &iv[8], sizeof(lo));
+    hi = __builtin_bswap64(hi), lo = __builtin_bswap64(lo);
+    for (i = 0; i <= rounds; i++) rk[i] = _mm_loadu_si128((const __m128i *)&k[i*16]);
+    
+    for (; off + sizeof(b) <= dataLen; off += sizeof(b)) {
+        for (j = 0; j < 8; j++) { // increment iv with overflow
+            b[j] = _mm_xor_si128(aesctr(hi, lo), rk[0]);
+            if (++lo == 0) hi++;
+        }
+        
+        for (i = 1; i < rounds; i++) {
+            for (j = 0; j < 8; j++) b[j] = _mm_aesenc_si128(b[j], rk[i]);
+        }
+        
+        for (j = 0; j < 8; j++) {
+            b[j] = _mm_aesenclast_si128(b[j], rk[rounds]);
+            b[j] = _mm_xor_si128(b[j], _mm_loadu_si128((const __m128i *)&data[off + j*16]));
+            _mm_storeu_si128((__m128i *)&out[off + j*16], b[j]);
+        }
+    }
+    
+    for (; off < dataLen; off += 16) {
+        b[0] = _mm_xor_si128(aesctr(hi, lo), rk[0]);
+        if (++lo == 0) hi++;
+        for (i = 1; i < rounds; i++) b[0] = _mm_aesenc_si128(b[0], rk[i]);
+        _mm_storeu_si128((__m128i *)x, _mm_aesenclast_si128(b[0], rk[rounds]));
+        for (i = 0; i < 16 && off + i < dataLen; i++) out[off + i] = data[off + i] ^ x[i];
+    }
+    
+    hi = __builtin_bswap64(hi), lo = __builtin_bswap64(lo);
+    memcpy(iv, &hi, sizeof(hi)), memcpy(&iv[8], &lo, sizeof(lo));
+    mem_clean(rk, sizeof(rk));
+    mem_clean(b, sizeof(b));
+    mem_clean(x, sizeof(x));
+}
+
+#endif // BR_CRYPTO_X86
+
+void BRAESKeyInit(BRAESKey *aesKey, const void *key, size_t keyLen)
+{
+    assert(aesKey != NULL);
     assert(key != NULL);
     assert(keyLen == 16 || keyLen == 24 || keyLen == 32);
     
-    _BRAESExpandKey(k, key, keyLen);
-    _BRAESCipher(buf16, k, keyLen);
-    mem_clean(k, sizeof(k));
+    pthread_once(&_cpu_once, _BRCPUInit);
+    memset(aesKey, 0, sizeof(*aesKey));
+    aesKey->keyLen = keyLen;
+    _BRAESExpandKey(aesKey->k, key, keyLen);
+#if BR_CRYPTO_X86
+    if (_aesni) _BRAESExpandKeyNI(aesKey->kd, aesKey->k, keyLen/4 + 6);
+#endif
 }
 
-void BRAESECBDecrypt(void *buf16, const void *key, size_t keyLen)
+void BRAESKeyClean(BRAESKey *aesKey)
+{
+    assert(aesKey != NULL);
+    mem_clean(aesKey, sizeof(*aesKey));
+}
+
+void BRAESKeyECBEncrypt(const BRAESKey *aesKey, void *buf16)
 {
-    uint8_t k[256];
+    assert(aesKey != NULL);
+    assert(buf16 != NULL);
     
+#if BR_CRYPTO_X86
+    if (_aesni) _BRAESCipherNI(buf16, aesKey->k, aesKey->keyLen/4 + 6);
+    else
+#endif
+    _BRAESCipher(buf16, aesKey->k, aesKey->keyLen);
+}
+
+void BRAESKeyECBDecrypt(const BRAESKey *aesKey, void *buf16)
+{
+    assert(aesKey != NULL);
     assert(buf16 != NULL);
-    assert(key != NULL);
-    assert(keyLen == 16 || keyLen == 24 || keyLen == 32);
     
-    _BRAESExpandKey(k, key, keyLen);
-    _BRAESDecipher(buf16, k, keyLen);
-    mem_clean(k, sizeof(k));
+#if BR_CRYPTO_X86
+    if (_aesni) _BRAESDecipherNI(buf16, aesKey->kd, aesKey->keyLen/4 + 6);
+    else
+#endif
+    _BRAESDecipher(buf16, aesKey->k, aesKey->keyLen);
 }
 
 // aes-ctr stream cipher encrypt/decrypt
-void BRAESCTR(void *out, const void *key, size_t keyLen, const void *iv16, const void *data, size_t dataLen)
+void BRAESKeyCTR(const BRAESKey *aesKey, void *out, void *iv16, const void *data, size_t dataLen)
 {
-    uint8_t x[16], iv[16], k[256];
+    uint8_t x[16], *iv = iv16;
     size_t off, i;
     
-    assert(out != NULL);
-    assert(key != NULL);
-    assert(keyLen == 16 || keyLen == 24 || keyLen == 32);
+    assert(aesKey != NULL);
+    assert(out != NULL || dataLen == 0);
     assert(iv16 != NULL);
     assert(data != NULL || dataLen == 0);
     
-    memcpy(iv, iv16, 16);
-    _BRAESExpandKey(k, key, keyLen);
+#if BR_CRYPTO_X86
+    if (_aesni) {
+        _BRAESCTRNI(aesKey->k, aesKey->keyLen/4 + 6, iv, out, data, dataLen);
+        return;
+    }
+#endif
     
     for (off = 0; off < dataLen; off++) {
         if ((off % 16) == 0) { // generate xor compliment
             memcpy(x, iv, 16);
-            _BRAESCipher(x, k, keyLen);
+            _BRAESCipher(x, aesKey->k, aesKey->keyLen);
             i = 16;
             do { iv[--i]++; } while (iv[i] == 0 && i > 0); // increment iv with overflow
         }
         
-        ((uint8_t *)out)[off] = (((uint8_t *)data)[off] ^ x[off % 16]);
+        ((uint8_t *)out)[off] = (((const uint8_t *)data)[off] ^ x[off % 16]);
     }
     
-    mem_clean(k, sizeof(k));
     mem_clean(x, sizeof(x));
 }
+
+// aes-ecb block cipher
+void BRAESECBEncrypt(void *buf16, const void *key, size_t keyLen)
+{
+    BRAESKey k;
+    
+    assert(buf16 != NULL);
+    BRAESKeyInit(&k, key, keyLen);
+    BRAESKeyECBEncrypt(&k, buf16);
+    BRAESKeyClean(&k);
+}
+
+void BRAESECBDecrypt(void *buf16, const void *key, size_t keyLen)
+{
+    BRAESKey k;
+    
+    assert(buf16 != NULL);
+    BRAESKeyInit(&k, key, keyLen);
+    BRAESKeyECBDecrypt(&k, buf16);
+    BRAESKeyClean(&k);
+}
+
 // aes-ctr stream cipher encrypt/decrypt
-void BRAESCTR_OFFSET(void *out, size_t outLen, const void *key, size_t keyLen, void *iv16, const void *data, size_t dataLen)
+void BRAESCTR(void *out, const void *key, size_t keyLen, const void *iv16, const void *data, size_t dataLen)
 {
-    uint8_t x[16], iv[16], k[256];
-    size_t off, i, outIdx = 0;
+    uint8_t iv[16];
+    BRAESKey k;
     
     assert(out != NULL);
-    assert(key != NULL);
-    assert(keyLen == 16 || keyLen == 24 || keyLen == 32);
     assert(iv16 != NULL);
     assert(data != NULL || dataLen == 0);
     
     memcpy(iv, iv16, 16);
-    _BRAESExpandKey(k, key, keyLen);
-    
-    for (off = (dataLen - outLen); off < dataLen; off++, outIdx++) {
-        if ((off % 16) == 0) { // generate xor compliment
-            memcpy(x, iv, 16);
-            _BRAESCipher(x, k, keyLen);
-            i = 16;
-            do { iv[--i]++; } while (iv[i] == 0 && i > 0); // increment iv with overflow
-        }
-        ((uint8_t *)out)[outIdx] = (((uint8_t *)data)[outIdx] ^ x[outIdx % 16]);
-    }
-    memcpy(iv16, iv, 16);
-    mem_clean(k, sizeof(k));
-    mem_clean(x, sizeof(x));
+    BRAESKeyInit(&k, key, keyLen);
+    BRAESKeyCTR(&k, out, iv, data, dataLen);
+    BRAESKeyClean(&k);
 }
 
-
+// aes-ctr stream cipher encrypt/decrypt, continuing from iv16 at offset dataLen - outLen
+void BRAESCTR_OFFSET(void *out, size_t outLen, const void *key, size_t keyLen, void *iv16, const void *data, size_t dataLen)
+{
+    BRAESKey k;
+    
+    assert(out != NULL);
+    assert(iv16 != NULL);
+    assert(data != NULL || dataLen == 0);
+    assert(outLen <= dataLen && ((dataLen - outLen) % 16) == 0);
+    
+    BRAESKeyInit(&k, key, keyLen);
+    BRAESKeyCTR(&k, out, iv16, data, outLen);
+    BRAESKeyClean(&k);
+}
 
 // dk = T1 || T2 || ... || Tdklen/hlen
 // Ti = U1 xor U2 xor ... xor Urounds
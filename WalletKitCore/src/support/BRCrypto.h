@@ -44,6 +44,11 @@ void BRSHA224(void *md28, const void *data, size_t dataLen);
 // double-sha-256 = sha-256(sha-256(x))
 void BRSHA256_2(void *md32, const void *data, size_t dataLen);
 
+// double-sha-256 of count messages, each dataLen bytes long and spaced stride bytes apart in data, written to md32s as
+// count consecutive 32 byte digests - e.g. 80 byte block headers or 64 byte merkle node pairs - using the sha-ni or
+// avx2 multi-buffer kernels when the cpu supports them
+void BRSHA256_2Batch(void *md32s, const void *data, size_t dataLen, size_t stride, size_t count);
+
 void BRSHA384(void *md48, const void *data, size_t dataLen);
 
 void BRSHA512(void *md64, const void *data, size_t dataLen);
@@ -60,6 +65,14 @@ void BRSHA3_256(void *md32, const void *data, size_t dataLen);
 // keccak-256: https://keccak.team/files/Keccak-submission-3.pdf
 void BRKeccak256(void *md32, const void *data, size_t dataLen);
 
+// keccak-256 of count independent messages, datas[i] holding dataLens[i] bytes, written to md32s as count consecutive
+// 32 byte digests - e.g. the nodes of an mpt proof or the public keys of many accounts - using the avx2 four-way
+// multi-buffer kernel when the cpu supports it
+void BRKeccak256Batch(void *md32s, const void *const datas[], const size_t dataLens[], size_t count);
+
+// keccak-512: https://keccak.team/files/Keccak-submission-3.pdf
+void BRKeccak512(void *md64, const void *data, size_t dataLen);
+
 // md5 - for non-cryptographic use only
 void BRMD5(void *md16, const void *data, size_t dataLen);
 
@@ -99,7 +112,31 @@ void BRAESECBDecrypt(void *buf16, const void *key, size_t keyLen);
 
 // aes-ctr stream cipher encrypt/decrypt
 void BRAESCTR(void *out, const void *key, size_t keyLen, const void *iv16, const void *data, size_t dataLen);
+
+// aes-ctr stream cipher encrypt/decrypt, continuing the key stream from iv16 at offset dataLen - outLen, which must
+// be a multiple of 16 - iv16 is updated to continue from dataLen
 void BRAESCTR_OFFSET(void *out, size_t outLen, const void *key, size_t keyLen, void *iv16, const void *data, size_t dataLen);
+
+// an aes key with its expanded key schedule, for ciphering many blocks with the same key
+// aes-ni is used when the cpu supports it
+typedef struct {
+    uint8_t k[256]; // cipher round keys
+    uint8_t kd[256]; // aes-ni inverse cipher round keys
+    size_t keyLen;
+} BRAESKey;
+
+void BRAESKeyInit(BRAESKey *aesKey, const void *key, size_t keyLen);
+
+// wipes the key schedule
+void BRAESKeyClean(BRAESKey *aesKey);
+
+void BRAESKeyECBEncrypt(const BRAESKey *aesKey, void *buf16);
+
+void BRAESKeyECBDecrypt(const BRAESKey *aesKey, void *buf16);
+
+// aes-ctr stream cipher encrypt/decrypt, iv16 is advanced past each 16 byte block of data, so consecutive calls with
+// data lengths that are multiples of 16 continue the same key stream
+void BRAESKeyCTR(const BRAESKey *aesKey, void *out, void *iv16, const void *data, size_t dataLen);
     
 void BRPBKDF2(void *dk, size_t dkLen, void (*hash)(void *, const void *, size_t), size_t hashLen,
               const void *pw, size_t pwLen, const void *salt, size_t saltLen, unsigned rounds);
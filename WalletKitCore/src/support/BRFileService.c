@@ -27,6 +27,7 @@
 #include "BRArray.h"
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -40,47 +41,77 @@ typedef int sqlite3_status_code;
 
 #define FILE_SERVICE_SDB_FILENAME      "entities.db"
 
+// The schema version is recorded in the DB's `user_version`:
+//   0: `Entity` w/ a CHAR `Type` and hex-encoded TEXT `Hash` and `Data`; SQLite's default, so
+//      never actually recorded.
+//   1: `EntityType` mapping `Type` names to an INTEGER and `EntityBlob` w/ BLOB `Hash` and `Data`
+#define FILE_SERVICE_SDB_SCHEMA_VERSION     (1)
+
+#define FILE_SERVICE_SDB_ENTITY_TYPE_TABLE     \
+"CREATE TABLE IF NOT EXISTS EntityType( \n\
+  Id        INTEGER     PRIMARY KEY,    \n\
+  Name      CHAR(64)    NOT NULL UNIQUE);"
+
 #define FILE_SERVICE_SDB_ENTITY_TABLE     \
-"CREATE TABLE IF NOT EXISTS Entity(     \n\
-  Type      CHAR(64)    NOT NULL,       \n\
-  Hash      CHAR(64)    NOT NULL,       \n\
-  Data      TEXT        NOT NULL,       \n\
+"CREATE TABLE IF NOT EXISTS EntityBlob( \n\
+  Type      INTEGER     NOT NULL,       \n\
+  Hash      BLOB        NOT NULL,       \n\
+  Data      BLOB        NOT NULL,       \n\
   PRIMARY KEY (Type, Hash));"
 
 typedef char FileServiceSQL[1024];
 
+#define FILE_SERVICE_SDB_INSERT_TYPE    \
+"INSERT OR IGNORE INTO EntityType (Name) VALUES (?);"
+
+#define FILE_SERVICE_SDB_QUERY_TYPE     \
+"SELECT Id FROM EntityType WHERE Name = ?;"
+
 #define FILE_SERVICE_SDB_INSERT_ENTITY    \
-"INSERT OR REPLACE INTO Entity (Type, Hash, Data) VALUES (?, ?, ?);"
+"INSERT OR REPLACE INTO EntityBlob (Type, Hash, Data) VALUES (?, ?, ?);"
 
 #define FILE_SERVICE_SDB_QUERY_ENTITY     \
-"SELECT Data FROM Entity WHERE Type = ? AND Hash = ?;"
+"SELECT Data FROM EntityBlob WHERE Type = ? AND Hash = ?;"
 
 #define FILE_SERVICE_SDB_QUERY_ALL_ENTITY     \
-"SELECT Hash, Data FROM Entity WHERE Type = ?;"
+"SELECT Data FROM EntityBlob WHERE Type = ?;"
+
+#define FILE_SERVICE_SDB_QUERY_ALL_HASH     \
+"SELECT Hash FROM EntityBlob WHERE Type = ?;"
 
 #define FILE_SERVICE_SDB_UPDATE_ENTITY     \
-"UPDATE Entity SET Data = ? WHERE Type = ? AND Hash = ?;"
+"UPDATE EntityBlob SET Data = ? WHERE Type = ? AND Hash = ?;"
 
 #define FILE_SERVICE_SDB_DELETE_ENTITY     \
-"DELETE FROM Entity WHERE Type = ? AND Hash = ?;"
+"DELETE FROM EntityBlob WHERE Type = ? AND Hash = ?;"
 
 #define FILE_SERVICE_SDB_DELETE_ALL_TYPE_ENTITY     \
-"DELETE FROM Entity WHERE Type = ?;"
+"DELETE FROM EntityBlob WHERE Type = ?;"
 
 #define FILE_SERVICE_SDB_DELETE_ALL_ENTITY     \
-"DELETE FROM Entity;"
+"DELETE FROM EntityBlob;"
+
+// Schema version 0 -> 1.  The types are copied in SQL; the entities are hex-decoded row by row.
+#define FILE_SERVICE_SDB_LEGACY_ENTITY_TABLE_EXISTS     \
+"SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'Entity';"
+
+#define FILE_SERVICE_SDB_LEGACY_COPY_TYPES     \
+"INSERT OR IGNORE INTO EntityType (Name) SELECT DISTINCT Type FROM Entity;"
+
+#define FILE_SERVICE_SDB_LEGACY_QUERY_ALL_ENTITY     \
+"SELECT EntityType.Id, Entity.Hash, Entity.Data FROM Entity JOIN EntityType ON EntityType.Name = Entity.Type;"
+
+#define FILE_SERVICE_SDB_LEGACY_DROP_ENTITY_TABLE     \
+"DROP TABLE Entity;"
 
 #if defined(DEBUG)
 static int needSQLiteCompileOptions = 1;
 #endif
-// HEX Encode/Decode - Cribbed from ethereum/util/BRUtilHex.c
+// HEX Decode - Cribbed from ethereum/util/BRUtilHex.c.  Only needed to migrate schema version 0.
 
 // Convert a char into uint8_t (decode)
 #define decodeChar(c)           ((uint8_t) _hexu(c))
 
-// Convert a uint8_t into a char (encode)
-#define encodeChar(u)           ((char)    _hexc(u))
-
 static void
 hexDecode (uint8_t *target, size_t targetLen, const char *source, size_t sourceLen) {
     //
@@ -92,18 +123,15 @@ hexDecode (uint8_t *target, size_t targetLen, const char *source, size_t sourceL
     }
 }
 
-static void
-hexEncode (char *target, size_t targetLen, const uint8_t *source, size_t sourceLen) {
-    assert (targetLen == 2 * sourceLen  + 1);
-
-    for (int i = 0; i < sourceLen; i++) {
-        target[2*i + 0] = encodeChar (source[i] >> 4);
-        target[2*i + 1] = encodeChar (source[i]);
-    }
-    target[2*sourceLen] = '\0';
-}
 
 /** Forward Declarations */
+static int
+fileServiceFailedImpl(BRFileService fs,
+                      int releaseLock,
+                      void* bufferToFree,
+                      FILE* fileToClose,
+                      const char *reason);
+
 static int
 fileServiceFailedSDB (BRFileService fs,
                       int releaseLock,
@@ -141,6 +169,7 @@ typedef struct {
 ///
 typedef struct {
     char *type;
+    sqlite3_int64 sdbType;   // The `EntityType.Id` for `type`
     BRFileServiceVersion currentVersion;
     BRArrayOf(BRFileServiceEntityHandler) handlers;
 } BRFileServiceEntityType;
@@ -184,14 +213,27 @@ struct BRFileServiceRecord {
 
 #if !defined(NEUTER_FILE_SERVICE)
     sqlite3 *sdb;
+    sqlite3_stmt *sdbInsertTypeStmt;
+    sqlite3_stmt *sdbSelectTypeStmt;
     sqlite3_stmt *sdbInsertStmt;
     sqlite3_stmt *sdbSelectStmt;
     sqlite3_stmt *sdbSelectAllStmt;
+    sqlite3_stmt *sdbSelectAllHashStmt;
     sqlite3_stmt *sdbUpdateStmt;
     sqlite3_stmt *sdbDeleteStmt;
     sqlite3_stmt *sdbDeleteAllTypeStmt;
     sqlite3_stmt *sdbDeleteAllStmt;
     bool  sdbClosed;
+
+    // The nesting depth of batches; the DB transaction is open iff `batchDepth > 0`.  If any
+    // write within the batch failed, then `batchFailed` and the transaction is rolled back.
+    size_t batchDepth;
+    bool   batchFailed;
+
+    // The thread that began the open batch.  Other threads wait on `batchCond` (with `lock`)
+    // until the batch commits, so that only `batchOwner` writes into, and can fail, the batch.
+    pthread_t batchOwner;
+    pthread_cond_t batchCond;
 #endif
 
     BRArrayOf(BRFileServiceEntityType) entityTypes;
@@ -222,6 +264,131 @@ fileServiceCreateFilePath (const char *basePath,
     return sdbPath;
 }
 
+#if !defined(NEUTER_FILE_SERVICE)
+static sqlite3_status_code
+fileServiceMigrateSchemaLegacy (BRFileService fs) {
+    sqlite3_stmt *sdbSelectStmt = NULL;
+    sqlite3_stmt *sdbInsertStmt = NULL;
+
+    uint8_t *dataBytes = NULL;
+    size_t   dataBytesCount = 0;
+
+    sqlite3_status_code status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_LEGACY_COPY_TYPES, NULL, NULL, NULL);
+
+    if (SQLITE_OK == status)
+        status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_LEGACY_QUERY_ALL_ENTITY, -1, &sdbSelectStmt, NULL);
+
+    if (SQLITE_OK == status)
+        status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_INSERT_ENTITY, -1, &sdbInsertStmt, NULL);
+
+    while (SQLITE_OK == status && SQLITE_ROW == (status = sqlite3_step (sdbSelectStmt))) {
+        sqlite3_int64 type = sqlite3_column_int64 (sdbSelectStmt, 0);
+        const char   *hash = (const char *) sqlite3_column_text (sdbSelectStmt, 1);
+        const char   *data = (const char *) sqlite3_column_text (sdbSelectStmt, 2);
+
+        status = SQLITE_OK;
+
+        // A malformed row could never have been loaded; drop it.
+        if (NULL == hash || 2 * sizeof (UInt256) != strlen (hash) ||
+            NULL == data || 0 != strlen (data) % 2)
+            continue;
+
+        UInt256 identifier;
+        hexDecode (identifier.u8, sizeof (UInt256), hash, 2 * sizeof (UInt256));
+
+        size_t dataCount = strlen (data);
+        if (dataCount / 2 > dataBytesCount) {
+            dataBytesCount = dataCount / 2;
+            dataBytes = realloc (dataBytes, dataBytesCount);
+        }
+        hexDecode (dataBytes, dataCount / 2, data, dataCount);
+
+        sqlite3_reset (sdbInsertStmt);
+        sqlite3_clear_bindings (sdbInsertStmt);
+
+        status = sqlite3_bind_int64 (sdbInsertStmt, 1, type);
+        if (SQLITE_OK == status)
+            status = sqlite3_bind_blob (sdbInsertStmt, 2, identifier.u8, sizeof (UInt256), SQLITE_STATIC);
+        if (SQLITE_OK == status)
+            status = sqlite3_bind_blob (sdbInsertStmt, 3, dataBytes, (int) (dataCount / 2), SQLITE_STATIC);
+        if (SQLITE_OK == status)
+            status = sqlite3_step (sdbInsertStmt);
+        if (SQLITE_DONE == status)
+            status = SQLITE_OK;
+    }
+    if (SQLITE_DONE == status) status = SQLITE_OK;
+
+    sqlite3_finalize (sdbInsertStmt);
+    sqlite3_finalize (sdbSelectStmt);
+    if (NULL != dataBytes) free (dataBytes);
+
+    if (SQLITE_OK == status)
+        status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_LEGACY_DROP_ENTITY_TABLE, NULL, NULL, NULL);
+
+    return status;
+}
+
+///
+/// Create the tables for FILE_SERVICE_SDB_SCHEMA_VERSION, migrating the entities from any prior
+/// schema version.  All in one DB transaction, so a failed migration leaves the DB as it was.
+///
+static sqlite3_status_code
+fileServiceUpdateSchema (BRFileService fs) {
+    sqlite3_stmt *stmt;
+    int version  = 0;
+    int migrated = 0;
+
+    // Immediate, to exclude another connection to the same DB that might also be updating.
+    sqlite3_status_code status = sqlite3_exec (fs->sdb, "BEGIN IMMEDIATE", NULL, NULL, NULL);
+    if (SQLITE_OK != status) return status;
+
+    status = sqlite3_prepare_v2 (fs->sdb, "PRAGMA user_version;", -1, &stmt, NULL);
+    if (SQLITE_OK == status) {
+        if (SQLITE_ROW == sqlite3_step (stmt)) version = sqlite3_column_int (stmt, 0);
+        sqlite3_finalize (stmt);
+    }
+
+    if (SQLITE_OK == status && version < FILE_SERVICE_SDB_SCHEMA_VERSION) {
+        status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_ENTITY_TYPE_TABLE, NULL, NULL, NULL);
+
+        if (SQLITE_OK == status)
+            status = sqlite3_exec (fs->sdb, FILE_SERVICE_SDB_ENTITY_TABLE, NULL, NULL, NULL);
+
+        if (SQLITE_OK == status)
+            status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_LEGACY_ENTITY_TABLE_EXISTS, -1, &stmt, NULL);
+
+        if (SQLITE_OK == status) {
+            migrated = (SQLITE_ROW == sqlite3_step (stmt));
+            sqlite3_finalize (stmt);
+
+            if (migrated)
+                status = fileServiceMigrateSchemaLegacy (fs);
+        }
+
+        if (SQLITE_OK == status) {
+            FileServiceSQL sql;
+            snprintf (sql, sizeof (sql), "PRAGMA user_version = %d;", FILE_SERVICE_SDB_SCHEMA_VERSION);
+            status = sqlite3_exec (fs->sdb, sql, NULL, NULL, NULL);
+        }
+    }
+
+    if (SQLITE_OK == status)
+        status = sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL);
+
+    if (SQLITE_OK != status) {
+        if (!sqlite3_get_autocommit (fs->sdb))
+            sqlite3_exec (fs->sdb, "ROLLBACK", NULL, NULL, NULL);
+        return status;
+    }
+
+    // Reclaim the space of the hex-encoded entities.  One time only; failure is harmless.
+    if (migrated)
+        sqlite3_exec (fs->sdb, "VACUUM", NULL, NULL, NULL);
+
+    return SQLITE_OK;
+}
+#endif // !defined(NEUTER_FILE_SERVICE)
+
 extern BRFileService
 fileServiceCreate (const char *basePath,
                    const char *currency,
@@ -262,6 +429,10 @@ fileServiceCreate (const char *basePath,
         pthread_mutexattr_destroy(&attr);
     }
 
+#if !defined(NEUTER_FILE_SERVICE)
+    pthread_cond_init (&fs->batchCond, NULL);
+#endif
+
     // Set the error handler - early
     fileServiceSetErrorHandler (fs, context, handler);
 
@@ -275,6 +446,8 @@ fileServiceCreate (const char *basePath,
 #if !defined(NEUTER_FILE_SERVICE)
     fs->sdb = NULL;
     fs->sdbClosed = false;
+    fs->batchDepth = 0;
+    fs->batchFailed = false;
 
     // Create/Open the SQLITE Database
     sqlite3_status_code status = sqlite3_open(fs->sdbPath, &fs->sdb);
@@ -283,21 +456,28 @@ fileServiceCreate (const char *basePath,
         return NULL;
     }
 
-    // Create the SQLite 'Entity' Table
-    sqlite3_stmt *sdbCreateTableStmt;
-    status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_ENTITY_TABLE, -1, &sdbCreateTableStmt, NULL);
+    // Create the SQLite 'EntityType' and 'EntityBlob' Tables, migrating any prior schema
+    status = fileServiceUpdateSchema (fs);
     if (SQLITE_OK != status)
         return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
             FILE_SERVICE_SDB,
             { .sdb = { status }}
         });
 
-    if (SQLITE_DONE != sqlite3_step(sdbCreateTableStmt))
+    // Create the SQLITE 'Insert into EntityType' and 'Select EntityType By Name' Statements
+    status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_INSERT_TYPE, -1, &fs->sdbInsertTypeStmt, NULL);
+    if (SQLITE_OK != status)
+        return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
+            FILE_SERVICE_SDB,
+            { .sdb = { status }}
+        });
+
+    status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_QUERY_TYPE, -1, &fs->sdbSelectTypeStmt, NULL);
+    if (SQLITE_OK != status)
         return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
             FILE_SERVICE_SDB,
             { .sdb = { status }}
         });
-    sqlite3_finalize(sdbCreateTableStmt);
 
     // Create the SQLITE 'Insert into Entity' Statement
     status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_INSERT_ENTITY, -1, &fs->sdbInsertStmt, NULL);
@@ -323,6 +503,14 @@ fileServiceCreate (const char *basePath,
             { .sdb = { status }}
         });
 
+    // Create the SQLITE "Select Entity Hash' Statement
+    status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_QUERY_ALL_HASH, -1, &fs->sdbSelectAllHashStmt, NULL);
+    if (SQLITE_OK != status)
+        return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
+            FILE_SERVICE_SDB,
+            { .sdb = { status }}
+        });
+
     status = sqlite3_prepare_v2 (fs->sdb, FILE_SERVICE_SDB_UPDATE_ENTITY, -1, &fs->sdbUpdateStmt, NULL);
     if (SQLITE_OK != status)
         return fileServiceCreateReturnError (fs, 1, (BRFileServiceError) {
@@ -379,9 +567,18 @@ _fileServiceCloseInternal (BRFileService fs) {
     if (fs->sdbClosed) return;
 
     fs->sdbClosed = true;
+
+    // Closing the DB rolls back any uncommitted batch; threads waiting on it then find `fs` closed.
+    fs->batchDepth = 0;
+    fs->batchFailed = false;
+    pthread_cond_broadcast (&fs->batchCond);
+
+    _fileServiceFinalizeStmt (fs, &fs->sdbInsertTypeStmt);
+    _fileServiceFinalizeStmt (fs, &fs->sdbSelectTypeStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbInsertStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbSelectStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbSelectAllStmt);
+    _fileServiceFinalizeStmt (fs, &fs->sdbSelectAllHashStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbUpdateStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbDeleteStmt);
     _fileServiceFinalizeStmt (fs, &fs->sdbDeleteAllTypeStmt);
@@ -424,6 +621,9 @@ fileServiceRelease (BRFileService fs) {
 
     pthread_mutex_unlock (&fs->lock);
     pthread_mutex_destroy(&fs->lock);
+#if !defined(NEUTER_FILE_SERVICE)
+    pthread_cond_destroy (&fs->batchCond);
+#endif
 
     free (fs);
 }
@@ -436,6 +636,16 @@ fileServiceSetErrorHandler (BRFileService fs,
     fs->handler = handler;
 }
 
+/// Lock `fs`, first waiting out any batch begun on another thread.
+static void
+fileServiceLock (BRFileService fs) {
+    pthread_mutex_lock (&fs->lock);
+#if !defined(NEUTER_FILE_SERVICE)
+    while (fs->batchDepth > 0 && !pthread_equal (fs->batchOwner, pthread_self()))
+        pthread_cond_wait (&fs->batchCond, &fs->lock);
+#endif
+}
+
 static BRFileServiceEntityType *
 fileServiceLookupType (const BRFileService fs,
                        const char *type) {
@@ -446,12 +656,65 @@ fileServiceLookupType (const BRFileService fs,
     return NULL;
 }
 
+/// Return the `EntityType.Id` for `type`, adding `type` if needed; report failures.
+static int
+fileServiceLookupTypeIdentifier (const BRFileService fs,
+                                 const char *type,
+                                 sqlite3_int64 *sdbType) {
+    *sdbType = 0;
+
+#if !defined(NEUTER_FILE_SERVICE)
+    sqlite3_status_code status;
+
+    fileServiceLock (fs);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    sqlite3_reset (fs->sdbInsertTypeStmt);
+    sqlite3_clear_bindings (fs->sdbInsertTypeStmt);
+
+    status = sqlite3_bind_text (fs->sdbInsertTypeStmt, 1, type, -1, SQLITE_STATIC);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    status = sqlite3_step (fs->sdbInsertTypeStmt);
+    if (SQLITE_DONE != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    sqlite3_reset (fs->sdbInsertTypeStmt);
+
+    sqlite3_reset (fs->sdbSelectTypeStmt);
+    sqlite3_clear_bindings (fs->sdbSelectTypeStmt);
+
+    status = sqlite3_bind_text (fs->sdbSelectTypeStmt, 1, type, -1, SQLITE_STATIC);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    status = sqlite3_step (fs->sdbSelectTypeStmt);
+    if (SQLITE_ROW != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    *sdbType = sqlite3_column_int64 (fs->sdbSelectTypeStmt, 0);
+
+    sqlite3_reset (fs->sdbSelectTypeStmt);
+
+    pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+    return 1;
+}
+
 static BRFileServiceEntityType *
 fileServiceAddType (const BRFileService fs,
                     const char *type,
                     BRFileServiceVersion version) {
+    sqlite3_int64 sdbType;
+    if (0 == fileServiceLookupTypeIdentifier (fs, type, &sdbType))
+        return NULL;
+
     BRFileServiceEntityType entityType = {
         strdup (type),
+        sdbType,
         version,
         NULL
     };
@@ -524,6 +787,11 @@ static int
 fileServiceFailedSDB (BRFileService fs,
                       int releaseLock,
                       sqlite3_status_code code) {
+#if !defined(NEUTER_FILE_SERVICE)
+    // Always called with the lock held, which, within a batch, only the batch owner can hold; a
+    // failure dooms the enclosing batch, if any.
+    if (fs->batchDepth > 0 && pthread_equal (fs->batchOwner, pthread_self())) fs->batchFailed = true;
+#endif
     return fileServiceFailedInternal (fs, releaseLock, NULL, NULL,
                                       (BRFileServiceError) {
                                           FILE_SERVICE_SDB,
@@ -531,20 +799,6 @@ fileServiceFailedSDB (BRFileService fs,
                                       });
 }
 
-static int
-fileServiceFailedEntity(BRFileService fs,
-                        int releaseLock,
-                        void* bufferToFree,
-                        FILE* fileToClose,
-                        const char *type,
-                        const char *reason) {
-    return fileServiceFailedInternal (fs, releaseLock, bufferToFree, fileToClose,
-                                      (BRFileServiceError) {
-                                          FILE_SERVICE_ENTITY,
-                                          { .entity = { type, reason }}
-                                      });
-}
-
 /// MARK: - Save
 
 static int
@@ -560,9 +814,8 @@ _fileServiceSave (BRFileService fs,
     if (NULL == handler) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type handler"); return 0; };
 
 #if !defined(NEUTER_FILE_SERVICE)
-    // Get then hex-encode the identifer
+    // Get the identifer
     UInt256 identifier = handler->identifier (handler->context, fs, entity);
-    const char *hash = u256hex(identifier);
 
     // Get the entity bytes
     uint32_t entityBytesCount;
@@ -588,45 +841,39 @@ _fileServiceSave (BRFileService fs,
     memcpy (&bytes[offset], entityBytes, entityBytesCount);
     free (entityBytes);
 
-    // Nex encode bytes
-    size_t dataCount = 2 * bytesCount + 1;
-    char *data = malloc (dataCount);
-    hexEncode (data, dataCount, bytes, bytesCount);
-    free (bytes);
-
     // Fill out the SQL statement
     sqlite3_status_code status;
 
     if (needLock)
-        pthread_mutex_lock (&fs->lock);
+        fileServiceLock (fs);
 
     if (fs->sdbClosed)
-        return fileServiceFailedImpl (fs, needLock, NULL, NULL, "closed");
+        return fileServiceFailedImpl (fs, needLock, bytes, NULL, "closed");
 
     sqlite3_reset (fs->sdbInsertStmt);
     sqlite3_clear_bindings(fs->sdbInsertStmt);
 
-    status = sqlite3_bind_text (fs->sdbInsertStmt, 1, type, -1, SQLITE_STATIC);
+    status = sqlite3_bind_int64 (fs->sdbInsertStmt, 1, entityType->sdbType);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
-    status = sqlite3_bind_text (fs->sdbInsertStmt, 2, hash, -1, SQLITE_STATIC);
+    status = sqlite3_bind_blob (fs->sdbInsertStmt, 2, identifier.u8, sizeof (UInt256), SQLITE_STATIC);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
-    status = sqlite3_bind_text (fs->sdbInsertStmt, 3, data, -1, SQLITE_STATIC);
+    status = sqlite3_bind_blob (fs->sdbInsertStmt, 3, bytes, (int) bytesCount, SQLITE_STATIC);
     if (SQLITE_OK != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
     status = sqlite3_step (fs->sdbInsertStmt);
     if (SQLITE_DONE != status) {
-        free (data);
+        free (bytes);
         return fileServiceFailedSDB (fs, needLock, status);
     }
 
@@ -636,7 +883,7 @@ _fileServiceSave (BRFileService fs,
     if (needLock)
         pthread_mutex_unlock (&fs->lock);
 
-    free (data);
+    free (bytes);
 #endif // !defined(NEUTER_FILE_SERVICE)
 
     return 1;
@@ -649,13 +896,296 @@ fileServiceSave (BRFileService fs,
     return _fileServiceSave (fs, type, entity, 1);
 }
 
+/// MARK: - Batch
+
+#if !defined(NEUTER_FILE_SERVICE)
+// Both called with the lock held (see fileServiceLock()).  Only the outermost begin/commit touch
+// the DB; the outermost begin makes this thread the batch owner until the outermost commit.
+static sqlite3_status_code
+_fileServiceBatchBegin (BRFileService fs) {
+    if (0 == fs->batchDepth) {
+        sqlite3_status_code status = sqlite3_exec (fs->sdb, "BEGIN", NULL, NULL, NULL);
+        if (SQLITE_OK != status) return status;
+        fs->batchFailed = false;
+        fs->batchOwner  = pthread_self();
+    }
+    fs->batchDepth += 1;
+    return SQLITE_OK;
+}
+
+/// Return SQLITE_OK if committed (or still nested), SQLITE_ABORT if rolled back on account of
+/// an earlier failure, or the status of a failed COMMIT (which is then rolled back).
+static sqlite3_status_code
+_fileServiceBatchCommit (BRFileService fs) {
+    assert (fs->batchDepth > 0);
+
+    fs->batchDepth -= 1;
+    if (fs->batchDepth > 0) return SQLITE_OK;
+
+    sqlite3_status_code status = (fs->batchFailed
+                                  ? SQLITE_ABORT
+                                  : sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL));
+
+    // SQLite may have rolled back already (on SQLITE_FULL, SQLITE_IOERR, etc).
+    if (SQLITE_OK != status && !sqlite3_get_autocommit (fs->sdb))
+        sqlite3_exec (fs->sdb, "ROLLBACK", NULL, NULL, NULL);
+
+    fs->batchFailed = false;
+    pthread_cond_broadcast (&fs->batchCond);
+    return status;
+}
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+extern int
+fileServiceSaveMany (BRFileService fs,
+                     const char *type,
+                     const void **entities,
+                     size_t entitiesCount) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType)
+        return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
+
+#if !defined(NEUTER_FILE_SERVICE)
+    sqlite3_status_code status;
+
+    fileServiceLock (fs);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    status = _fileServiceBatchBegin (fs);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    for (size_t index = 0; index < entitiesCount; index++)
+        if (0 == _fileServiceSave (fs, type, entities[index], 0)) {
+            fs->batchFailed = true;
+            _fileServiceBatchCommit (fs);
+            pthread_mutex_unlock (&fs->lock);
+            return 0;
+        }
+
+    status = _fileServiceBatchCommit (fs);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+    return 1;
+}
+
+extern int
+fileServiceBeginBatch (BRFileService fs) {
+#if !defined(NEUTER_FILE_SERVICE)
+    fileServiceLock (fs);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    sqlite3_status_code status = _fileServiceBatchBegin (fs);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+    return 1;
+}
+
+extern int
+fileServiceCommitBatch (BRFileService fs) {
+#if !defined(NEUTER_FILE_SERVICE)
+    fileServiceLock (fs);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    if (0 == fs->batchDepth)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "missed batch");
+
+    sqlite3_status_code status = _fileServiceBatchCommit (fs);
+
+    // The failure that doomed the batch has already been reported.
+    if (SQLITE_ABORT == status) {
+        pthread_mutex_unlock (&fs->lock);
+        return 0;
+    }
+
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+    return 1;
+}
+
+/// MARK: - Journal Mode, Synchronous
+
+#if !defined(NEUTER_FILE_SERVICE)
+static int
+_fileServicePragmaResult (void *context, int columnsCount, char **values, char **names) {
+    char *result = context;
+    if (columnsCount > 0 && NULL != values[0])
+        strncpy (result, values[0], 15);
+    return 0;
+}
+
+static int
+_fileServiceSetPragma (BRFileService fs,
+                       const char *pragma,
+                       const char *value,
+                       int checkResult) {
+    FileServiceSQL sql;
+    char result[16] = { '\0' };
+
+    fileServiceLock (fs);
+    if (fs->sdbClosed)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+
+    // Neither can be changed within a transaction.
+    if (fs->batchDepth > 0)
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "in batch");
+
+    snprintf (sql, sizeof (sql), "PRAGMA %s = %s;", pragma, value);
+
+    sqlite3_status_code status = sqlite3_exec (fs->sdb, sql, _fileServicePragmaResult, result, NULL);
+    if (SQLITE_OK != status)
+        return fileServiceFailedSDB (fs, 1, status);
+
+    // Some pragmas, like `journal_mode`, report the resulting value rather than failing.
+    if (checkResult && 0 != strcasecmp (result, value))
+        return fileServiceFailedImpl (fs, 1, NULL, NULL, "unsupported pragma value");
+
+    pthread_mutex_unlock (&fs->lock);
+    return 1;
+}
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+extern int
+fileServiceSetJournalMode (BRFileService fs,
+                           BRFileServiceJournalMode mode) {
+#if !defined(NEUTER_FILE_SERVICE)
+    const char *value = NULL;
+    switch (mode) {
+        case FILE_SERVICE_JOURNAL_MODE_DELETE: value = "delete"; break;
+        case FILE_SERVICE_JOURNAL_MODE_WAL:    value = "wal";    break;
+    }
+    if (NULL == value) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed journal mode");
+
+    return _fileServiceSetPragma (fs, "journal_mode", value, 1);
+#else
+    return 1;
+#endif
+}
+
+extern int
+fileServiceSetSynchronous (BRFileService fs,
+                           BRFileServiceSynchronous level) {
+#if !defined(NEUTER_FILE_SERVICE)
+    const char *value = NULL;
+    switch (level) {
+        case FILE_SERVICE_SYNCHRONOUS_OFF:    value = "OFF";    break;
+        case FILE_SERVICE_SYNCHRONOUS_NORMAL: value = "NORMAL"; break;
+        case FILE_SERVICE_SYNCHRONOUS_FULL:   value = "FULL";   break;
+    }
+    if (NULL == value) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed synchronous level");
+
+    return _fileServiceSetPragma (fs, "synchronous", value, 0);
+#else
+    return 1;
+#endif
+}
+
 /// MARK: - Load
 
+#if !defined(NEUTER_FILE_SERVICE)
+///
+/// Read an entity from `data`, as saved by _fileServiceSave().  The readers are handed mutable
+/// bytes, SQLite's are not; so `data` is copied into `*dataBytes`, which is grown as needed and
+/// is owned by the caller.  On failure, returns NULL and fills `error`.
+///
+static void *
+_fileServiceReadEntity (BRFileService fs,
+                        BRFileServiceEntityType *entityType,
+                        const uint8_t *data,
+                        size_t dataCount,
+                        uint8_t **dataBytes,
+                        size_t *dataBytesCount,
+                        bool *outdated,
+                        BRFileServiceError *error) {
+    // At least the header: {HeaderFormatVersion, Current(Type)Version, EntityBytesCount}
+    if (NULL == data || dataCount < 1 + 1 + sizeof (uint32_t)) {
+        *error = (BRFileServiceError) { FILE_SERVICE_IMPL, { .impl = { "missed query `data`" }}};
+        return NULL;
+    }
+
+    // Ensure `dataBytes` is large enough for `data`
+    if (dataCount > *dataBytesCount) {
+        *dataBytesCount = dataCount;
+        *dataBytes = realloc (*dataBytes, *dataBytesCount);
+    }
+    memcpy (*dataBytes, data, dataCount);
+
+    size_t offset = 0;
+    BRFileServiceVersion version = 0;
+    uint32_t  entityBytesCount = 0;
+    uint8_t  *entityBytes;
+
+    BRFileServiceHeaderFormatVersion headerVersion = (*dataBytes)[offset];
+    offset += 1;
+
+    switch (headerVersion) {
+        case HEADER_FORMAT_1:
+            version = (*dataBytes)[offset];
+            offset += 1;
+
+            entityBytesCount = UInt32GetBE (&(*dataBytes)[offset]);
+            offset += sizeof (uint32_t);
+
+            break;
+    }
+
+    // Assert entityBytesCount remain in dataBytes
+    if (offset + entityBytesCount > dataCount) {
+        assert (0); // In DEBUG builds.
+        *error = (BRFileServiceError) { FILE_SERVICE_IMPL, { .impl = { "missed bytes count" }}};
+        return NULL;
+    }
+
+    entityBytes = &(*dataBytes)[offset];
+
+    switch (headerVersion) {
+        case HEADER_FORMAT_1:
+            // compute then compare checksum
+            break;
+    }
+
+    // Look up the entity handler
+    BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, version);
+    if (NULL == handler) {
+        *error = (BRFileServiceError) { FILE_SERVICE_IMPL, { .impl = { "missed type handler" }}};
+        return NULL;
+    }
+
+    // Read the entity from buffer
+    void *entity = handler->reader (handler->context, fs, entityBytes, entityBytesCount);
+    if (NULL == entity) {
+        *error = (BRFileServiceError) { FILE_SERVICE_ENTITY, { .entity = { entityType->type, "reader" }}};
+        return NULL;
+    }
+
+    *outdated = (version != entityType->currentVersion ||
+                 headerVersion != currentHeaderFormatVersion);
+
+    return entity;
+}
+#endif // !defined(NEUTER_FILE_SERVICE)
+
 extern int
-fileServiceLoad (BRFileService fs,
-                 BRSet *results,
-                 const char *type,
-                 int updateVersion) {
+fileServiceLoadEach (BRFileService fs,
+                     const char *type,
+                     int updateVersion,
+                     BRFileServiceContext context,
+                     BRFileServiceLoadHandler handler) {
     BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
     if (NULL == entityType) return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
 
@@ -665,115 +1195,196 @@ fileServiceLoad (BRFileService fs,
 #if !defined(NEUTER_FILE_SERVICE)
     sqlite3_status_code status;
 
-    pthread_mutex_lock (&fs->lock);
+    fileServiceLock (fs);
     if (fs->sdbClosed)
         return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
 
     sqlite3_reset (fs->sdbSelectAllStmt);
     sqlite3_clear_bindings (fs->sdbSelectAllStmt);
 
-    status = sqlite3_bind_text (fs->sdbSelectAllStmt, 1, type, -1, SQLITE_STATIC);
+    status = sqlite3_bind_int64 (fs->sdbSelectAllStmt, 1, entityType->sdbType);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
-    uint8_t  dataBytesBuffer[8196];
-    uint8_t *dataBytes = dataBytesBuffer;
-    size_t   dataBytesCount = 8196;
+    // One row at a time; only the largest row's bytes are held.
+    uint8_t *dataBytes = NULL;
+    size_t   dataBytesCount = 0;
+
+    while (SQLITE_ROW == (status = sqlite3_step(fs->sdbSelectAllStmt))) {
+        BRFileServiceError error;
+        bool outdated = false;
+
+        void *entity = _fileServiceReadEntity (fs, entityType,
+                                               sqlite3_column_blob  (fs->sdbSelectAllStmt, 0),
+                                               (size_t) sqlite3_column_bytes (fs->sdbSelectAllStmt, 0),
+                                               &dataBytes, &dataBytesCount,
+                                               &outdated,
+                                               &error);
+        if (NULL == entity) {
+            sqlite3_reset (fs->sdbSelectAllStmt);
+            return fileServiceFailedInternal (fs, 1, dataBytes, NULL, error);
+        }
 
-    // Zero out the dataByte memory to avoid subsequent Clang Static Analysis errors releted
-    // to dereferencing uninitialized memory.  We accept this minimal, extraneous function call.
-    memset(dataBytes, 0, dataBytesCount);
+        // If the read version is not the current version, update.  Do this before `handler`
+        // takes ownership of `entity`.
+        if (updateVersion && outdated)
+            // This could signal an error.  Perhaps we should test the return result and
+            // if `0` skip out here?  We won't - we couldn't save the entity in the new format
+            // but we'll continue and will try next time we load it.
+            _fileServiceSave (fs, type, entity, 0);
 
-    while (SQLITE_ROW == sqlite3_step(fs->sdbSelectAllStmt)) {
-        const char *hash = (const char *) sqlite3_column_text (fs->sdbSelectAllStmt, 0);
-        const char *data = (const char *) sqlite3_column_text (fs->sdbSelectAllStmt, 1);
+        if (0 == handler (context, fs, entity)) {
+            status = SQLITE_DONE;
+            break;
+        }
+    }
 
-        if (NULL == hash || NULL == data)
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed query `hash` or `data`");
+    // Ensure the 'implicit DB transaction' is committed.
+    sqlite3_reset (fs->sdbSelectAllStmt);
 
-        assert (64 == strlen (hash));
-        
-        // Ensure `dataBytes` is large enough for hex-decoded `data`
-        size_t dataCount = strlen (data);
-        assert (0 == dataCount % 2);  // Surely 'even'
-        if ((dataCount/2) > dataBytesCount) {
-            if (dataBytes != dataBytesBuffer) free (dataBytes);
-            dataBytesCount = dataCount/2;
-            dataBytes = malloc (dataBytesCount);
-        }
+    if (NULL != dataBytes) free (dataBytes);
 
-        // Actually decode `data` into `dataBytes`
-        hexDecode (dataBytes, dataCount/2, data, dataCount);
+    if (SQLITE_DONE != status)
+        return fileServiceFailedSDB (fs, 1, status);
 
-        size_t offset = 0;
-        BRFileServiceVersion version;
-        uint32_t  entityBytesCount;
-        uint8_t  *entityBytes;
+    pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
 
-        BRFileServiceHeaderFormatVersion headerVersion = dataBytes[offset];
-        offset += 1;
+    return 1;
+}
 
-        switch (headerVersion) {
-            case HEADER_FORMAT_1:
-                version = dataBytes[offset];
-                offset += 1;
+static int
+fileServiceLoadIntoSet (BRFileServiceContext context,
+                        BRFileService fs,
+                        void *entity) {
+    BRSet *results = (BRSet *) context;
 
-                entityBytesCount = UInt32GetBE (&dataBytes[offset]);
-                offset += sizeof (uint32_t);
+    // Update restuls with the newly restored entity
+    BRSetAdd (results, entity);
+    return 1;
+}
 
-                break;
-        }
+extern int
+fileServiceLoad (BRFileService fs,
+                 BRSet *results,
+                 const char *type,
+                 int updateVersion) {
+    return fileServiceLoadEach (fs, type, updateVersion, results, fileServiceLoadIntoSet);
+}
 
-        // Assert entityBytesCount remain in dataBytes
-        if (offset + entityBytesCount > dataBytesCount) {
-            assert (0); // In DEBUG builds.
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed bytes count");
-        }
+extern BRArrayOf(UInt256)
+fileServiceLoadIdentifiers (BRFileService fs,
+                            const char *type) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return NULL; }
 
-        entityBytes = &dataBytes[offset];
+    BRArrayOf(UInt256) identifiers;
+    array_new (identifiers, 100);
 
-        switch (headerVersion) {
-            case HEADER_FORMAT_1:
-                // compute then compare checksum
-                break;
-        }
+#if !defined(NEUTER_FILE_SERVICE)
+    sqlite3_status_code status;
 
-        // Look up the entity handler
-        BRFileServiceEntityHandler *handler = fileServiceEntityTypeLookupHandler(entityType, version);
-        if (NULL == handler)
-            return fileServiceFailedImpl (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                          "missed type handler");
-
-        // Read the entity from buffer and add to results.
-        void *entity = handler->reader (handler->context, fs, entityBytes, entityBytesCount);
-        if (NULL == entity)
-            return fileServiceFailedEntity (fs, 1, (dataBytes == dataBytesBuffer ? NULL : dataBytes), NULL,
-                                            type, "reader");
-
-        // Update restuls with the newly restored entity
-        BRSetAdd (results, entity);
-
-        // If the read version is not the current version, update
-        if (updateVersion &&
-            (version != entityType->currentVersion ||
-             headerVersion != currentHeaderFormatVersion))
-            // This could signal an error.  Perhaps we should test the return result and
-            // if `0` skip out here?  We won't - we couldn't save the entity in the new format
-            // but we'll continue and will try next time we load it.
-            _fileServiceSave (fs, type, entity, 0);
+    fileServiceLock (fs);
+    if (fs->sdbClosed) {
+        array_free (identifiers);
+        fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
+        return NULL;
+    }
+
+    sqlite3_reset (fs->sdbSelectAllHashStmt);
+    sqlite3_clear_bindings (fs->sdbSelectAllHashStmt);
+
+    status = sqlite3_bind_int64 (fs->sdbSelectAllHashStmt, 1, entityType->sdbType);
+    if (SQLITE_OK != status) {
+        array_free (identifiers);
+        fileServiceFailedSDB (fs, 1, status);
+        return NULL;
+    }
+
+    while (SQLITE_ROW == (status = sqlite3_step (fs->sdbSelectAllHashStmt))) {
+        const void *hash = sqlite3_column_blob (fs->sdbSelectAllHashStmt, 0);
+        if (NULL == hash || sizeof (UInt256) != sqlite3_column_bytes (fs->sdbSelectAllHashStmt, 0))
+            continue;
+
+        UInt256 identifier;
+        memcpy (identifier.u8, hash, sizeof (UInt256));
+        array_add (identifiers, identifier);
     }
 
     // Ensure the 'implicit DB transaction' is committed.
-    sqlite3_reset (fs->sdbSelectAllStmt);
+    sqlite3_reset (fs->sdbSelectAllHashStmt);
+
+    if (SQLITE_DONE != status) {
+        array_free (identifiers);
+        fileServiceFailedSDB (fs, 1, status);
+        return NULL;
+    }
 
     pthread_mutex_unlock (&fs->lock);
+#endif // !defined(NEUTER_FILE_SERVICE)
+
+    return identifiers;
+}
+
+extern void *
+fileServiceLoadEntity (BRFileService fs,
+                       const char *type,
+                       UInt256 identifier,
+                       int updateVersion) {
+    BRFileServiceEntityType *entityType = fileServiceLookupType (fs, type);
+    if (NULL == entityType) { fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type"); return NULL; }
+
+    void *entity = NULL;
+
+#if !defined(NEUTER_FILE_SERVICE)
+    sqlite3_status_code status;
+
+    fileServiceLock (fs);
+    if (fs->sdbClosed) { fileServiceFailedImpl (fs, 1, NULL, NULL, "closed"); return NULL; }
+
+    sqlite3_reset (fs->sdbSelectStmt);
+    sqlite3_clear_bindings (fs->sdbSelectStmt);
+
+    status = sqlite3_bind_int64 (fs->sdbSelectStmt, 1, entityType->sdbType);
+    if (SQLITE_OK != status) { fileServiceFailedSDB (fs, 1, status); return NULL; }
+
+    status = sqlite3_bind_blob (fs->sdbSelectStmt, 2, identifier.u8, sizeof (UInt256), SQLITE_STATIC);
+    if (SQLITE_OK != status) { fileServiceFailedSDB (fs, 1, status); return NULL; }
+
+    status = sqlite3_step (fs->sdbSelectStmt);
+    if (SQLITE_ROW == status) {
+        BRFileServiceError error;
+        bool outdated = false;
 
-    if (dataBytes != dataBytesBuffer) free (dataBytes);
+        uint8_t *dataBytes = NULL;
+        size_t   dataBytesCount = 0;
+
+        entity = _fileServiceReadEntity (fs, entityType,
+                                         sqlite3_column_blob  (fs->sdbSelectStmt, 0),
+                                         (size_t) sqlite3_column_bytes (fs->sdbSelectStmt, 0),
+                                         &dataBytes, &dataBytesCount,
+                                         &outdated,
+                                         &error);
+
+        sqlite3_reset (fs->sdbSelectStmt);
+
+        if (NULL == entity) { fileServiceFailedInternal (fs, 1, dataBytes, NULL, error); return NULL; }
+        free (dataBytes);
+
+        if (updateVersion && outdated)
+            _fileServiceSave (fs, type, entity, 0);
+    }
+    else {
+        sqlite3_reset (fs->sdbSelectStmt);
+
+        // Not found is not a failure
+        if (SQLITE_DONE != status) { fileServiceFailedSDB (fs, 1, status); return NULL; }
+    }
+
+    pthread_mutex_unlock (&fs->lock);
 #endif // !defined(NEUTER_FILE_SERVICE)
 
-    return 1;
+    return entity;
 }
 
 /// MARK: - Remove, Clear
@@ -787,23 +1398,20 @@ fileServiceRemove (BRFileService fs,
         return fileServiceFailedImpl (fs, 0, NULL, NULL, "missed type");
 
 #if !defined(NEUTER_FILE_SERVICE)
-    // Hex-Encode identifier
-    const char *hash = u256hex(identifier);
-
     sqlite3_status_code status;
 
-    pthread_mutex_lock (&fs->lock);
+    fileServiceLock (fs);
     if (fs->sdbClosed)
         return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
 
     sqlite3_reset (fs->sdbDeleteStmt);
     sqlite3_clear_bindings (fs->sdbDeleteStmt);
 
-    status = sqlite3_bind_text (fs->sdbDeleteStmt, 1, type, -1, SQLITE_STATIC);
+    status = sqlite3_bind_int64 (fs->sdbDeleteStmt, 1, entityType->sdbType);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
-    status = sqlite3_bind_text (fs->sdbDeleteStmt, 2, hash, -1, SQLITE_STATIC);
+    status = sqlite3_bind_blob (fs->sdbDeleteStmt, 2, identifier.u8, sizeof (UInt256), SQLITE_STATIC);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
@@ -825,18 +1433,16 @@ fileServiceClearForType (BRFileService fs,
                          BRFileServiceEntityType *entityType,
                          int needLock) {
 #if !defined(NEUTER_FILE_SERVICE)
-    const char *type = entityType->type;
-
     sqlite3_status_code status;
 
-    if (needLock) pthread_mutex_lock (&fs->lock);
+    if (needLock) fileServiceLock (fs);
     if (fs->sdbClosed)
         return fileServiceFailedImpl (fs, needLock, NULL, NULL, "closed");
 
     sqlite3_reset (fs->sdbDeleteAllTypeStmt);
     sqlite3_clear_bindings (fs->sdbDeleteAllTypeStmt);
 
-    status = sqlite3_bind_text (fs->sdbDeleteAllTypeStmt, 1, type, -1, SQLITE_STATIC);
+    status = sqlite3_bind_int64 (fs->sdbDeleteAllTypeStmt, 1, entityType->sdbType);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, needLock, status);
 
@@ -874,6 +1480,11 @@ fileServiceClearAll (BRFileService fs) {
 
 static int
 fileServiceReplaceFailed (BRFileService fs, int needUnlock) {
+#if !defined(NEUTER_FILE_SERVICE)
+    // Roll back the partial replace (or doom the enclosing batch)
+    fs->batchFailed = true;
+    _fileServiceBatchCommit (fs);
+#endif
     if (needUnlock) pthread_mutex_unlock (&fs->lock);
     return 0;
 }
@@ -890,11 +1501,11 @@ fileServiceReplace (BRFileService fs,
 #if !defined(NEUTER_FILE_SERVICE)
     sqlite3_status_code status;
 
-    pthread_mutex_lock (&fs->lock);
+    fileServiceLock (fs);
     if (fs->sdbClosed)
         return fileServiceFailedImpl (fs, 1, NULL, NULL, "closed");
 
-    status = sqlite3_exec (fs->sdb, "BEGIN", NULL, NULL, NULL);
+    status = _fileServiceBatchBegin (fs);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
@@ -905,7 +1516,7 @@ fileServiceReplace (BRFileService fs,
         if (0 == _fileServiceSave (fs, type, entities[index], 0))
             return fileServiceReplaceFailed (fs, 1);
 
-    status = sqlite3_exec (fs->sdb, "COMMIT", NULL, NULL, NULL);
+    status = _fileServiceBatchCommit (fs);
     if (SQLITE_OK != status)
         return fileServiceFailedSDB (fs, 1, status);
 
@@ -927,6 +1538,16 @@ fileServiceWipe (const char *basePath,
 
     // Remove it.
     result  = (0 == remove (sdbPath) ? 0 : errno);
+
+    // Remove any write-ahead log and its index, which exist in FILE_SERVICE_JOURNAL_MODE_WAL
+    // if the DB was not cleanly closed.
+    const char *sdbSuffixes[] = { "-wal", "-shm" };
+    for (size_t index = 0; index < sizeof (sdbSuffixes) / sizeof (char *); index++) {
+        char *sdbAuxPath = malloc (strlen (sdbPath) + strlen (sdbSuffixes[index]) + 1);
+        sprintf (sdbAuxPath, "%s%s", sdbPath, sdbSuffixes[index]);
+        if (0 != remove (sdbAuxPath) && ENOENT != errno && 0 == result) result = errno;
+        free (sdbAuxPath);
+    }
     free (sdbPath);
 #endif
 
@@ -962,6 +1583,10 @@ fileServiceDefineType (BRFileService fs,
     if (NULL == entityType)
         entityType = fileServiceAddType (fs, type, version);
 
+    // If one couldn't be created, the failure has been reported
+    if (NULL == entityType)
+        return 0;
+
     // Create a handler for the entity
     BRFileServiceEntityHandler newEntityHander = {
         version,
@@ -28,6 +28,7 @@
 
 #include <stdlib.h>
 #include "BRSet.h"
+#include "BRArray.h"
 #include "BRInt.h"
 
 // Both Bitcoin and Ethereum Wallet Managers include the ability to save and load peers, block,
@@ -128,6 +129,59 @@ fileServiceLoad (BRFileService fs,
                  const char *type,   /* blocks, peers, transactions, logs, ... */
                  int updateVersion);
 
+/**
+ * A function type to receive each entity loaded by fileServiceLoadEach().  You own the entity.
+ * This is called with `fs` locked; it must not itself use `fs`.
+ *
+ * @return true (1) to continue loading, false (0) to stop.
+ */
+typedef int
+(*BRFileServiceLoadHandler) (BRFileServiceContext context,
+                             BRFileService fs,
+                             void *entity);
+
+/**
+ * Load all entities of `type`, one at a time, passing each to `handler`.  Unlike
+ * fileServiceLoad() no collection of entities is built; memory is bounded by the largest entity.
+ * If there is an error then the fileServices' error handler is invoked and 0 is returned; entities
+ * already passed to `handler` remain owned by it.
+ *
+ * @param fs The fileService
+ * @param type The type to restore
+ * @param updateVersion If true (1) update old versions with newer ones.
+ * @param context An arbitrary value passed to `handler`
+ * @param handler The function receiving each entity
+ *
+ * @return true (1) if success, false (0) otherwise;
+ */
+extern int
+fileServiceLoadEach (BRFileService fs,
+                     const char *type,
+                     int updateVersion,
+                     BRFileServiceContext context,
+                     BRFileServiceLoadHandler handler);
+
+/**
+ * Load the identifiers of all entities of `type`, without reading any entity.  Along with
+ * fileServiceLoadEntity() this allows entities to be loaded lazily, on demand.
+ *
+ * @return an array of identifiers, which you own, or NULL on an error.
+ */
+extern BRArrayOf(UInt256)
+fileServiceLoadIdentifiers (BRFileService fs,
+                            const char *type);
+
+/**
+ * Load the one entity of `type` with `identifier`.
+ *
+ * @return the entity, which you own, or NULL if there is no such entity or on an error.
+ */
+extern void *
+fileServiceLoadEntity (BRFileService fs,
+                       const char *type,
+                       UInt256 identifier,
+                       int updateVersion);
+
 extern int  // 1 -> success, 0 -> failure
 fileServiceSave (BRFileService fs,
                  const char *type,  /* block, peers, transactions, logs, ... */
@@ -144,6 +198,70 @@ fileServiceReplace (BRFileService fs,
                     const void **entities,
                     size_t entitiesCount);
 
+/**
+ * Save all of `entities` of `type` in a single DB transaction.  If `fs` is within a batch (see
+ * fileServiceBeginBatch()) the entities are saved as part of that batch.  On failure none of the
+ * entities are saved, unless within a batch, in which case the batch itself is rolled back.
+ *
+ * @return true (1) if success, false (0) otherwise
+ */
+extern int
+fileServiceSaveMany (BRFileService fs,
+                     const char *type,
+                     const void **entities,
+                     size_t entitiesCount);
+
+/**
+ * Begin a batch of writes.  Until the matching fileServiceCommitBatch(), every save, remove,
+ * replace and clear on `fs` is part of one DB transaction and thus costs a single commit (and a
+ * single fsync) rather than one apiece.  Batches nest; only the outermost commit writes.  The
+ * batch belongs to the calling thread: until it commits, any use of `fs` on another thread waits,
+ * so only this thread's writes join the batch and only its failures roll the batch back.
+ *
+ * @return true (1) if success, false (0) otherwise
+ */
+extern int
+fileServiceBeginBatch (BRFileService fs);
+
+/**
+ * Commit a batch begun with fileServiceBeginBatch().  If any write within the (outermost) batch
+ * failed then the batch is rolled back and 0 is returned.
+ *
+ * @return true (1) if success, false (0) otherwise
+ */
+extern int
+fileServiceCommitBatch (BRFileService fs);
+
+typedef enum {
+    FILE_SERVICE_JOURNAL_MODE_DELETE,   // SQLite default; a rollback journal
+    FILE_SERVICE_JOURNAL_MODE_WAL       // write-ahead log; readers don't block the writer
+} BRFileServiceJournalMode;
+
+typedef enum {
+    FILE_SERVICE_SYNCHRONOUS_OFF,       // no fsync; a power loss can corrupt the DB
+    FILE_SERVICE_SYNCHRONOUS_NORMAL,    // with WAL, fsync only at checkpoints; durable but may lose a commit
+    FILE_SERVICE_SYNCHRONOUS_FULL       // SQLite default; fsync on every commit
+} BRFileServiceSynchronous;
+
+/**
+ * Set the journal mode of the DB underlying `fs`.  Cannot be changed within a batch.
+ *
+ * @return true (1) if success, false (0) otherwise
+ */
+extern int
+fileServiceSetJournalMode (BRFileService fs,
+                           BRFileServiceJournalMode mode);
+
+/**
+ * Set the synchronous level of the DB underlying `fs`.  Cannot be changed within a batch.  With
+ * FILE_SERVICE_JOURNAL_MODE_WAL, FILE_SERVICE_SYNCHRONOUS_NORMAL is the typical choice.
+ *
+ * @return true (1) if success, false (0) otherwise
+ */
+extern int
+fileServiceSetSynchronous (BRFileService fs,
+                           BRFileServiceSynchronous level);
+
 extern int
 fileServiceClear (BRFileService fs,
                   const char *type);
@@ -26,6 +26,7 @@
 #include "BRBase.h"
 #include "BRBase58.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>             // getpid()
@@ -126,6 +127,64 @@ int BRSecp256k1PointAdd(BRECPoint *p, const UInt256 *i)
             secp256k1_ec_pubkey_serialize(_ctx, (unsigned char *)p, &pLen, &pubkey, SECP256K1_EC_COMPRESSED));
 }
 
+// multiplies secp256k1 generator by each 256bit big endian int in i, adds ec-point p, and stores the results in points
+// p is only decompressed once, and all results share a single field inversion for the conversion to affine coordinates
+// results for an i that isn't a valid scalar, or that sum to the point at infinity, are left equal to p
+// returns the number of valid results
+size_t BRSecp256k1PointAddList(BRECPoint points[], const BRECPoint *p, const UInt256 i[], size_t count)
+{
+    secp256k1_ge P, r;
+    secp256k1_gej *R;
+    secp256k1_fe *z, zinv, t;
+    secp256k1_scalar s;
+    size_t j, len, n = 0;
+    int overflow;
+
+    assert(points != NULL || count == 0);
+    assert(p != NULL);
+    assert(i != NULL || count == 0);
+    pthread_once(&_ctx_once, _ctx_init);
+    if (count == 0 || ! secp256k1_eckey_pubkey_parse(&P, (const unsigned char *)p, sizeof(*p))) return 0;
+    R = malloc(count*sizeof(*R));
+    z = malloc(count*sizeof(*z));
+    assert(R != NULL && z != NULL);
+
+    for (j = 0; j < count; j++) { // R[j] = P(i[j]) + p, z[j] = product of z coordinates of R[0..j]
+        secp256k1_scalar_set_b32(&s, i[j].u8, &overflow);
+
+        if (overflow) secp256k1_gej_set_infinity(&R[j]);
+        else {
+            secp256k1_ecmult_gen(&_ctx->ecmult_gen_ctx, &R[j], &s);
+            secp256k1_gej_add_ge_var(&R[j], &R[j], &P, NULL);
+        }
+
+        if (j == 0) secp256k1_fe_set_int(&z[j], 1);
+        else z[j] = z[j - 1];
+        if (! secp256k1_gej_is_infinity(&R[j])) secp256k1_fe_mul(&z[j], &z[j], &R[j].z);
+    }
+
+    secp256k1_fe_inv_var(&zinv, &z[count - 1]); // zinv = 1/(z[0]*z[1]*...*z[count - 1])
+
+    for (j = count; j > 0; j--) { // walk back, peeling off one z coordinate at a time
+        if (secp256k1_gej_is_infinity(&R[j - 1])) {
+            points[j - 1] = *p;
+            continue;
+        }
+
+        if (j > 1) secp256k1_fe_mul(&t, &zinv, &z[j - 2]); // t = 1/R[j - 1].z
+        else t = zinv;
+        secp256k1_fe_mul(&zinv, &zinv, &R[j - 1].z);
+        secp256k1_ge_set_gej_zinv(&r, &R[j - 1], &t);
+        len = sizeof(points[j - 1]);
+        if (secp256k1_eckey_pubkey_serialize(&r, points[j - 1].p, &len, 1)) n++;
+        else points[j - 1] = *p;
+    }
+
+    free(z);
+    free(R);
+    return n;
+}
+
 // multiplies secp256k1 ec-point p by 256bit big endian int i and stores the result in p
 // returns true on success
 int BRSecp256k1PointMul(BRECPoint *p, const UInt256 *i)
@@ -358,7 +417,7 @@ size_t BRKeyLegacyAddr(BRKey *key, char *addr, size_t addrLen, BRAddressParams p
     UInt160Set(&data[1], hash);
 
     if (! UInt160IsZero(hash)) {
-        addrLen = BRBase58CheckEncode(addr, addrLen, data, sizeof(data));
+        addrLen = BRBase58CheckEncodePublic(addr, addrLen, data, sizeof(data));
     }
     else addrLen = 0;
     
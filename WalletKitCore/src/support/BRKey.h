@@ -59,6 +59,12 @@ int BRSecp256k1PointGen(BRECPoint *p, const UInt256 *i);
 // returns true on success
 int BRSecp256k1PointAdd(BRECPoint *p, const UInt256 *i);
 
+// multiplies secp256k1 generator by each 256bit big endian int in i, adds ec-point p, and stores the results in points
+// this is much faster than calling BRSecp256k1PointAdd() count times
+// results for an i that isn't a valid scalar, or that sum to the point at infinity, are left equal to p
+// returns the number of valid results
+size_t BRSecp256k1PointAddList(BRECPoint points[], const BRECPoint *p, const UInt256 i[], size_t count);
+
 // multiplies secp256k1 ec-point p by 256bit big endian int i and stores the result in p
 // returns true on success
 int BRSecp256k1PointMul(BRECPoint *p, const UInt256 *i);